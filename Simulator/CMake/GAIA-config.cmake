@@ -2,12 +2,25 @@ cmake_minimum_required(VERSION 3.13 FATAL_ERROR)
 
 message( "Adding GAIA." )
 
-set(CMAKE_CUDA_ARCHITECTURES 75;80;86)
+option (GAIA_WITH_CUDA
+       "Build the CUDA solvers. When OFF, GPU paths are compiled out and the CUDA runtime is emulated on the host." ON)
 
 find_package(Eigen3 REQUIRED)
 find_package(MeshFrame2 REQUIRED PATHS ${CMAKE_CURRENT_LIST_DIR}/../3rdParty/MeshFrame2/MeshFrame/cmake)
 find_package(embree 3.0 REQUIRED)
-find_package(CuMatrix REQUIRED PATHS ${CMAKE_CURRENT_LIST_DIR}/../3rdParty/CuMatrix/cmake)
+if (GAIA_WITH_CUDA)
+	set(CMAKE_CUDA_ARCHITECTURES 75;80;86)
+	find_package(CUDAToolkit 11 REQUIRED)
+	enable_language(CUDA)
+	find_package(CuMatrix REQUIRED PATHS ${CMAKE_CURRENT_LIST_DIR}/../3rdParty/CuMatrix/cmake)
+else()
+	# CuMatrix is header only, its host functions are usable without the CUDA toolkit
+	set(CU_MATRIX_INCLUDE_DIR
+		${CMAKE_CURRENT_LIST_DIR}/../Modules/CudaCompat
+		${CMAKE_CURRENT_LIST_DIR}/../3rdParty/CuMatrix
+	)
+	set(CU_MATRIX_LIBS)
+endif (GAIA_WITH_CUDA)
 find_package(TBB REQUIRED)
 set (GAIA_ROOT ${CMAKE_CURRENT_LIST_DIR}/..)
 	
@@ -28,9 +41,26 @@ option (BUILD_GUI
 	   
 option (BUILD_Collision_Detector
        "Build Collision Detectors Modules." ON)
+
+option (GAIA_WITH_PROFILER
+       "Compile the profiler scopes in. When OFF, GAIA_PROFILE_SCOPE expands to nothing." ON)
 	   
 set(GAIA_DEFINITIONS)
 
+if (NOT GAIA_WITH_CUDA)
+	message("GAIA: Build without CUDA, GPU solvers are disabled!\n")
+	set(GAIA_DEFINITIONS
+		${GAIA_DEFINITIONS}
+		GAIA_NO_CUDA
+	)
+endif (NOT GAIA_WITH_CUDA)
+
+if (NOT GAIA_WITH_PROFILER)
+	set(GAIA_DEFINITIONS
+		${GAIA_DEFINITIONS}
+		GAIA_NO_PROFILER
+	)
+endif (NOT GAIA_WITH_PROFILER)
 
 
 set(THIRD_PARTY_INCLUDE_DIRS
@@ -105,6 +135,8 @@ file(GLOB GAIA_SRCS
 	"${CMAKE_CURRENT_LIST_DIR}/../Modules/VersionTracker/*.cpp"
 	"${CMAKE_CURRENT_LIST_DIR}/../Modules/IO/*.h"
 	"${CMAKE_CURRENT_LIST_DIR}/../Modules/IO/*.cpp"
+	"${CMAKE_CURRENT_LIST_DIR}/../Modules/Timer/*.h"
+	"${CMAKE_CURRENT_LIST_DIR}/../Modules/Timer/*.cpp"
 	"${CMAKE_CURRENT_LIST_DIR}/../Modules/Framework/*.h"
 	"${CMAKE_CURRENT_LIST_DIR}/../Modules/Framework/*.cpp"
 	"${CMAKE_CURRENT_LIST_DIR}/../Modules/common/math/constants.cpp"
@@ -127,6 +159,12 @@ file(GLOB GAIA_COLORING_SRCS
 
 list(REMOVE_ITEM GAIA_COLLISION_SRCS "${CMAKE_CURRENT_SOURCE_DIR}/${CMAKE_CURRENT_LIST_DIR}/../Modules/CollisionDetector/TetMeshContactDetector.h" "${CMAKE_CURRENT_SOURCE_DIR}/${CMAKE_CURRENT_LIST_DIR}/../Modules/CollisionDetector/TetMeshContactDetector.cpp")
 
+# the tet meshes color their vertex graph at load time when no coloring file is given
+SET (GAIA_SRCS 
+	${GAIA_SRCS}
+	${GAIA_COLORING_SRCS}
+)
+
 if (BUILD_VBD)
 message("GAIA: Build with VBD components!\n")
 SET (GAIA_SRCS 
@@ -160,6 +198,9 @@ SET (GAIA_SRCS
 )
 endif (BUILD_VBD_Cloth)
 
+if (NOT GAIA_WITH_CUDA)
+	list(FILTER GAIA_SRCS EXCLUDE REGEX ".*\\.cuh?$")
+endif (NOT GAIA_WITH_CUDA)
 
 
 set (GAIA_LIBRARY
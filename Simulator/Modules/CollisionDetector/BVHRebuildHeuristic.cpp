@@ -0,0 +1,158 @@
+#include "BVHRebuildHeuristic.h"
+#include "../Parallelization/CPUParallelization.h"
+
+#include <iostream>
+
+using namespace GAIA;
+
+void GAIA::BVHRebuildHeuristic::initialize(const std::vector<std::shared_ptr<TetMeshFEM>>& in_tMeshes, bool in_surfaceOnly,
+	FloatingType in_maxQueryCostRatio, bool in_logDecisions, const std::string& in_name)
+{
+	tMeshes = in_tMeshes;
+	surfaceOnly = in_surfaceOnly;
+	maxQueryCostRatio = in_maxQueryCostRatio;
+	logDecisions = in_logDecisions;
+	name = in_name;
+
+	verticesAtRebuild.resize(tMeshes.size());
+	meshDiagonals.assign(tMeshes.size(), 0.f);
+	meshNumPrimitives.resize(tMeshes.size());
+	numPrimitivesTotal = 0;
+	for (size_t iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+	{
+		meshNumPrimitives[iMesh] = surfaceOnly ? tMeshes[iMesh]->numSurfaceFaces() : tMeshes[iMesh]->numTets();
+		numPrimitivesTotal += meshNumPrimitives[iMesh];
+	}
+
+	rebuildTime = -1.0;
+	refitTime = 0.0;
+	queryTimeSinceUpdate = 0.0;
+	costRatioAtUpdate = 1.f;
+	extraQueryTimeSinceRebuild = 0.0;
+	lastCostRatio = 1.f;
+	numRebuilds = 0;
+	numRefits = 0;
+}
+
+bool GAIA::BVHRebuildHeuristic::needsRebuild()
+{
+	bool rebuild;
+	const char* reason;
+	lastCostRatio = estimateQueryCostRatio();
+	if (rebuildTime < 0)
+	{
+		rebuild = true;
+		reason = "rebuild time not measured yet";
+	}
+	else if (lastCostRatio > maxQueryCostRatio)
+	{
+		rebuild = true;
+		reason = "query cost ratio over the limit";
+	}
+	else if (extraQueryTimeSinceRebuild > rebuildTime - refitTime)
+	{
+		rebuild = true;
+		reason = "extra query time over the extra rebuild time";
+	}
+	else
+	{
+		rebuild = false;
+		reason = "extra query time under the extra rebuild time";
+	}
+
+	if (logDecisions)
+	{
+		std::cout << "[BVH] " << name << (rebuild ? ": rebuild" : ": refit")
+			<< ", estimated query cost ratio: " << lastCostRatio
+			<< ", query time since update: " << queryTimeSinceUpdate << "ms"
+			<< ", extra query time since rebuild: " << extraQueryTimeSinceRebuild << "ms"
+			<< ", rebuild time: " << rebuildTime << "ms, refit time: " << refitTime << "ms"
+			<< " (" << reason << ")\n";
+	}
+
+	return rebuild;
+}
+
+void GAIA::BVHRebuildHeuristic::recordUpdate(bool rebuilt, double time)
+{
+	if (rebuilt)
+	{
+		rebuildTime = time;
+		numRebuilds++;
+
+		for (size_t iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+		{
+			TetMeshFEM* pTM = tMeshes[iMesh].get();
+			verticesAtRebuild[iMesh] = pTM->mVertPos;
+			if (pTM->numVertices())
+			{
+				Vec3 lower = pTM->positions().rowwise().minCoeff();
+				Vec3 upper = pTM->positions().rowwise().maxCoeff();
+				meshDiagonals[iMesh] = (upper - lower).norm();
+			}
+		}
+		costRatioAtUpdate = 1.f;
+		extraQueryTimeSinceRebuild = 0.0;
+	}
+	else
+	{
+		refitTime = time;
+		numRefits++;
+		costRatioAtUpdate = lastCostRatio;
+	}
+	queryTimeSinceUpdate = 0.0;
+}
+
+void GAIA::BVHRebuildHeuristic::recordQueryTime(double time)
+{
+	queryTimeSinceUpdate += time;
+	// the part of the query time caused by the degradation of the refitted BVH
+	extraQueryTimeSinceRebuild += time * (costRatioAtUpdate - 1.f) / costRatioAtUpdate;
+}
+
+FloatingType GAIA::BVHRebuildHeuristic::estimateQueryCostRatio()
+{
+	std::vector<FloatingType> meshCostRatios(tMeshes.size(), 1.f);
+	auto meshCostRatio = [&](int iMesh) {
+		TetMeshFEM* pTM = tMeshes[iMesh].get();
+		if (!pTM->activeForCollision || meshDiagonals[iMesh] <= 0.f
+			|| verticesAtRebuild[iMesh].cols() != pTM->mVertPos.cols())
+		{
+			return;
+		}
+
+		// the spread of the displacements around their mean: sqrt(E[|d|^2] - |E[d]|^2)
+		size_t numVerts = surfaceOnly ? pTM->surfaceVIds().size() : pTM->numVertices();
+		Vec3 displacementSum = Vec3::Zero();
+		FloatingType displacementSquaredNormSum = 0.f;
+		for (size_t iV = 0; iV < numVerts; iV++)
+		{
+			IdType vId = surfaceOnly ? pTM->surfaceVIds()(iV) : iV;
+			Vec3 displacement = pTM->mVertPos.col(vId) - verticesAtRebuild[iMesh].col(vId);
+			displacementSum += displacement;
+			displacementSquaredNormSum += displacement.squaredNorm();
+		}
+
+		if (numVerts)
+		{
+			Vec3 displacementMean = displacementSum / numVerts;
+			FloatingType spread = sqrt(std::max(displacementSquaredNormSum / numVerts - displacementMean.squaredNorm(), (FloatingType)0));
+			FloatingType nodeGrowth = 1.f + 2.f * spread / meshDiagonals[iMesh];
+			meshCostRatios[iMesh] = nodeGrowth * nodeGrowth * nodeGrowth;
+		}
+	};
+	cpu_parallel_for(0, (int)tMeshes.size(), meshCostRatio);
+
+	FloatingType costRatioSum = 0.f;
+	size_t numPrimitivesActive = 0;
+	for (size_t iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+	{
+		if (tMeshes[iMesh]->activeForCollision)
+		{
+			costRatioSum += meshCostRatios[iMesh] * meshNumPrimitives[iMesh];
+			numPrimitivesActive += meshNumPrimitives[iMesh];
+		}
+	}
+
+	return numPrimitivesActive ? costRatioSum / numPrimitivesActive : 1.f;
+}
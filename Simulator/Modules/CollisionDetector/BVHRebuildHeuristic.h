@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../TetMesh/TetMeshFEM.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace GAIA {
+	// decides whether a BVH over a set of meshes is refitted or rebuilt
+	// a refitted BVH keeps the topology of the last rebuild, its node bounds grow with the relative motion of the primitives under each node;
+	// to the first order, the relative growth of the nodes of a mesh is 2 * delta / L, where delta is the spread of the vertex displacements
+	// since the last rebuild around their mean and L is the diagonal of the mesh at the last rebuild;
+	// the cost of a point query scales with the bound volumes, so the estimated query cost ratio of the refitted BVH over a rebuilt one is
+	// the primitive weighted mean of (1 + 2 * delta / L)^3
+	// the extra query time caused by the refits is accumulated since the last rebuild, and the BVH is rebuilt once it exceeds the extra
+	// time of a rebuild over a refit, i.e. the rent-or-buy rule; the ratio is also capped by maxQueryCostRatio
+	struct BVHRebuildHeuristic
+	{
+		// the primitives are the tets of each mesh, or the surface faces with surfaceOnly
+		void initialize(const std::vector<std::shared_ptr<TetMeshFEM>>& in_tMeshes, bool in_surfaceOnly,
+			FloatingType in_maxQueryCostRatio, bool in_logDecisions, const std::string& in_name);
+
+		// call before each update of the BVH, also logs the decision
+		bool needsRebuild();
+		// time: the time of the update in ms; a rebuild takes the snapshot of the vertices the motion is measured from
+		void recordUpdate(bool rebuilt, double time);
+		// time: the time in ms spent in the queries of the BVH since its last update
+		void recordQueryTime(double time);
+
+		FloatingType estimateQueryCostRatio();
+		size_t numPrimitives() const { return numPrimitivesTotal; }
+
+		std::vector<std::shared_ptr<TetMeshFEM>> tMeshes;
+		bool surfaceOnly = false;
+		FloatingType maxQueryCostRatio = 4.f;
+		bool logDecisions = false;
+		std::string name;
+
+		// nMeshes, the vertices at the last rebuild
+		std::vector<TVerticesMat> verticesAtRebuild;
+		// nMeshes, the diagonal of the AABB of each mesh at the last rebuild
+		std::vector<FloatingType> meshDiagonals;
+		// nMeshes
+		std::vector<size_t> meshNumPrimitives;
+		size_t numPrimitivesTotal = 0;
+
+		// in ms, negative before the first measurement
+		double rebuildTime = -1.0;
+		double refitTime = 0.0;
+		double queryTimeSinceUpdate = 0.0;
+		// the query cost ratio when the BVH was last updated, the query time of a rebuilt BVH is queryTime / costRatioAtUpdate
+		FloatingType costRatioAtUpdate = 1.f;
+		double extraQueryTimeSinceRebuild = 0.0;
+
+		// the estimate of the last call to needsRebuild
+		FloatingType lastCostRatio = 1.f;
+
+		size_t numRebuilds = 0;
+		size_t numRefits = 0;
+	};
+}
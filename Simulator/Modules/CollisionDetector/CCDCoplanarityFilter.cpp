@@ -0,0 +1,66 @@
+#include "CCDCoplanarityFilter.h"
+#include "../common/simd/simd.h"
+
+using namespace GAIA;
+
+unsigned int GAIA::CCDCoplanarityFilter::filterBatch(const FloatingType x0SoA[4][3][CCD_SIMD_WIDTH], const FloatingType x1SoA[4][3][CCD_SIMD_WIDTH])
+{
+	typedef embree::vfloat<CCD_SIMD_WIDTH> vfloatN;
+
+	// relative to point 0, as in cy::MovingPointsPlanar: e[i] = x0[i + 1] - x0[0], de[i] = dx[i + 1] - dx[0]
+	vfloatN e[3][3], de[3][3];
+	// bounds the magnitude of every input of the cubic; includes the displacements, since de is computed from them
+	vfloatN M = vfloatN(embree::zero);
+	for (int iDim = 0; iDim < 3; iDim++)
+	{
+		const vfloatN x00 = vfloatN::load(x0SoA[0][iDim]);
+		const vfloatN dx0 = vfloatN::load(x1SoA[0][iDim]) - x00;
+		M = max(M, abs(dx0));
+		for (int iPt = 1; iPt < 4; iPt++)
+		{
+			const vfloatN xi0 = vfloatN::load(x0SoA[iPt][iDim]);
+			const vfloatN dxi = vfloatN::load(x1SoA[iPt][iDim]) - xi0;
+			e[iPt - 1][iDim] = xi0 - x00;
+			de[iPt - 1][iDim] = dxi - dx0;
+			M = max(M, max(abs(e[iPt - 1][iDim]), max(abs(dxi), abs(de[iPt - 1][iDim]))));
+		}
+	}
+
+	auto cross = [](const vfloatN a[3], const vfloatN b[3], vfloatN c[3]) {
+		c[0] = a[1] * b[2] - a[2] * b[1];
+		c[1] = a[2] * b[0] - a[0] * b[2];
+		c[2] = a[0] * b[1] - a[1] * b[0];
+	};
+	auto dot = [](const vfloatN a[3], const vfloatN b[3]) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	};
+
+	vfloatN e1xe2[3], de1xde2[3], e1xde2[3], de1xe2[3], dde1xe2[3];
+	cross(e[0], e[1], e1xe2);
+	cross(de[0], de[1], de1xde2);
+	cross(e[0], de[1], e1xde2);
+	cross(de[0], e[1], de1xe2);
+	for (int iDim = 0; iDim < 3; iDim++)
+	{
+		dde1xe2[iDim] = e1xde2[iDim] + de1xe2[iDim];
+	}
+
+	// the coplanarity cubic p0 + p1 * t + p2 * t^2 + p3 * t^3
+	const vfloatN p0 = dot(e[2], e1xe2);
+	const vfloatN p1 = dot(de[2], e1xe2) + dot(e[2], dde1xe2);
+	const vfloatN p2 = dot(e[2], de1xde2) + dot(de[2], dde1xe2);
+	const vfloatN p3 = dot(de[2], de1xde2);
+
+	// its Bernstein coefficients on [0, 1]; the cubic is within the convex hull of them
+	const vfloatN b0 = p0;
+	const vfloatN b1 = p0 + p1 * (1.f / 3.f);
+	const vfloatN b2 = p0 + p1 * (2.f / 3.f) + p2 * (1.f / 3.f);
+	const vfloatN b3 = p0 + p1 + p2 + p3;
+
+	const vfloatN errorBound = vfloatN(CCD_FILTER_ERROR_FACTOR) * M * M * M;
+	const vfloatN negErrorBound = -errorBound;
+	const auto allPositive = (b0 > errorBound) & (b1 > errorBound) & (b2 > errorBound) & (b3 > errorBound);
+	const auto allNegative = (b0 < negErrorBound) & (b1 < negErrorBound) & (b2 < negErrorBound) & (b3 < negErrorBound);
+
+	return (unsigned int)movemask(!(allPositive | allNegative));
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "../Types/Types.h"
+#include "../Parallelization/CPUParallelization.h"
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+// number of CCD candidates filtered at once: AVX's vfloat8 or SSE's vfloat4
+#if defined(__AVX__)
+#define CCD_SIMD_WIDTH 8
+#else
+#define CCD_SIMD_WIDTH 4
+#endif
+
+// the filter rejects a candidate only if the Bernstein coefficients of its coplanarity cubic all have the same sign and exceed
+// CCD_FILTER_ERROR_FACTOR * M^3 in magnitude, where M bounds the coordinates of the relative positions and the displacements;
+// this covers the rounding errors of the single precision evaluation with a wide margin
+#define CCD_FILTER_ERROR_FACTOR 1.2e-4f
+
+namespace GAIA {
+	// a candidate pair of the CCD from the rtcCollide callbacks: primitive primId0 of geometry geomId0 against primitive primId1 of geometry geomId1
+	struct CCDCandidate {
+		int geomId0;
+		int primId0;
+		int geomId1;
+		int primId1;
+	};
+
+	// both the v-f and the e-e CCD first solve for the times when the 4 moving points are coplanar, i.e., the roots of a cubic in [0, 1];
+	// most of the candidates from the BVH never become coplanar within the step, which the convex hull property of the Bernstein form of the
+	// cubic shows without solving it; the filter evaluates this in single precision on CCD_SIMD_WIDTH candidates at once, in SoA batches,
+	// and only keeps the ambiguous candidates, which go through the scalar solvers of CCDSolver.h
+	struct CCDCoplanarityFilter
+	{
+		// gatherFunc(const CCDCandidate& candidate, Vec3 x0[4], Vec3 x1[4]): the 4 points of the candidate at the beginning (x0) and the end (x1)
+		// of the step: the 3 face vertices and the vertex for v-f, the 2 vertices of the 1st edge and the 2 vertices of the 2nd edge for e-e
+		// the indices of the candidates that may collide are written to survivingCandidates in increasing order
+		template<typename GatherFunc>
+		void filter(const CCDCandidate* candidates, size_t numCandidates, GatherFunc& gatherFunc);
+
+		// solveFunc(const CCDCandidate& candidate, bool record): solves the candidate with the scalar solver, returns whether it collides,
+		// and records the collision if record is true
+		template<typename SolveFunc>
+		void solveSurvivingCandidates(const CCDCandidate* candidates, SolveFunc& solveFunc);
+
+		// solves the candidates rejected by the last filter call without recording them and prints how many of them collide, which must be 0
+		template<typename SolveFunc>
+		void validate(const CCDCandidate* candidates, SolveFunc& solveFunc, const char* name);
+
+		// the lane mask of the candidates whose coplanarity cubic may have a root in [0, 1]
+		static unsigned int filterBatch(const FloatingType x0SoA[4][3][CCD_SIMD_WIDTH], const FloatingType x1SoA[4][3][CCD_SIMD_WIDTH]);
+
+		// nCandidates, whether each candidate may collide
+		std::vector<uint8_t> mayCollide;
+		std::vector<int> survivingCandidates;
+
+		// accumulated over all the calls of filter
+		size_t numCandidatesFiltered = 0;
+		size_t numCandidatesSurvived = 0;
+	};
+
+	template<typename GatherFunc>
+	inline void CCDCoplanarityFilter::filter(const CCDCandidate* candidates, size_t numCandidates, GatherFunc& gatherFunc)
+	{
+		const int numBatches = int((numCandidates + CCD_SIMD_WIDTH - 1) / CCD_SIMD_WIDTH);
+		mayCollide.resize(numCandidates);
+
+		auto filterBatchFunc = [&](int iBatch) {
+			alignas(64) FloatingType x0SoA[4][3][CCD_SIMD_WIDTH];
+			alignas(64) FloatingType x1SoA[4][3][CCD_SIMD_WIDTH];
+			const size_t iStart = size_t(iBatch) * CCD_SIMD_WIDTH;
+			const int numLanes = int(std::min(size_t(CCD_SIMD_WIDTH), numCandidates - iStart));
+
+			Vec3 x0[4], x1[4];
+			for (int iLane = 0; iLane < CCD_SIMD_WIDTH; iLane++)
+			{
+				// the padding lanes repeat the first candidate of the batch
+				gatherFunc(candidates[iStart + (iLane < numLanes ? iLane : 0)], x0, x1);
+				for (int iPt = 0; iPt < 4; iPt++)
+				{
+					for (int iDim = 0; iDim < 3; iDim++)
+					{
+						x0SoA[iPt][iDim][iLane] = x0[iPt](iDim);
+						x1SoA[iPt][iDim][iLane] = x1[iPt](iDim);
+					}
+				}
+			}
+
+			const unsigned int mask = filterBatch(x0SoA, x1SoA);
+			for (int iLane = 0; iLane < numLanes; iLane++)
+			{
+				mayCollide[iStart + iLane] = (mask >> iLane) & 1;
+			}
+		};
+		cpu_parallel_for(0, numBatches, filterBatchFunc);
+
+		survivingCandidates.clear();
+		for (size_t iCandidate = 0; iCandidate < numCandidates; iCandidate++)
+		{
+			if (mayCollide[iCandidate])
+			{
+				survivingCandidates.push_back(int(iCandidate));
+			}
+		}
+
+		numCandidatesFiltered += numCandidates;
+		numCandidatesSurvived += survivingCandidates.size();
+	}
+
+	template<typename SolveFunc>
+	inline void CCDCoplanarityFilter::solveSurvivingCandidates(const CCDCandidate* candidates, SolveFunc& solveFunc)
+	{
+		auto solveSurvivingCandidate = [&](int iSurvivor) {
+			solveFunc(candidates[survivingCandidates[iSurvivor]], true);
+		};
+		cpu_parallel_for(0, (int)survivingCandidates.size(), solveSurvivingCandidate);
+	}
+
+	template<typename SolveFunc>
+	inline void CCDCoplanarityFilter::validate(const CCDCandidate* candidates, SolveFunc& solveFunc, const char* name)
+	{
+		std::atomic<int> numMissed = 0;
+		auto validateCandidate = [&](int iCandidate) {
+			if (!mayCollide[iCandidate] && solveFunc(candidates[iCandidate], false))
+			{
+				numMissed++;
+			}
+		};
+		cpu_parallel_for(0, (int)mayCollide.size(), validateCandidate);
+
+		std::cout << "[CCD filter] " << name << ": " << mayCollide.size() << " candidates, " << survivingCandidates.size()
+			<< " survived, " << numMissed << " collisions missed\n";
+		if (numMissed)
+		{
+			std::cout << "Error! The CCD filter rejected colliding candidates!\n";
+		}
+	}
+}
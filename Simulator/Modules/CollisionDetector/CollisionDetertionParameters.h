@@ -56,9 +56,24 @@ namespace GAIA {
 		bool restPoseCloestPoint = false;
 		bool loopLessTraverse = false;
 		int maxNumberOfCollisions = 1;
+		// start from the embracing tet and the closest face found for the vertex by the last DCD;
+		// the cached tet is only used with maxNumberOfCollisions == 1, since a local search cannot find all the embracing tets
+		bool dcdTemporalCoherence = true;
+		int dcdCoherenceWalkSteps = 4;
 
 		// CCD parameters
 		bool doEdgeEdgeCCD = false;
+		// collide the swept surface vertices with the swept surface faces in one rtcCollide call, instead of one point query per vertex
+		bool ccdBatchVertexFace = false;
+		// with ccdBatchVertexFace, also run the point query version and print the timings of both and the number of vertices
+		// whose results differ; for benchmarking only
+		bool ccdBatchBenchmark = false;
+		// buffer the rtcCollide candidates of the CCD and reject the ones that cannot become coplanar within the step with
+		// the SIMD filter of CCDCoplanarityFilter.h before the scalar solvers
+		bool ccdSIMDFilter = false;
+		// with ccdSIMDFilter, also solve the rejected candidates and print the number of collisions the filter missed,
+		// which should always be 0; for validation only
+		bool ccdSIMDFilterValidation = false;
 
 		bool shiftQueryPointToCenter = true;
 		float centerShiftLevel = 0.01f;
@@ -79,6 +94,18 @@ namespace GAIA {
 		// volumetric related collision
 		bool allowVolumetricCollision = false;
 
+		// BVH update: with adaptiveBVHRebuild the detectors choose between refitting and rebuilding their BVHs with BVHRebuildHeuristic,
+		// instead of the fixed rebuild intervals of the physics parameters
+		bool adaptiveBVHRebuild = true;
+		// a refitted BVH is rebuilt regardless of the timings once its estimated query cost exceeds this many times the one of a rebuilt BVH
+		float bvhMaxQueryCostRatio = 4.f;
+		bool logBVHRebuildDecisions = false;
+
+		// mesh level broad phase: the meshes are culled by their AABBs, swept from the previous positions for the CCD,
+		// and a surface vertex is only queried when it is in the AABB of a mesh it can collide with
+		// with handleSelfCollision every mesh is a partner of itself; without it, a mesh with no overlapping partner skips all its queries
+		bool meshBroadPhase = true;
+
 		virtual bool fromJson(nlohmann::json& collisionParam) {
 			EXTRACT_FROM_JSON(collisionParam, allowCCD);
 			EXTRACT_FROM_JSON(collisionParam, allowDCD);
@@ -88,8 +115,15 @@ namespace GAIA {
 			EXTRACT_FROM_JSON(collisionParam, handleSelfCollision);
 			EXTRACT_FROM_JSON(collisionParam, stopTraversingAfterPassingQueryPoint);
 			EXTRACT_FROM_JSON(collisionParam, maxNumberOfCollisions);
+			EXTRACT_FROM_JSON(collisionParam, dcdTemporalCoherence);
+			EXTRACT_FROM_JSON(collisionParam, dcdCoherenceWalkSteps);
 
 			EXTRACT_FROM_JSON(collisionParam, computeContactNormal);
+			EXTRACT_FROM_JSON(collisionParam, doEdgeEdgeCCD);
+			EXTRACT_FROM_JSON(collisionParam, ccdBatchVertexFace);
+			EXTRACT_FROM_JSON(collisionParam, ccdBatchBenchmark);
+			EXTRACT_FROM_JSON(collisionParam, ccdSIMDFilter);
+			EXTRACT_FROM_JSON(collisionParam, ccdSIMDFilterValidation);
 
 			EXTRACT_FROM_JSON(collisionParam, shiftQueryPointToCenter);
 			EXTRACT_FROM_JSON(collisionParam, centerShiftLevel);
@@ -104,6 +138,12 @@ namespace GAIA {
 
 			EXTRACT_FROM_JSON(collisionParam, allowVolumetricCollision);
 
+			EXTRACT_FROM_JSON(collisionParam, adaptiveBVHRebuild);
+			EXTRACT_FROM_JSON(collisionParam, bvhMaxQueryCostRatio);
+			EXTRACT_FROM_JSON(collisionParam, logBVHRebuildDecisions);
+
+			EXTRACT_FROM_JSON(collisionParam, meshBroadPhase);
+
 
 			return true;
 		}
@@ -117,8 +157,15 @@ namespace GAIA {
 			PUT_TO_JSON(collisionParam, handleSelfCollision);
 			PUT_TO_JSON(collisionParam, stopTraversingAfterPassingQueryPoint);
 			PUT_TO_JSON(collisionParam, maxNumberOfCollisions);
+			PUT_TO_JSON(collisionParam, dcdTemporalCoherence);
+			PUT_TO_JSON(collisionParam, dcdCoherenceWalkSteps);
 
 			PUT_TO_JSON(collisionParam, computeContactNormal);
+			PUT_TO_JSON(collisionParam, doEdgeEdgeCCD);
+			PUT_TO_JSON(collisionParam, ccdBatchVertexFace);
+			PUT_TO_JSON(collisionParam, ccdBatchBenchmark);
+			PUT_TO_JSON(collisionParam, ccdSIMDFilter);
+			PUT_TO_JSON(collisionParam, ccdSIMDFilterValidation);
 
 			PUT_TO_JSON(collisionParam, shiftQueryPointToCenter);
 			PUT_TO_JSON(collisionParam, centerShiftLevel);
@@ -133,6 +180,12 @@ namespace GAIA {
 
 			PUT_TO_JSON(collisionParam, allowVolumetricCollision);
 
+			PUT_TO_JSON(collisionParam, adaptiveBVHRebuild);
+			PUT_TO_JSON(collisionParam, bvhMaxQueryCostRatio);
+			PUT_TO_JSON(collisionParam, logBVHRebuildDecisions);
+
+			PUT_TO_JSON(collisionParam, meshBroadPhase);
+
 			return true;
 
 		}
@@ -4,6 +4,8 @@
 #include "CCDSolver.h"
 
 #include "CollisionGeometry.h"
+#include "../Timer/Timer.h"
+#include "../Parallelization/CPUParallelization.h"
 
 //typedef double CCDDType;
 typedef GAIA::FloatingType CCDDType;
@@ -66,6 +68,347 @@ void movingFaceBoundsFunc(const struct RTCBoundsFunctionArguments* args)
     *(embree::BBox3fa*)args->bounds_o = bounds;
 }
 
+void movingSurfaceEdgeBoundsFunc(const struct RTCBoundsFunctionArguments* args)
+{
+    const GAIA::TetMeshSurfaceEdges* pEdges = (const GAIA::TetMeshSurfaceEdges*)args->geometryUserPtr;
+    const GAIA::TetMeshFEM* pTM = pEdges->pTM;
+
+    embree::BBox3fa bounds = embree::empty;
+    const GAIA::IdType* edge = pEdges->edgeVIds.col(args->primID).data();
+
+    embree::Vec3fa a = embree::Vec3fa::loadu(pTM->vertex(edge[0]).data());
+    bounds.extend(a);
+    a = embree::Vec3fa::loadu(pTM->vertex(edge[1]).data());
+    bounds.extend(a);
+
+    const GAIA::TVerticesMat& prevPos = pTM->mVertPrevPos;
+    a = embree::Vec3fa::loadu(prevPos.col(edge[0]).data());
+    bounds.extend(a);
+    a = embree::Vec3fa::loadu(prevPos.col(edge[1]).data());
+    bounds.extend(a);
+
+    *(embree::BBox3fa*)args->bounds_o = bounds;
+}
+
+template<typename DType>
+inline void setCCDVert(cy::Vec3<DType>& v, const GAIA::Vec3& v_in) {
+    v.x = (DType)v_in.x();
+    v.y = (DType)v_in.y();
+    v.z = (DType)v_in.z();
+}
+
+// e-e candidate: surface edge primId0 of mesh geomId0 against surface edge primId1 of mesh geomId1
+bool isValidEECandidateTetMesh(GAIA::ContinuousCollisionDetector* pCCD, const GAIA::CCDCandidate& candidate)
+{
+    // filter out the same edge and the adjacent edges
+    if (candidate.geomId0 == candidate.geomId1)
+    {
+        const GAIA::IdType* edge1 = pCCD->surfaceEdges[candidate.geomId0].edgeVIds.col(candidate.primId0).data();
+        const GAIA::IdType* edge2 = pCCD->surfaceEdges[candidate.geomId1].edgeVIds.col(candidate.primId1).data();
+        if (candidate.primId0 == candidate.primId1
+            || edge1[0] == edge2[0] || edge1[0] == edge2[1]
+            || edge1[1] == edge2[0] || edge1[1] == edge2[1])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the 2 vertices of the 1st edge and then the 2 vertices of the 2nd edge, for CCDCoplanarityFilter
+void gatherEECandidateTetMesh(GAIA::ContinuousCollisionDetector* pCCD, const GAIA::CCDCandidate& candidate, GAIA::Vec3 x0[4], GAIA::Vec3 x1[4])
+{
+    GAIA::TetMeshFEM* pTM1 = pCCD->tMeshPtrs[candidate.geomId0].get();
+    GAIA::TetMeshFEM* pTM2 = pCCD->tMeshPtrs[candidate.geomId1].get();
+    const GAIA::IdType* edge1 = pCCD->surfaceEdges[candidate.geomId0].edgeVIds.col(candidate.primId0).data();
+    const GAIA::IdType* edge2 = pCCD->surfaceEdges[candidate.geomId1].edgeVIds.col(candidate.primId1).data();
+    for (int iEV = 0; iEV < 2; iEV++)
+    {
+        x0[iEV] = pTM1->vertexPrevPos(edge1[iEV]);
+        x1[iEV] = pTM1->vertex(edge1[iEV]);
+        x0[2 + iEV] = pTM2->vertexPrevPos(edge2[iEV]);
+        x1[2 + iEV] = pTM2->vertex(edge2[iEV]);
+    }
+}
+
+// solves a valid e-e candidate, returns whether it collides; the collision is added to eeCollisionResults if record is true
+bool solveEECandidateTetMesh(GAIA::ContinuousCollisionDetector* pCCD, const GAIA::CCDCandidate& candidate, bool record)
+{
+    GAIA::EECollisionResults& eeCollisionResults = pCCD->eeCollisionResults;
+
+    const int eId1 = candidate.primId0;
+    const int meshId1 = candidate.geomId0;
+
+    const int eId2 = candidate.primId1;
+    const int meshId2 = candidate.geomId1;
+
+    GAIA::TetMeshFEM* pTM1 = pCCD->tMeshPtrs[meshId1].get();
+    GAIA::TetMeshFEM* pTM2 = pCCD->tMeshPtrs[meshId2].get();
+    const GAIA::IdType* edge1 = pCCD->surfaceEdges[meshId1].edgeVIds.col(eId1).data();
+    const GAIA::IdType* edge2 = pCCD->surfaceEdges[meshId2].edgeVIds.col(eId2).data();
+
+    const GAIA::Vec3 e0V0Prev = pTM1->vertexPrevPos(edge1[0]);
+    const GAIA::Vec3 e0V1Prev = pTM1->vertexPrevPos(edge1[1]);
+    const GAIA::Vec3 e0V0 = pTM1->vertex(edge1[0]);
+    const GAIA::Vec3 e0V1 = pTM1->vertex(edge1[1]);
+
+    const GAIA::Vec3 e1V0Prev = pTM2->vertexPrevPos(edge2[0]);
+    const GAIA::Vec3 e1V1Prev = pTM2->vertexPrevPos(edge2[1]);
+    const GAIA::Vec3 e1V0 = pTM2->vertex(edge2[0]);
+    const GAIA::Vec3 e1V1 = pTM2->vertex(edge2[1]);
+
+    cy::Vec3<CCDDType> e0[2][2];
+    cy::Vec3<CCDDType> e1[2][2];
+    setCCDVert(e0[0][0], e0V0Prev);
+    setCCDVert(e0[0][1], e0V1Prev);
+    setCCDVert(e0[1][0], e0V0);
+    setCCDVert(e0[1][1], e0V1);
+
+    setCCDVert(e1[0][0], e1V0Prev);
+    setCCDVert(e1[0][1], e1V1Prev);
+    setCCDVert(e1[1][0], e1V0);
+    setCCDVert(e1[1][1], e1V1);
+
+    CCDDType tt = -1;
+    if (!cy::IntersectContinuousEdgeEdge<CCDDType>(tt, e0, e1))
+    {
+        return false;
+    }
+    if (!record)
+    {
+        return true;
+    }
+
+    const int curId = eeCollisionResults.numCollisions++;
+    if (curId >= eeCollisionResults.maxNumTriTriIntersections)
+    {
+        eeCollisionResults.overflow = true;
+        return true;
+    }
+
+    // the colliding points on the 2 edges at the time of the collision
+    const GAIA::Vec3 e0V0_collide = (1.f - tt) * e0V0Prev + tt * e0V0;
+    const GAIA::Vec3 e0V1_collide = (1.f - tt) * e0V1Prev + tt * e0V1;
+    const GAIA::Vec3 e1V0_collide = (1.f - tt) * e1V0Prev + tt * e1V0;
+    const GAIA::Vec3 e1V1_collide = (1.f - tt) * e1V1Prev + tt * e1V1;
+
+    const embree::Vec3fa p1 = embree::Vec3fa::loadu(e0V0_collide.data());
+    const embree::Vec3fa p2 = embree::Vec3fa::loadu(e0V1_collide.data());
+    const embree::Vec3fa q1 = embree::Vec3fa::loadu(e1V0_collide.data());
+    const embree::Vec3fa q2 = embree::Vec3fa::loadu(e1V1_collide.data());
+    embree::Vec3fa c1, c2;
+    GAIA::FloatingType mua, mub;
+    GAIA::get_closest_points_between_segments(p1, p2, q1, q2, c1, c2, mua, mub);
+
+    GAIA::EECollision& curCollision = eeCollisionResults.collisions[curId];
+    curCollision.miu1 = mua;
+    curCollision.miu2 = mub;
+    curCollision.t = tt;
+
+    curCollision.edgeId1 = eId1;
+    curCollision.edgeMeshId1 = meshId1;
+    curCollision.edgeId2 = eId2;
+    curCollision.edgeMeshId2 = meshId2;
+
+#ifdef RECORD_COLLIDING_POINT
+    curCollision.c << c1.x, c1.y, c1.z;
+#endif // RECORD_COLLIDING_POINT
+    return true;
+}
+
+void eeCollideFuncTetMesh(void* userPtr, RTCCollision* collisions, unsigned int num_collisions)
+{
+    GAIA::ContinuousCollisionDetector* pCCD = (GAIA::ContinuousCollisionDetector*)userPtr;
+
+    for (unsigned int iCollision = 0; iCollision < num_collisions; iCollision++)
+    {
+        const GAIA::CCDCandidate candidate = { (int)collisions[iCollision].geomID0, (int)collisions[iCollision].primID0,
+            (int)collisions[iCollision].geomID1, (int)collisions[iCollision].primID1 };
+        if (!isValidEECandidateTetMesh(pCCD, candidate))
+        {
+            continue;
+        }
+
+        if (pCCD->params.ccdSIMDFilter)
+        {
+            // solved after the coplanarity filter
+            if (!pCCD->eeCandidates.add(candidate))
+            {
+                return;
+            }
+        }
+        else
+        {
+            if (pCCD->eeCollisionResults.overflow)
+            {
+                return;
+            }
+            solveEECandidateTetMesh(pCCD, candidate, true);
+        }
+    }
+}
+
+void movingSurfaceVertexBoundsFunc(const struct RTCBoundsFunctionArguments* args)
+{
+    const GAIA::TetMeshFEM* pTM = (const GAIA::TetMeshFEM*)args->geometryUserPtr;
+
+    embree::BBox3fa bounds = embree::empty;
+    const GAIA::IdType vId = pTM->surfaceVIds()(args->primID);
+
+    embree::Vec3fa a = embree::Vec3fa::loadu(pTM->vertex(vId).data());
+    bounds.extend(a);
+    a = embree::Vec3fa::loadu(pTM->mVertPrevPos.col(vId).data());
+    bounds.extend(a);
+
+    *(embree::BBox3fa*)args->bounds_o = bounds;
+}
+
+// v-f candidate: surface vertex primId0 of mesh geomId0 against surface face primId1 of mesh geomId1
+bool isValidVFCandidateTetMesh(GAIA::ContinuousCollisionDetector* pCCD, const GAIA::CCDCandidate& candidate)
+{
+    // filter out the faces containing the vertex
+    if (candidate.geomId0 == candidate.geomId1)
+    {
+        GAIA::TetMeshFEM* pTM = pCCD->tMeshPtrs[candidate.geomId0].get();
+        const GAIA::IdType vId = pTM->surfaceVIds()(candidate.primId0);
+        const GAIA::IdType* face = pTM->surfaceFacesTetMeshVIds().col(candidate.primId1).data();
+        if (face[0] == vId || face[1] == vId || face[2] == vId)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the 3 face vertices and then the vertex, for CCDCoplanarityFilter
+void gatherVFCandidateTetMesh(GAIA::ContinuousCollisionDetector* pCCD, const GAIA::CCDCandidate& candidate, GAIA::Vec3 x0[4], GAIA::Vec3 x1[4])
+{
+    GAIA::TetMeshFEM* pTMV = pCCD->tMeshPtrs[candidate.geomId0].get();
+    GAIA::TetMeshFEM* pTMF = pCCD->tMeshPtrs[candidate.geomId1].get();
+    const GAIA::IdType vId = pTMV->surfaceVIds()(candidate.primId0);
+    const GAIA::IdType* face = pTMF->surfaceFacesTetMeshVIds().col(candidate.primId1).data();
+    for (int iFV = 0; iFV < 3; iFV++)
+    {
+        x0[iFV] = pTMF->vertexPrevPos(face[iFV]);
+        x1[iFV] = pTMF->vertex(face[iFV]);
+    }
+    x0[3] = pTMV->vertexPrevPos(vId);
+    x1[3] = pTMV->vertex(vId);
+}
+
+// solves a valid v-f candidate, returns whether it collides; the collision is added to vfCollisionResults if record is true
+bool solveVFCandidateTetMesh(GAIA::ContinuousCollisionDetector* pCCD, const GAIA::CCDCandidate& candidate, bool record)
+{
+    GAIA::VFCollisionResults& vfCollisionResults = pCCD->vfCollisionResults;
+
+    const int iSurfaceV = candidate.primId0;
+    const int meshIdV = candidate.geomId0;
+
+    const int faceId = candidate.primId1;
+    const int meshIdF = candidate.geomId1;
+
+    GAIA::TetMeshFEM* pTMV = pCCD->tMeshPtrs[meshIdV].get();
+    GAIA::TetMeshFEM* pTMF = pCCD->tMeshPtrs[meshIdF].get();
+    const GAIA::IdType vId = pTMV->surfaceVIds()(iSurfaceV);
+    const GAIA::IdType* face = pTMF->surfaceFacesTetMeshVIds().col(faceId).data();
+
+    cy::Vec3<CCDDType> fvs[2][3];
+    for (int iFV = 0; iFV < 3; iFV++)
+    {
+        setCCDVert(fvs[0][iFV], pTMF->vertexPrevPos(face[iFV]));
+        setCCDVert(fvs[1][iFV], pTMF->vertex(face[iFV]));
+    }
+
+    cy::Vec3<CCDDType> p[2];
+    setCCDVert(p[0], pTMV->vertexPrevPos(vId));
+    setCCDVert(p[1], pTMV->vertex(vId));
+
+    CCDDType tt = -1;
+    cy::Vec3<CCDDType> barycentrics;
+    if (!cy::IntersectContinuousTriPoint<CCDDType>(tt, fvs, p, barycentrics))
+    {
+        return false;
+    }
+    if (!record)
+    {
+        return true;
+    }
+
+    const int curId = vfCollisionResults.numCollisions++;
+    if (curId >= vfCollisionResults.maxNumTriTriIntersections)
+    {
+        vfCollisionResults.overflow = true;
+        return true;
+    }
+
+    GAIA::VFCollision& curCollision = vfCollisionResults.collisions[curId];
+    curCollision.t = tt;
+    curCollision.barycentrics << (GAIA::FloatingType)barycentrics.x, (GAIA::FloatingType)barycentrics.y, (GAIA::FloatingType)barycentrics.z;
+
+    curCollision.faceMeshId = meshIdF;
+    curCollision.faceId = faceId;
+
+    curCollision.vertexMeshId = meshIdV;
+    curCollision.vertexId = vId;
+
+#ifdef RECORD_COLLIDING_POINT
+    curCollision.c = (1.f - tt) * pTMV->vertexPrevPos(vId) + tt * pTMV->vertex(vId);
+#endif // RECORD_COLLIDING_POINT
+    return true;
+}
+
+void vfCollideFuncTetMesh(void* userPtr, RTCCollision* collisions, unsigned int num_collisions)
+{
+    GAIA::ContinuousCollisionDetector* pCCD = (GAIA::ContinuousCollisionDetector*)userPtr;
+
+    for (unsigned int iCollision = 0; iCollision < num_collisions; iCollision++)
+    {
+        const GAIA::CCDCandidate candidate = { (int)collisions[iCollision].geomID0, (int)collisions[iCollision].primID0,
+            (int)collisions[iCollision].geomID1, (int)collisions[iCollision].primID1 };
+        if (!isValidVFCandidateTetMesh(pCCD, candidate))
+        {
+            continue;
+        }
+
+        if (pCCD->params.ccdSIMDFilter)
+        {
+            // solved after the coplanarity filter
+            if (!pCCD->vfCandidates.add(candidate))
+            {
+                return;
+            }
+        }
+        else
+        {
+            if (pCCD->vfCollisionResults.overflow)
+            {
+                return;
+            }
+            solveVFCandidateTetMesh(pCCD, candidate, true);
+        }
+    }
+}
+
+template<typename GatherFunc, typename SolveFunc>
+void filterAndSolveCandidatesTetMesh(GAIA::ContinuousCollisionDetector* pCCD, GAIA::CCDCandidateResults& candidates,
+    GatherFunc& gatherFunc, SolveFunc& solveFunc, const char* name)
+{
+    auto gatherCandidate = [&](const GAIA::CCDCandidate& candidate, GAIA::Vec3 x0[4], GAIA::Vec3 x1[4]) {
+        gatherFunc(pCCD, candidate, x0, x1);
+    };
+    auto solveCandidate = [&](const GAIA::CCDCandidate& candidate, bool record) {
+        return solveFunc(pCCD, candidate, record);
+    };
+
+    GAIA::CCDCoplanarityFilter& filter = pCCD->coplanarityFilter;
+    filter.filter(candidates.collisions.data(), candidates.numCollisions, gatherCandidate);
+    filter.solveSurvivingCandidates(candidates.collisions.data(), solveCandidate);
+    if (pCCD->params.ccdSIMDFilterValidation)
+    {
+        filter.validate(candidates.collisions.data(), solveCandidate, name);
+    }
+}
+
 
 bool continuousTriPointIntersectionFunc(RTCPointQueryFunctionArguments* args)
 {
@@ -125,47 +468,9 @@ bool continuousTriPointIntersectionFunc(RTCPointQueryFunctionArguments* args)
     CCDDType tt = -1;
     cy::Vec3<CCDDType> barycentrics;
     if (cy::IntersectContinuousTriPoint<CCDDType>(tt, fvs, p, barycentrics)) {
-        GAIA::FloatingType penetrationDepth = tt * (p[1] - p[0]).Length();
-
-        bool needUpdate = false;
-        if (!result->numIntersections()) {
-            result->collidingPts.emplace_back();
-            needUpdate = true;
-        }
-        else if (result->penetrationDepth > penetrationDepth)
-        {
-            needUpdate = true;
-        }
-        GAIA::CollidingPointInfo& colldingPt = result->collidingPts.back();
-
-        if (needUpdate)
-        {
-                GAIA::Vec3 penetratePoint = (1. - tt) * pMQuery->vertexPrevPos(result->idVQuery)
-                + tt * pMQuery->vertex(result->idVQuery);
-
-                colldingPt.closestSurfaceFaceId = primID;
-                // result->intersectedTets.push_back(-1);
-                colldingPt.intersectedMeshId = intersectedMeshId;
-                colldingPt.shortestPathFound = true;
-                colldingPt.closestSurfacePtBarycentrics <<
-                    (GAIA::FloatingType)barycentrics[0], (GAIA::FloatingType)barycentrics[1], (GAIA::FloatingType)barycentrics[2];
-
-                colldingPt.closestSurfacePt = penetratePoint;
-                colldingPt.closestPointType = GAIA::ClosestPointOnTriangleType::AtInterior;
-
-                result->penetrationDepth = penetrationDepth;
-
-                GAIA::Vec3 contactNormal;
-                if (pCCD->params.computeContactNormal)
-                {
-                    GAIA::computeContactNormalTetMesh(*result, 0, contactNormal, pCCD->tMeshPtrs);
-                }
-                else
-                {
-                    contactNormal << 0.f, 0.f, 0.f;
-                }
-                colldingPt.closestPointNormal = contactNormal;
-        }
+        GAIA::Vec3 intersectionBarys;
+        intersectionBarys << (GAIA::FloatingType)barycentrics[0], (GAIA::FloatingType)barycentrics[1], (GAIA::FloatingType)barycentrics[2];
+        pCCD->updateVertexFaceCollision(result, intersectedMeshId, primID, tt, intersectionBarys);
 
         //    CollidingPointInfo& colldingPt = result->collidingPts.back();
 
@@ -309,12 +614,131 @@ void GAIA::ContinuousCollisionDetector::initialize(std::vector<std::shared_ptr<T
     }
     rtcCommitScene(surfaceTriangleTrajectoryScene);
 
-    
+    if (params.ccdBatchVertexFace)
+    {
+        surfaceVertexTrajectoryScene = rtcNewScene(device);
+        rtcSetSceneFlags(surfaceVertexTrajectoryScene, RTC_SCENE_FLAG_DYNAMIC | RTC_SCENE_FLAG_ROBUST);
+        rtcSetSceneBuildQuality(surfaceVertexTrajectoryScene, RTC_BUILD_QUALITY_LOW);
+
+        vertexOffsets.assign(tMeshes.size() + 1, 0);
+        size_t numSurfaceVertsAll = 0;
+        for (int meshId = 0; meshId < tMeshes.size(); meshId++)
+        {
+            TetMeshFEM* pTM = tMeshes[meshId].get();
+            RTCGeometry geomVerts = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_USER);
+            rtcSetGeometryUserPrimitiveCount(geomVerts, pTM->surfaceVIds().size());
+            rtcSetGeometryBoundsFunction(geomVerts, movingSurfaceVertexBoundsFunc, nullptr);
+            rtcSetGeometryUserData(geomVerts, (void*)(pTM));
+            rtcCommitGeometry(geomVerts);
+            rtcAttachGeometryByID(surfaceVertexTrajectoryScene, geomVerts, meshId);
+            rtcReleaseGeometry(geomVerts);
+
+            vertexOffsets[meshId + 1] = vertexOffsets[meshId] + pTM->numVertices();
+            numSurfaceVertsAll += pTM->surfaceVIds().size();
+        }
+        rtcCommitScene(surfaceVertexTrajectoryScene);
+
+        vfCollisionResults.initialize(std::max(size_t(vfCollisionPreAllocationRatio * numSurfaceVertsAll), size_t(1)));
+        if (params.ccdSIMDFilter)
+        {
+            vfCandidates.initialize(std::max(size_t(candidatePreAllocationRatio * numSurfaceVertsAll), size_t(1)));
+        }
+    }
+
+    if (params.doEdgeEdgeCCD)
+    {
+        edgeEdgeTrajectoryScene = rtcNewScene(device);
+        rtcSetSceneFlags(edgeEdgeTrajectoryScene, RTC_SCENE_FLAG_DYNAMIC | RTC_SCENE_FLAG_ROBUST);
+        rtcSetSceneBuildQuality(edgeEdgeTrajectoryScene, RTC_BUILD_QUALITY_LOW);
+
+        // all the edge lists are filled before the geometries take the pointers to them
+        surfaceEdges.resize(tMeshes.size());
+        size_t numSurfaceEdgesAll = 0;
+        for (int meshId = 0; meshId < tMeshes.size(); meshId++)
+        {
+            TetMeshFEM* pTM = tMeshes[meshId].get();
+            TetMeshSurfaceEdges& meshSurfaceEdges = surfaceEdges[meshId];
+            meshSurfaceEdges.pTM = pTM;
+
+            // each edge is shared by 2 surface faces, and is only added by the face with the smaller id
+            std::vector<IdType> edgeData;
+            for (int iF = 0; iF < pTM->numSurfaceFaces(); iF++)
+            {
+                for (int iFE = 0; iFE < 3; iFE++)
+                {
+                    IdType neiFaceId = pTM->surfaceFaces3NeighborFaces()(iFE, iF);
+                    if (neiFaceId >= 0 && neiFaceId < iF)
+                    {
+                        continue;
+                    }
+                    IdType eV1 = pTM->surfaceFacesTetMeshVIds()(iFE, iF);
+                    IdType eV2 = pTM->surfaceFacesTetMeshVIds()((iFE + 1) % 3, iF);
+
+                    IdType neiFaceEdgeOrder = -1;
+                    if (neiFaceId >= 0)
+                    {
+                        for (int iNeiFE = 0; iNeiFE < 3; iNeiFE++)
+                        {
+                            IdType neiEV1 = pTM->surfaceFacesTetMeshVIds()(iNeiFE, neiFaceId);
+                            IdType neiEV2 = pTM->surfaceFacesTetMeshVIds()((iNeiFE + 1) % 3, neiFaceId);
+                            if ((neiEV1 == eV1 && neiEV2 == eV2) || (neiEV1 == eV2 && neiEV2 == eV1))
+                            {
+                                neiFaceEdgeOrder = iNeiFE;
+                                break;
+                            }
+                        }
+                    }
+                    edgeData.insert(edgeData.end(), { eV1, eV2, iF, neiFaceId, iFE, neiFaceEdgeOrder });
+                }
+            }
+
+            size_t numSurfaceEdges = edgeData.size() / 6;
+            meshSurfaceEdges.edgeVIds.resize(2, numSurfaceEdges);
+            meshSurfaceEdges.edgeFaces.resize(2, numSurfaceEdges);
+            meshSurfaceEdges.edgeOrderInFaces.resize(2, numSurfaceEdges);
+            for (size_t iE = 0; iE < numSurfaceEdges; iE++)
+            {
+                meshSurfaceEdges.edgeVIds.col(iE) << edgeData[6 * iE], edgeData[6 * iE + 1];
+                meshSurfaceEdges.edgeFaces.col(iE) << edgeData[6 * iE + 2], edgeData[6 * iE + 3];
+                meshSurfaceEdges.edgeOrderInFaces.col(iE) << edgeData[6 * iE + 4], edgeData[6 * iE + 5];
+            }
+            numSurfaceEdgesAll += numSurfaceEdges;
+
+            RTCGeometry geomEdges = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_USER);
+            rtcSetGeometryUserPrimitiveCount(geomEdges, numSurfaceEdges);
+            rtcSetGeometryBoundsFunction(geomEdges, movingSurfaceEdgeBoundsFunc, nullptr);
+            rtcSetGeometryUserData(geomEdges, (void*)(&meshSurfaceEdges));
+            // no need to set up query function, because the scene is collided with itself
+            rtcCommitGeometry(geomEdges);
+            rtcAttachGeometryByID(edgeEdgeTrajectoryScene, geomEdges, meshId);
+            rtcReleaseGeometry(geomEdges);
+        }
+        rtcCommitScene(edgeEdgeTrajectoryScene);
+
+        eeCollisionResults.initialize(std::max(size_t(eeCollisionPreAllocationRatio * numSurfaceEdgesAll), size_t(1)));
+        if (params.ccdSIMDFilter)
+        {
+            eeCandidates.initialize(std::max(size_t(candidatePreAllocationRatio * numSurfaceEdgesAll), size_t(1)));
+        }
+    }
+
+    sceneRebuildHeuristic.initialize(tMeshes, true, params.bvhMaxQueryCostRatio, params.logBVHRebuildDecisions, "CCD scene");
 }
 
 
+void GAIA::ContinuousCollisionDetector::updateBVHAdaptive()
+{
+    updateBVH(sceneRebuildHeuristic.needsRebuild() ? RTC_BUILD_QUALITY_LOW : RTC_BUILD_QUALITY_REFIT);
+}
+
+void GAIA::ContinuousCollisionDetector::recordQueryTime(double time)
+{
+    sceneRebuildHeuristic.recordQueryTime(time);
+}
+
 void GAIA::ContinuousCollisionDetector::updateBVH(RTCBuildQuality quality)
 {
+    TICK(timeUpdate);
     RTCBuildQuality sceneQuality = quality;
     if (sceneQuality == RTC_BUILD_QUALITY_REFIT) {
         sceneQuality = RTC_BUILD_QUALITY_LOW;
@@ -346,6 +770,52 @@ void GAIA::ContinuousCollisionDetector::updateBVH(RTCBuildQuality quality)
     }
 
     rtcCommitScene(surfaceTriangleTrajectoryScene);
+
+    if (surfaceVertexTrajectoryScene != nullptr)
+    {
+        rtcSetSceneBuildQuality(surfaceVertexTrajectoryScene, sceneQuality);
+        for (int meshId = 0; meshId < tMeshPtrs.size(); meshId++)
+        {
+            RTCGeometry geomVerts = rtcGetGeometry(surfaceVertexTrajectoryScene, meshId);
+            if (tMeshPtrs[meshId]->activeForCollision) {
+                rtcEnableGeometry(geomVerts);
+            }
+            else
+            {
+                rtcDisableGeometry(geomVerts);
+                continue;
+            }
+            rtcSetGeometryBuildQuality(geomVerts, quality);
+            rtcUpdateGeometryBuffer(geomVerts, RTC_BUFFER_TYPE_VERTEX, 0);
+            rtcCommitGeometry(geomVerts);
+        }
+        rtcCommitScene(surfaceVertexTrajectoryScene);
+    }
+
+    if (edgeEdgeTrajectoryScene != nullptr)
+    {
+        rtcSetSceneBuildQuality(edgeEdgeTrajectoryScene, sceneQuality);
+        for (int meshId = 0; meshId < tMeshPtrs.size(); meshId++)
+        {
+            RTCGeometry geomEdges = rtcGetGeometry(edgeEdgeTrajectoryScene, meshId);
+            if (tMeshPtrs[meshId]->activeForCollision) {
+                rtcEnableGeometry(geomEdges);
+            }
+            else
+            {
+                rtcDisableGeometry(geomEdges);
+                continue;
+            }
+            rtcSetGeometryBuildQuality(geomEdges, quality);
+            rtcUpdateGeometryBuffer(geomEdges, RTC_BUFFER_TYPE_VERTEX, 0);
+            rtcCommitGeometry(geomEdges);
+        }
+        rtcCommitScene(edgeEdgeTrajectoryScene);
+    }
+
+    double timeUpdate = 0;
+    TOCK(timeUpdate);
+    sceneRebuildHeuristic.recordUpdate(quality != RTC_BUILD_QUALITY_REFIT, timeUpdate);
 }
 
 
@@ -355,11 +825,7 @@ bool GAIA::ContinuousCollisionDetector::vertexContinuousCollisionDetection(int32
     RTCPointQueryContext context;
     rtcInitPointQueryContext(&context);
 
-    pResult->clear();
-    pResult->idVQuery = vId;
-    pResult->idTMQuery = tMeshId;
-    pResult->pDetector = (void*)this;
-    pResult->fromCCD = true;
+    clearVertexResult(vId, tMeshId, pResult);
 
     //query.radius = (prevPosVQuery - pVQuery->point()).norm();
     // radius should be half of the length that the vertex moved
@@ -380,3 +846,225 @@ bool GAIA::ContinuousCollisionDetector::vertexContinuousCollisionDetection(int32
     return false;
 }
 
+void GAIA::ContinuousCollisionDetector::clearVertexResult(int32_t vId, int32_t tMeshId, CollisionDetectionResult* pResult)
+{
+    pResult->clear();
+    pResult->idVQuery = vId;
+    pResult->idTMQuery = tMeshId;
+    pResult->pDetector = (void*)this;
+    pResult->fromCCD = true;
+}
+
+bool GAIA::ContinuousCollisionDetector::updateVertexFaceCollision(CollisionDetectionResult* pResult, int32_t faceMeshId, int32_t faceId,
+    FloatingType tt, const Vec3& barycentrics)
+{
+    TetMeshFEM* pMQuery = tMeshPtrs[pResult->idTMQuery].get();
+    const Vec3 vPrevPos = pMQuery->vertexPrevPos(pResult->idVQuery);
+    const Vec3 vPos = pMQuery->vertex(pResult->idVQuery);
+    FloatingType penetrationDepth = tt * (vPos - vPrevPos).norm();
+
+    if (!pResult->numIntersections()) {
+        pResult->collidingPts.emplace_back();
+    }
+    else if (pResult->penetrationDepth <= penetrationDepth)
+    {
+        return false;
+    }
+    CollidingPointInfo& colldingPt = pResult->collidingPts.back();
+
+    Vec3 penetratePoint = (1.f - tt) * vPrevPos + tt * vPos;
+
+    colldingPt.closestSurfaceFaceId = faceId;
+    colldingPt.intersectedMeshId = faceMeshId;
+    colldingPt.shortestPathFound = true;
+    colldingPt.closestSurfacePtBarycentrics = barycentrics;
+
+    colldingPt.closestSurfacePt = penetratePoint;
+    colldingPt.closestPointType = ClosestPointOnTriangleType::AtInterior;
+
+    pResult->penetrationDepth = penetrationDepth;
+
+    Vec3 contactNormal;
+    if (params.computeContactNormal)
+    {
+        computeContactNormalTetMesh(*pResult, 0, contactNormal, tMeshPtrs);
+    }
+    else
+    {
+        contactNormal << 0.f, 0.f, 0.f;
+    }
+    colldingPt.closestPointNormal = contactNormal;
+
+    return true;
+}
+
+void GAIA::ContinuousCollisionDetector::vertexFaceContinuousCollisionDetection()
+{
+    if (params.ccdSIMDFilter)
+    {
+        do
+        {
+            vfCandidates.clear();
+            rtcCollide(surfaceVertexTrajectoryScene, surfaceTriangleTrajectoryScene, vfCollideFuncTetMesh, this);
+        } while (vfCandidates.overflow);
+
+        do
+        {
+            vfCollisionResults.clear();
+            filterAndSolveCandidatesTetMesh(this, vfCandidates, gatherVFCandidateTetMesh, solveVFCandidateTetMesh, "v-f");
+        } while (vfCollisionResults.overflow);
+    }
+    else
+    {
+        do
+        {
+            vfCollisionResults.clear();
+            rtcCollide(surfaceVertexTrajectoryScene, surfaceTriangleTrajectoryScene, vfCollideFuncTetMesh, this);
+        } while (vfCollisionResults.overflow);
+    }
+
+    // (global vertex id << 32) | index in vfCollisionResults, sorted to group the collisions by vertex
+    const size_t numVFCollisions = vfCollisionResults.numCollisions;
+    vfCollisionKeys.resize(numVFCollisions);
+    auto makeKey = [&](int iCollision) {
+        const VFCollision& vfCollision = vfCollisionResults.collisions[iCollision];
+        vfCollisionKeys[iCollision] = (uint64_t(vertexOffsets[vfCollision.vertexMeshId] + vfCollision.vertexId) << 32) | uint64_t(iCollision);
+    };
+    cpu_parallel_for(0, numVFCollisions, makeKey);
+    cpu_parallel_sort(vfCollisionKeys.begin(), vfCollisionKeys.end());
+}
+
+void GAIA::ContinuousCollisionDetector::edgeEdgeContinuousCollisionDetection()
+{
+    if (params.ccdSIMDFilter)
+    {
+        do
+        {
+            eeCandidates.clear();
+            rtcCollide(edgeEdgeTrajectoryScene, edgeEdgeTrajectoryScene, eeCollideFuncTetMesh, this);
+        } while (eeCandidates.overflow);
+
+        do
+        {
+            eeCollisionResults.clear();
+            filterAndSolveCandidatesTetMesh(this, eeCandidates, gatherEECandidateTetMesh, solveEECandidateTetMesh, "e-e");
+        } while (eeCollisionResults.overflow);
+    }
+    else
+    {
+        do
+        {
+            eeCollisionResults.clear();
+            rtcCollide(edgeEdgeTrajectoryScene, edgeEdgeTrajectoryScene, eeCollideFuncTetMesh, this);
+        } while (eeCollisionResults.overflow);
+    }
+}
+
+void GAIA::ContinuousCollisionDetector::getEdgeEdgeCollisionVertex(const EECollision& eeCollision, int iSide, int32_t& vId, int32_t& tMeshId)
+{
+    const int edgeId = iSide == 0 ? eeCollision.edgeId1 : eeCollision.edgeId2;
+    const FloatingType miu = iSide == 0 ? eeCollision.miu1 : eeCollision.miu2;
+    tMeshId = iSide == 0 ? eeCollision.edgeMeshId1 : eeCollision.edgeMeshId2;
+    vId = surfaceEdges[tMeshId].edgeVIds(miu < 0.5f ? 0 : 1, edgeId);
+}
+
+bool GAIA::ContinuousCollisionDetector::edgeEdgeCollisionToVertexFace(const EECollision& eeCollision, int iSide, CollisionDetectionResult* pResult)
+{
+    int32_t vId, tMeshId;
+    getEdgeEdgeCollisionVertex(eeCollision, iSide, vId, tMeshId);
+
+    const int otherEdgeId = iSide == 0 ? eeCollision.edgeId2 : eeCollision.edgeId1;
+    const int otherMeshId = iSide == 0 ? eeCollision.edgeMeshId2 : eeCollision.edgeMeshId1;
+    const FloatingType otherMiu = iSide == 0 ? eeCollision.miu2 : eeCollision.miu1;
+    const FloatingType tt = eeCollision.t;
+
+    TetMeshFEM* pTM = tMeshPtrs[tMeshId].get();
+    TetMeshFEM* pTMOther = tMeshPtrs[otherMeshId].get();
+    const TetMeshSurfaceEdges& otherEdges = surfaceEdges[otherMeshId];
+    const IdType otherEV1 = otherEdges.edgeVIds(0, otherEdgeId);
+    const IdType otherEV2 = otherEdges.edgeVIds(1, otherEdgeId);
+
+    // the colliding point on the other edge at the time of the collision
+    const Vec3 collidingPt = (1.f - otherMiu) * ((1.f - tt) * pTMOther->vertexPrevPos(otherEV1) + tt * pTMOther->vertex(otherEV1))
+        + otherMiu * ((1.f - tt) * pTMOther->vertexPrevPos(otherEV2) + tt * pTMOther->vertex(otherEV2));
+
+    // pick the face of the other edge that faces the previous position of the vertex, skipping the faces containing the vertex
+    int faceOrder = -1;
+    FloatingType bestFacing = 0.f;
+    for (int iEF = 0; iEF < 2; iEF++)
+    {
+        const IdType faceId = otherEdges.edgeFaces(iEF, otherEdgeId);
+        if (faceId < 0)
+        {
+            continue;
+        }
+        if (otherMeshId == tMeshId)
+        {
+            const IdType* face = pTMOther->surfaceFacesTetMeshVIds().col(faceId).data();
+            if (face[0] == vId || face[1] == vId || face[2] == vId)
+            {
+                continue;
+            }
+        }
+        Vec3 faceNormal;
+        pTMOther->computeFaceNormal(faceId, faceNormal);
+        const FloatingType facing = faceNormal.dot(pTM->vertexPrevPos(vId) - collidingPt);
+        if (faceOrder == -1 || facing > bestFacing)
+        {
+            faceOrder = iEF;
+            bestFacing = facing;
+        }
+    }
+
+    if (faceOrder == -1)
+    {
+        return false;
+    }
+
+    const FloatingType penetrationDepth = tt * (pTM->vertex(vId) - pTM->vertexPrevPos(vId)).norm();
+    if (pResult->numIntersections() && pResult->penetrationDepth <= penetrationDepth)
+    {
+        return false;
+    }
+
+    if (!pResult->numIntersections())
+    {
+        pResult->collidingPts.emplace_back();
+    }
+    pResult->idVQuery = vId;
+    pResult->idTMQuery = tMeshId;
+    pResult->pDetector = (void*)this;
+    pResult->fromCCD = true;
+
+    const IdType faceId = otherEdges.edgeFaces(faceOrder, otherEdgeId);
+    const IdType edgeOrderInFace = otherEdges.edgeOrderInFaces(faceOrder, otherEdgeId);
+    const IdType* face = pTMOther->surfaceFacesTetMeshVIds().col(faceId).data();
+
+    CollidingPointInfo& colldingPt = pResult->collidingPts.back();
+    colldingPt.closestSurfaceFaceId = faceId;
+    colldingPt.intersectedMeshId = otherMeshId;
+    colldingPt.shortestPathFound = true;
+    for (int iFV = 0; iFV < 3; iFV++)
+    {
+        colldingPt.closestSurfacePtBarycentrics(iFV) = face[iFV] == otherEV1 ? 1.f - otherMiu : (face[iFV] == otherEV2 ? otherMiu : 0.f);
+    }
+    colldingPt.closestSurfacePt = collidingPt;
+    // edge order 0, 1, 2 are AB, BC and CA
+    colldingPt.closestPointType = edgeOrderInFace == 0 ? ClosestPointOnTriangleType::AtAB :
+        (edgeOrderInFace == 1 ? ClosestPointOnTriangleType::AtBC : ClosestPointOnTriangleType::AtAC);
+
+    pResult->penetrationDepth = penetrationDepth;
+
+    Vec3 contactNormal;
+    if (params.computeContactNormal)
+    {
+        computeContactNormalTetMesh(*pResult, 0, contactNormal, tMeshPtrs);
+    }
+    else
+    {
+        contactNormal << 0.f, 0.f, 0.f;
+    }
+    colldingPt.closestPointNormal = contactNormal;
+
+    return true;
+}
@@ -1,26 +1,87 @@
 #pragma once
 
 #include "DiscreteCollisionDetector.h"
+#include "TriMeshContinuousCollisionDetector.h"
 
 namespace GAIA {
 	struct TetMeshFEM;
 
+	// the edges of the surface of a tet mesh, each shared by 2 surface faces
+	struct TetMeshSurfaceEdges {
+		TetMeshFEM* pTM = nullptr;
+		// 2 x nSurfaceEdges, tet mesh vertex ids
+		Mat2xI edgeVIds;
+		// 2 x nSurfaceEdges, the 2 surface faces sharing the edge
+		Mat2xI edgeFaces;
+		// 2 x nSurfaceEdges, the order of the edge in each of the 2 faces, i.e., 0 for AB, 1 for BC and 2 for CA
+		Mat2xI edgeOrderInFaces;
+	};
+
 	struct ContinuousCollisionDetector {
 
 		ContinuousCollisionDetector(const CollisionDetectionParamters& in_params);
 		void initialize(std::vector<std::shared_ptr<TetMeshFEM>> tMeshes);
 
 		bool vertexContinuousCollisionDetection(int32_t vId, int32_t tMeshId, CollisionDetectionResult* pResult);
+		// clears pResult and sets it up for the CCD of vertex vId of mesh tMeshId
+		void clearVertexResult(int32_t vId, int32_t tMeshId, CollisionDetectionResult* pResult);
+		// records the collision of the vertex of pResult with a surface face, if it has a smaller penetration depth than 
+		// the collision already in pResult; returns whether pResult is updated
+		bool updateVertexFaceCollision(CollisionDetectionResult* pResult, int32_t faceMeshId, int32_t faceId, FloatingType tt, 
+			const Vec3& barycentrics);
+
+		// the batched version of vertexContinuousCollisionDetection over all the surface vertices: the swept surface vertices are 
+		// collided with the swept surface faces by rtcCollide, the results are in vfCollisionResults and vfCollisionKeys groups 
+		// them by vertex; only valid with params.ccdBatchVertexFace
+		void vertexFaceContinuousCollisionDetection();
+
+		// collides the swept surface edges of all the meshes with each other, the results are in eeCollisionResults;
+		// only valid with params.doEdgeEdgeCCD
+		void edgeEdgeContinuousCollisionDetection();
+		// an e-e collision is handled as a v-f collision: iSide (0 or 1) selects one of the 2 edges, whose endpoint closer to 
+		// the colliding point becomes the colliding vertex
+		void getEdgeEdgeCollisionVertex(const EECollision& eeCollision, int iSide, int32_t& vId, int32_t& tMeshId);
+		// the colliding vertex collides with the surface face of the other edge that faces its previous position, at the colliding
+		// point on that edge; like the v-f CCD, only the collision with the smallest penetration depth is kept in pResult;
+		// returns whether pResult is updated
+		bool edgeEdgeCollisionToVertexFace(const EECollision& eeCollision, int iSide, CollisionDetectionResult* pResult);
 
 		void updateBVH(RTCBuildQuality quality);
+		// refits or rebuilds the scene as decided by sceneRebuildHeuristic
+		void updateBVHAdaptive();
+		// the time in ms spent in the continuous collision detection since the last update of the BVH
+		void recordQueryTime(double time);
 
 		std::vector<std::shared_ptr<TetMeshFEM>> tMeshPtrs;
 		RTCScene surfaceTriangleTrajectoryScene;
-		//RTCScene edgeEdgeTrajectoryScene;
+		// only created with params.ccdBatchVertexFace
+		RTCScene surfaceVertexTrajectoryScene = nullptr;
+		// only created with params.doEdgeEdgeCCD
+		RTCScene edgeEdgeTrajectoryScene = nullptr;
 		RTCDevice device;
 		const CollisionDetectionParamters& params;
 		size_t numFaces;
 
+		BVHRebuildHeuristic sceneRebuildHeuristic;
+
+		VFCollisionResults vfCollisionResults;
+		float vfCollisionPreAllocationRatio = 0.25f;
+		// nVFCollisions, (global vertex id << 32) | index in vfCollisionResults, sorted
+		std::vector<uint64_t> vfCollisionKeys;
+		// nMeshes + 1, prefix sum of the number of vertices, for the global vertex ids
+		std::vector<size_t> vertexOffsets;
+
+		// nMeshes, must not be reallocated after initialization since the edge geometries point to them
+		std::vector<TetMeshSurfaceEdges> surfaceEdges;
+		EECollisionResults eeCollisionResults;
+		float eeCollisionPreAllocationRatio = 0.25f;
+
+		// with params.ccdSIMDFilter, the candidates of the batched v-f and the e-e CCD are buffered, filtered by coplanarityFilter and then solved
+		CCDCandidateResults vfCandidates;
+		CCDCandidateResults eeCandidates;
+		float candidatePreAllocationRatio = 2.f;
+		CCDCoplanarityFilter coplanarityFilter;
+
 	};
 
 }
\ No newline at end of file
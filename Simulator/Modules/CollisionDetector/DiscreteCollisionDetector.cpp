@@ -1,6 +1,8 @@
 #include "DiscreteCollisionDetector.h"
 #include "CuMatrix/MatrixOps/CuMatrix.h"
 #include "CuMatrix/Geometry/Geometry.h"
+#include "../Timer/Timer.h"
+#include "../Parallelization/CPUParallelization.h"
 
 using namespace GAIA;
 using embree::Vec3fa;
@@ -9,29 +11,13 @@ using embree::Vec3fa;
 
 
 
-bool tetIntersectionFunc(RTCPointQueryFunctionArguments* args)
+// whether the tet of the intersected mesh embraces p, and can be counted as an intersection of the query
+static bool tetEmbracesQueryPoint(const CollisionDetectionResult* result, DiscreteCollisionDetector* pDCD, 
+    unsigned int geomID, IdType intersectedTId, const embree::Vec3fa& p)
 {
-    CollisionDetectionResult* result = (CollisionDetectionResult*)args->userPtr;
-
-    //the pointer to the mesh that has potential collision
-    //TM::Ptr pTM = (*(result->pTetmeshGeoIdToPointerMap))[args->geomID];
-    DiscreteCollisionDetector* pDCD = (DiscreteCollisionDetector*)result->pDetector;
-    TetMeshFEM* pTMIntersected = pDCD->tMeshPtrs[args->geomID].get();
-
-    assert(args->userPtr);
-    const unsigned int geomID = args->geomID;
-    const unsigned int primID = args->primID;
-
-    RTCPointQueryContext* context = args->context;
-
-    IdType intersectedTId = primID;
+    TetMeshFEM* pTMIntersected = pDCD->tMeshPtrs[geomID].get();
     const IdType* tetVIds = pTMIntersected->tetVIds().data() + (4 * intersectedTId);
 
-    //if (result->pTMToCheck != nullptr && result->pTMToCheck != pTM)
-    //{
-    //    return false;
-    //}
-
     if (!result->handleSelfIntersection && geomID == result->idTMQuery)
     {
         // do not detect the self-intersection in this case
@@ -48,14 +34,6 @@ bool tetIntersectionFunc(RTCPointQueryFunctionArguments* args)
                     return false;
                 }
             }
-
-            //if (result->idVQuery == tetVId1 ||
-            //    result->idVQuery == tetVId2 ||
-            //    result->idVQuery == tetVId3 ||
-            //    result->idVQuery == tetVId3 )
-            //{
-            //    return false;
-            //}
         }
         if (result->idTetQuery != -1) {
             if (result->idTetQuery == intersectedTId)
@@ -65,22 +43,39 @@ bool tetIntersectionFunc(RTCPointQueryFunctionArguments* args)
         }
     }
 
-    embree::Vec3fa p(args->query->x, args->query->y, args->query->z);
     embree::Vec3fa a = embree::Vec3fa::loadu(pTMIntersected->mVertPos.col(tetVIds[0]).data());
     embree::Vec3fa b = embree::Vec3fa::loadu(pTMIntersected->mVertPos.col(tetVIds[1]).data());
     embree::Vec3fa c = embree::Vec3fa::loadu(pTMIntersected->mVertPos.col(tetVIds[2]).data());
     embree::Vec3fa d = embree::Vec3fa::loadu(pTMIntersected->mVertPos.col(tetVIds[3]).data());
 
-    if (pointInTet(p, a, b, c ,d)
+    return pointInTet(p, a, b, c, d);
+}
+
+bool tetIntersectionFunc(RTCPointQueryFunctionArguments* args)
+{
+    CollisionDetectionResult* result = (CollisionDetectionResult*)args->userPtr;
+
+    //the pointer to the mesh that has potential collision
+    //TM::Ptr pTM = (*(result->pTetmeshGeoIdToPointerMap))[args->geomID];
+    DiscreteCollisionDetector* pDCD = (DiscreteCollisionDetector*)result->pDetector;
+
+    assert(args->userPtr);
+    const unsigned int geomID = args->geomID;
+    const unsigned int primID = args->primID;
+
+    RTCPointQueryContext* context = args->context;
+
+    IdType intersectedTId = primID;
+
+    embree::Vec3fa p(args->query->x, args->query->y, args->query->z);
+
+    if (tetEmbracesQueryPoint(result, pDCD, geomID, intersectedTId, p)
        && result->numIntersections() < pDCD->params.maxNumberOfCollisions
        ) {
        result->collidingPts.emplace_back();
 
        result->collidingPts.back().intersectedElement = intersectedTId;
        result->collidingPts.back().intersectedMeshId = geomID;
-       /*std::cout << "vertex: " << result->idVQuery << " intersects with tet: " 
-           << tetVIds[0] << ", " << tetVIds[1] << ", " << tetVIds[2] << ", " << tetVIds[3] << "\n";
-       std::cout << "tet oriented volume:" << CuMatrix::tetOrientedVolume(pTMIntersected->positions().data(), tetVIds);*/
    }
 
     //if (CuMatrix::tetPointInTet(p, pTMIntersected->mVertPos.data(), tetVIds)
@@ -454,22 +449,74 @@ void GAIA::DiscreteCollisionDetector::initialize(std::vector<std::shared_ptr<Tet
 	}
     rtcCommitScene(tetMeshesScene);
 
+    tetMeshSceneRebuildHeuristic.initialize(tMeshes, false, params.bvhMaxQueryCostRatio, params.logBVHRebuildDecisions, "DCD tet mesh scene");
+    surfaceSceneRebuildHeuristics.resize(tMeshes.size());
+    for (int meshId = 0; meshId < tMeshes.size(); meshId++)
+    {
+        surfaceSceneRebuildHeuristics[meshId].initialize({ tMeshes[meshId] }, true, params.bvhMaxQueryCostRatio, params.logBVHRebuildDecisions,
+            "DCD surface scene " + std::to_string(meshId));
+    }
+    surfaceSceneQualities.assign(tMeshes.size(), RTC_BUILD_QUALITY_LOW);
+
+    vertexCoherenceCaches.resize(tMeshes.size());
+    for (int meshId = 0; meshId < tMeshes.size(); meshId++)
+    {
+        vertexCoherenceCaches[meshId].assign(tMeshes[meshId]->numVertices(), DCDCoherenceCacheEntry());
+    }
+    perThreadCoherenceStatistics.assign(cpu_max_threads(), DCDCoherenceStatistics());
 }
 
 void GAIA::DiscreteCollisionDetector::updateBVH(RTCBuildQuality tetMeshSceneQuality, 
     RTCBuildQuality surfaceSceneQuality, bool updateSurfaceScene)
 {
+    surfaceSceneQualities.assign(tMeshPtrs.size(), surfaceSceneQuality);
+    updateScenes(tetMeshSceneQuality, updateSurfaceScene);
+}
+
+void GAIA::DiscreteCollisionDetector::updateBVHAdaptive(bool updateSurfaceScene)
+{
+    RTCBuildQuality tetMeshSceneQuality = tetMeshSceneRebuildHeuristic.needsRebuild() ? RTC_BUILD_QUALITY_LOW : RTC_BUILD_QUALITY_REFIT;
+
+    surfaceSceneQualities.resize(tMeshPtrs.size());
+    if (updateSurfaceScene && !params.restPoseCloestPoint)
+    {
+        for (size_t iMesh = 0; iMesh < tMeshPtrs.size(); iMesh++)
+        {
+            if (tMeshPtrs[iMesh]->activeForCollision)
+            {
+                surfaceSceneQualities[iMesh] = surfaceSceneRebuildHeuristics[iMesh].needsRebuild() ? RTC_BUILD_QUALITY_LOW : RTC_BUILD_QUALITY_REFIT;
+            }
+        }
+    }
+    updateScenes(tetMeshSceneQuality, updateSurfaceScene);
+}
+
+void GAIA::DiscreteCollisionDetector::recordQueryTime(double time)
+{
+    tetMeshSceneRebuildHeuristic.recordQueryTime(time);
+    if (!params.restPoseCloestPoint)
+    {
+        size_t numFacesTotal = 0;
+        for (size_t iMesh = 0; iMesh < tMeshPtrs.size(); iMesh++)
+        {
+            numFacesTotal += surfaceSceneRebuildHeuristics[iMesh].numPrimitives();
+        }
+        for (size_t iMesh = 0; iMesh < tMeshPtrs.size() && numFacesTotal; iMesh++)
+        {
+            surfaceSceneRebuildHeuristics[iMesh].recordQueryTime(time * surfaceSceneRebuildHeuristics[iMesh].numPrimitives() / numFacesTotal);
+        }
+    }
+}
 
+void GAIA::DiscreteCollisionDetector::updateScenes(RTCBuildQuality tetMeshSceneQuality, bool updateSurfaceScene)
+{
+    bool rebuildTetMeshScene = tetMeshSceneQuality != RTC_BUILD_QUALITY_REFIT;
     RTCBuildQuality tetMeshGeomQuality = tetMeshSceneQuality;
     if (tetMeshSceneQuality == RTC_BUILD_QUALITY_REFIT) {
         tetMeshSceneQuality = RTC_BUILD_QUALITY_LOW;
     }
 
-    RTCBuildQuality surfaceGeomQuality = surfaceSceneQuality;
-    if (surfaceSceneQuality == RTC_BUILD_QUALITY_REFIT) {
-        surfaceSceneQuality = RTC_BUILD_QUALITY_LOW;
-    }
-
+    TICK(timeTetMeshScene);
     rtcSetSceneBuildQuality(tetMeshesScene, tetMeshSceneQuality);
 
     for (size_t iMesh = 0; iMesh < tMeshPtrs.size(); iMesh++)
@@ -496,9 +543,29 @@ void GAIA::DiscreteCollisionDetector::updateBVH(RTCBuildQuality tetMeshSceneQual
 
         rtcUpdateGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0);
         rtcCommitGeometry(geom);
-     
-        if (updateSurfaceScene && !params.restPoseCloestPoint) {
+    }
+
+    rtcCommitScene(tetMeshesScene);
+    double timeTetMeshScene = 0;
+    TOCK(timeTetMeshScene);
+    tetMeshSceneRebuildHeuristic.recordUpdate(rebuildTetMeshScene, timeTetMeshScene);
+
+    if (updateSurfaceScene && !params.restPoseCloestPoint) {
+        for (size_t iMesh = 0; iMesh < tMeshPtrs.size(); iMesh++)
+        {
+            if (!tMeshPtrs[iMesh]->activeForCollision)
+            {
+                continue;
+            }
+
             // update surface Mesh
+            RTCBuildQuality surfaceSceneQuality = surfaceSceneQualities[iMesh];
+            RTCBuildQuality surfaceGeomQuality = surfaceSceneQuality;
+            if (surfaceSceneQuality == RTC_BUILD_QUALITY_REFIT) {
+                surfaceSceneQuality = RTC_BUILD_QUALITY_LOW;
+            }
+
+            TICK(timeSurfaceScene);
             RTCScene surfaceScene = surfaceMeshScenes[iMesh];
             rtcSetSceneBuildQuality(surfaceScene, surfaceSceneQuality);
 
@@ -508,10 +575,11 @@ void GAIA::DiscreteCollisionDetector::updateBVH(RTCBuildQuality tetMeshSceneQual
             rtcUpdateGeometryBuffer(geomSurface, RTC_BUFFER_TYPE_VERTEX, 0);
             rtcCommitGeometry(geomSurface);
             rtcCommitScene(surfaceScene);
+            double timeSurfaceScene = 0;
+            TOCK(timeSurfaceScene);
+            surfaceSceneRebuildHeuristics[iMesh].recordUpdate(surfaceGeomQuality != RTC_BUILD_QUALITY_REFIT, timeSurfaceScene);
         }
     }
-
-    rtcCommitScene(tetMeshesScene);
 }
 
 bool GAIA::DiscreteCollisionDetector::vertexCollisionDetection(int32_t vId, int32_t tMeshId, CollisionDetectionResult* pResult)
@@ -533,10 +601,132 @@ bool GAIA::DiscreteCollisionDetector::vertexCollisionDetection(int32_t vId, int3
     pResult->idVQuery = vId;
     pResult->pDetector = (void*)this;
     pResult->handleSelfIntersection = params.handleSelfCollision;
-    rtcPointQuery(tetMeshesScene, &query, &context, nullptr, (void*)pResult);
+
+    bool useCache = params.dcdTemporalCoherence && params.maxNumberOfCollisions == 1;
+    if (!useCache || !coherentTetQuery(vId, tMeshId, pResult))
+    {
+        rtcPointQuery(tetMeshesScene, &query, &context, nullptr, (void*)pResult);
+    }
+
+    if (params.dcdTemporalCoherence)
+    {
+        DCDCoherenceCacheEntry& cacheEntry = vertexCoherenceCaches[tMeshId][vId];
+        if (pResult->numIntersections())
+        {
+            if (cacheEntry.meshId != pResult->collidingPts[0].intersectedMeshId)
+            {
+                cacheEntry.faceId = -1;
+            }
+            cacheEntry.meshId = pResult->collidingPts[0].intersectedMeshId;
+            cacheEntry.tetId = pResult->collidingPts[0].intersectedElement;
+        }
+        else
+        {
+            cacheEntry.meshId = -1;
+            cacheEntry.tetId = -1;
+            cacheEntry.faceId = -1;
+        }
+    }
     return true;
 }
 
+bool GAIA::DiscreteCollisionDetector::coherentTetQuery(int32_t vId, int32_t tMeshId, CollisionDetectionResult* pResult)
+{
+    const DCDCoherenceCacheEntry& cacheEntry = vertexCoherenceCaches[tMeshId][vId];
+    if (cacheEntry.meshId == -1 || !tMeshPtrs[cacheEntry.meshId]->activeForCollision)
+    {
+        return false;
+    }
+    DCDCoherenceStatistics* pStatistics = threadCoherenceStatistics();
+    if (pStatistics != nullptr)
+    {
+        ++pStatistics->numTetQueries;
+    }
+
+    TetMeshFEM* pTMCached = tMeshPtrs[cacheEntry.meshId].get();
+    embree::Vec3fa p = loadVertexPos(tMeshPtrs[tMeshId].get(), vId);
+
+    auto recordHit = [&](int32_t tetId) {
+        pResult->collidingPts.emplace_back();
+        pResult->collidingPts.back().intersectedElement = tetId;
+        pResult->collidingPts.back().intersectedMeshId = cacheEntry.meshId;
+        if (pStatistics != nullptr)
+        {
+            ++pStatistics->numTetHits;
+        }
+        return true;
+    };
+
+    if (tetEmbracesQueryPoint(pResult, this, cacheEntry.meshId, cacheEntry.tetId, p))
+    {
+        return recordHit(cacheEntry.tetId);
+    }
+    // the one ring of the cached tet
+    for (int iNei = 0; iNei < 4; iNei++)
+    {
+        int32_t neiTetId = pTMCached->tetsNeighborTets()(iNei, cacheEntry.tetId);
+        if (neiTetId != -1 && tetEmbracesQueryPoint(pResult, this, cacheEntry.meshId, neiTetId, p))
+        {
+            return recordHit(neiTetId);
+        }
+    }
+
+    // walk through the face the vertex is the furthest behind, the first step lands in the ring tested above
+    int32_t tetId = cacheEntry.tetId;
+    for (int iStep = 0; iStep < params.dcdCoherenceWalkSteps; iStep++)
+    {
+        FloatingType barycentrics[4];
+        CuMatrix::tetPointBarycentricsInTet(&p.x, pTMCached->mVertPos.data(), pTMCached->tetVIds().col(tetId).data(), barycentrics);
+        int32_t exitFace = 0;
+        for (int iV = 1; iV < 4; iV++)
+        {
+            if (barycentrics[iV] < barycentrics[exitFace])
+            {
+                exitFace = iV;
+            }
+        }
+
+        tetId = pTMCached->tetsNeighborTets()(exitFace, tetId);
+        if (tetId == -1 || barycentrics[exitFace] >= 0)
+        {
+            // left the mesh, or a degenerate tet
+            return false;
+        }
+        if (iStep && tetEmbracesQueryPoint(pResult, this, cacheEntry.meshId, tetId, p))
+        {
+            return recordHit(tetId);
+        }
+    }
+    return false;
+}
+
+GAIA::DCDCoherenceStatistics GAIA::DiscreteCollisionDetector::coherenceStatistics() const
+{
+    DCDCoherenceStatistics total;
+    for (const DCDCoherenceStatistics& threadStatistics : perThreadCoherenceStatistics)
+    {
+        total.numTetQueries += threadStatistics.numTetQueries;
+        total.numTetHits += threadStatistics.numTetHits;
+        total.numFaceQueries += threadStatistics.numFaceQueries;
+        total.numFaceHits += threadStatistics.numFaceHits;
+    }
+    return total;
+}
+
+void GAIA::DiscreteCollisionDetector::resetCoherenceStatistics()
+{
+    perThreadCoherenceStatistics.assign(perThreadCoherenceStatistics.size(), DCDCoherenceStatistics());
+}
+
+GAIA::DCDCoherenceStatistics* GAIA::DiscreteCollisionDetector::threadCoherenceStatistics()
+{
+    if (!recordCoherenceStatistics)
+    {
+        return nullptr;
+    }
+    return &perThreadCoherenceStatistics[cpu_thread_index() % perThreadCoherenceStatistics.size()];
+}
+
 bool GAIA::DiscreteCollisionDetector::closestPointQuery(CollisionDetectionResult* pColResult, ClosestPointQueryResult* pClosestPtResult)
 {
     TetMeshFEM* pTM = tMeshPtrs[pColResult->idTMQuery].get();
@@ -593,7 +783,59 @@ bool GAIA::DiscreteCollisionDetector::closestPointQuery(CollisionDetectionResult
 
         RTCPointQueryContext context;
         rtcInitPointQueryContext(&context);
-        rtcPointQuery(surfaceMeshScenes[idTMIntersected], &query, &context, nullptr, (void*)pClosestPtResult);
+
+        DCDCoherenceCacheEntry* pCacheEntry = nullptr;
+        if (params.dcdTemporalCoherence && iIntersection == 0 && !params.restPoseCloestPoint)
+        {
+            pCacheEntry = &vertexCoherenceCaches[pColResult->idTMQuery][pColResult->idVQuery];
+        }
+
+        if (pCacheEntry != nullptr && pCacheEntry->faceId != -1 && pCacheEntry->meshId == idTMIntersected)
+        {
+            // the cached face bounds the distance to the closest face, the query is limited to that radius;
+            // if the cached face and the ones within the radius are all rejected, the query is done again with the full radius
+            DCDCoherenceStatistics* pStatistics = threadCoherenceStatistics();
+            if (pStatistics != nullptr)
+            {
+                ++pStatistics->numFaceQueries;
+            }
+            TetMeshFEM* pTMSearch = tMeshPtrs[idTMIntersected].get();
+            embree::Vec3fa queryPt(query.x, query.y, query.z);
+            ClosestPointOnTriangleType pointType;
+            embree::Vec3fa barycentrics;
+            embree::Vec3fa closestP = GAIA::closestPointTriangle(queryPt,
+                loadVertexPos(pTMSearch, pTMSearch->surfaceFacesTetMeshVIds()(0, pCacheEntry->faceId)),
+                loadVertexPos(pTMSearch, pTMSearch->surfaceFacesTetMeshVIds()(1, pCacheEntry->faceId)),
+                loadVertexPos(pTMSearch, pTMSearch->surfaceFacesTetMeshVIds()(2, pCacheEntry->faceId)),
+                barycentrics, pointType);
+            query.radius = embree::distance(queryPt, closestP) * 1.001f + 1e-7f;
+
+            int numberOfBVHQuery = pClosestPtResult->numberOfBVHQuery;
+            rtcPointQuery(surfaceMeshScenes[idTMIntersected], &query, &context, nullptr, (void*)pClosestPtResult);
+            if (pClosestPtResult->found)
+            {
+                if (pStatistics != nullptr)
+                {
+                    ++pStatistics->numFaceHits;
+                }
+            }
+            else
+            {
+                pClosestPtResult->numberOfBVHQuery = numberOfBVHQuery;
+                query.radius = embree::inf;
+                rtcInitPointQueryContext(&context);
+                rtcPointQuery(surfaceMeshScenes[idTMIntersected], &query, &context, nullptr, (void*)pClosestPtResult);
+            }
+        }
+        else
+        {
+            rtcPointQuery(surfaceMeshScenes[idTMIntersected], &query, &context, nullptr, (void*)pClosestPtResult);
+        }
+
+        if (pCacheEntry != nullptr)
+        {
+            pCacheEntry->faceId = pClosestPtResult->found ? pClosestPtResult->closestFaceId : -1;
+        }
 
         // for testing
         //queryPoint(closestPtResult, p, pTetIntersected, surfaceSceneId, inf);
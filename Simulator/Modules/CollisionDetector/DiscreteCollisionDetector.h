@@ -15,6 +15,7 @@
 #include "CollisionDetertionParameters.h"
 
 #include "CollisionGeometry.h"
+#include "BVHRebuildHeuristic.h"
 
 #include "../TetMesh/TetMeshFEM.h"
 
@@ -57,6 +58,26 @@ namespace GAIA {
     };
 
 
+    // the result of the last DCD of a vertex, a hint for the next one
+    struct DCDCoherenceCacheEntry
+    {
+        // -1 if the vertex was not penetrating
+        int32_t meshId = -1;
+        int32_t tetId = -1;
+        // the closest surface face on meshId, -1 if not found
+        int32_t faceId = -1;
+    };
+
+    // the cache hits of the DCD, the queries count the vertices with a cache entry to try
+    // one per thread, padded so the threads do not share a cache line
+    struct alignas(64) DCDCoherenceStatistics
+    {
+        int numTetQueries = 0;
+        int numTetHits = 0;
+        int numFaceQueries = 0;
+        int numFaceHits = 0;
+    };
+
 	struct DiscreteCollisionDetector
 	{
 		DiscreteCollisionDetector(const CollisionDetectionParamters & in_params);
@@ -64,10 +85,20 @@ namespace GAIA {
 
         void updateBVH(RTCBuildQuality tetMeshSceneQuality, RTCBuildQuality surfaceSceneQuality
             , bool updateSurfaceScene);
+        // refits or rebuilds the tet mesh scene and each surface scene as decided by their BVHRebuildHeuristic
+        void updateBVHAdaptive(bool updateSurfaceScene);
+        // the time in ms spent in the vertex collision detection and the closest point queries since the last update of the BVHs
+        // the time of the closest point queries is not measured separately, it is shared among the surface scenes by their face counts
+        void recordQueryTime(double time);
 
         // vId: index of tetmesh vertex (not surface vertex, this also works for interior verts)
         bool vertexCollisionDetection(int32_t vId, int32_t tMeshId, CollisionDetectionResult* pResult);
         bool closestPointQuery(CollisionDetectionResult* pResult, ClosestPointQueryResult* pClosestPtResult);
+        // tries the cached embracing tet of the vertex, its neighbor tets, then walks towards the vertex for dcdCoherenceWalkSteps tets
+        bool coherentTetQuery(int32_t vId, int32_t tMeshId, CollisionDetectionResult* pResult);
+        // the sum over the threads since resetCoherenceStatistics, all zero unless recordCoherenceStatistics is set
+        DCDCoherenceStatistics coherenceStatistics() const;
+        void resetCoherenceStatistics();
 
         // edgeID: 0,1,2 represents 
         bool checkFeasibleRegion(embree::Vec3fa& p, TetMeshFEM *pTM, int32_t faceId, 
@@ -80,6 +111,17 @@ namespace GAIA {
 		// a scene for each surface mesh
         // used for geodesic closest surface point query 
 		std::vector<RTCScene> surfaceMeshScenes;
+
+        BVHRebuildHeuristic tetMeshSceneRebuildHeuristic;
+        // nMeshes
+        std::vector<BVHRebuildHeuristic> surfaceSceneRebuildHeuristics;
+        // nMeshes, the qualities used by updateScenes
+        std::vector<RTCBuildQuality> surfaceSceneQualities;
+
+        // nMeshes x nVertices, only written by the query of the vertex itself
+        std::vector<std::vector<DCDCoherenceCacheEntry>> vertexCoherenceCaches;
+        // set from doStatistics by the physics framework
+        bool recordCoherenceStatistics = false;
 		
         void computeNormal(CollisionDetectionResult& colResult, int32_t iIntersection, Vec3& normal);
 
@@ -87,6 +129,14 @@ namespace GAIA {
 
 		const CollisionDetectionParamters& params;
 
+    private:
+        // the update shared by updateBVH and updateBVHAdaptive, the surface scenes use surfaceSceneQualities
+        void updateScenes(RTCBuildQuality tetMeshSceneQuality, bool updateSurfaceScene);
+        // nullptr unless recordCoherenceStatistics is set
+        DCDCoherenceStatistics* threadCoherenceStatistics();
+
+        // cpu_max_threads()
+        std::vector<DCDCoherenceStatistics> perThreadCoherenceStatistics;
 	};
 
     embree::Vec3fa loadVertexPos(TetMeshFEM* pTM, int32_t vId);
@@ -0,0 +1,101 @@
+#include "MeshBroadPhase.h"
+#include "../Parallelization/CPUParallelization.h"
+
+#include <algorithm>
+
+using namespace GAIA;
+
+void GAIA::MeshBroadPhase::initialize(const std::vector<std::shared_ptr<TetMeshFEM>>& in_tMeshes)
+{
+	tMeshes = in_tMeshes;
+	meshLowers.assign(tMeshes.size(), Vec3::Zero());
+	meshUppers.assign(tMeshes.size(), Vec3::Zero());
+	meshPartners.resize(tMeshes.size());
+	sortedMeshes.reserve(tMeshes.size());
+	sweepActiveMeshes.reserve(tMeshes.size());
+}
+
+void GAIA::MeshBroadPhase::update(bool swept, bool selfCollision)
+{
+	auto computeMeshAABB = [&](int iMesh) {
+		TetMeshFEM* pTM = tMeshes[iMesh].get();
+		meshPartners[iMesh].clear();
+		if (!pTM->activeForCollision || !pTM->surfaceVIds().size())
+		{
+			return;
+		}
+
+		Vec3 lower = pTM->vertex(pTM->surfaceVIds()(0));
+		Vec3 upper = lower;
+		for (IdType iSurfaceV = 0; iSurfaceV < pTM->surfaceVIds().size(); iSurfaceV++)
+		{
+			IdType vId = pTM->surfaceVIds()(iSurfaceV);
+			lower = lower.cwiseMin(pTM->vertex(vId));
+			upper = upper.cwiseMax(pTM->vertex(vId));
+			if (swept)
+			{
+				lower = lower.cwiseMin(pTM->vertexPrevPos(vId));
+				upper = upper.cwiseMax(pTM->vertexPrevPos(vId));
+			}
+		}
+		meshLowers[iMesh] = lower;
+		meshUppers[iMesh] = upper;
+		if (selfCollision)
+		{
+			meshPartners[iMesh].push_back(iMesh);
+		}
+	};
+	cpu_parallel_for(0, (int)tMeshes.size(), computeMeshAABB);
+
+	sortedMeshes.clear();
+	Vec3 centerSum = Vec3::Zero();
+	Vec3 centerSquaredSum = Vec3::Zero();
+	for (IdType iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+	{
+		if (tMeshes[iMesh]->activeForCollision && tMeshes[iMesh]->surfaceVIds().size())
+		{
+			sortedMeshes.push_back(iMesh);
+			Vec3 center = 0.5f * (meshLowers[iMesh] + meshUppers[iMesh]);
+			centerSum += center;
+			centerSquaredSum += center.cwiseProduct(center);
+		}
+	}
+
+	if (sortedMeshes.size())
+	{
+		Vec3 centerVariance = centerSquaredSum / sortedMeshes.size() - (centerSum / sortedMeshes.size()).cwiseAbs2();
+		centerVariance.maxCoeff(&sweepAxis);
+	}
+
+	std::sort(sortedMeshes.begin(), sortedMeshes.end(), [&](IdType iMesh1, IdType iMesh2) {
+		return meshLowers[iMesh1][sweepAxis] < meshLowers[iMesh2][sweepAxis];
+		});
+
+	overlappingPairs.clear();
+	sweepActiveMeshes.clear();
+	for (IdType iMesh : sortedMeshes)
+	{
+		// drop the meshes that end before this one starts along the axis
+		size_t numStillActive = 0;
+		for (IdType iActive : sweepActiveMeshes)
+		{
+			if (meshUppers[iActive][sweepAxis] >= meshLowers[iMesh][sweepAxis])
+			{
+				sweepActiveMeshes[numStillActive++] = iActive;
+			}
+		}
+		sweepActiveMeshes.resize(numStillActive);
+
+		for (IdType iActive : sweepActiveMeshes)
+		{
+			if ((meshLowers[iMesh].array() <= meshUppers[iActive].array()).all()
+				&& (meshLowers[iActive].array() <= meshUppers[iMesh].array()).all())
+			{
+				overlappingPairs.emplace_back(std::min(iMesh, iActive), std::max(iMesh, iActive));
+				meshPartners[iMesh].push_back(iActive);
+				meshPartners[iActive].push_back(iMesh);
+			}
+		}
+		sweepActiveMeshes.push_back(iMesh);
+	}
+}
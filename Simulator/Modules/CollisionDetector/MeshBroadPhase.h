@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../TetMesh/TetMeshFEM.h"
+
+#include <memory>
+#include <vector>
+
+namespace GAIA {
+	// mesh level broad phase of the collision detection: the AABBs of the surfaces of the meshes are culled by sort-and-sweep
+	// along the axis with the largest spread of the AABB centers
+	// a mesh without overlapping partners can skip its per vertex queries, and a vertex only needs to be queried
+	// when it is in the AABB of one of the partners of its mesh
+	struct MeshBroadPhase
+	{
+		void initialize(const std::vector<std::shared_ptr<TetMeshFEM>>& in_tMeshes);
+
+		// swept: the AABBs also cover the positions at the beginning of the step, for the CCD
+		// selfCollision: every mesh active for collision is a partner of itself
+		// the meshes not active for collision take no part in the broad phase
+		void update(bool swept, bool selfCollision);
+
+		bool meshHasPartner(IdType iMesh) const { return !meshPartners[iMesh].empty(); }
+		// whether the box overlaps the AABB of one of the partners of iMesh
+		bool overlapsPartner(IdType iMesh, const Vec3& lower, const Vec3& upper) const;
+
+		std::vector<std::shared_ptr<TetMeshFEM>> tMeshes;
+
+		// nMeshes
+		std::vector<Vec3> meshLowers;
+		std::vector<Vec3> meshUppers;
+		// nMeshes x nPartners, including the mesh itself with selfCollision
+		std::vector<std::vector<IdType>> meshPartners;
+		// the overlapping pairs of different meshes, first < second
+		std::vector<std::pair<IdType, IdType>> overlappingPairs;
+
+		// the meshes active for collision, sorted by the lower bound of their AABBs along sweepAxis
+		std::vector<IdType> sortedMeshes;
+		// scratch buffer of the sweep
+		std::vector<IdType> sweepActiveMeshes;
+		int sweepAxis = 0;
+	};
+
+	inline bool MeshBroadPhase::overlapsPartner(IdType iMesh, const Vec3& lower, const Vec3& upper) const
+	{
+		for (IdType iPartner : meshPartners[iMesh])
+		{
+			if ((lower.array() <= meshUppers[iPartner].array()).all()
+				&& (meshLowers[iPartner].array() <= upper.array()).all())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
@@ -311,6 +311,11 @@ void GAIA::TriMeshContinuousCollisionDetector::initialize(std::vector<std::share
 
     vfCollisionResults.initialize(preAllocationRatio * numVerts);
     eeCollisionResults.initialize(preAllocationRatio * numEdges);
+    if (params.ccdSIMDFilter)
+    {
+        vfCandidates.initialize(candidatePreAllocationRatio * numVerts);
+        eeCandidates.initialize(candidatePreAllocationRatio * numEdges);
+    }
     
 }
 
@@ -353,18 +358,47 @@ void GAIA::TriMeshContinuousCollisionDetector::updateBVH(RTCBuildQuality quality
     rtcCommitScene(edgeTrajectoriesScene);
 }
 
-void vfCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_collisions)
+// v-f candidate: vertex primId0 of mesh geomId0 against face primId1 of mesh geomId1
+bool isValidVFCandidate(TriMeshContinuousCollisionDetector* pCCD, const CCDCandidate& candidate)
 {
-    TriMeshContinuousCollisionDetector* pCCD = (TriMeshContinuousCollisionDetector*)userPtr;
-    if (pCCD->vfCollisionResults.overflow)
+    // filter out the self collision
+    if (candidate.geomId0 == candidate.geomId1)
     {
-        return;
+        const GAIA::IdType* face = pCCD->ccdGeometries[candidate.geomId1].pMesh->facePos.col(candidate.primId1).data();
+        for (int iFV = 0; iFV < 3; iFV++)
+        {
+            if (candidate.primId0 == face[iFV])
+            {
+                return false;
+            }
+        }
     }
-    const int vId1 = collisions->primID0;
-    const int meshId1 = collisions->geomID0;
+    return true;
+}
 
-    const int fId2 = collisions->primID1;
-    const int meshId2 = collisions->geomID1;
+// the 3 face vertices and then the vertex, for CCDCoplanarityFilter
+void gatherVFCandidate(TriMeshContinuousCollisionDetector* pCCD, const CCDCandidate& candidate, Vec3 x0[4], Vec3 x1[4])
+{
+    const CCDGeometry& geom1 = pCCD->ccdGeometries[candidate.geomId0];
+    const CCDGeometry& geom2 = pCCD->ccdGeometries[candidate.geomId1];
+    const GAIA::IdType* face = geom2.pMesh->facePos.col(candidate.primId1).data();
+    for (int iFV = 0; iFV < 3; iFV++)
+    {
+        x0[iFV] = geom2.pPrevPos->col(face[iFV]);
+        x1[iFV] = geom2.pMesh->vertex(face[iFV]);
+    }
+    x0[3] = geom1.pPrevPos->col(candidate.primId0);
+    x1[3] = geom1.pMesh->vertex(candidate.primId0);
+}
+
+// solves a valid v-f candidate, returns whether it collides; the collision is added to vfCollisionResults if record is true
+bool solveVFCandidate(TriMeshContinuousCollisionDetector* pCCD, const CCDCandidate& candidate, bool record)
+{
+    const int vId1 = candidate.primId0;
+    const int meshId1 = candidate.geomId0;
+
+    const int fId2 = candidate.primId1;
+    const int meshId2 = candidate.geomId1;
 
     const TriMeshFEM::Ptr pMesh1 = pCCD->ccdGeometries[meshId1].pMesh;
     const TVerticesMat* pPrevPos1 = pCCD->ccdGeometries[meshId1].pPrevPos;
@@ -372,18 +406,6 @@ void vfCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_col
     const TVerticesMat* pPrevPos2 = pCCD->ccdGeometries[meshId2].pPrevPos;
     const GAIA::IdType* face = pMesh2->facePos.col(fId2).data();
 
-    // filter out the self collision
-    if (meshId1 == meshId2)
-    {
-        for (int iFV = 0; iFV < 3; iFV++)
-        {
-            if (vId1 == face[iFV])
-            {
-                return;
-            }
-        }
-    }
-
     // face from mesh 2
     cy::Vec3<CCDDType> fvs[2][3];
     for (int iFV = 0; iFV < 3; iFV++)
@@ -417,6 +439,10 @@ void vfCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_col
     CCDDType tt = -1;
     if (cy::IntersectContinuousTriPoint(tt, fvs, p, barycentrics))
     {
+        if (!record)
+        {
+            return true;
+        }
         const int curId = pCCD->vfCollisionResults.numCollisions++;
         if (curId < pCCD->vfCollisionResults.maxNumTriTriIntersections)
         {
@@ -450,7 +476,7 @@ void vfCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_col
 		else
 		{
 			pCCD->vfCollisionResults.overflow = true;
-			return;
+			return true;
         }
 
 
@@ -494,61 +520,103 @@ void vfCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_col
             assert(false);
         }
 #endif // DEBUG_CCD
+        return true;
     }
+    return false;
 }
 
-void eeCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_collisions)
+void vfCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_collisions)
 {
     TriMeshContinuousCollisionDetector* pCCD = (TriMeshContinuousCollisionDetector*)userPtr;
-    if (pCCD->eeCollisionResults.overflow)
+    CCDCandidateResults& candidates = pCCD->vfCandidates;
+    for (unsigned int iCollision = 0; iCollision < num_collisions; iCollision++)
     {
-        return;
-    }
-
-    const int eId1 = collisions->primID0;
-    const int meshId1 = collisions->geomID0;
-
-    const int eId2 = collisions->primID1;
-    const int meshId2 = collisions->geomID1;
-
-    const TriMeshFEM::Ptr pMesh1 = pCCD->ccdGeometries[meshId1].pMesh;
-    const TVerticesMat* pPrevPos1 = pCCD->ccdGeometries[meshId1].pPrevPos;
-    const TriMeshFEM::Ptr pMesh2 = pCCD->ccdGeometries[meshId2].pMesh;
-    const TVerticesMat* pPrevPos2 = pCCD->ccdGeometries[meshId2].pPrevPos;
-
-    const EdgeInfo & edgeInfo1 = pMesh1->pTopology->edgeInfos[eId1];
-    const EdgeInfo & edgeInfo2 = pMesh2->pTopology->edgeInfos[eId2];
-
-    //if (eId1 == 1440 && eId2 == 1351)
-    //{
-    //    std::cout << "Edge " << eId1 << " and " << eId2 << " collide!\n";
-    //}
+        const CCDCandidate candidate = { (int)collisions[iCollision].geomID0, (int)collisions[iCollision].primID0,
+            (int)collisions[iCollision].geomID1, (int)collisions[iCollision].primID1 };
+        if (!isValidVFCandidate(pCCD, candidate))
+        {
+            continue;
+        }
 
-    //if (eId1 == 1351 && eId2 == 1440)
-    //{
-    //    std::cout << "Edge " << eId1 << " and " << eId2 << " collide!\n";
-    //}
+        if (pCCD->params.ccdSIMDFilter)
+        {
+            // solved after the coplanarity filter
+            if (!candidates.add(candidate))
+            {
+                return;
+            }
+        }
+        else
+        {
+            if (pCCD->vfCollisionResults.overflow)
+            {
+                return;
+            }
+            solveVFCandidate(pCCD, candidate, true);
+        }
+    }
+}
 
+// e-e candidate: edge primId0 of mesh geomId0 against edge primId1 of mesh geomId1
+bool isValidEECandidate(TriMeshContinuousCollisionDetector* pCCD, const CCDCandidate& candidate)
+{
     // filter out the self collision
-    if (meshId1 == meshId2)
+    if (candidate.geomId0 == candidate.geomId1)
     {
         // same edge
-        if (eId1 == eId2)
+        if (candidate.primId0 == candidate.primId1)
         {
-            return;
+            return false;
         }
+        const TriMeshFEM::Ptr pMesh = pCCD->ccdGeometries[candidate.geomId0].pMesh;
+        const EdgeInfo& edgeInfo1 = pMesh->pTopology->edgeInfos[candidate.primId0];
+        const EdgeInfo& edgeInfo2 = pMesh->pTopology->edgeInfos[candidate.primId1];
         // adjacent edges
         if (edgeInfo1.eV1 == edgeInfo2.eV1
             || edgeInfo1.eV1 == edgeInfo2.eV2
             || edgeInfo1.eV2 == edgeInfo2.eV1
             || edgeInfo1.eV2 == edgeInfo2.eV2)
         {
-            return;
+            return false;
         }
     }
+    return true;
+}
+
+// the 2 vertices of the 1st edge and then the 2 vertices of the 2nd edge, for CCDCoplanarityFilter
+void gatherEECandidate(TriMeshContinuousCollisionDetector* pCCD, const CCDCandidate& candidate, Vec3 x0[4], Vec3 x1[4])
+{
+    const CCDGeometry& geom1 = pCCD->ccdGeometries[candidate.geomId0];
+    const CCDGeometry& geom2 = pCCD->ccdGeometries[candidate.geomId1];
+    const EdgeInfo& edgeInfo1 = geom1.pMesh->pTopology->edgeInfos[candidate.primId0];
+    const EdgeInfo& edgeInfo2 = geom2.pMesh->pTopology->edgeInfos[candidate.primId1];
+    x0[0] = geom1.pPrevPos->col(edgeInfo1.eV1);
+    x0[1] = geom1.pPrevPos->col(edgeInfo1.eV2);
+    x0[2] = geom2.pPrevPos->col(edgeInfo2.eV1);
+    x0[3] = geom2.pPrevPos->col(edgeInfo2.eV2);
+    x1[0] = geom1.pMesh->vertex(edgeInfo1.eV1);
+    x1[1] = geom1.pMesh->vertex(edgeInfo1.eV2);
+    x1[2] = geom2.pMesh->vertex(edgeInfo2.eV1);
+    x1[3] = geom2.pMesh->vertex(edgeInfo2.eV2);
+}
+
+// solves a valid e-e candidate, returns whether it collides; the collision is added to eeCollisionResults if record is true
+bool solveEECandidate(TriMeshContinuousCollisionDetector* pCCD, const CCDCandidate& candidate, bool record)
+{
+    const int eId1 = candidate.primId0;
+    const int meshId1 = candidate.geomId0;
 
+    const int eId2 = candidate.primId1;
+    const int meshId2 = candidate.geomId1;
+
+    const TriMeshFEM::Ptr pMesh1 = pCCD->ccdGeometries[meshId1].pMesh;
+    const TVerticesMat* pPrevPos1 = pCCD->ccdGeometries[meshId1].pPrevPos;
+    const TriMeshFEM::Ptr pMesh2 = pCCD->ccdGeometries[meshId2].pMesh;
+    const TVerticesMat* pPrevPos2 = pCCD->ccdGeometries[meshId2].pPrevPos;
+
+    const EdgeInfo & edgeInfo1 = pMesh1->pTopology->edgeInfos[eId1];
+    const EdgeInfo & edgeInfo2 = pMesh2->pTopology->edgeInfos[eId2];
 
-    
     cy::Vec3<CCDDType> e0[2][2];
     cy::Vec3<CCDDType> e1[2][2];
 
@@ -583,6 +651,10 @@ void eeCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_col
 
     if (cy::IntersectContinuousEdgeEdge(tt, e0, e1))
     {
+        if (!record)
+        {
+            return true;
+        }
         const int curId = pCCD->eeCollisionResults.numCollisions++;
         if (curId < pCCD->eeCollisionResults.maxNumTriTriIntersections)
         {
@@ -607,6 +679,11 @@ void eeCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_col
 
             curCollision.t = tt;
 
+            curCollision.edgeId1 = eId1;
+            curCollision.edgeMeshId1 = meshId1;
+            curCollision.edgeId2 = eId2;
+            curCollision.edgeMeshId2 = meshId2;
+
 #ifdef RECORD_COLLIDING_POINT
             Vec3 c;
             c << c1.x, c1.y, c1.z;
@@ -644,28 +721,111 @@ void eeCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_col
         else
         {
             pCCD->eeCollisionResults.overflow = true;
-            return;
+            return true;
         }
 
 
         
 #endif // DEBUG_CCD
+        return true;
+    }
+    return false;
+}
+
+void eeCollideFunc(void* userPtr, RTCCollision* collisions, unsigned int num_collisions)
+{
+    TriMeshContinuousCollisionDetector* pCCD = (TriMeshContinuousCollisionDetector*)userPtr;
+    CCDCandidateResults& candidates = pCCD->eeCandidates;
+    for (unsigned int iCollision = 0; iCollision < num_collisions; iCollision++)
+    {
+        const CCDCandidate candidate = { (int)collisions[iCollision].geomID0, (int)collisions[iCollision].primID0,
+            (int)collisions[iCollision].geomID1, (int)collisions[iCollision].primID1 };
+        if (!isValidEECandidate(pCCD, candidate))
+        {
+            continue;
+        }
+
+        if (pCCD->params.ccdSIMDFilter)
+        {
+            // solved after the coplanarity filter
+            if (!candidates.add(candidate))
+            {
+                return;
+            }
+        }
+        else
+        {
+            if (pCCD->eeCollisionResults.overflow)
+            {
+                return;
+            }
+            solveEECandidate(pCCD, candidate, true);
+        }
+    }
+}
+
+template<typename GatherFunc, typename SolveFunc>
+void filterAndSolveCandidates(TriMeshContinuousCollisionDetector* pCCD, CCDCandidateResults& candidates, 
+    GatherFunc& gatherFunc, SolveFunc& solveFunc, const char* name)
+{
+    auto gatherCandidate = [&](const CCDCandidate& candidate, Vec3 x0[4], Vec3 x1[4]) {
+        gatherFunc(pCCD, candidate, x0, x1);
+    };
+    auto solveCandidate = [&](const CCDCandidate& candidate, bool record) {
+        return solveFunc(pCCD, candidate, record);
+    };
+
+    CCDCoplanarityFilter& filter = pCCD->coplanarityFilter;
+    filter.filter(candidates.collisions.data(), candidates.numCollisions, gatherCandidate);
+    filter.solveSurvivingCandidates(candidates.collisions.data(), solveCandidate);
+    if (pCCD->params.ccdSIMDFilterValidation)
+    {
+        filter.validate(candidates.collisions.data(), solveCandidate, name);
     }
 }
 
 bool GAIA::TriMeshContinuousCollisionDetector::continuousCollisionDetection()
 {
-    do
+    if (params.ccdSIMDFilter)
     {
-        vfCollisionResults.clear();
-        rtcCollide(vertexTrajectoriesScene, triangleTrajectoriesScene, vfCollideFunc, this);
-    } while (vfCollisionResults.overflow);
+        do
+        {
+            vfCandidates.clear();
+            rtcCollide(vertexTrajectoriesScene, triangleTrajectoriesScene, vfCollideFunc, this);
+        } while (vfCandidates.overflow);
+
+        do
+        {
+            vfCollisionResults.clear();
+            filterAndSolveCandidates(this, vfCandidates, gatherVFCandidate, solveVFCandidate, "v-f");
+        } while (vfCollisionResults.overflow);
 
-    do
+        do
+        {
+            eeCandidates.clear();
+            rtcCollide(edgeTrajectoriesScene, edgeTrajectoriesScene, eeCollideFunc, this);
+        } while (eeCandidates.overflow);
+
+        do
+        {
+            eeCollisionResults.clear();
+            filterAndSolveCandidates(this, eeCandidates, gatherEECandidate, solveEECandidate, "e-e");
+        } while (eeCollisionResults.overflow);
+    }
+    else
     {
-        eeCollisionResults.clear();
-        rtcCollide(edgeTrajectoriesScene, edgeTrajectoriesScene, eeCollideFunc, this);
-    } while (eeCollisionResults.overflow);
+        do
+        {
+            vfCollisionResults.clear();
+            rtcCollide(vertexTrajectoriesScene, triangleTrajectoriesScene, vfCollideFunc, this);
+        } while (vfCollisionResults.overflow);
+
+        do
+        {
+            eeCollisionResults.clear();
+            rtcCollide(edgeTrajectoriesScene, edgeTrajectoriesScene, eeCollideFunc, this);
+        } while (eeCollisionResults.overflow);
+    }
 
     //rtcCollide
     return false;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DiscreteCollisionDetector.h"
+#include "CCDCoplanarityFilter.h"
 
 #define RECORD_COLLIDING_POINT
 
@@ -35,6 +36,12 @@ namespace GAIA {
 		FloatingType miu2;
 
 		FloatingType t;
+
+		int edgeId1;
+		int edgeMeshId1;
+
+		int edgeId2;
+		int edgeMeshId2;
 	};
 
 	template<typename T>
@@ -54,6 +61,17 @@ namespace GAIA {
 			}
 		}
 
+		// thread safe; returns false and sets overflow if the buffer is full
+		bool add(const T& collision) {
+			const int curId = numCollisions++;
+			if (curId < maxNumTriTriIntersections) {
+				collisions[curId] = collision;
+				return true;
+			}
+			overflow = true;
+			return false;
+		}
+
 		size_t maxNumTriTriIntersections = -1;
 		std::atomic<int> numCollisions = 0;
 		bool overflow = false;
@@ -65,6 +83,7 @@ namespace GAIA {
 
 	typedef CollisionResults<VFCollision> VFCollisionResults;
 	typedef CollisionResults<EECollision> EECollisionResults;
+	typedef CollisionResults<CCDCandidate> CCDCandidateResults;
 
 	struct TriMeshContinuousCollisionDetector {
 		typedef std::shared_ptr<TriMeshContinuousCollisionDetector> SharedPtr;
@@ -88,7 +107,13 @@ namespace GAIA {
 		VFCollisionResults vfCollisionResults;
 		EECollisionResults eeCollisionResults;
 
+		// with params.ccdSIMDFilter, the candidates from the BVH are buffered, filtered by coplanarityFilter and then solved
+		CCDCandidateResults vfCandidates;
+		CCDCandidateResults eeCandidates;
+		CCDCoplanarityFilter coplanarityFilter;
+
 		float preAllocationRatio=0.25f;
+		float candidatePreAllocationRatio=2.f;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+// Host-only stand-in for the subset of the CUDA runtime that GAIA and CuMatrix use.
+// This directory is put on the include path only when GAIA is configured with GAIA_WITH_CUDA=OFF,
+// in which case GAIA_NO_CUDA is defined and no .cu translation unit is compiled.
+// "Device" memory is plain host memory, streams and graphs are no-ops and copies are synchronous,
+// so the GPU data structures (ManagedBuffer, DeviceClassBuffer, *MeshGPU) keep working on the CPU.
+
+#ifndef GAIA_NO_CUDA
+#error "CudaCompat/cuda_runtime.h must only be used when building with GAIA_NO_CUDA."
+#endif // !GAIA_NO_CUDA
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+
+#include "vector_types.h"
+
+#define __host__
+#define __device__
+#define __global__
+#define __shared__
+#define __constant__
+#define __managed__
+#define __forceinline__ inline
+
+enum cudaError
+{
+	cudaSuccess = 0,
+	cudaErrorInvalidValue = 1,
+	cudaErrorMemoryAllocation = 2,
+	cudaErrorNotSupported = 801
+};
+typedef enum cudaError cudaError_t;
+
+enum cudaMemcpyKind
+{
+	cudaMemcpyHostToHost = 0,
+	cudaMemcpyHostToDevice = 1,
+	cudaMemcpyDeviceToHost = 2,
+	cudaMemcpyDeviceToDevice = 3,
+	cudaMemcpyDefault = 4
+};
+
+enum cudaStreamCaptureMode
+{
+	cudaStreamCaptureModeGlobal = 0,
+	cudaStreamCaptureModeThreadLocal = 1,
+	cudaStreamCaptureModeRelaxed = 2
+};
+
+#define cudaHostRegisterDefault 0x00
+#define cudaHostAllocDefault 0x00
+
+typedef struct CUstream_st* cudaStream_t;
+typedef struct CUgraph_st* cudaGraph_t;
+typedef struct CUgraphExec_st* cudaGraphExec_t;
+typedef struct CUgraphNode_st* cudaGraphNode_t;
+
+inline const char* cudaGetErrorString(cudaError_t error)
+{
+	switch (error)
+	{
+	case cudaSuccess:
+		return "no error";
+	case cudaErrorInvalidValue:
+		return "invalid argument";
+	case cudaErrorMemoryAllocation:
+		return "out of memory";
+	case cudaErrorNotSupported:
+		return "operation not supported in a CPU-only build";
+	default:
+		return "unknown error";
+	}
+}
+
+inline cudaError_t cudaGetLastError() { return cudaSuccess; }
+
+// memory
+inline cudaError_t cudaHostMemAlloc_(void** ptr, size_t size)
+{
+	if (size == 0)
+	{
+		*ptr = nullptr;
+		return cudaSuccess;
+	}
+	*ptr = std::malloc(size);
+	return *ptr != nullptr ? cudaSuccess : cudaErrorMemoryAllocation;
+}
+
+inline cudaError_t cudaMalloc(void** ptr, size_t size) { return cudaHostMemAlloc_(ptr, size); }
+inline cudaError_t cudaMallocManaged(void** ptr, size_t size, unsigned int flags = 0) { return cudaHostMemAlloc_(ptr, size); }
+inline cudaError_t cudaMallocHost(void** ptr, size_t size) { return cudaHostMemAlloc_(ptr, size); }
+inline cudaError_t cudaHostAlloc(void** ptr, size_t size, unsigned int flags) { return cudaHostMemAlloc_(ptr, size); }
+inline cudaError_t cudaFree(void* ptr) { std::free(ptr); return cudaSuccess; }
+inline cudaError_t cudaFreeHost(void* ptr) { std::free(ptr); return cudaSuccess; }
+
+inline cudaError_t cudaHostRegister(void* ptr, size_t size, unsigned int flags) { return cudaSuccess; }
+inline cudaError_t cudaHostUnregister(void* ptr) { return cudaSuccess; }
+
+inline cudaError_t cudaMemcpy(void* dst, const void* src, size_t count, cudaMemcpyKind kind)
+{
+	if (count != 0 && dst != src)
+	{
+		std::memcpy(dst, src, count);
+	}
+	return cudaSuccess;
+}
+
+inline cudaError_t cudaMemcpyAsync(void* dst, const void* src, size_t count, cudaMemcpyKind kind, cudaStream_t stream = 0)
+{
+	return cudaMemcpy(dst, src, count, kind);
+}
+
+inline cudaError_t cudaMemset(void* ptr, int value, size_t count)
+{
+	if (count != 0)
+	{
+		std::memset(ptr, value, count);
+	}
+	return cudaSuccess;
+}
+
+inline cudaError_t cudaMemsetAsync(void* ptr, int value, size_t count, cudaStream_t stream = 0)
+{
+	return cudaMemset(ptr, value, count);
+}
+
+// synchronization: everything above is synchronous already
+inline cudaError_t cudaDeviceSynchronize() { return cudaSuccess; }
+inline cudaError_t cudaStreamCreate(cudaStream_t* pStream) { *pStream = nullptr; return cudaSuccess; }
+inline cudaError_t cudaStreamDestroy(cudaStream_t stream) { return cudaSuccess; }
+inline cudaError_t cudaStreamSynchronize(cudaStream_t stream) { return cudaSuccess; }
+
+// graphs cannot be captured without kernels, report it to the caller
+inline cudaError_t cudaStreamBeginCapture(cudaStream_t stream, cudaStreamCaptureMode mode) { return cudaErrorNotSupported; }
+inline cudaError_t cudaStreamEndCapture(cudaStream_t stream, cudaGraph_t* pGraph) { *pGraph = nullptr; return cudaErrorNotSupported; }
+inline cudaError_t cudaGraphInstantiate(cudaGraphExec_t* pGraphExec, cudaGraph_t graph, cudaGraphNode_t* pErrorNode, char* pLogBuffer, size_t bufferSize)
+{
+	*pGraphExec = nullptr;
+	return cudaErrorNotSupported;
+}
+inline cudaError_t cudaGraphLaunch(cudaGraphExec_t graphExec, cudaStream_t stream) { return cudaErrorNotSupported; }
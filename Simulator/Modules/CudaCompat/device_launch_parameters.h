@@ -0,0 +1,10 @@
+#pragma once
+// Host-only stand-in for the kernel built-in variables, see cuda_runtime.h in this directory.
+// They only exist so that kernel templates in shared headers parse; no kernel is ever launched
+// in a CPU-only build, and a single-thread single-block launch is what they describe.
+#include "vector_types.h"
+
+static const uint3 threadIdx = { 0, 0, 0 };
+static const uint3 blockIdx = { 0, 0, 0 };
+static const dim3 blockDim = dim3(1, 1, 1);
+static const dim3 gridDim = dim3(1, 1, 1);
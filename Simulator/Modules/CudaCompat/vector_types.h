@@ -0,0 +1,41 @@
+#pragma once
+// Host-only stand-in for CUDA's built-in vector types, see cuda_runtime.h in this directory.
+
+#define CUDA_COMPAT_VECTOR_TYPE_2(T, name) \
+	struct name { T x, y; }; \
+	inline name make_##name(T x, T y) { name v; v.x = x; v.y = y; return v; }
+
+#define CUDA_COMPAT_VECTOR_TYPE_3(T, name) \
+	struct name { T x, y, z; }; \
+	inline name make_##name(T x, T y, T z) { name v; v.x = x; v.y = y; v.z = z; return v; }
+
+#define CUDA_COMPAT_VECTOR_TYPE_4(T, name) \
+	struct name { T x, y, z, w; }; \
+	inline name make_##name(T x, T y, T z, T w) { name v; v.x = x; v.y = y; v.z = z; v.w = w; return v; }
+
+#define CUDA_COMPAT_VECTOR_TYPES(T, name) \
+	CUDA_COMPAT_VECTOR_TYPE_2(T, name##2) \
+	CUDA_COMPAT_VECTOR_TYPE_3(T, name##3) \
+	CUDA_COMPAT_VECTOR_TYPE_4(T, name##4)
+
+CUDA_COMPAT_VECTOR_TYPES(signed char, char)
+CUDA_COMPAT_VECTOR_TYPES(unsigned char, uchar)
+CUDA_COMPAT_VECTOR_TYPES(short, short)
+CUDA_COMPAT_VECTOR_TYPES(unsigned short, ushort)
+CUDA_COMPAT_VECTOR_TYPES(int, int)
+CUDA_COMPAT_VECTOR_TYPES(unsigned int, uint)
+CUDA_COMPAT_VECTOR_TYPES(long long, longlong)
+CUDA_COMPAT_VECTOR_TYPES(unsigned long long, ulonglong)
+CUDA_COMPAT_VECTOR_TYPES(float, float)
+CUDA_COMPAT_VECTOR_TYPES(double, double)
+
+#undef CUDA_COMPAT_VECTOR_TYPES
+#undef CUDA_COMPAT_VECTOR_TYPE_4
+#undef CUDA_COMPAT_VECTOR_TYPE_3
+#undef CUDA_COMPAT_VECTOR_TYPE_2
+
+struct dim3
+{
+	unsigned int x, y, z;
+	constexpr dim3(unsigned int vx = 1, unsigned int vy = 1, unsigned int vz = 1) : x(vx), y(vy), z(vz) {}
+};
@@ -28,6 +28,8 @@ namespace GAIA {
         virtual void updateCollider();
 
 		virtual void writeOutputs(std::string outFolder, int frameId);
+		// the cloth outputs are written synchronously
+		virtual void writeOutputsAsync(std::string outFolder, int frameId) { writeOutputs(outFolder, frameId); }
 		virtual void runStep()=0;
         virtual void recoverFromState(std::string& stateFile);
 
@@ -10,6 +10,7 @@
 
 #include "../IO/FileIO.h"
 #include "../Timer/Timer.h"
+#include "../Timer/Profiler.h"
 
 #include "../Parallelization/CPUParallelization.h"
 
@@ -132,7 +133,13 @@ void GAIA::BasePhysicFramework::initialize()
 			std::lock_guard<std::mutex> meshMFPtrsLockGuard(tmeshMFPtrs_lock);
 
 			auto pTMeshMFItem = tmeshMFPtrs.find(modelPath);
-			if (pTMeshMFItem == tmeshMFPtrs.end())
+			if (objectParamsList->objectParams[iMesh]->useBinaryMeshCache && TetMeshBinaryCache::isValid(objectParamsList->objectParams[iMesh]))
+			{
+				// the mesh will be loaded from the binary cache by TetMeshFEM::initialize, no need to parse the input file
+				pTM_MF = nullptr;
+				loadSucceed = true;
+			}
+			else if (pTMeshMFItem == tmeshMFPtrs.end())
 			{
 				pTM_MF = std::make_shared<TetMeshMF>();
 				if (fp.ext == ".t")
@@ -160,9 +167,17 @@ void GAIA::BasePhysicFramework::initialize()
 				pTM_MF = pTMeshMFItem->second;
 			}
 
-			std::cout << "Adding " << objectParamsList->objectParams[iMesh]->materialName
-				<< " tetmesh: " << modelPath << "\n"
-				<< "with " << pTM_MF->numVertices() << " vertices and " << pTM_MF->numTets() << " tets.\n";
+			if (pTM_MF != nullptr)
+			{
+				std::cout << "Adding " << objectParamsList->objectParams[iMesh]->materialName
+					<< " tetmesh: " << modelPath << "\n"
+					<< "with " << pTM_MF->numVertices() << " vertices and " << pTM_MF->numTets() << " tets.\n";
+			}
+			else
+			{
+				std::cout << "Adding " << objectParamsList->objectParams[iMesh]->materialName
+					<< " tetmesh: " << modelPath << " from the binary mesh cache.\n";
+			}
 		}
 
 		if (loadSucceed) {
@@ -261,17 +276,32 @@ void GAIA::BasePhysicFramework::initializeCollisionDetector()
 	if (baseCollisionParams->allowDCD) {
 		pDCD = std::make_shared<DiscreteCollisionDetector>(*baseCollisionParams);
 		pDCD->initialize(basetetMeshes);
+		pDCD->recordCoherenceStatistics = basePhysicsParams->doStatistics;
 	}
 }
 
 void GAIA::BasePhysicFramework::recoverFromState(std::string& stateFile)
 {
-	PhysicsState state;
 	std::cout << "----------------------------------------------------\n"
 		<< "Recovering state from:" << stateFile << "\n"
 		<< "----------------------------------------------------\n";
-	state.loadFromJsonFile(stateFile, &stateFile);
-	state.initializePhysics(*this);
+	if (Checkpoint::isCheckpoint(stateFile))
+	{
+		double checkpointTime = 0;
+		if (!Checkpoint::read(stateFile, frameId, checkpointTime, basetetMeshes))
+		{
+			// the meshes may be partially overwritten, continuing would also overwrite the outputs from frame 0
+			std::cout << "[Error] Fail to recover from checkpoint: " << stateFile << std::endl;
+			exit(-1);
+		}
+		curTime = checkpointTime;
+	}
+	else
+	{
+		PhysicsState state;
+		state.loadFromJsonFile(stateFile, &stateFile);
+		state.initializePhysics(*this);
+	}
 
 	if (baseCollisionParams->allowDCD)
 	{
@@ -292,6 +322,11 @@ void GAIA::BasePhysicFramework::simulate()
 		<< "----------------------------------------------------\n"
 		<< "Output folder is: " << outputFolder << std::endl;
 
+	if (basePhysicsParams->profile)
+	{
+		Profiler::start(basePhysicsParams->profilerEventsPerThread);
+	}
+
 	writeOutputs(outputFolder, frameId);
 	std::cout
 		<< "----------------------------------------------------\n"
@@ -307,6 +342,7 @@ void GAIA::BasePhysicFramework::simulate()
 		// viewer must run in the main thread, therefore we need to open a thread to do the compute
 		std::thread t([this]() {
 			while (frameId < basePhysicsParams->numFrames) {
+				GAIA_PROFILE_SCOPE_I("Frame", frameId);
 				TICK(timeCsmpFrame);
 				debugOperation(DEBUG_LVL_INFO, [&]() {
 					std::cout
@@ -322,8 +358,16 @@ void GAIA::BasePhysicFramework::simulate()
 
 				if (basePhysicsParams->saveOutputs)
 				{
+					GAIA_PROFILE_SCOPE("SaveOutputs");
 					TICK(timeCsmpSaveOutputs);
-					writeOutputs(outputFolder, frameId);
+					if (basePhysicsParams->asyncOutput)
+					{
+						writeOutputsAsync(outputFolder, frameId);
+					}
+					else
+					{
+						writeOutputs(outputFolder, frameId);
+					}
 					TOCK_STRUCT((*baseTimeStatistics), timeCsmpSaveOutputs);
 				}
 
@@ -350,6 +394,7 @@ void GAIA::BasePhysicFramework::simulate()
 	else
 	{
 		while (frameId < basePhysicsParams->numFrames) {
+			GAIA_PROFILE_SCOPE_I("Frame", frameId);
 			TICK(timeCsmpFrame);
 			debugOperation(DEBUG_LVL_INFO, [&]() {
 				std::cout
@@ -365,8 +410,16 @@ void GAIA::BasePhysicFramework::simulate()
 
 			if (basePhysicsParams->saveOutputs)
 			{
+				GAIA_PROFILE_SCOPE("SaveOutputs");
 				TICK(timeCsmpSaveOutputs);
-				writeOutputs(outputFolder, frameId);
+				if (basePhysicsParams->asyncOutput)
+				{
+					writeOutputsAsync(outputFolder, frameId);
+				}
+				else
+				{
+					writeOutputs(outputFolder, frameId);
+				}
 				TOCK_STRUCT((*baseTimeStatistics), timeCsmpSaveOutputs);
 			}
 
@@ -387,7 +440,28 @@ void GAIA::BasePhysicFramework::simulate()
 			baseTimeStatistics->setToZero();
 		}
 	}
-	
+
+	if (pOutputWriter != nullptr)
+	{
+		// make sure every frame is on the disk before returning
+		pOutputWriter->stop();
+		pOutputWriter = nullptr;
+	}
+
+	if (pTrajectoryWriter != nullptr)
+	{
+		pTrajectoryWriter->close();
+	}
+
+	if (basePhysicsParams->profile)
+	{
+		writeProfilerOutputs(outputFolder);
+	}
+}
+
+void GAIA::BasePhysicFramework::writeProfilerOutputs(std::string outFolder)
+{
+	Profiler::writeOutputs(outFolder, basePhysicsParams->debugVerboseLvl);
 }
 
 std::string GAIA::BasePhysicFramework::getDebugFolder()
@@ -439,6 +513,70 @@ void GAIA::BasePhysicFramework::setUpOutputFolders(std::string outFolder)
 
 void GAIA::BasePhysicFramework::writeOutputs(std::string outFolder, int frameId)
 {
+	FrameOutputSnapshot snapshot;
+	snapshot.frameId = frameId;
+	snapshot.curTime = curTime;
+	snapshot.tetMeshes = basetetMeshes;
+	snapshot.hasVelocities = true;
+	if (basePhysicsParams->outputStatistics)
+	{
+		baseTimeStatistics->toJson(snapshot.statistics);
+	}
+
+	writeFrameOutputs(outFolder, snapshot);
+	writeCheckpoint(outFolder, frameId);
+}
+
+void GAIA::BasePhysicFramework::writeOutputsAsync(std::string outFolder, int frameId)
+{
+	if (pOutputWriter == nullptr)
+	{
+		pOutputWriter = std::make_shared<AsyncOutputWriter>();
+		pOutputWriter->start(basePhysicsParams->numAsyncOutputBuffers, [this, outFolder](FrameOutputSnapshot& snapshot) {
+			writeFrameOutputs(outFolder, snapshot);
+			});
+	}
+
+	// blocks if the writer is numAsyncOutputBuffers frames behind
+	FrameOutputSnapshot& snapshot = pOutputWriter->acquireSnapshot();
+	snapshot.frameId = frameId;
+	snapshot.curTime = curTime;
+	// the velocities are only needed by the json recovery states
+	snapshot.hasVelocities = basePhysicsParams->outputRecoveryState && !basePhysicsParams->outputRecoveryStateCheckpoint
+		&& !(frameId % basePhysicsParams->outputRecoveryStateStep);
+	AsyncOutputWriter::copyMeshes(basetetMeshes, snapshot.tetMeshes, snapshot.hasVelocities);
+	if (basePhysicsParams->outputStatistics)
+	{
+		snapshot.statistics.clear();
+		baseTimeStatistics->toJson(snapshot.statistics);
+	}
+
+	pOutputWriter->submitSnapshot(snapshot);
+	// the checkpoints need the whole stepping state which the snapshots don't hold, they are written from the meshes directly
+	writeCheckpoint(outFolder, frameId);
+}
+
+void GAIA::BasePhysicFramework::writeCheckpoint(std::string outFolder, int frameId)
+{
+	if (!basePhysicsParams->outputRecoveryState || !basePhysicsParams->outputRecoveryStateCheckpoint
+		|| frameId % basePhysicsParams->outputRecoveryStateStep)
+	{
+		return;
+	}
+	GAIA_PROFILE_SCOPE("WriteCheckpoint");
+
+	std::ostringstream aSs;
+	aSs << std::setfill('0') << std::setw(8) << frameId;
+	std::string outFileState = outFolder + "/RecoveryStates/A" + aSs.str() + ".ckpt";
+	Checkpoint::write(outFileState, frameId, curTime, basetetMeshes);
+}
+
+void GAIA::BasePhysicFramework::writeFrameOutputs(std::string outFolder, FrameOutputSnapshot& snapshot)
+{
+	GAIA_PROFILE_SCOPE_I("WriteFrameOutputs", snapshot.frameId);
+	int frameId = snapshot.frameId;
+	std::vector<TetMeshFEM::SharedPtr>& tetMeshes = snapshot.tetMeshes;
+
 	std::ostringstream aSs;
 	aSs << std::setfill('0') << std::setw(8) << frameId;
 	std::string outNumber = aSs.str();
@@ -457,20 +595,43 @@ void GAIA::BasePhysicFramework::writeOutputs(std::string outFolder, int frameId)
 			MF::IO::createFolder(templateMeshOutOutPath);
 
 			std::string templateMeshesName = outFolder + "/TemplateMesh/TemplateMesh.ply";
-			writeAllToPLY(templateMeshesName.c_str(), basetetMeshes, false, true);
+			writeAllToPLY(templateMeshesName.c_str(), tetMeshes, false, true);
 		}
-		writeAllToBinary(outFile.c_str(), basetetMeshes);
+		writeAllToBinary(outFile.c_str(), tetMeshes);
 
 		if (!(frameId % basePhysicsParams->binaryModeVisualizationSteps))
 		{
 			std::string outFileVis = outFolder + "/A" + outNumber + ".ply";
 
-			writeAllToPLY(outFileVis.c_str(), basetetMeshes, basePhysicsParams->saveAllModelsTogether, basePhysicsParams->saveAllModelsTogether);
+			writeAllToPLY(outFileVis.c_str(), tetMeshes, basePhysicsParams->saveAllModelsTogether, basePhysicsParams->saveAllModelsTogether);
+		}
+	}
+	else if (basePhysicsParams->outputExt == "traj")
+	{
+		if (pTrajectoryWriter == nullptr)
+		{
+			std::string templateMeshOutOutPath = outFolder + "/TemplateMesh";
+			MF::IO::createFolder(templateMeshOutOutPath);
+
+			std::string templateMeshesName = outFolder + "/TemplateMesh/TemplateMesh.ply";
+			writeAllToPLY(templateMeshesName.c_str(), tetMeshes, false, true);
+
+			pTrajectoryWriter = std::make_shared<TrajectoryWriter>();
+			pTrajectoryWriter->open(outFolder + "/Trajectory.traj", tetMeshes, basePhysicsParams->trajectoryQuantizationTolerance,
+				basePhysicsParams->trajectoryKeyframeInterval);
+		}
+		pTrajectoryWriter->writeFrame(frameId, tetMeshes);
+
+		if (!(frameId % basePhysicsParams->binaryModeVisualizationSteps))
+		{
+			std::string outFileVis = outFolder + "/A" + outNumber + ".ply";
+
+			writeAllToPLY(outFileVis.c_str(), tetMeshes, basePhysicsParams->saveAllModelsTogether, basePhysicsParams->saveAllModelsTogether);
 		}
 	}
 	else if (basePhysicsParams->outputExt == "ply")
 	{
-		writeAllToPLY(outFile.c_str(), basetetMeshes, basePhysicsParams->saveAllModelsTogether, basePhysicsParams->saveAllModelsTogether);
+		writeAllToPLY(outFile.c_str(), tetMeshes, basePhysicsParams->saveAllModelsTogether, basePhysicsParams->saveAllModelsTogether);
 	}
 	else if (basePhysicsParams->outputExt == "obj") {
 		// writeAllToObj(outFile.c_str(), getSoftBodies(), physicsAllParams.pPhysicsParams.saveAllModelsTogether);
@@ -494,7 +655,11 @@ void GAIA::BasePhysicFramework::writeOutputs(std::string outFolder, int frameId)
 	if (basePhysicsParams->outputStatistics)
 	{
 		//pSoftbodyManager->statistics.writeToJsonFile(outFolder + "/Statistics.json");
-		baseTimeStatistics->writeToJsonFile(tetMeshOutStatistics + "/A" + outNumber + ".json");
+		std::ofstream ofs(tetMeshOutStatistics + "/A" + outNumber + ".json");
+		if (ofs.is_open())
+		{
+			ofs << snapshot.statistics.dump();
+		}
 		if (frameId % basePhysicsParams->outputRecoveryStateStep == 0) {
 #ifdef DO_COLLISION_STATISTICS
 			collisionStatistics.writeToJsonFile(tetMeshOutStatistics + "/CollisionStatisticsAll.json");
@@ -503,14 +668,16 @@ void GAIA::BasePhysicFramework::writeOutputs(std::string outFolder, int frameId)
 		}
 	}
 
-	if (basePhysicsParams->outputRecoveryState && !(frameId % basePhysicsParams->outputRecoveryStateStep))
+	if (basePhysicsParams->outputRecoveryState && !basePhysicsParams->outputRecoveryStateCheckpoint
+		&& !(frameId % basePhysicsParams->outputRecoveryStateStep))
 	{
 		std::string stateOutOutPath = outFolder + "/RecoveryStates";
 		PhysicsState state;
 
 		std::string outFileState = stateOutOutPath + "/A" + outNumber + ".json";
 		state.binary = basePhysicsParams->outputRecoveryStateBinary;
-		state.fromPhysics(*this);
+		assert(snapshot.hasVelocities);
+		state.fromMeshes(frameId, snapshot.curTime, tetMeshes);
 		state.writeToJsonFile(outFileState, 2, &outFileState);
 
 	}
@@ -6,6 +6,9 @@
 #include "../Materials/Materials.h"
 #include "../TetMesh/TetMeshFEM.h"
 #include "../Viewer/Viewer.h"
+#include "../IO/AsyncOutputWriter.h"
+#include "../IO/TrajectoryIO.h"
+#include "../IO/Checkpoint.h"
 
 #include "../Utility/Logger.h"
 #include <MeshFrame/Utility/Str.h>
@@ -54,6 +57,10 @@ namespace GAIA {
 
 		std::shared_ptr<Viewer> pViewer;
 
+		AsyncOutputWriter::SharedPtr pOutputWriter;
+		// for outputExt "traj", created at the first output frame
+		TrajectoryWriter::SharedPtr pTrajectoryWriter;
+
 		void updateWorldBox();
 		virtual void loadRunningparameters(std::string inModelInputFile, std::string inParameterFile, std::string outFolder);
 		virtual void parseRunningParameters();
@@ -81,6 +88,14 @@ namespace GAIA {
 
 		virtual void setUpOutputFolders(std::string outFolder);
 		virtual void writeOutputs(std::string outFolder, int frameId);
+		// snapshots the meshes and hands them to pOutputWriter, the files are written on its thread
+		virtual void writeOutputsAsync(std::string outFolder, int frameId);
+		// only reads the snapshot and the parameters, so it can run on the writer thread
+		virtual void writeFrameOutputs(std::string outFolder, FrameOutputSnapshot& snapshot);
+		// writes RecoveryStates/A<frameId>.ckpt from the simulated meshes when outputRecoveryStateCheckpoint is on
+		virtual void writeCheckpoint(std::string outFolder, int frameId);
+		// stops the profiler and writes its trace and summary to outFolder/Profile
+		virtual void writeProfilerOutputs(std::string outFolder);
 		virtual void saveExperimentParameters(const std::string& paramsOutOutPath, int indent = 2);
 
 		virtual bool writeSimulationParameters(nlohmann::json& outPhysicsParams);
@@ -149,13 +164,17 @@ namespace GAIA {
 		bool binary = false;
 
 		void fromPhysics(const BasePhysicFramework& physics) {
-			frameId = physics.frameId;
-			curTime = physics.curTime;
+			fromMeshes(physics.frameId, physics.curTime, physics.basetetMeshes);
+		}
+
+		void fromMeshes(int inFrameId, double inCurTime, const std::vector<TetMeshFEM::SharedPtr>& tetMeshes) {
+			frameId = inFrameId;
+			curTime = inCurTime;
 			meshesState.clear();
-			for (size_t iMesh = 0; iMesh < physics.basetetMeshes.size(); iMesh++)
+			for (size_t iMesh = 0; iMesh < tetMeshes.size(); iMesh++)
 			{
 				meshesState.emplace_back();
-				TetMeshFEM::SharedPtr pTM = physics.basetetMeshes[iMesh];
+				const TetMeshFEM::SharedPtr& pTM = tetMeshes[iMesh];
 
                 for (size_t iP = 0; iP < pTM->numVertices(); iP++)
                 {
@@ -43,6 +43,7 @@ namespace GAIA {
             unsigned size() { return this->graph.size(); }
             bool is_colored();
             vector<int>& get_coloring() { return this->graph_colors; }
+            vector<vector<int>>& get_categories() { return this->categories; }
             int get_color(int node) { return graph_colors[node]; }
             int get_num_colors();
             bool is_valid();
@@ -0,0 +1,93 @@
+#include "JonesPlassmann.h"
+#include "../Parallelization/CPUParallelization.h"
+
+#include <cstdint>
+
+using std::vector;
+
+bool GAIA::GraphColoring::JonesPlassmann::higherPriority(int node1, int node2)
+{
+	return priorities[node1] > priorities[node2] || (priorities[node1] == priorities[node2] && node1 > node2);
+}
+
+vector<int>& GAIA::GraphColoring::JonesPlassmann::color()
+{
+	const int numNodes = graph.size();
+
+	// a hash of the node id instead of a random number, to make the coloring reproducible
+	priorities.resize(numNodes);
+	auto initializeFunc = [&](int iNode) {
+		uint32_t h = iNode;
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		priorities[iNode] = h;
+		graph_colors[iNode] = -1;
+	};
+	cpu_parallel_for(0, numNodes, initializeFunc);
+
+	std::vector<int> uncolored(numNodes);
+	for (int iNode = 0; iNode < numNodes; iNode++)
+	{
+		uncolored[iNode] = iNode;
+	}
+	std::vector<char> isLocalMax(numNodes);
+
+	int numRounds = 0;
+	while (uncolored.size())
+	{
+		// only reads the colors
+		auto findLocalMaxFunc = [&](int iUncolored) {
+			int node = uncolored[iUncolored];
+			bool localMax = true;
+			for (size_t iNei = 0; iNei < graph[node].size(); iNei++)
+			{
+				int neiId = graph[node][iNei];
+				if (graph_colors[neiId] == -1 && higherPriority(neiId, node))
+				{
+					localMax = false;
+					break;
+				}
+			}
+			isLocalMax[iUncolored] = localMax;
+		};
+		cpu_parallel_for(0, uncolored.size(), findLocalMaxFunc);
+
+		// the local maxima are not adjacent, none of them reads a color written in this pass
+		auto colorFunc = [&](int iUncolored) {
+			if (!isLocalMax[iUncolored])
+			{
+				return;
+			}
+			int node = uncolored[iUncolored];
+			int minUsableColor = 0;
+			while (!changable(node, minUsableColor))
+			{
+				minUsableColor++;
+			}
+			graph_colors[node] = minUsableColor;
+		};
+		cpu_parallel_for(0, uncolored.size(), colorFunc);
+
+		size_t numUncolored = 0;
+		for (size_t iUncolored = 0; iUncolored < uncolored.size(); iUncolored++)
+		{
+			if (!isLocalMax[iUncolored])
+			{
+				uncolored[numUncolored] = uncolored[iUncolored];
+				numUncolored++;
+			}
+		}
+		uncolored.resize(numUncolored);
+		numRounds++;
+	}
+
+	if (verbose)
+	{
+		std::cout << "Jones-Plassmann coloring finished in " << numRounds << " rounds with " << get_num_colors() << " colors.\n";
+	}
+
+	return this->graph_colors;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ColoringAlgorithms.h"
+
+namespace GAIA {
+	namespace GraphColoring {
+
+		/*
+		* Parallel coloring by Jones, Mark T., and Paul E. Plassmann. "A parallel graph coloring heuristic." SIAM Journal on Scientific Computing 14.3 (1993): 654-669.
+		* Each round, every uncolored node whose (hashed) priority is the highest among its uncolored neighbors takes the smallest color 
+		* not used by its neighbors. Those nodes form an independent set, so each round is race free and the result does not depend on the scheduling.
+		*/
+		class JonesPlassmann : public GraphColor {
+		public:
+			/* Constructors */
+			JonesPlassmann(const Graph& graph) : GraphColor(graph) {}
+			JonesPlassmann(const vector<vector<int>>& graph) : GraphColor(graph) {}
+
+			/* Mutators */
+			vector<int>& color();
+
+			/* Accessors */
+			string get_algorithm() { return "JonesPlassmann"; }
+
+		private:
+			bool higherPriority(int node1, int node2);
+
+			std::vector<uint32_t> priorities;
+		};
+	}
+}
@@ -0,0 +1,128 @@
+#include "AsyncOutputWriter.h"
+
+using namespace GAIA;
+
+GAIA::AsyncOutputWriter::~AsyncOutputWriter()
+{
+	stop();
+}
+
+void GAIA::AsyncOutputWriter::start(size_t numSnapshotBuffers, WriteFunc inWriteFunc)
+{
+	stop();
+
+	writeFunc = inWriteFunc;
+	stopping = false;
+	numWriting = 0;
+	snapshotBuffers.clear();
+	freeSnapshots.clear();
+	pendingSnapshots.clear();
+
+	// at least one snapshot being written and one being filled
+	numSnapshotBuffers = std::max(numSnapshotBuffers, (size_t)2);
+	for (size_t iBuffer = 0; iBuffer < numSnapshotBuffers; iBuffer++)
+	{
+		snapshotBuffers.push_back(std::make_unique<FrameOutputSnapshot>());
+		freeSnapshots.push_back(snapshotBuffers.back().get());
+	}
+
+	writerThread = std::thread(&AsyncOutputWriter::writerLoop, this);
+}
+
+FrameOutputSnapshot& GAIA::AsyncOutputWriter::acquireSnapshot()
+{
+	std::unique_lock<std::mutex> queueLockGuard(queueLock);
+	snapshotFreed.wait(queueLockGuard, [&]() { return !freeSnapshots.empty(); });
+
+	FrameOutputSnapshot* pSnapshot = freeSnapshots.front();
+	freeSnapshots.pop_front();
+	return *pSnapshot;
+}
+
+void GAIA::AsyncOutputWriter::submitSnapshot(FrameOutputSnapshot& snapshot)
+{
+	{
+		std::lock_guard<std::mutex> queueLockGuard(queueLock);
+		pendingSnapshots.push_back(&snapshot);
+	}
+	snapshotSubmitted.notify_one();
+}
+
+void GAIA::AsyncOutputWriter::flush()
+{
+	std::unique_lock<std::mutex> queueLockGuard(queueLock);
+	snapshotFreed.wait(queueLockGuard, [&]() { return pendingSnapshots.empty() && numWriting == 0; });
+}
+
+void GAIA::AsyncOutputWriter::stop()
+{
+	if (!writerThread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> queueLockGuard(queueLock);
+		stopping = true;
+	}
+	snapshotSubmitted.notify_one();
+	// the writer thread drains the queue before exiting
+	writerThread.join();
+}
+
+void GAIA::AsyncOutputWriter::copyMeshes(const std::vector<TetMeshFEM::SharedPtr>& meshes, std::vector<TetMeshFEM::SharedPtr>& shadowMeshes,
+	bool copyVelocities)
+{
+	shadowMeshes.resize(meshes.size());
+	for (size_t iMesh = 0; iMesh < meshes.size(); iMesh++)
+	{
+		const TetMeshFEM::SharedPtr& pMesh = meshes[iMesh];
+		TetMeshFEM::SharedPtr& pShadowMesh = shadowMeshes[iMesh];
+		if (pShadowMesh == nullptr)
+		{
+			pShadowMesh = std::make_shared<TetMeshFEM>();
+			pShadowMesh->pTopology = pMesh->pTopology;
+			pShadowMesh->pObjectParams = pMesh->pObjectParams;
+			pShadowMesh->m_nVertices = pMesh->m_nVertices;
+			pShadowMesh->m_nTets = pMesh->m_nTets;
+			pShadowMesh->meshId = pMesh->meshId;
+		}
+
+		// same sized assignments reuse the buffers of the shadow meshes
+		pShadowMesh->mVertPos = pMesh->mVertPos;
+		if (copyVelocities)
+		{
+			pShadowMesh->mVelocity = pMesh->mVelocity;
+		}
+	}
+}
+
+void GAIA::AsyncOutputWriter::writerLoop()
+{
+	while (true)
+	{
+		FrameOutputSnapshot* pSnapshot = nullptr;
+		{
+			std::unique_lock<std::mutex> queueLockGuard(queueLock);
+			snapshotSubmitted.wait(queueLockGuard, [&]() { return stopping || !pendingSnapshots.empty(); });
+
+			if (pendingSnapshots.empty())
+			{
+				// stopping and nothing left to write
+				break;
+			}
+			pSnapshot = pendingSnapshots.front();
+			pendingSnapshots.pop_front();
+			++numWriting;
+		}
+
+		writeFunc(*pSnapshot);
+
+		{
+			std::lock_guard<std::mutex> queueLockGuard(queueLock);
+			--numWriting;
+			freeSnapshots.push_back(pSnapshot);
+		}
+		snapshotFreed.notify_all();
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "../TetMesh/TetMeshFEM.h"
+
+#include <MeshFrame/Utility/Parser.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+
+namespace GAIA {
+	// everything needed to write the outputs of one frame, decoupled from the simulation state
+	struct FrameOutputSnapshot
+	{
+		int frameId = 0;
+		double curTime = 0;
+		// either the simulated meshes themselves (synchronous output) or shadow meshes that share the topology and the object
+		// parameters with the simulated meshes and hold copies of their positions (and velocities when hasVelocities is true)
+		std::vector<TetMeshFEM::SharedPtr> tetMeshes;
+		bool hasVelocities = false;
+		// the running time statistics of the frame
+		nlohmann::json statistics;
+	};
+
+	// writes the frame outputs on a background thread, so stepping overlaps with the disk I/O;
+	// the snapshots are recycled from a fixed pool, the simulation thread blocks in acquireSnapshot when all of them are
+	// waiting to be written, which bounds both the queue length and the memory
+	struct AsyncOutputWriter
+	{
+		typedef std::shared_ptr<AsyncOutputWriter> SharedPtr;
+		typedef std::function<void(FrameOutputSnapshot&)> WriteFunc;
+
+		~AsyncOutputWriter();
+
+		void start(size_t numSnapshotBuffers, WriteFunc inWriteFunc);
+		FrameOutputSnapshot& acquireSnapshot();
+		void submitSnapshot(FrameOutputSnapshot& snapshot);
+		// blocks until all the submitted snapshots are written
+		void flush();
+		// flushes and joins the writer thread
+		void stop();
+
+		// copies the positions (and velocities) of the meshes to the shadow meshes, reusing their buffers
+		static void copyMeshes(const std::vector<TetMeshFEM::SharedPtr>& meshes, std::vector<TetMeshFEM::SharedPtr>& shadowMeshes,
+			bool copyVelocities);
+
+	private:
+		void writerLoop();
+
+		WriteFunc writeFunc;
+
+		std::vector<std::unique_ptr<FrameOutputSnapshot>> snapshotBuffers;
+		std::deque<FrameOutputSnapshot*> freeSnapshots;
+		std::deque<FrameOutputSnapshot*> pendingSnapshots;
+		size_t numWriting = 0;
+		bool stopping = false;
+
+		std::mutex queueLock;
+		std::condition_variable snapshotFreed;
+		std::condition_variable snapshotSubmitted;
+		std::thread writerThread;
+	};
+}
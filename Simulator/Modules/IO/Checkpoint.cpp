@@ -0,0 +1,226 @@
+#include "Checkpoint.h"
+#include "../Parallelization/CPUParallelization.h"
+
+#include <cstring>
+#include <fstream>
+
+using namespace GAIA;
+
+namespace {
+	const char checkpointMagic[8] = { 'G', 'A', 'I', 'A', 'C', 'K', 'P', '\0' };
+
+	inline uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + CHECKPOINT_MESH_ALIGNMENT - 1) / CHECKPOINT_MESH_ALIGNMENT * CHECKPOINT_MESH_ALIGNMENT;
+	}
+
+	bool readHeader(std::ifstream& file, CheckpointFileHeader& header)
+	{
+		file.read((char*)&header, sizeof(header));
+		return file.good() && memcmp(header.magic, checkpointMagic, sizeof(checkpointMagic)) == 0
+			&& header.version == CHECKPOINT_FILE_VERSION;
+	}
+}
+
+bool GAIA::Checkpoint::write(const std::string& path, int frameId, double curTime, std::vector<TetMeshFEM::SharedPtr>& tetMeshes)
+{
+	size_t numMeshes = tetMeshes.size();
+	std::vector<std::vector<CheckpointBuffer>> meshBuffers(numMeshes);
+	std::vector<CheckpointMeshRecord> records(numMeshes);
+
+	uint64_t offset = sizeof(CheckpointFileHeader) + numMeshes * sizeof(CheckpointMeshRecord);
+	for (size_t iMesh = 0; iMesh < numMeshes; iMesh++)
+	{
+		tetMeshes[iMesh]->getCheckpointBuffers(meshBuffers[iMesh]);
+
+		offset = alignOffset(offset);
+		records[iMesh].offset = offset;
+		records[iMesh].numBuffers = (uint32_t)meshBuffers[iMesh].size();
+		records[iMesh].reserved = 0;
+
+		offset += meshBuffers[iMesh].size() * sizeof(uint64_t);
+		for (const CheckpointBuffer& buffer : meshBuffers[iMesh])
+		{
+			offset += buffer.numBytes;
+		}
+	}
+
+	CheckpointFileHeader header;
+	memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+	header.version = CHECKPOINT_FILE_VERSION;
+	header.floatSize = sizeof(FloatingType);
+	header.frameId = frameId;
+	header.numMeshes = (uint32_t)numMeshes;
+	header.curTime = curTime;
+
+	// write to a temporary file first so an interrupted write never replaces a good checkpoint with a broken one
+	std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "[Error] Fail to open file: " << tmpPath << std::endl;
+			return false;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)records.data(), numMeshes * sizeof(CheckpointMeshRecord));
+		if (!file.good())
+		{
+			std::cout << "[Error] Fail to write checkpoint: " << tmpPath << std::endl;
+			return false;
+		}
+	}
+
+	std::vector<int8_t> meshWritten(numMeshes, 0);
+	auto writeMesh = [&](int iMesh) {
+		std::fstream file(tmpPath, std::ios::binary | std::ios::in | std::ios::out);
+		if (!file.is_open())
+		{
+			return;
+		}
+		file.seekp(records[iMesh].offset);
+
+		for (const CheckpointBuffer& buffer : meshBuffers[iMesh])
+		{
+			uint64_t numBytes = buffer.numBytes;
+			file.write((const char*)&numBytes, sizeof(numBytes));
+		}
+		for (const CheckpointBuffer& buffer : meshBuffers[iMesh])
+		{
+			file.write((const char*)buffer.data, buffer.numBytes);
+		}
+		meshWritten[iMesh] = file.good();
+	};
+	cpu_parallel_for(0, (int)numMeshes, writeMesh);
+
+	for (size_t iMesh = 0; iMesh < numMeshes; iMesh++)
+	{
+		if (!meshWritten[iMesh])
+		{
+			std::cout << "[Error] Fail to write checkpoint: " << tmpPath << std::endl;
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		std::cout << "[Error] Fail to write checkpoint: " << path << std::endl;
+		std::remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool GAIA::Checkpoint::read(const std::string& path, int& frameId, double& curTime, std::vector<TetMeshFEM::SharedPtr>& tetMeshes)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "[Error] Fail to open file: " << path << std::endl;
+		return false;
+	}
+
+	CheckpointFileHeader header;
+	if (!readHeader(file, header))
+	{
+		std::cout << "[Error] Not a checkpoint file or unsupported version: " << path << std::endl;
+		return false;
+	}
+	if (header.floatSize != sizeof(FloatingType))
+	{
+		std::cout << "[Error] The checkpoint was written with " << header.floatSize * 8 << " bits floats: " << path << std::endl;
+		return false;
+	}
+	if (header.numMeshes != tetMeshes.size())
+	{
+		std::cout << "[Error] The checkpoint has " << header.numMeshes << " meshes while the simulation has "
+			<< tetMeshes.size() << ": " << path << std::endl;
+		return false;
+	}
+
+	size_t numMeshes = tetMeshes.size();
+	std::vector<CheckpointMeshRecord> records(numMeshes);
+	file.read((char*)records.data(), numMeshes * sizeof(CheckpointMeshRecord));
+	if (!file.good())
+	{
+		std::cout << "[Error] Truncated checkpoint file: " << path << std::endl;
+		return false;
+	}
+
+	// validate every mesh against the file before any buffer is overwritten, so a mismatch never leaves the meshes half loaded
+	file.seekg(0, std::ios::end);
+	uint64_t fileSize = (uint64_t)file.tellg();
+	std::vector<std::vector<CheckpointBuffer>> meshBuffers(numMeshes);
+	for (size_t iMesh = 0; iMesh < numMeshes; iMesh++)
+	{
+		std::vector<CheckpointBuffer>& buffers = meshBuffers[iMesh];
+		tetMeshes[iMesh]->getCheckpointBuffers(buffers);
+		if (buffers.size() != records[iMesh].numBuffers)
+		{
+			std::cout << "[Error] The checkpoint has " << records[iMesh].numBuffers << " buffers for mesh " << iMesh
+				<< " while the simulation has " << buffers.size() << ": " << path << std::endl;
+			return false;
+		}
+
+		std::vector<uint64_t> numBytes(buffers.size());
+		file.seekg(records[iMesh].offset);
+		file.read((char*)numBytes.data(), numBytes.size() * sizeof(uint64_t));
+		if (!file.good())
+		{
+			std::cout << "[Error] Truncated checkpoint file: " << path << std::endl;
+			return false;
+		}
+
+		uint64_t meshEnd = records[iMesh].offset + numBytes.size() * sizeof(uint64_t);
+		for (size_t iBuffer = 0; iBuffer < buffers.size(); iBuffer++)
+		{
+			if (numBytes[iBuffer] != buffers[iBuffer].numBytes)
+			{
+				std::cout << "[Error] The state of mesh " << iMesh << " in the checkpoint does not match the simulation: " << path << std::endl;
+				return false;
+			}
+			meshEnd += numBytes[iBuffer];
+		}
+		if (meshEnd > fileSize)
+		{
+			std::cout << "[Error] Truncated checkpoint file: " << path << std::endl;
+			return false;
+		}
+	}
+	file.close();
+
+	std::vector<int8_t> meshRead(numMeshes, 0);
+	auto readMesh = [&](int iMesh) {
+		const std::vector<CheckpointBuffer>& buffers = meshBuffers[iMesh];
+		std::ifstream meshFile(path, std::ios::binary);
+		meshFile.seekg(records[iMesh].offset + buffers.size() * sizeof(uint64_t));
+		for (const CheckpointBuffer& buffer : buffers)
+		{
+			meshFile.read((char*)buffer.data, buffer.numBytes);
+		}
+		meshRead[iMesh] = meshFile.good();
+	};
+	cpu_parallel_for(0, (int)numMeshes, readMesh);
+
+	for (size_t iMesh = 0; iMesh < numMeshes; iMesh++)
+	{
+		if (!meshRead[iMesh])
+		{
+			std::cout << "[Error] Fail to read the state of mesh " << iMesh << " from checkpoint: " << path << std::endl;
+			return false;
+		}
+	}
+
+	frameId = header.frameId;
+	curTime = header.curTime;
+	return true;
+}
+
+bool GAIA::Checkpoint::isCheckpoint(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	CheckpointFileHeader header;
+	return file.is_open() && readHeader(file, header);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "../TetMesh/TetMeshFEM.h"
+
+#define CHECKPOINT_FILE_VERSION 2
+// the data of each mesh starts at a multiple of this, so the meshes are written by different threads without sharing blocks
+#define CHECKPOINT_MESH_ALIGNMENT 4096
+
+namespace GAIA {
+	// binary recovery state: the buffers reported by TetMeshFEM::getCheckpointBuffers of every mesh, stored as raw bytes
+	// layout: CheckpointFileHeader, numMeshes CheckpointMeshRecord, then the data of each mesh at its offset:
+	// numBuffers uint64_t byte sizes followed by the buffers
+	// a checkpoint can only be loaded by a simulation set up with the same models, the sizes of the buffers are validated
+	struct CheckpointFileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t floatSize;
+		int32_t frameId;
+		uint32_t numMeshes;
+		double curTime;
+	};
+
+	struct CheckpointMeshRecord
+	{
+		uint64_t offset;
+		uint32_t numBuffers;
+		uint32_t reserved;
+	};
+
+	struct Checkpoint
+	{
+		// the meshes are written in parallel, each to its own range of the file
+		static bool write(const std::string& path, int frameId, double curTime, std::vector<TetMeshFEM::SharedPtr>& tetMeshes);
+		// reads the checkpoint directly into the buffers of the meshes, all the records are validated before any buffer is overwritten
+		static bool read(const std::string& path, int& frameId, double& curTime, std::vector<TetMeshFEM::SharedPtr>& tetMeshes);
+		// checks the magic number, so the recovery can tell the checkpoints from the json states
+		static bool isCheckpoint(const std::string& path);
+	};
+}
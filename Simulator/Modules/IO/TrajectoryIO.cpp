@@ -0,0 +1,377 @@
+#include "TrajectoryIO.h"
+#include "../Parallelization/CPUParallelization.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace GAIA;
+
+namespace {
+	const char trajectoryMagic[8] = { 'G', 'A', 'I', 'A', 'T', 'R', 'J', '\0' };
+
+	inline uint32_t zigzagEncode(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+	inline int32_t zigzagDecode(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+	// puts the i-th byte of every word in the i-th quarter of the output
+	void shuffleBytes(const uint32_t* words, size_t numWords, uint8_t* out)
+	{
+		for (size_t iWord = 0; iWord < numWords; iWord++)
+		{
+			uint32_t w = words[iWord];
+			out[iWord] = w & 0xFF;
+			out[numWords + iWord] = (w >> 8) & 0xFF;
+			out[2 * numWords + iWord] = (w >> 16) & 0xFF;
+			out[3 * numWords + iWord] = (w >> 24) & 0xFF;
+		}
+	}
+
+	// run length coder: a control byte c < 128 is followed by c + 1 literal bytes,
+	// a control byte c >= 128 is followed by one byte repeated c - 128 + 3 times
+	void compressBlock(const uint8_t* in, size_t numBytes, std::vector<uint8_t>& out)
+	{
+		out.clear();
+		size_t literalStart = 0;
+		size_t i = 0;
+
+		auto flushLiterals = [&](size_t end) {
+			while (literalStart < end)
+			{
+				size_t numLiterals = std::min(end - literalStart, (size_t)128);
+				out.push_back((uint8_t)(numLiterals - 1));
+				out.insert(out.end(), in + literalStart, in + literalStart + numLiterals);
+				literalStart += numLiterals;
+			}
+		};
+
+		while (i < numBytes)
+		{
+			size_t run = 1;
+			while (i + run < numBytes && in[i + run] == in[i] && run < 130)
+			{
+				++run;
+			}
+
+			if (run >= 3)
+			{
+				flushLiterals(i);
+				out.push_back((uint8_t)(128 + run - 3));
+				out.push_back(in[i]);
+				i += run;
+				literalStart = i;
+			}
+			else
+			{
+				i += run;
+			}
+		}
+		flushLiterals(numBytes);
+	}
+
+	bool decompressBlock(const uint8_t* in, size_t numBytesIn, uint8_t* out, size_t numBytesOut)
+	{
+		size_t iIn = 0, iOut = 0;
+		while (iIn < numBytesIn)
+		{
+			uint8_t c = in[iIn++];
+			if (c < 128)
+			{
+				size_t numLiterals = (size_t)c + 1;
+				if (iIn + numLiterals > numBytesIn || iOut + numLiterals > numBytesOut)
+				{
+					return false;
+				}
+				memcpy(out + iOut, in + iIn, numLiterals);
+				iIn += numLiterals;
+				iOut += numLiterals;
+			}
+			else
+			{
+				size_t run = (size_t)c - 128 + 3;
+				if (iIn >= numBytesIn || iOut + run > numBytesOut)
+				{
+					return false;
+				}
+				memset(out + iOut, in[iIn++], run);
+				iOut += run;
+			}
+		}
+		return iOut == numBytesOut;
+	}
+}
+
+GAIA::TrajectoryWriter::~TrajectoryWriter()
+{
+	close();
+}
+
+bool GAIA::TrajectoryWriter::open(const std::string& path, std::vector<TetMeshFEM::SharedPtr>& tetMeshes,
+	FloatingType quantizationTolerance, int keyframeInterval)
+{
+	close();
+
+	dataFile.open(path, std::ios::out | std::ios::binary);
+	indexFile.open(path + ".idx", std::ios::out | std::ios::binary);
+	if (!dataFile.is_open() || !indexFile.is_open())
+	{
+		std::cout << "[Error] Fail to open file: " << path << std::endl;
+		close();
+		return false;
+	}
+
+	std::vector<uint32_t> meshSurfaceVertexCounts;
+	uint64_t numValues = 0;
+	for (TetMeshFEM::SharedPtr& pTMesh : tetMeshes)
+	{
+		meshSurfaceVertexCounts.push_back(pTMesh->surfaceVIds().size());
+		numValues += 3 * pTMesh->surfaceVIds().size();
+	}
+
+	memset(&header, 0, sizeof(TrajectoryFileHeader));
+	memcpy(header.magic, trajectoryMagic, sizeof(trajectoryMagic));
+	header.version = TRAJECTORY_FILE_VERSION;
+	header.flags = quantizationTolerance > 0 ? TRAJECTORY_FLAG_QUANTIZED : 0;
+	header.quantizationStep = quantizationTolerance > 0 ? 2.0 * quantizationTolerance : 0.0;
+	header.keyframeInterval = std::max(keyframeInterval, 1);
+	header.numMeshes = tetMeshes.size();
+	header.numValues = numValues;
+
+	dataFile.write((const char*)&header, sizeof(TrajectoryFileHeader));
+	dataFile.write((const char*)meshSurfaceVertexCounts.data(), meshSurfaceVertexCounts.size() * sizeof(uint32_t));
+
+	words.resize(numValues);
+	prevWords.resize(numValues);
+	shuffled.resize(4 * numValues);
+	numFramesWritten = 0;
+
+	return dataFile.good();
+}
+
+bool GAIA::TrajectoryWriter::writeFrame(int frameId, std::vector<TetMeshFEM::SharedPtr>& tetMeshes)
+{
+	if (!dataFile.is_open())
+	{
+		return false;
+	}
+
+	bool keyframe = numFramesWritten % header.keyframeInterval == 0;
+	bool quantized = header.flags & TRAJECTORY_FLAG_QUANTIZED;
+	double invStep = quantized ? 1.0 / header.quantizationStep : 0.0;
+
+	size_t valueOffset = 0;
+	for (TetMeshFEM::SharedPtr& pTMesh : tetMeshes)
+	{
+		// the words of this frame are kept in prevWords for the next frame, words gets the encoded ones
+		auto encodeFunc = [&](int iSurfaceV) {
+			auto v = pTMesh->surfaceVertex(iSurfaceV);
+			for (int iDim = 0; iDim < 3; iDim++)
+			{
+				size_t iValue = valueOffset + 3 * iSurfaceV + iDim;
+				uint32_t word;
+				if (quantized)
+				{
+					double q = std::round(v[iDim] * invStep);
+					q = std::max(std::min(q, (double)INT32_MAX), (double)INT32_MIN);
+					word = (uint32_t)(int32_t)q;
+				}
+				else
+				{
+					FloatingType x = v[iDim];
+					memcpy(&word, &x, sizeof(uint32_t));
+				}
+
+				if (keyframe)
+				{
+					words[iValue] = quantized ? zigzagEncode((int32_t)word) : word;
+				}
+				else
+				{
+					words[iValue] = quantized ? zigzagEncode((int32_t)(word - prevWords[iValue])) : word ^ prevWords[iValue];
+				}
+				prevWords[iValue] = word;
+			}
+		};
+		cpu_parallel_for(0, pTMesh->surfaceVIds().size(), encodeFunc);
+		valueOffset += 3 * pTMesh->surfaceVIds().size();
+	}
+
+	shuffleBytes(words.data(), words.size(), shuffled.data());
+
+	size_t numBlocks = (shuffled.size() + TRAJECTORY_BLOCK_SIZE - 1) / TRAJECTORY_BLOCK_SIZE;
+	compressedBlocks.resize(numBlocks);
+	auto compressFunc = [&](int iBlock) {
+		size_t start = (size_t)iBlock * TRAJECTORY_BLOCK_SIZE;
+		size_t numBytes = std::min((size_t)TRAJECTORY_BLOCK_SIZE, shuffled.size() - start);
+		compressBlock(shuffled.data() + start, numBytes, compressedBlocks[iBlock]);
+	};
+	cpu_parallel_for(0, numBlocks, compressFunc);
+
+	TrajectoryIndexRecord record;
+	record.frameId = frameId;
+	record.flags = keyframe ? TRAJECTORY_FLAG_KEYFRAME : 0;
+	record.offset = dataFile.tellp();
+
+	TrajectoryFrameHeader frameHeader;
+	frameHeader.frameId = frameId;
+	frameHeader.flags = record.flags;
+	frameHeader.numBlocks = numBlocks;
+	frameHeader.reserved = 0;
+	frameHeader.numValues = header.numValues;
+	dataFile.write((const char*)&frameHeader, sizeof(TrajectoryFrameHeader));
+	for (size_t iBlock = 0; iBlock < numBlocks; iBlock++)
+	{
+		uint32_t compressedSize = compressedBlocks[iBlock].size();
+		dataFile.write((const char*)&compressedSize, sizeof(uint32_t));
+	}
+	for (size_t iBlock = 0; iBlock < numBlocks; iBlock++)
+	{
+		dataFile.write((const char*)compressedBlocks[iBlock].data(), compressedBlocks[iBlock].size());
+	}
+	dataFile.flush();
+
+	// the index is only appended after the frame is on the disk, so it never points to a partial frame
+	indexFile.write((const char*)&record, sizeof(TrajectoryIndexRecord));
+	indexFile.flush();
+
+	++numFramesWritten;
+	return dataFile.good() && indexFile.good();
+}
+
+void GAIA::TrajectoryWriter::close()
+{
+	if (dataFile.is_open())
+	{
+		dataFile.close();
+	}
+	if (indexFile.is_open())
+	{
+		indexFile.close();
+	}
+}
+
+bool GAIA::TrajectoryReader::open(const std::string& path)
+{
+	dataFile.open(path, std::ios::in | std::ios::binary);
+	std::ifstream indexFile(path + ".idx", std::ios::in | std::ios::binary);
+	if (!dataFile.is_open() || !indexFile.is_open())
+	{
+		std::cout << "[Error] Fail to open file: " << path << std::endl;
+		return false;
+	}
+
+	dataFile.read((char*)&header, sizeof(TrajectoryFileHeader));
+	if (!dataFile.good() || memcmp(header.magic, trajectoryMagic, sizeof(trajectoryMagic)) != 0
+		|| header.version != TRAJECTORY_FILE_VERSION)
+	{
+		std::cout << "[Error] Not a trajectory file or unsupported version: " << path << std::endl;
+		return false;
+	}
+	meshSurfaceVertexCounts.resize(header.numMeshes);
+	dataFile.read((char*)meshSurfaceVertexCounts.data(), header.numMeshes * sizeof(uint32_t));
+
+	TrajectoryIndexRecord record;
+	index.clear();
+	while (indexFile.read((char*)&record, sizeof(TrajectoryIndexRecord)))
+	{
+		index.push_back(record);
+	}
+
+	words.resize(header.numValues);
+	shuffled.resize(4 * header.numValues);
+	lastDecodedFrame = -1;
+
+	return dataFile.good();
+}
+
+bool GAIA::TrajectoryReader::readFrame(size_t iFrame, std::vector<FloatingType>& positions)
+{
+	if (iFrame >= index.size())
+	{
+		return false;
+	}
+
+	size_t keyframe = iFrame;
+	while (!(index[keyframe].flags & TRAJECTORY_FLAG_KEYFRAME) && keyframe > 0)
+	{
+		--keyframe;
+	}
+
+	size_t startFrame = keyframe;
+	if (lastDecodedFrame >= (int64_t)keyframe && lastDecodedFrame <= (int64_t)iFrame)
+	{
+		// continue from the frame decoded last time, i.e., sequential playback
+		startFrame = lastDecodedFrame + 1;
+	}
+
+	for (size_t iDecode = startFrame; iDecode <= iFrame; iDecode++)
+	{
+		if (!decodeFrame(iDecode))
+		{
+			lastDecodedFrame = -1;
+			return false;
+		}
+	}
+
+	positions.resize(header.numValues);
+	bool quantized = header.flags & TRAJECTORY_FLAG_QUANTIZED;
+	for (size_t iValue = 0; iValue < header.numValues; iValue++)
+	{
+		if (quantized)
+		{
+			positions[iValue] = (FloatingType)((int32_t)words[iValue] * header.quantizationStep);
+		}
+		else
+		{
+			memcpy(&positions[iValue], &words[iValue], sizeof(uint32_t));
+		}
+	}
+
+	return true;
+}
+
+bool GAIA::TrajectoryReader::decodeFrame(size_t iFrame)
+{
+	dataFile.clear();
+	dataFile.seekg(index[iFrame].offset);
+
+	TrajectoryFrameHeader frameHeader;
+	dataFile.read((char*)&frameHeader, sizeof(TrajectoryFrameHeader));
+	if (!dataFile.good() || frameHeader.numValues != header.numValues)
+	{
+		return false;
+	}
+
+	std::vector<uint32_t> compressedSizes(frameHeader.numBlocks);
+	dataFile.read((char*)compressedSizes.data(), frameHeader.numBlocks * sizeof(uint32_t));
+
+	for (size_t iBlock = 0; iBlock < frameHeader.numBlocks; iBlock++)
+	{
+		size_t start = iBlock * TRAJECTORY_BLOCK_SIZE;
+		size_t numBytes = std::min((size_t)TRAJECTORY_BLOCK_SIZE, shuffled.size() - start);
+		compressed.resize(compressedSizes[iBlock]);
+		dataFile.read((char*)compressed.data(), compressed.size());
+		if (!dataFile.good() || !decompressBlock(compressed.data(), compressed.size(), shuffled.data() + start, numBytes))
+		{
+			return false;
+		}
+	}
+
+	bool keyframe = frameHeader.flags & TRAJECTORY_FLAG_KEYFRAME;
+	bool quantized = header.flags & TRAJECTORY_FLAG_QUANTIZED;
+	for (size_t iValue = 0; iValue < header.numValues; iValue++)
+	{
+		uint32_t word = (uint32_t)shuffled[iValue] | ((uint32_t)shuffled[header.numValues + iValue] << 8)
+			| ((uint32_t)shuffled[2 * header.numValues + iValue] << 16) | ((uint32_t)shuffled[3 * header.numValues + iValue] << 24);
+		if (quantized)
+		{
+			int32_t delta = zigzagDecode(word);
+			words[iValue] = keyframe ? (uint32_t)delta : words[iValue] + (uint32_t)delta;
+		}
+		else
+		{
+			words[iValue] = keyframe ? word : words[iValue] ^ word;
+		}
+	}
+
+	lastDecodedFrame = iFrame;
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "../TetMesh/TetMeshFEM.h"
+
+#include <fstream>
+
+#define TRAJECTORY_FILE_VERSION 1
+// size of the blocks the shuffled bytes of a frame are split into, each block is compressed independently and in parallel
+#define TRAJECTORY_BLOCK_SIZE (1 << 16)
+
+#define TRAJECTORY_FLAG_QUANTIZED 1
+#define TRAJECTORY_FLAG_KEYFRAME 1
+
+namespace GAIA {
+	// the trajectory file stores the surface vertex positions of all the tet meshes (same order as writeAllToBinary) every frame;
+	// the topology is written once as TemplateMesh.ply
+	// each frame is either a keyframe or a delta from the previous frame:
+	// - with quantization the positions are rounded to a grid of 2 x tolerance and the integer deltas are zigzag encoded
+	// - without quantization the float bits are XORed with the ones of the previous frame, which is lossless
+	// the 32 bits words are then byte shuffled, so the mostly zero high bytes are adjacent, and compressed by a run length coder
+	// a side file (path + ".idx") holds a fixed size record for every frame, so the frames can be accessed randomly
+	struct TrajectoryFileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t flags;
+		double quantizationStep;
+		uint32_t keyframeInterval;
+		uint32_t numMeshes;
+		uint64_t numValues;
+		// followed by numMeshes uint32_t: number of surface vertices of each mesh
+	};
+
+	struct TrajectoryFrameHeader
+	{
+		int32_t frameId;
+		uint32_t flags;
+		uint32_t numBlocks;
+		uint32_t reserved;
+		uint64_t numValues;
+		// followed by numBlocks uint32_t: compressed size of each block, then the compressed blocks
+	};
+
+	struct TrajectoryIndexRecord
+	{
+		int32_t frameId;
+		uint32_t flags;
+		uint64_t offset;
+	};
+
+	struct TrajectoryWriter
+	{
+		typedef std::shared_ptr<TrajectoryWriter> SharedPtr;
+
+		~TrajectoryWriter();
+
+		// quantizationTolerance <= 0 means lossless
+		bool open(const std::string& path, std::vector<TetMeshFEM::SharedPtr>& tetMeshes, FloatingType quantizationTolerance, int keyframeInterval);
+		bool writeFrame(int frameId, std::vector<TetMeshFEM::SharedPtr>& tetMeshes);
+		void close();
+
+	private:
+		std::ofstream dataFile;
+		std::ofstream indexFile;
+		TrajectoryFileHeader header;
+		size_t numFramesWritten = 0;
+
+		// encoded words of the current frame and the words the deltas are computed against
+		std::vector<uint32_t> words;
+		std::vector<uint32_t> prevWords;
+		std::vector<uint8_t> shuffled;
+		std::vector<std::vector<uint8_t>> compressedBlocks;
+	};
+
+	// random access reader for playback tools
+	struct TrajectoryReader
+	{
+		bool open(const std::string& path);
+		size_t numFrames() const { return index.size(); }
+		int frameId(size_t iFrame) const { return index[iFrame].frameId; }
+		const std::vector<uint32_t>& surfaceVertexCounts() const { return meshSurfaceVertexCounts; }
+		// decodes from the closest keyframe at or before iFrame, or continues from the last decoded frame when it is closer
+		bool readFrame(size_t iFrame, std::vector<FloatingType>& positions);
+
+	private:
+		bool decodeFrame(size_t iFrame);
+
+		std::ifstream dataFile;
+		TrajectoryFileHeader header;
+		std::vector<uint32_t> meshSurfaceVertexCounts;
+		std::vector<TrajectoryIndexRecord> index;
+
+		// the words of lastDecodedFrame, before the deltas are resolved into positions
+		std::vector<uint32_t> words;
+		std::vector<uint8_t> shuffled;
+		std::vector<uint8_t> compressed;
+		int64_t lastDecodedFrame = -1;
+	};
+}
@@ -41,6 +41,12 @@ namespace GAIA {
 		std::string tetsColoringCategoriesPath;
 		std::string edgesColoringCategoriesPath;
 		std::string verticesColoringCategoriesPath;
+		// when verticesColoringCategoriesPath is not given, the coloring is computed at load time and 
+		// cached to path + ".verticesColoring.json" for the next run
+		bool cacheVerticesColoring = true;
+		// loads the topology and the rest state from a binary cache next to the input mesh when it matches the input,
+		// otherwise creates it after the mesh is initialized
+		bool useBinaryMeshCache = false;
 
 		typedef std::shared_ptr<ObjectParams> SharedPtr;
 
@@ -69,6 +75,8 @@ namespace GAIA {
 		EXTRACT_FROM_JSON(objectParam, tetsColoringCategoriesPath);
 		EXTRACT_FROM_JSON(objectParam, edgesColoringCategoriesPath);
 		EXTRACT_FROM_JSON(objectParam, verticesColoringCategoriesPath);
+		EXTRACT_FROM_JSON(objectParam, cacheVerticesColoring);
+		EXTRACT_FROM_JSON(objectParam, useBinaryMeshCache);
 		EXTRACT_FROM_JSON(objectParam, shuffleParallelizationGroup);
 		EXTRACT_FROM_JSON(objectParam, frameToAppear);
 		return true;
@@ -91,6 +99,8 @@ namespace GAIA {
 		PUT_TO_JSON(objectParam, tetsColoringCategoriesPath);
 		PUT_TO_JSON(objectParam, edgesColoringCategoriesPath);
 		PUT_TO_JSON(objectParam, verticesColoringCategoriesPath);
+		PUT_TO_JSON(objectParam, cacheVerticesColoring);
+		PUT_TO_JSON(objectParam, useBinaryMeshCache);
 		PUT_TO_JSON(objectParam, shuffleParallelizationGroup);
 		PUT_TO_JSON(objectParam, frameToAppear);
 
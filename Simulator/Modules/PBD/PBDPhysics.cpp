@@ -13,6 +13,7 @@
 #include "../Parallelization/CPUParallelization.h"
 
 #include "../Timer/Timer.h"
+#include "../Timer/Profiler.h"
 #include "../Timer/RunningTimeStatistics.h"
 
 #include "../IO/FileIO.h"
@@ -149,13 +150,12 @@ void GAIA::PBDPhysics::recoverFromState(std::string& stateFile)
 	pCCD->updateBVH(RTC_BUILD_QUALITY_LOW);
 }
 
-bool GAIA::PBDPhysics::initializeGPU()
+bool GAIA::PBDPhysics::initialize()
 {
 	std::cout << "----------------------------------------------------\n"
 		<< "Load input mesh files and precomputing topological information.\n"
 		<< "----------------------------------------------------\n";
 	tMeshes.resize(objectParamsList.objectParams.size(), nullptr);
-	GPUTMeshes.resize(objectParamsList.objectParams.size(), nullptr);
 #ifdef KEEP_MESHFRAME_MESHES
 	tMeshesMF.resize(objectParamsList.objectParams.size(), nullptr);
 #endif // KEEP_MESHFRAME_MESHES
@@ -194,7 +194,6 @@ bool GAIA::PBDPhysics::initializeGPU()
 				PBDTetMeshNeoHookean::SharedPtr pTetMeshNeoHookean = std::make_shared<PBDTetMeshNeoHookean>();
 				tMeshes[iMesh] = pTetMeshNeoHookean;
 				pTetMeshNeoHookean->initialize(objectParamsList.objectParams[iMesh], pTM_MF, this);
-				GPUTMeshes[iMesh] = pTetMeshNeoHookean->getTetMeshGPU();
 				break;
 			}
 			case MassSpring:
@@ -202,7 +201,6 @@ bool GAIA::PBDPhysics::initializeGPU()
 				PBDTetMeshMassSpring::SharedPtr pTetMeshMassSpring = std::make_shared<PBDTetMeshMassSpring>();
 				tMeshes[iMesh] = pTetMeshMassSpring;
 				pTetMeshMassSpring->initialize(objectParamsList.objectParams[iMesh], pTM_MF, this);
-				GPUTMeshes[iMesh] = pTetMeshMassSpring->getTetMeshGPU();
 			}
 				break;
 			default:
@@ -239,6 +237,7 @@ bool GAIA::PBDPhysics::initializeGPU()
 		dcdResultsAll[iMesh].resize(tMeshes[iMesh]->numSurfaceVerts());
 	}
 	pDCD->initialize(tMeshPtrsBase);
+	pDCD->recordCoherenceStatistics = physicsParams().doStatistics;
 	pCCD->initialize(tMeshPtrsBase);
 
 #if 0
@@ -248,6 +247,33 @@ bool GAIA::PBDPhysics::initializeGPU()
 		pVolCD->initialize(tMeshPtrsBase);
 	}
 #endif
+	return true;
+}
+
+#ifndef GAIA_NO_CUDA
+bool GAIA::PBDPhysics::initializeGPU()
+{
+	std::cout
+		<< "----------------------------------------------------\n"
+		<< "Initializing GPU meshes. "
+		<< "\n----------------------------------------------------" << std::endl;
+
+	GPUTMeshes.resize(tMeshes.size(), nullptr);
+	for (size_t iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+	{
+		tMeshes[iMesh]->initializeGPUMesh();
+		switch (objectParamsList.objectParams[iMesh]->materialType)
+		{
+		case NeoHookean:
+			GPUTMeshes[iMesh] = std::static_pointer_cast<PBDTetMeshNeoHookean>(tMeshes[iMesh])->getTetMeshGPU();
+			break;
+		case MassSpring:
+			GPUTMeshes[iMesh] = std::static_pointer_cast<PBDTetMeshMassSpring>(tMeshes[iMesh])->getTetMeshGPU();
+			break;
+		default:
+			break;
+		}
+	}
 
 	// initialize GPUS
 	cudaStreams.resize(tMeshes.size());
@@ -304,13 +330,22 @@ void GAIA::PBDPhysics::simulateGPU()
 
 	timeStatistics.setToZero();
 
+	if (physicsParams().profile)
+	{
+		Profiler::start(physicsParams().profilerEventsPerThread);
+	}
+
 	while (frameId < physicsAllParams.physicsParams.numFrames) {
+		GAIA_PROFILE_SCOPE_I("Frame", frameId);
 		TICK(timeCsmpFrame);
 		runStepGPU();
 
-		TICK(timeCsmpSaveOutputs);
-		writeOutputs(outputFolder, frameId + 1);
-		TOCK_STRUCT(timeStatistics, timeCsmpSaveOutputs);
+		{
+			GAIA_PROFILE_SCOPE("SaveOutputs");
+			TICK(timeCsmpSaveOutputs);
+			writeOutputs(outputFolder, frameId + 1);
+			TOCK_STRUCT(timeStatistics, timeCsmpSaveOutputs);
+		}
 
 		TOCK_STRUCT(timeStatistics, timeCsmpFrame);
 		
@@ -323,7 +358,10 @@ void GAIA::PBDPhysics::simulateGPU()
 		++frameId;
 	}
 
-
+	if (physicsParams().profile)
+	{
+		Profiler::writeOutputs(outputFolder, physicsParams().debugVerboseLvl);
+	}
 }
 
 void GAIA::PBDPhysics::simulateGPU_debugOnCPU()
@@ -380,14 +418,72 @@ void GAIA::PBDPhysics::simulateGPU_debugOnCPU()
 		++frameId;
 	}
 }
+#endif // !GAIA_NO_CUDA
+
+void GAIA::PBDPhysics::simulateCPU()
+{
+	if (physicsParams().checkAndUpdateWorldBounds)
+	{
+		updateWorldBox();
+	}
+	setUpOutputFolders(outputFolder);
+	std::cout
+		<< "----------------------------------------------------\n"
+		<< "Output folder is: " << outputFolder << std::endl;
+
+	writeOutputs(outputFolder, frameId);
+	std::cout
+		<< "----------------------------------------------------\n"
+		<< "Starting Sims on CPU\n"
+		<< "----------------------------------------------------"
+		<< std::endl;
+
+	timeStatistics.setToZero();
+
+	if (physicsParams().profile)
+	{
+		Profiler::start(physicsParams().profilerEventsPerThread);
+	}
+
+	while (frameId < physicsAllParams.physicsParams.numFrames) {
+		GAIA_PROFILE_SCOPE_I("Frame", frameId);
+		TICK(timeCsmpFrame);
+		runStepCPU();
+
+		{
+			GAIA_PROFILE_SCOPE("SaveOutputs");
+			TICK(timeCsmpSaveOutputs);
+			writeOutputs(outputFolder, frameId + 1);
+			TOCK_STRUCT(timeStatistics, timeCsmpSaveOutputs);
+		}
+
+		TOCK_STRUCT(timeStatistics, timeCsmpFrame);
+
+		std::cout
+			<< "----------------------------------------------------\n"
+			<< "Frame " << frameId + 1 << " completed, Time consumption: " << timeStatistics.timeCsmpFrame
+			<< "\n----------------------------------------------------" << std::endl;
+		timeStatistics.print();
+
+		++frameId;
+	}
+
+	if (physicsParams().profile)
+	{
+		Profiler::writeOutputs(outputFolder, physicsParams().debugVerboseLvl);
+	}
+}
 
+#ifndef GAIA_NO_CUDA
 void GAIA::PBDPhysics::runStepGPU()
 {	
+	GAIA_PROFILE_SCOPE("runStepGPU");
 	timeStatistics.setToZero();
 
 	collisionDetectionCounter = 0;
 
 	for (substep = 0; substep < physicsParams().numSubsteps; substep++) {
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
 		if (physicsParams().showSubstepProgress) {
 			std::cout << "---Substep #" << substep << " | time consumption till now: "
 				<< timeStatistics.timeCsmpAllSubSteps << std::endl;
@@ -411,6 +507,7 @@ void GAIA::PBDPhysics::runStepGPU()
 		// run on GPU
 		for (iIter = 0; iIter < physicsParams().iterations; iIter++)
 		{
+			GAIA_PROFILE_SCOPE_I("Iteration", iIter);
 			applyDeformers();
 
 			TICK(timeCsmpMaterialSolve);
@@ -469,6 +566,7 @@ void GAIA::PBDPhysics::runStepGPU_debugOnCPU(std::vector<PBDTetMeshFEMGPU*>& gpu
 	int collisionDetectionCounter = 0;
 
 	for (substep = 0; substep < physicsParams().numSubsteps; substep++) {
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
 		if (physicsParams().showSubstepProgress) {
 			std::cout << "---Substep #" << substep << std::endl;
 		}
@@ -551,9 +649,92 @@ void GAIA::PBDPhysics::runStepGPU_debugOnCPU(std::vector<PBDTetMeshFEMGPU*>& gpu
 	}
 	TOCK_STRUCT(timeStatistics, timeCsmpAllSubSteps);
 }
+#endif // !GAIA_NO_CUDA
+
+void GAIA::PBDPhysics::runStepCPU()
+{
+	GAIA_PROFILE_SCOPE("runStepCPU");
+	timeStatistics.setToZero();
+
+	collisionDetectionCounter = 0;
+
+	for (substep = 0; substep < physicsParams().numSubsteps; substep++) {
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
+		if (physicsParams().showSubstepProgress) {
+			std::cout << "---Substep #" << substep << " | time consumption till now: "
+				<< timeStatistics.timeCsmpAllSubSteps << std::endl;
+		}
+		TICK(timeCsmpAllSubSteps);
 
+		TICK(timeCsmpInitialCollision);
+		// do the initial detection to categorize the vertices into 2 types: penetration free ones and penetrated ones
+		if (!(substep % physicsParams().collisionDetectionSubSteps))
+		{
+			initialCollisionsDetection();
+		}
+		TOCK_STRUCT(timeStatistics, timeCsmpInitialCollision);
+
+		// the same sequence as runStepGPU, all on the CPU buffers
+		for (iIter = 0; iIter < physicsParams().iterations; iIter++)
+		{
+			GAIA_PROFILE_SCOPE_I("Iteration", iIter);
+			applyDeformers();
+
+			TICK(timeCsmpMaterialSolve);
+			if (iIter == 0)
+			{
+				applyInitialGuesses();
+				evaluateConvergence(substep, 0);
+			}
+
+			materialBoundarySolveCPU();
+
+			TICK(timeCsmpInversionSolve);
+			InversionSolveCPU();
+			TOCK_STRUCT(timeStatistics, timeCsmpInversionSolve);
+
+			evaluateConvergence(substep, iIter + 1);
+
+			TOCK_STRUCT(timeStatistics, timeCsmpMaterialSolve);
+
+			collisionSolve();
+
+			applyConstraints();
+
+			applyPostSolvingDeformers();
+		}
+
+		updateVelocities();
+		++collisionDetectionCounter;
+		curTime += dt;
+		TOCK_STRUCT(timeStatistics, timeCsmpAllSubSteps);
+	}
+}
+
+void GAIA::PBDPhysics::materialBoundarySolveCPU()
+{
+	GAIA_PROFILE_SCOPE("materialBoundarySolveCPU");
+	// the meshes are independent, each of them is also parallelized over its own parallelization groups
+	auto materialBoundarySolveHandler = [&](int iMesh) {
+		tMeshes[iMesh]->solveMaterialConstraint();
+		tMeshes[iMesh]->solveBoundaryConstraint();
+	};
+	cpu_parallel_for(0, tMeshes.size(), materialBoundarySolveHandler);
+}
+
+void GAIA::PBDPhysics::InversionSolveCPU()
+{
+	GAIA_PROFILE_SCOPE("InversionSolveCPU");
+	auto inversionSolveHandler = [&](int iMesh) {
+		tMeshes[iMesh]->solveInversionConstraint();
+	};
+	cpu_parallel_for(0, tMeshes.size(), inversionSolveHandler);
+}
+
+#ifndef GAIA_NO_CUDA
 void GAIA::PBDPhysics::materialBoundarySolveGPU()
 {
+	GAIA_PROFILE_SCOPE("materialBoundarySolveGPU");
 	bool allDone = false;
 	int iParallelizationGroup = 0;
 	while (!allDone)
@@ -602,6 +783,7 @@ void GAIA::PBDPhysics::materialBoundarySolveGPU_debugOnCPU(std::vector<PBDTetMes
 
 void GAIA::PBDPhysics::InversionSolveGPU()
 {
+	GAIA_PROFILE_SCOPE("InversionSolveGPU");
 	// solve inversions
 	// verticesInversionSign has been initialized in BoundarySolve()
 
@@ -671,9 +853,11 @@ void GAIA::PBDPhysics::BoundarySolveSolveGPU_debugOnCPU(std::vector<PBDTetMeshFE
 		}
 	}
 }
+#endif // !GAIA_NO_CUDA
 
 void GAIA::PBDPhysics::collisionSolve()
 {
+	GAIA_PROFILE_SCOPE("collisionSolve");
 	depthBasedCollisionSolve();
 
 	TICK(timeCsmpCollisionSolve);
@@ -722,6 +906,7 @@ void GAIA::PBDPhysics::volumeBasedCollisionSolve()
 
 void GAIA::PBDPhysics::initialCollisionsDetection()
 {
+	GAIA_PROFILE_SCOPE("initialCollisionsDetection");
 	pDCD->updateBVH(RTC_BUILD_QUALITY_REFIT, RTC_BUILD_QUALITY_REFIT, false);
 
 	// if CCD is not allowed, we do not need to do the initial collision detection
@@ -782,6 +967,7 @@ void GAIA::PBDPhysics::initialCollisionsDetection()
 
 void GAIA::PBDPhysics::updateDCD_CPU(bool rebuild)
 {
+	GAIA_PROFILE_SCOPE("updateDCD_CPU");
 	//positiveCollisionDetectionResults.clear();
 	TICK(timeCsmpUpdatingBVHDCD);
 	int numActiveCCD = positiveCollisionDetectionResults.size();
@@ -890,6 +1076,15 @@ void GAIA::PBDPhysics::updateDCD_CPU(bool rebuild)
 			}
 		}
 	}
+	if (physicsParams().doStatistics)
+	{
+		DCDCoherenceStatistics coherenceStatistics = pDCD->coherenceStatistics();
+		timeStatistics.numDCDCoherentTetQueries += coherenceStatistics.numTetQueries;
+		timeStatistics.numDCDCoherentTetHits += coherenceStatistics.numTetHits;
+		timeStatistics.numDCDCoherentFaceQueries += coherenceStatistics.numFaceQueries;
+		timeStatistics.numDCDCoherentFaceHits += coherenceStatistics.numFaceHits;
+		pDCD->resetCoherenceStatistics();
+	}
 	int numActiveDCD = positiveCollisionDetectionResults.size() - numActiveCCD;
 
 
@@ -913,6 +1108,7 @@ void GAIA::PBDPhysics::updateDCD_CPU(bool rebuild)
 
 void GAIA::PBDPhysics::updateCCD_CPU(bool rebuild)
 {
+	GAIA_PROFILE_SCOPE("updateCCD_CPU");
 	TICK(timeCsmpUpdatingBVHCCD);
 	if (rebuild)
 	{
@@ -990,11 +1186,18 @@ void GAIA::PBDPhysics::changeNumSubSteps(int newNumSubSteps)
 		}
 	}
 
-	updateGPUMeshes();
+#ifndef GAIA_NO_CUDA
+	// the GPU meshes only exist when initializeGPU was called
+	if (GPUTMeshes.size())
+	{
+		updateGPUMeshes();
+	}
+#endif // !GAIA_NO_CUDA
 }
 
 void GAIA::PBDPhysics::updateVelocities()
 {
+	GAIA_PROFILE_SCOPE("updateVelocities");
 	for (size_t iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 	{
 		tMeshes[iMesh]->mVelocity = (tMeshes[iMesh]->mVertPos - tMeshes[iMesh]->mVertPrevPos) * (1.0f / dt);
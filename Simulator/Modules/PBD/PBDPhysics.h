@@ -56,9 +56,14 @@ namespace GAIA {
 
         void saveExperimentParameters(const std::string& paramsOutOutPath);
 
+		// loads the meshes and sets up the collision detectors, all that the CPU solver needs
+		bool initialize();
+#ifndef GAIA_NO_CUDA
+		// the GPU meshes and the CUDA streams, call after initialize and only for the GPU solver
 		bool initializeGPU();
 
         void updateGPUMeshes();
+#endif // !GAIA_NO_CUDA
 
 		void syncAllToGPU(bool sync = true);
         void syncAllToCPU(bool sync = true);
@@ -68,19 +73,33 @@ namespace GAIA {
 
         void recoverFromState(std::string& stateFile);
 
+#ifndef GAIA_NO_CUDA
 		void simulateGPU();
 		void simulateGPU_debugOnCPU();
+#endif // !GAIA_NO_CUDA
+		// the multi-threaded CPU backend, no GPU computation nor CPU-GPU syncing
+		void simulateCPU();
 
+#ifndef GAIA_NO_CUDA
 		void runStepGPU();
 		void runStepGPU_debugOnCPU(std::vector<PBDTetMeshFEMGPU*>& gpuTMeshesOnCPU);
+#endif // !GAIA_NO_CUDA
+		void runStepCPU();
 		
+#ifndef GAIA_NO_CUDA
 		void materialBoundarySolveGPU();
 		void materialBoundarySolveGPU_debugOnCPU(std::vector<PBDTetMeshFEMGPU*>& gpuTMeshesOnCPU);
 
         void InversionSolveGPU();
+#endif // !GAIA_NO_CUDA
 
+		void materialBoundarySolveCPU();
+		void InversionSolveCPU();
+
+#ifndef GAIA_NO_CUDA
 		void BoundarySolve();
 		void BoundarySolveSolveGPU_debugOnCPU(std::vector<PBDTetMeshFEMGPU*>& gpuTMeshesOnCPU);
+#endif // !GAIA_NO_CUDA
 
         void collisionSolve();
         void depthBasedCollisionSolve();
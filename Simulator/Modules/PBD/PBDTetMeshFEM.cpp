@@ -1,5 +1,6 @@
 #include "PBDTetMeshFEM.h"
 #include "PBDPhysics.h"
+#include "PBDTetMeshGeneralCompute.h"
 
 bool GAIA::ObjectParamsPBD::fromJson(nlohmann::json& objectParam)
 {
@@ -34,6 +35,7 @@ void GAIA::PBDTetMeshFEM::initialize(ObjectParams::SharedPtr inMaterialParams, T
 		<< "with " << numVertices() << " vertices and " << numTets() << "tets.\n";
 	pPBDPhysics = inPPBDPhysics;
 	dt = inPPBDPhysics->dt;
+	minParallizationBatchSize = inPPBDPhysics->physicsParams().minParallizationBatchSize;
 }
 
 void GAIA::PBDTetMeshFEM::applyInitialGuess()
@@ -64,10 +66,173 @@ void GAIA::PBDTetMeshFEM::solveMaterialConstraint()
 
 void GAIA::PBDTetMeshFEM::solveBoundaryConstraint()
 {
+	PBDPhysicParameters& physicsParams = pPBDPhysics->physicsParams();
+	if (!physicsParams.usePlaneGround)
+	{
+		return;
+	}
+
+	auto solveBoundaryForVertex = [&](int iVert) {
+		Vec3 vel;
+		for (int iDim = 0; iDim < 3; iDim++)
+		{
+			Vec3 contactNormal = Vec3::Zero();
+			FloatingType penetrationDepth;
+			if (mVertPos(iDim, iVert) < physicsParams.worldBounds(iDim, 0))
+			{
+				penetrationDepth = physicsParams.worldBounds(iDim, 0) - mVertPos(iDim, iVert);
+				mVertPos(iDim, iVert) = physicsParams.worldBounds(iDim, 0);
+				contactNormal(iDim) = 1.f;
+			}
+			else if (mVertPos(iDim, iVert) > physicsParams.worldBounds(iDim, 1))
+			{
+				penetrationDepth = mVertPos(iDim, iVert) - physicsParams.worldBounds(iDim, 1);
+				mVertPos(iDim, iVert) = physicsParams.worldBounds(iDim, 1);
+				contactNormal(iDim) = -1.f;
+			}
+			else
+			{
+				continue;
+			}
+
+			vel = mVertPos.col(iVert) - mVertPrevPos.col(iVert);
+			applyBoundaryFriction(mVertPos.col(iVert).data(), penetrationDepth, contactNormal.data(), vel.data(),
+				physicsParams.boundaryFrictionStatic, physicsParams.boundaryFrictionDynamic);
+		}
+	};
+	cpu_parallel_for(0, numVertices(), solveBoundaryForVertex);
 }
 
 void GAIA::PBDTetMeshFEM::solveInversionConstraint()
 {
+	PBDPhysicParameters& physicsParams = pPBDPhysics->physicsParams();
+	if (physicsParams.solveInvertedTets)
+	{
+		for (int iSolve = 0; iSolve < physicsParams.inversionSolveIterations; iSolve++)
+		{
+			for (size_t iGroup = 0; iGroup < tetsColoringCategories().size(); iGroup++)
+			{
+				const std::vector<int32_t>& tetsGroup = tetsColoringCategories()[iGroup];
+				auto solveInversionForTet = [&](int iTet) {
+					// only changes the tets with non positive volumes
+					pPBDPhysics->solveInversionConstraint(this, tetsGroup[iTet]);
+				};
+				solveParallelizationGroup(tetsGroup, solveInversionForTet);
+			}
+		}
+	}
+
+	verticesInvertedSign.fill(false);
+	auto evaluateInversionForTet = [&](int iTet) {
+		if (CuMatrix::tetOrientedVolume(mVertPos.data(), tetVIds().col(iTet).data()) > 0.f)
+		{
+			tetsInvertedSign[iTet] = false;
+		}
+		else
+		{
+			tetsInvertedSign[iTet] = true;
+			// only changes from false to true, the concurrent writes do not conflict
+			for (int iV = 0; iV < 4; iV++)
+			{
+				verticesInvertedSign[tetVIds()(iV, iTet)] = true;
+			}
+		}
+	};
+	cpu_parallel_for(0, numTets(), evaluateInversionForTet);
+}
+
+void GAIA::PBDTetMeshFEM::applyTetConstraint(int32_t tetId, FloatingType C, FloatingType compliance, FloatingType damping,
+	FloatingType& lambda, const Vec12& gradients)
+{
+	if (C == 0.f)
+	{
+		return;
+	}
+
+	FloatingType w = 0.f;
+	FloatingType damp = 0.f;
+	for (int iV = 0; iV < 4; iV++)
+	{
+		IdType vId = tetVIds()(iV, tetId);
+		w += gradients.segment<3>(3 * iV).squaredNorm() * vertexInvMass(vId);
+		if (damping != 0.f)
+		{
+			damp += gradients.segment<3>(3 * iV).dot(mVertPos.col(vId) - mVertPrevPos.col(vId));
+		}
+	}
+
+	if (w == 0.f)
+	{
+		return;
+	}
+
+	if (damping != 0.f)
+	{
+		C += damp * damping / dt;
+		w *= 1 + damping / dt;
+	}
+
+	FloatingType correctedCompliance = tetInvRestVolume(tetId) * compliance / (dt * dt);
+	FloatingType dLambda = 0.f;
+	if (w + correctedCompliance != 0.f)
+	{
+		dLambda = (-C - correctedCompliance * lambda) / (w + correctedCompliance);
+	}
+	lambda += dLambda;
+
+	for (int iV = 0; iV < 4; iV++)
+	{
+		IdType vId = tetVIds()(iV, tetId);
+		mVertPos.col(vId) += (dLambda * vertexInvMass(vId)) * gradients.segment<3>(3 * iV);
+	}
+}
+
+void GAIA::PBDTetMeshFEM::applyTetConstraintInfiniteStiffness(int32_t tetId, FloatingType C, const Vec12& gradients)
+{
+	if (C == 0.f)
+	{
+		return;
+	}
+
+	FloatingType w = 0.f;
+	for (int iV = 0; iV < 4; iV++)
+	{
+		w += gradients.segment<3>(3 * iV).squaredNorm() * vertexInvMass(tetVIds()(iV, tetId));
+	}
+
+	if (w == 0.f)
+	{
+		return;
+	}
+
+	FloatingType dLambda = -C / w;
+	for (int iV = 0; iV < 4; iV++)
+	{
+		IdType vId = tetVIds()(iV, tetId);
+		mVertPos.col(vId) += (dLambda * vertexInvMass(vId)) * gradients.segment<3>(3 * iV);
+	}
+}
+
+GAIA::FloatingType GAIA::PBDTetMeshFEM::computeVolConstraint(int32_t tetId, Vec12& gradients)
+{
+	Mat3 Ds;
+	computeDs(Ds, tetId);
+	Eigen::Map<Mat3> DmInv = getDmInv(tetId);
+	Mat3 F = Ds * DmInv;
+
+	// d det(F) / dF, column by column
+	Mat3 dDetdF;
+	dDetdF.col(0) = F.col(1).cross(F.col(2));
+	dDetdF.col(1) = F.col(2).cross(F.col(0));
+	dDetdF.col(2) = F.col(0).cross(F.col(1));
+
+	Mat3 g = dDetdF * DmInv.transpose();
+	gradients.segment<3>(3) = g.col(0);
+	gradients.segment<3>(6) = g.col(1);
+	gradients.segment<3>(9) = g.col(2);
+	gradients.segment<3>(0) = -g.rowwise().sum();
+
+	return F.determinant() - 1.f;
 }
 
 GAIA::FloatingType GAIA::PBDTetMeshFEM::evaluateMeritEnergy()
@@ -4,6 +4,7 @@
 #include "../TetMesh/TetMeshFEM.h"
 #include "PBDTetMeshFEMGPU.h"
 #include "../PBD/PBDPhysicsParameters.h"
+#include "../Parallelization/CPUParallelization.h"
 
 namespace GAIA {
 	struct PBDPhysics;
@@ -30,17 +31,39 @@ namespace GAIA {
 		typedef PBDTetMeshFEM* Ptr;
 
 		virtual void initialize(ObjectParams::SharedPtr inMaterialParams, TetMeshMF::SharedPtr pTM_MF, PBDPhysics* inPPBDPhysics);
+		// allocates the GPU buffers and the GPU tet mesh, only needed by the GPU solver
+		virtual void initializeGPUMesh() = 0;
 		
 		PBDPhysics* pPBDPhysics = nullptr;
 
 		virtual void applyInitialGuess();
+
+		// the CPU XPBD solver, on the CPU buffers directly, without syncing to the GPU
+		// each parallelization group is solved in parallel, and the groups with fewer than minParallizationBatchSize elements in serial
 		virtual void solveMaterialConstraint();
+		// the box boundary with friction, the counterpart of solveBoxBoundaryConstraintGPU
 		virtual void solveBoundaryConstraint();
+		// solves the inverted tets for inversionSolveIterations and updates tetsInvertedSign and verticesInvertedSign,
+		// the counterpart of solveInversionConstraintGPU and evaluateInversionGPU
 		virtual void solveInversionConstraint();
 
+		// XPBD projection of a constraint on the 4 vertices of a tet, the compliance is scaled by the inverse rest volume;
+		// the counterpart of applyToElem
+		void applyTetConstraint(int32_t tetId, FloatingType C, FloatingType compliance, FloatingType damping, 
+			FloatingType& lambda, const Vec12& gradients);
+		// the projection of a constraint with zero compliance, without lambda; the counterpart of applyToInfiniteStiffness
+		void applyTetConstraintInfiniteStiffness(int32_t tetId, FloatingType C, const Vec12& gradients);
+		// the volume constraint det(F) - 1 and its gradients w.r.t. the 4 vertices, the counterpart of solveVolConstraint
+		FloatingType computeVolConstraint(int32_t tetId, Vec12& gradients);
+
+		template <typename Func>
+		void solveParallelizationGroup(const std::vector<int32_t>& parallelizationGroup, Func& solveElement);
+
+#ifndef GAIA_NO_CUDA
 		virtual void solveMaterialConstraintGPU_ParallelizationGroup(int iGroup, int numThreads, cudaStream_t stream) = 0;
 		virtual void solveMaterialGPUAggregated(int numThreads, cudaStream_t stream) = 0;
 		virtual void solveMaterialConstraintGPU_debugOnCPU(PBDTetMeshFEMGPU* pExternGPUTMeshOnCPU) = 0;
+#endif // !GAIA_NO_CUDA
 		virtual size_t numAllParallelizationGroups() = 0;
 
 		virtual size_t numTetParallelizationGroups() = 0;
@@ -58,10 +81,27 @@ namespace GAIA {
 		virtual FloatingType evaluateElasticEnergy() = 0;
 
 		FloatingType dt;
+		int minParallizationBatchSize = 100;
 		TVerticesMat inertia;
 	protected:
 		// hide this intializer, because PBDTetMeshFEM must be initialized with the pointer to PBDPhysics
 		using TetMeshFEM::initialize;
 	};
 
+	template<typename Func>
+	inline void PBDTetMeshFEM::solveParallelizationGroup(const std::vector<int32_t>& parallelizationGroup, Func& solveElement)
+	{
+		if (parallelizationGroup.size() >= minParallizationBatchSize)
+		{
+			cpu_parallel_for(0, parallelizationGroup.size(), solveElement);
+		}
+		else
+		{
+			for (int iElement = 0; iElement < parallelizationGroup.size(); iElement++)
+			{
+				solveElement(iElement);
+			}
+		}
+	}
+
 }
\ No newline at end of file
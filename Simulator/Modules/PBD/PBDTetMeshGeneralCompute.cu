@@ -68,48 +68,6 @@ __host__ __device__ void GAIA::solveBoxBoundaryContraintForVertex(PBDTetMeshFEMG
 	}	
 }
 
-__host__ __device__ void GAIA::applyBoundaryFriction(FloatingTypeGPU* v, FloatingTypeGPU penetrationDepth,
-	FloatingTypeGPU* contactNormal, FloatingTypeGPU* vel, FloatingTypeGPU boundaryFritionStatic,
-	FloatingTypeGPU boundaryFritionDynamic)
-{
-	// shift that is perpendicular to the contact normal
-	FloatingTypeGPU diff[3]; //vel - contactNormal * (vel * contactNormal);
-	FloatingTypeGPU velNormPerp = vec3DotProduct(vel, contactNormal);
-
-	vec3Mul(contactNormal, velNormPerp, contactNormal);
-	vec3Minus(vel, contactNormal, diff);
-
-	FloatingTypeGPU dNorm = vec3Norm(diff);
-
-	if (dNorm == 0.f)
-	{
-		return;
-	}
-
-	//FloatingType dynamicNorm = C * curPhysics.friction_dynamic;
-	//FloatingType staticNorm = C * curPhysics.friction_static;
-
-	FloatingTypeGPU dynamicNorm;
-	if (penetrationDepth * boundaryFritionDynamic / dNorm <= 1)
-	{
-		dynamicNorm = penetrationDepth * boundaryFritionDynamic;
-	}
-	else
-	{
-		dynamicNorm = dNorm;
-	}
-
-
-	FloatingTypeGPU staticNorm = penetrationDepth * boundaryFritionStatic;
-
-	if (dNorm > staticNorm) {
-		vec3Mul(diff, dynamicNorm / dNorm, diff);
-		// diff = (diff / dNorm) * dynamicNorm;
-	}
-
-	vec3Minus(v, diff, v);
-}
-
 __global__ void GAIA::solveBoxBoundaryConstraintGPU(PBDTetMeshFEMGPU* pTetMeshGPU, FloatingTypeGPU xMin, FloatingTypeGPU xMax, FloatingTypeGPU yMin, FloatingTypeGPU yMax,
 	FloatingTypeGPU zMin, FloatingTypeGPU zMax, FloatingTypeGPU boundaryFritionStatic, FloatingTypeGPU boundaryFritionDynamic)
 {
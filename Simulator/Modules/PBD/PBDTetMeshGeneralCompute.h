@@ -195,6 +195,48 @@ __host__ __device__ inline void GAIA::applyToInfiniteStiffness(FloatingTypeGPU*
 	}
 }
 
+__host__ __device__ inline void GAIA::applyBoundaryFriction(FloatingTypeGPU* v, FloatingTypeGPU penetrationDepth,
+	FloatingTypeGPU* contactNormal, FloatingTypeGPU* vel, FloatingTypeGPU boundaryFritionStatic,
+	FloatingTypeGPU boundaryFritionDynamic)
+{
+	// shift that is perpendicular to the contact normal
+	FloatingTypeGPU diff[3]; //vel - contactNormal * (vel * contactNormal);
+	FloatingTypeGPU velNormPerp = CuMatrix::vec3DotProduct(vel, contactNormal);
+
+	CuMatrix::vec3Mul(contactNormal, velNormPerp, contactNormal);
+	CuMatrix::vec3Minus(vel, contactNormal, diff);
+
+	FloatingTypeGPU dNorm = CuMatrix::vec3Norm(diff);
+
+	if (dNorm == 0.f)
+	{
+		return;
+	}
+
+	//FloatingType dynamicNorm = C * curPhysics.friction_dynamic;
+	//FloatingType staticNorm = C * curPhysics.friction_static;
+
+	FloatingTypeGPU dynamicNorm;
+	if (penetrationDepth * boundaryFritionDynamic / dNorm <= 1)
+	{
+		dynamicNorm = penetrationDepth * boundaryFritionDynamic;
+	}
+	else
+	{
+		dynamicNorm = dNorm;
+	}
+
+
+	FloatingTypeGPU staticNorm = penetrationDepth * boundaryFritionStatic;
+
+	if (dNorm > staticNorm) {
+		CuMatrix::vec3Mul(diff, dynamicNorm / dNorm, diff);
+		// diff = (diff / dNorm) * dynamicNorm;
+	}
+
+	CuMatrix::vec3Minus(v, diff, v);
+}
+
 __host__ __device__ inline const int32_t* GAIA::getTetVIdsPtr(const int32_t* tetVIdsAll, int32_t tetId)
 {
 	return tetVIdsAll + 4* tetId;
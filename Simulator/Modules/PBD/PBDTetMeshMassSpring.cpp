@@ -41,7 +41,10 @@ void GAIA::PBDTetMeshMassSpring::initialize(ObjectParams::SharedPtr inMaterialPa
 	}
 
 	// std::cout << edges.transpose() << std::endl;
+}
 
+void GAIA::PBDTetMeshMassSpring::initializeGPUMesh()
+{
 	initializeGPUTetMesh(this, &tetMeshGPU);
 	pTetMeshGPUBuffer = std::make_shared<DeviceClassBuffer<PBDTetMeshFEMGPUMassSpring>>();
 	pTetMeshGPUBuffer->fromCPU(&tetMeshGPU);
@@ -55,6 +58,78 @@ void GAIA::PBDTetMeshMassSpring::applyInitialGuess()
 	initializeLambda();
 }
 
+void GAIA::PBDTetMeshMassSpring::solveMaterialConstraint()
+{
+	// solve edges first
+	for (size_t iGroup = 0; iGroup < edgesColoringCategories().size(); iGroup++)
+	{
+		const std::vector<int32_t>& edgesGroup = edgesColoringCategories()[iGroup];
+		auto solveSpringForEdge = [&](int iEdge) {
+			solveSpringConstraintForOneEdgeCPU(edgesGroup[iEdge]);
+		};
+		solveParallelizationGroup(edgesGroup, solveSpringForEdge);
+	}
+
+	// solve volume constraints the second
+	for (size_t iGroup = 0; iGroup < tetsColoringCategories().size(); iGroup++)
+	{
+		const std::vector<int32_t>& tetsGroup = tetsColoringCategories()[iGroup];
+		auto solveVolumeForTet = [&](int iTet) {
+			solveVolumeConstraintForOneTetCPU(tetsGroup[iTet]);
+		};
+		solveParallelizationGroup(tetsGroup, solveVolumeForTet);
+	}
+}
+
+void GAIA::PBDTetMeshMassSpring::solveSpringConstraintForOneEdgeCPU(int32_t edgeId)
+{
+	FloatingType springCompliance = pObjectParamsMaterial->springCompliance;
+	FloatingType springDamping = pObjectParamsMaterial->springDamping;
+
+	IdType v1 = edges()(0, edgeId);
+	IdType v2 = edges()(1, edgeId);
+
+	Vec3 diff = mVertPos.col(v1) - mVertPos.col(v2);
+	FloatingType l = diff.norm();
+	if (l == 0.f)
+	{
+		return;
+	}
+	FloatingType C = l - orgLengths(edgeId);
+	// the gradient of v2 is -x1Grad
+	Vec3 x1Grad = diff / l;
+
+	FloatingType w = vertexInvMass(v1) + vertexInvMass(v2);
+	if (springDamping != 0.f)
+	{
+		FloatingType damp = x1Grad.dot((mVertPos.col(v1) - mVertPrevPos.col(v1)) - (mVertPos.col(v2) - mVertPrevPos.col(v2)));
+		C += damp * springDamping / dt;
+		w *= 1 + springDamping / dt;
+	}
+
+	FloatingType alpha = springCompliance / (dt * dt);
+	FloatingType dLambda = 0.f;
+	if (w + alpha != 0.f)
+	{
+		dLambda = (-C - alpha * springLambdas(edgeId)) / (w + alpha);
+	}
+
+	if (springCompliance != 0.f)
+	{
+		springLambdas(edgeId) += dLambda;
+	}
+
+	mVertPos.col(v1) += (dLambda * vertexInvMass(v1)) * x1Grad;
+	mVertPos.col(v2) -= (dLambda * vertexInvMass(v2)) * x1Grad;
+}
+
+void GAIA::PBDTetMeshMassSpring::solveVolumeConstraintForOneTetCPU(int32_t tetId)
+{
+	Vec12 gradients;
+	FloatingType CVol = computeVolConstraint(tetId, gradients);
+	applyTetConstraintInfiniteStiffness(tetId, CVol, gradients);
+}
+
 void GAIA::PBDTetMeshMassSpring::syncToGPU(bool sync, cudaStream_t stream)
 {
 	PBDTetMeshFEMShared::syncToGPU(false, stream);
@@ -85,6 +160,7 @@ void GAIA::PBDTetMeshMassSpring::syncToCPUInversionSignOnly(bool sync, cudaStrea
 	PBDTetMeshFEMShared::syncToCPUInversionSignOnly(sync, stream);
 }
 
+#ifndef GAIA_NO_CUDA
 void GAIA::PBDTetMeshMassSpring::solveMaterialGPUAggregated(int numThreads, cudaStream_t stream)
 {
 	solveSpringConstraintsAggregatedGPU(numThreads, stream, edgesColoringCategories().front().size(), getTetMeshGPU());
@@ -121,6 +197,7 @@ void GAIA::PBDTetMeshMassSpring::solveMaterialConstraintGPU_debugOnCPU(PBDTetMes
 		solveVolumeConstraintsCPU(tetsColoringCategories()[iParalGroup].data(), tetsColoringCategories()[iParalGroup].size(), tetMeshGPU_forCPU);
 	}
 }
+#endif // !GAIA_NO_CUDA
 
 size_t GAIA::PBDTetMeshMassSpring::numAllParallelizationGroups()
 {
@@ -55,19 +55,27 @@ namespace GAIA {
 		//PBDTetMeshFEMGPUMassSpring tetMeshGPU;
 
 		virtual void initialize(ObjectParams::SharedPtr inMaterialParams, std::shared_ptr<TetMeshMF> pTM_MF, PBDPhysics* inPPBDPhysics);
+		virtual void initializeGPUMesh();
 
 		virtual void applyInitialGuess();
 
+		virtual void solveMaterialConstraint();
+		// the counterparts of solveMaterialForOneEdge_MassSpring and solveVolumeConstraints_kernel
+		void solveSpringConstraintForOneEdgeCPU(int32_t edgeId);
+		void solveVolumeConstraintForOneTetCPU(int32_t tetId);
+
 		virtual void syncToGPU(bool sync=true, cudaStream_t stream = 0);
 		virtual void syncToCPU(bool sync=true, cudaStream_t stream = 0);
 		virtual void syncToCPUVertPosOnly(bool sync=true, cudaStream_t stream = 0);
 		virtual void syncToGPUVertPosOnly(bool sync=true, cudaStream_t stream = 0);
 		virtual void syncToCPUInversionSignOnly(bool sync = true, cudaStream_t stream = 0);
 
+#ifndef GAIA_NO_CUDA
 		// before calling this, call syncToGPU() first
 		virtual void solveMaterialGPUAggregated(int numThreads, cudaStream_t stream);
 		virtual void solveMaterialConstraintGPU_ParallelizationGroup(int iGroup, int numThreads, cudaStream_t stream);
 		virtual void solveMaterialConstraintGPU_debugOnCPU(PBDTetMeshFEMGPU* pExternGPUTMeshOnCPU);
+#endif // !GAIA_NO_CUDA
 
 		virtual size_t numAllParallelizationGroups();
 		virtual size_t numTetParallelizationGroups();
@@ -44,7 +44,10 @@ void GAIA::PBDTetMeshNeoHookean::initialize(ObjectParams::SharedPtr inMaterialPa
 
 	devLambdas.resize(m_nTets);
 	volLambdas.resize(m_nTets);
+}
 
+void GAIA::PBDTetMeshNeoHookean::initializeGPUMesh()
+{
 	initializeGPUTetMesh(this, &tetMeshGPU);
 	pTetMeshGPUBuffer = std::make_shared<DeviceClassBuffer<TetMeshFEMGPU_NeoHookean>>();
 	pTetMeshGPUBuffer->fromCPU(&tetMeshGPU);
@@ -59,6 +62,52 @@ void GAIA::PBDTetMeshNeoHookean::applyInitialGuess()
 	initializeLambda();
 }
 
+void GAIA::PBDTetMeshNeoHookean::solveMaterialConstraint()
+{
+	for (size_t iGroup = 0; iGroup < tetsColoringCategories().size(); iGroup++)
+	{
+		const std::vector<int32_t>& tetsGroup = tetsColoringCategories()[iGroup];
+		auto solveMaterialForTet = [&](int iTet) {
+			solveMaterialForOneTetCPU(tetsGroup[iTet]);
+		};
+		solveParallelizationGroup(tetsGroup, solveMaterialForTet);
+	}
+}
+
+void GAIA::PBDTetMeshNeoHookean::solveMaterialForOneTetCPU(int32_t tetId)
+{
+	Vec12 gradients;
+
+	// deviatoric constraint: C = |F|_F
+	Mat3 Ds;
+	computeDs(Ds, tetId);
+	Eigen::Map<Mat3> DmInv = getDmInv(tetId);
+	Mat3 F = Ds * DmInv;
+	FloatingType rS = F.norm();
+	FloatingType rSInv = rS != 0.f ? 1.f / rS : 0.f;
+
+	Mat3 g = (rSInv * F) * DmInv.transpose();
+	gradients.segment<3>(3) = g.col(0);
+	gradients.segment<3>(6) = g.col(1);
+	gradients.segment<3>(9) = g.col(2);
+	gradients.segment<3>(0) = -g.rowwise().sum();
+
+	applyTetConstraint(tetId, rS, pObjectParamsNeoHookean->devCompliance, pObjectParamsNeoHookean->devDamping,
+		devLambdas(tetId), gradients);
+
+	// volume constraint, on the positions updated by the deviatoric one
+	FloatingType CVol = computeVolConstraint(tetId, gradients);
+	if (pObjectParamsNeoHookean->volCompliance == 0.f)
+	{
+		applyTetConstraintInfiniteStiffness(tetId, CVol, gradients);
+	}
+	else
+	{
+		applyTetConstraint(tetId, CVol, pObjectParamsNeoHookean->volCompliance, pObjectParamsNeoHookean->volDamping,
+			volLambdas(tetId), gradients);
+	}
+}
+
 void GAIA::PBDTetMeshNeoHookean::syncToGPU(bool sync, cudaStream_t stream)
 {
 	PBDTetMeshFEMShared::syncToGPU(false, stream);
@@ -106,7 +155,7 @@ void GAIA::PBDTetMeshNeoHookean::syncToCPUInversionSignOnly(bool sync, cudaStrea
 	PBDTetMeshFEMShared::syncToCPUInversionSignOnly(sync, stream);
 }
 
-
+#ifndef GAIA_NO_CUDA
 void GAIA::PBDTetMeshNeoHookean::solveMaterialGPUAggregated(int numThreads, cudaStream_t stream)
 {
 	solveNeoHookeanMaterialAggregatedGPU(numThreads, stream, tetsColoringCategories().front().size(), getTetMeshGPU());
@@ -141,6 +190,7 @@ void GAIA::PBDTetMeshNeoHookean::solveMaterialConstraintGPU_debugOnCPU(PBDTetMes
 			tetsColoringEachCategoryBuffer[iParalGroup]->getSize(), (TetMeshFEMGPU_NeoHookean*)pExternGPUTMeshOnCPU);
 	}
 }
+#endif // !GAIA_NO_CUDA
 
 size_t GAIA::PBDTetMeshNeoHookean::numAllParallelizationGroups()
 {
@@ -1,5 +1,6 @@
 #pragma once
 #include <functional>
+#include <algorithm>
 
 //#define TURN_ON_DEBUG 
 
@@ -26,4 +27,51 @@ inline void cpu_parallel_for(int start, int end, Func & func) {
 	for (int index = start; index < end; ++index)
 		func (index);
 	#endif
-}
\ No newline at end of file
+}
+
+// the number of threads cpu_parallel_for may run on, to size the per thread accumulators
+inline int cpu_max_threads() {
+	#ifdef TBB_PARALLEL 
+	return tbb::this_task_arena::max_concurrency();
+	#else
+	return 1;
+	#endif
+}
+
+// the index of the calling thread in [0, cpu_max_threads()), 0 outside of the parallel loops
+inline int cpu_thread_index() {
+	#ifdef TBB_PARALLEL 
+	int index = tbb::this_task_arena::current_thread_index();
+	return index < 0 ? 0 : index;
+	#else
+	return 0;
+	#endif
+}
+
+template<typename RandomIt>
+inline void cpu_parallel_sort(RandomIt begin, RandomIt end) {
+	#ifdef TBB_PARALLEL 
+	tbb::parallel_sort(begin, end);
+	#else
+	std::sort(begin, end);
+	#endif
+}
+
+// the max of func(index) over [start, end), init if the range is empty
+template<typename T, typename Func>
+inline T cpu_parallel_max(int start, int end, T init, Func & func) {
+	#ifdef TBB_PARALLEL 
+	return tbb::parallel_reduce(tbb::blocked_range<int>(start, end), init,
+		[&](const tbb::blocked_range<int>& range, T localMax) {
+			for (int index = range.begin(); index < range.end(); ++index)
+				localMax = std::max(localMax, (T)func(index));
+			return localMax;
+		},
+		[](T a, T b) { return std::max(a, b); });
+	#else
+	T maxValue = init;
+	for (int index = start; index < end; ++index)
+		maxValue = std::max(maxValue, (T)func(index));
+	return maxValue;
+	#endif
+}
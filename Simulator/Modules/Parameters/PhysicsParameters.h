@@ -77,7 +77,7 @@ namespace GAIA {
 		// Collision Solving
 		bool smoothSurfaceNormal = true;
 
-		// BVH Updates
+		// BVH Updates, the rebuild intervals in frames when collisionParams().adaptiveBVHRebuild is off
 		int dcdTetMeshSceneBVHRebuildSteps = 16;
 		int dcdSurfaceSceneBVHRebuildSteps = 3;
 		int ccdBVHRebuildSteps = 7;
@@ -89,6 +89,10 @@ namespace GAIA {
 		// output the vertex coordinates (pos only)
 		std::string outputExt = "ply";
 		int binaryModeVisualizationSteps = 100;
+		// for outputExt "traj": the maximum position error of the quantization, <= 0 means lossless,
+		// and the number of frames between two keyframes that don't depend on the previous frames
+		FloatingType trajectoryQuantizationTolerance = 0;
+		int trajectoryKeyframeInterval = 100;
 
 		bool outputT = false;
 		bool outputVTK = false;
@@ -97,6 +101,17 @@ namespace GAIA {
 		bool saveSimulationParameters = true;
 		int outputRecoveryStateStep = 10;
 		bool outputRecoveryStateBinary = true;
+		// write the recovery states as binary checkpoints (RecoveryStates/A*.ckpt) holding the full stepping state of the meshes,
+		// which are written and read in parallel and resume bit identically; overrides outputRecoveryStateBinary
+		bool outputRecoveryStateCheckpoint = false;
+		// write the outputs on a background thread from snapshots of the meshes, numAsyncOutputBuffers bounds
+		// the number of frames waiting to be written
+		bool asyncOutput = false;
+		int numAsyncOutputBuffers = 2;
+		// record the profiler scopes and write Profile/Trace.json (Chrome trace format) and Profile/Summary.txt/json at the end;
+		// the trace keeps the latest profilerEventsPerThread scopes of each thread
+		bool profile = false;
+		int profilerEventsPerThread = 1 << 16;
 
 		// rendering
 		std::string shaderFolderPath;
@@ -166,12 +181,19 @@ namespace GAIA {
 			EXTRACT_FROM_JSON(physicsParam, outputRecoveryState);
 			EXTRACT_FROM_JSON(physicsParam, outputRecoveryStateStep);
 			EXTRACT_FROM_JSON(physicsParam, outputRecoveryStateBinary);
+			EXTRACT_FROM_JSON(physicsParam, outputRecoveryStateCheckpoint);
+			EXTRACT_FROM_JSON(physicsParam, asyncOutput);
+			EXTRACT_FROM_JSON(physicsParam, numAsyncOutputBuffers);
+			EXTRACT_FROM_JSON(physicsParam, profile);
+			EXTRACT_FROM_JSON(physicsParam, profilerEventsPerThread);
 			EXTRACT_FROM_JSON(physicsParam, outputVTK);
 			EXTRACT_FROM_JSON(physicsParam, outputT);
 			EXTRACT_FROM_JSON(physicsParam, saveSimulationParameters);
 			EXTRACT_FROM_JSON(physicsParam, outputStatistics);
 			EXTRACT_FROM_JSON(physicsParam, outputStatisticsStep);
 			EXTRACT_FROM_JSON(physicsParam, binaryModeVisualizationSteps);
+			EXTRACT_FROM_JSON(physicsParam, trajectoryQuantizationTolerance);
+			EXTRACT_FROM_JSON(physicsParam, trajectoryKeyframeInterval);
 
 			EXTRACT_FROM_JSON(physicsParam, psd);
 			return true;
@@ -232,12 +254,19 @@ namespace GAIA {
 			PUT_TO_JSON(physicsParam, outputRecoveryState);
 			PUT_TO_JSON(physicsParam, outputRecoveryStateStep);
 			PUT_TO_JSON(physicsParam, outputRecoveryStateBinary);
+			PUT_TO_JSON(physicsParam, outputRecoveryStateCheckpoint);
+			PUT_TO_JSON(physicsParam, asyncOutput);
+			PUT_TO_JSON(physicsParam, numAsyncOutputBuffers);
+			PUT_TO_JSON(physicsParam, profile);
+			PUT_TO_JSON(physicsParam, profilerEventsPerThread);
 			PUT_TO_JSON(physicsParam, outputVTK);
 			PUT_TO_JSON(physicsParam, outputT);
 			PUT_TO_JSON(physicsParam, saveSimulationParameters);
 			PUT_TO_JSON(physicsParam, outputStatistics);
 			PUT_TO_JSON(physicsParam, outputStatisticsStep);
 			PUT_TO_JSON(physicsParam, binaryModeVisualizationSteps);
+			PUT_TO_JSON(physicsParam, trajectoryQuantizationTolerance);
+			PUT_TO_JSON(physicsParam, trajectoryKeyframeInterval);
 
 			PUT_TO_JSON(physicsParam, psd);
 
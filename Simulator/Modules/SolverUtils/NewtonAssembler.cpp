@@ -1,9 +1,15 @@
 #include "NewtonAssembler.h"
+#include "../Parallelization/CPUParallelization.h"
+
+#include <algorithm>
 
 using namespace GAIA;
 
-inline void GAIA::TetMeshNewtonAssembler::initialize(std::vector<TetMeshFEM::SharedPtr> meshes)
+void GAIA::TetMeshNewtonAssembler::initialize(std::vector<TetMeshFEM::SharedPtr> meshes_in, int solverType_in)
 {
+	meshes = meshes_in;
+	solverType = solverType_in;
+
 	numAllVertices = 0;
 	numAllEdges = 0;
 	numAllTets = 0;
@@ -20,11 +26,17 @@ inline void GAIA::TetMeshNewtonAssembler::initialize(std::vector<TetMeshFEM::Sha
 		diagonalHessianBlockPtrs[iMesh].reserve(pMesh->numVertices() * 9);
 		offDiagonalHessianBlockPtrs[iMesh].reserve(pMesh->numEdges() * 18);
 	}
+	newtonHessianTripletsElasticity.clear();
 	newtonHessianTripletsElasticity.reserve(numAllVertices * 9 + numAllEdges * 18);
+	meshOffsets.clear();
+	tetOffsets.clear();
 	int offset = 0;
+	int tetOffset = 0;
 	for (int iMesh = 0; iMesh < meshes.size(); iMesh++)
 	{
 		TetMeshFEM::SharedPtr pMesh = meshes[iMesh];
+		tetOffsets.push_back(tetOffset);
+		tetOffset += pMesh->numTets();
 
 		//diagonal blocks
 		for (int iV = 0; iV < pMesh->numVertices(); iV++)
@@ -59,27 +71,109 @@ inline void GAIA::TetMeshNewtonAssembler::initialize(std::vector<TetMeshFEM::Sha
 				}
 			}
 		}
+		meshOffsets.push_back(offset);
 		offset += pMesh->numVertices() * 3;
 	}
 	newtonHessianAll.resize(numAllVertices * 3, numAllVertices * 3);
-	newtonHessianAll.setFromTriplets(newtonHessianTripletsElasticity.begin(), newtonHessianTripletsElasticity.end());
-	newtonHessianAll.makeCompressed();
 
-	if (solverType == 0)
+	if (solverType == 2)
 	{
-		solverDirect.analyzePattern(newtonHessianAll);
+		diagonalHessianBlocks.resize(numAllVertices);
+		diagonalHessianBlockInverses.resize(numAllVertices);
+		if (pcgPreconditionerType == 1)
+		{
+			tetLocalHessianInverses.resize(numAllTets);
+			tetLocalSolutions.resize(numAllTets);
+			schwarzWeights.resize(numAllVertices);
+			for (int iMesh = 0; iMesh < meshes.size(); iMesh++)
+			{
+				TetMeshFEM::SharedPtr pMesh = meshes[iMesh];
+				for (int iV = 0; iV < pMesh->numVertices(); iV++)
+				{
+					schwarzWeights(meshOffsets[iMesh] / 3 + iV) = 1.0 / sqrt(NFloatingType(std::max(pMesh->getNumVertexNeighborTets(iV), 1)));
+				}
+			}
+		}
+		// there is no previous solution to start from
+		Ndx.setZero(numAllVertices * 3);
+	}
+
+	collisionHessianBlocks.clear();
+	buildHessian();
+
+	newtonForce.resize(numAllVertices * 3);
+	elasticHessian.resize(numAllTets);
+	elasticForce.resize(numAllTets);
+	elasticEnergy.resize(numAllTets);
+}
 
+bool GAIA::TetMeshNewtonAssembler::analyzeCollision(const std::vector<std::pair<IdType, IdType>>& collisionBlocks)
+{
+	// the active collisions usually persist over many substeps, in that case the pattern and its analysis are reused
+	if (collisionBlocks == collisionHessianBlocks)
+	{
+		return false;
 	}
-	else {
-		solverCG.compute(newtonHessianAll);
-		solverCG.setMaxIterations(300);
-		solverCG.setTolerance(1e-7f);
+	collisionHessianBlocks = collisionBlocks;
+	buildHessian();
+	return true;
+}
+
+GAIA::IdType GAIA::TetMeshNewtonAssembler::findCollisionBlock(IdType row, IdType col) const
+{
+	auto pBlock = std::lower_bound(collisionHessianBlocks.begin(), collisionHessianBlocks.end(), std::make_pair(row, col));
+	if (pBlock == collisionHessianBlocks.end() || pBlock->first != row || pBlock->second != col)
+	{
+		return -1;
 	}
+	return IdType(pBlock - collisionHessianBlocks.begin());
+}
+
+void GAIA::TetMeshNewtonAssembler::clearHessian()
+{
+	memset(newtonHessianAll.valuePtr(), 0, newtonHessianAll.nonZeros() * sizeof(NFloatingType));
+	if (solverType == 2)
+	{
+		std::fill(diagonalHessianBlocks.begin(), diagonalHessianBlocks.end(), NMat3::Zero());
+		std::fill(collisionHessianBlockValues.begin(), collisionHessianBlockValues.end(), NMat3::Zero());
+	}
+}
+
+void GAIA::TetMeshNewtonAssembler::buildHessian()
+{
+	if (solverType == 2)
+	{
+		buildMatrixFreeHessian();
+		return;
+	}
+
+	newtonHessianTripletsCollision.clear();
+	newtonHessianTripletsCollision.reserve(collisionHessianBlocks.size() * 9);
+	for (const auto& block : collisionHessianBlocks)
+	{
+		for (IdType i = 0; i < 3; ++i)
+		{
+			for (IdType j = 0; j < 3; ++j)
+			{
+				newtonHessianTripletsCollision.emplace_back(block.first + i, block.second + j, 1.0);
+			}
+		}
+	}
+
+	// the collision blocks may overlap with the elastic ones, setFromTriplets merges them into one entry
+	std::vector<NTriplet> newtonHessianTriplets;
+	newtonHessianTriplets.reserve(newtonHessianTripletsElasticity.size() + newtonHessianTripletsCollision.size());
+	newtonHessianTriplets.insert(newtonHessianTriplets.end(), newtonHessianTripletsElasticity.begin(), newtonHessianTripletsElasticity.end());
+	newtonHessianTriplets.insert(newtonHessianTriplets.end(), newtonHessianTripletsCollision.begin(), newtonHessianTripletsCollision.end());
+	newtonHessianAll.setFromTriplets(newtonHessianTriplets.begin(), newtonHessianTriplets.end());
+	newtonHessianAll.makeCompressed();
 
-	offset = 0;
 	for (int iMesh = 0; iMesh < meshes.size(); iMesh++)
 	{
+		diagonalHessianBlockPtrs[iMesh].clear();
+		offDiagonalHessianBlockPtrs[iMesh].clear();
 		TetMeshFEM::SharedPtr pMesh = meshes[iMesh];
+		int offset = meshOffsets[iMesh];
 		for (int iV = 0; iV < pMesh->numVertices(); iV++)
 		{
 			int vertPos = offset + iV * 3;
@@ -110,11 +204,274 @@ inline void GAIA::TetMeshNewtonAssembler::initialize(std::vector<TetMeshFEM::Sha
 				}
 			}
 		}
-		offset += pMesh->numVertices() * 3;
 	}
-	newtonForce.resize(numAllVertices * 3);
-	elasticHessian.resize(numAllTets);
-	elasticForce.resize(numAllTets);
+
+	collisionHessianBlockPtrs.clear();
+	collisionHessianBlockPtrs.reserve(collisionHessianBlocks.size() * 9);
+	for (const auto& block : collisionHessianBlocks)
+	{
+		for (IdType i = 0; i < 3; ++i)
+		{
+			for (IdType j = 0; j < 3; ++j)
+			{
+				collisionHessianBlockPtrs.push_back(&newtonHessianAll.coeffRef(block.first + i, block.second + j));
+			}
+		}
+	}
+
+	analyzePattern();
+}
+
+void GAIA::TetMeshNewtonAssembler::buildMatrixFreeHessian()
+{
+	// same layout as the pointers into newtonHessianAll, so the system can be filled the same way
+	for (int iMesh = 0; iMesh < meshes.size(); iMesh++)
+	{
+		diagonalHessianBlockPtrs[iMesh].clear();
+		offDiagonalHessianBlockPtrs[iMesh].clear();
+		TetMeshFEM::SharedPtr pMesh = meshes[iMesh];
+		for (int iV = 0; iV < pMesh->numVertices(); iV++)
+		{
+			NMat3& block = diagonalHessianBlocks[meshOffsets[iMesh] / 3 + iV];
+			for (int i = 0; i < 3; ++i)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					diagonalHessianBlockPtrs[iMesh].push_back(&block(j, i));
+				}
+			}
+		}
+	}
+
+	collisionHessianBlockValues.resize(collisionHessianBlocks.size());
+	collisionHessianBlockPtrs.clear();
+	collisionHessianBlockPtrs.reserve(collisionHessianBlocks.size() * 9);
+	for (size_t iBlock = 0; iBlock < collisionHessianBlocks.size(); iBlock++)
+	{
+		for (IdType i = 0; i < 3; ++i)
+		{
+			for (IdType j = 0; j < 3; ++j)
+			{
+				collisionHessianBlockPtrs.push_back(&collisionHessianBlockValues[iBlock](i, j));
+			}
+		}
+	}
+
+	// the blocks are sorted by row
+	collisionHessianBlockRowOffsets.assign(numAllVertices + 1, 0);
+	for (const auto& block : collisionHessianBlocks)
+	{
+		collisionHessianBlockRowOffsets[block.first / 3 + 1]++;
+	}
+	for (size_t iV = 0; iV < numAllVertices; iV++)
+	{
+		collisionHessianBlockRowOffsets[iV + 1] += collisionHessianBlockRowOffsets[iV];
+	}
+}
+
+void GAIA::TetMeshNewtonAssembler::multiplyHessian(const NVecDynamic& x, NVecDynamic& y)
+{
+	for (int iMesh = 0; iMesh < meshes.size(); iMesh++)
+	{
+		TetMeshFEM* pMesh = meshes[iMesh].get();
+		const IdType offset = meshOffsets[iMesh];
+		const NMat12* tetHessians = elasticHessian.data() + tetOffsets[iMesh];
+
+		// each vertex gathers its own row, so no two threads write to the same entry
+		auto multiplyHessianHandler = [&](int iV) {
+			const IdType vertPos = offset + iV * 3;
+			const IdType iVAll = vertPos / 3;
+			NVec3 yV = diagonalHessianBlocks[iVAll] * x.segment<3>(vertPos);
+			if (!pMesh->fixedMask[iV])
+			{
+				const size_t numNeiTets = pMesh->getNumVertexNeighborTets(iV);
+				for (size_t iNeiTet = 0; iNeiTet < numNeiTets; iNeiTet++) {
+					const auto tetId = pMesh->getVertexNeighborTet(iV, iNeiTet);
+					const auto corner = pMesh->getVertexNeighborTetVertexOrder(iV, iNeiTet);
+					for (int iCorner = 0; iCorner < 4; iCorner++)
+					{
+						const IdType otherVId = pMesh->tetVIds()(iCorner, tetId);
+						if (iCorner != corner && !pMesh->fixedMask[otherVId])
+						{
+							yV += tetHessians[tetId].block<3, 3>(corner * 3, iCorner * 3) * x.segment<3>(offset + otherVId * 3);
+						}
+					}
+				}
+				for (IdType iBlock = collisionHessianBlockRowOffsets[iVAll]; iBlock < collisionHessianBlockRowOffsets[iVAll + 1]; iBlock++)
+				{
+					yV += collisionHessianBlockValues[iBlock] * x.segment<3>(collisionHessianBlocks[iBlock].second);
+				}
+			}
+			y.segment<3>(vertPos) = yV;
+		};
+		cpu_parallel_for(0, pMesh->numVertices(), multiplyHessianHandler);
+	}
+}
+
+void GAIA::TetMeshNewtonAssembler::setupPreconditioner()
+{
+	auto invertDiagonalBlockHandler = [&](int iV) {
+		diagonalHessianBlockInverses[iV] = diagonalHessianBlocks[iV].inverse();
+	};
+	cpu_parallel_for(0, numAllVertices, invertDiagonalBlockHandler);
+
+	if (pcgPreconditionerType != 1)
+	{
+		return;
+	}
+
+	for (int iMesh = 0; iMesh < meshes.size(); iMesh++)
+	{
+		TetMeshFEM* pMesh = meshes[iMesh].get();
+		const IdType vertexOffset = meshOffsets[iMesh] / 3;
+		const IdType tetOffset = tetOffsets[iMesh];
+
+		// the local matrix of a tet is the restriction of the global Hessian to its vertices, but with only this tet's coupling terms;
+		// the diagonal blocks are the full ones, thus it stays positive definite as long as the elastic Hessians are
+		auto invertTetLocalHessianHandler = [&](int iTet) {
+			NMat12 localHessian = NMat12::Zero();
+			for (int iCorner = 0; iCorner < 4; iCorner++)
+			{
+				const IdType vId = pMesh->tetVIds()(iCorner, iTet);
+				localHessian.block<3, 3>(iCorner * 3, iCorner * 3) = diagonalHessianBlocks[vertexOffset + vId];
+				if (pMesh->fixedMask[vId])
+				{
+					continue;
+				}
+				for (int jCorner = 0; jCorner < 4; jCorner++)
+				{
+					if (jCorner != iCorner && !pMesh->fixedMask[pMesh->tetVIds()(jCorner, iTet)])
+					{
+						localHessian.block<3, 3>(iCorner * 3, jCorner * 3) = elasticHessian[tetOffset + iTet].block<3, 3>(iCorner * 3, jCorner * 3);
+					}
+				}
+			}
+
+			NMat12& localInverse = tetLocalHessianInverses[tetOffset + iTet];
+			Eigen::LLT<NMat12> llt(localHessian);
+			if (llt.info() == Eigen::Success)
+			{
+				localInverse = llt.solve(NMat12::Identity());
+			}
+			else
+			{
+				// indefinite elastic Hessian, fall back to the block Jacobi of this tet
+				localInverse.setZero();
+				for (int iCorner = 0; iCorner < 4; iCorner++)
+				{
+					localInverse.block<3, 3>(iCorner * 3, iCorner * 3) = diagonalHessianBlockInverses[vertexOffset + pMesh->tetVIds()(iCorner, iTet)];
+				}
+			}
+		};
+		cpu_parallel_for(0, pMesh->numTets(), invertTetLocalHessianHandler);
+	}
+}
+
+void GAIA::TetMeshNewtonAssembler::applyPreconditioner(const NVecDynamic& r, NVecDynamic& z)
+{
+	if (pcgPreconditionerType != 1)
+	{
+		auto blockJacobiHandler = [&](int iV) {
+			z.segment<3>(iV * 3) = diagonalHessianBlockInverses[iV] * r.segment<3>(iV * 3);
+		};
+		cpu_parallel_for(0, numAllVertices, blockJacobiHandler);
+		return;
+	}
+
+	// z = W * sum_t(R_t^T * A_t^-1 * R_t) * W * r, solved per tet first then gathered per vertex, which needs no locks
+	for (int iMesh = 0; iMesh < meshes.size(); iMesh++)
+	{
+		TetMeshFEM* pMesh = meshes[iMesh].get();
+		const IdType vertexOffset = meshOffsets[iMesh] / 3;
+		const IdType tetOffset = tetOffsets[iMesh];
+
+		auto tetLocalSolveHandler = [&](int iTet) {
+			NVec12 rLocal;
+			for (int iCorner = 0; iCorner < 4; iCorner++)
+			{
+				const IdType vIdAll = vertexOffset + pMesh->tetVIds()(iCorner, iTet);
+				rLocal.segment<3>(iCorner * 3) = schwarzWeights(vIdAll) * r.segment<3>(vIdAll * 3);
+			}
+			tetLocalSolutions[tetOffset + iTet] = tetLocalHessianInverses[tetOffset + iTet] * rLocal;
+		};
+		cpu_parallel_for(0, pMesh->numTets(), tetLocalSolveHandler);
+
+		auto gatherHandler = [&](int iV) {
+			NVec3 zV = NVec3::Zero();
+			const size_t numNeiTets = pMesh->getNumVertexNeighborTets(iV);
+			for (size_t iNeiTet = 0; iNeiTet < numNeiTets; iNeiTet++) {
+				const auto tetId = pMesh->getVertexNeighborTet(iV, iNeiTet);
+				const auto corner = pMesh->getVertexNeighborTetVertexOrder(iV, iNeiTet);
+				zV += tetLocalSolutions[tetOffset + tetId].segment<3>(corner * 3);
+			}
+			z.segment<3>((vertexOffset + iV) * 3) = schwarzWeights(vertexOffset + iV) * zV;
+		};
+		cpu_parallel_for(0, pMesh->numVertices(), gatherHandler);
+	}
+}
+
+void GAIA::TetMeshNewtonAssembler::solveMatrixFreePCG()
+{
+	const size_t numDofs = numAllVertices * 3;
+	pcgResidual.resize(numDofs);
+	pcgZ.resize(numDofs);
+	pcgP.resize(numDofs);
+	pcgAp.resize(numDofs);
+
+	if (!pcgWarmStart || Ndx.size() != numDofs)
+	{
+		Ndx.setZero(numDofs);
+	}
+
+	pcgIterations = 0;
+	pcgRelativeResidual = 0;
+	const NFloatingType forceNorm = newtonForce.norm();
+	if (forceNorm == 0)
+	{
+		Ndx.setZero();
+		return;
+	}
+
+	setupPreconditioner();
+
+	multiplyHessian(Ndx, pcgAp);
+	pcgResidual = newtonForce - pcgAp;
+	applyPreconditioner(pcgResidual, pcgZ);
+	pcgP = pcgZ;
+	NFloatingType rz = pcgResidual.dot(pcgZ);
+	NFloatingType residualNorm = pcgResidual.norm();
+
+	const NFloatingType threshold = cgTolerance * forceNorm;
+	for (; pcgIterations < cgMaxIterations && residualNorm > threshold; pcgIterations++)
+	{
+		multiplyHessian(pcgP, pcgAp);
+		const NFloatingType pAp = pcgP.dot(pcgAp);
+		if (pAp <= 0)
+		{
+			std::cerr << "PCG solve failed: the Newton system is not positive definite at iteration " << pcgIterations << std::endl;
+			if (pcgIterations == 0)
+			{
+				// the warm start cannot be improved along p, fall back to the preconditioned residual
+				Ndx += pcgZ;
+			}
+			break;
+		}
+		const NFloatingType alpha = rz / pAp;
+		Ndx += alpha * pcgP;
+		pcgResidual -= alpha * pcgAp;
+		residualNorm = pcgResidual.norm();
+
+		applyPreconditioner(pcgResidual, pcgZ);
+		const NFloatingType rzNew = pcgResidual.dot(pcgZ);
+		pcgP = pcgZ + (rzNew / rz) * pcgP;
+		rz = rzNew;
+	}
+	pcgRelativeResidual = residualNorm / forceNorm;
+
+	if (pcgIterations >= cgMaxIterations && residualNorm > threshold)
+	{
+		std::cerr << "PCG solve did not converge in " << pcgIterations << " iterations, relative residual: " << pcgRelativeResidual << std::endl;
+	}
 }
 
 void GAIA::TriMeshNewtonAssembler::initialize(std::vector<TriMeshFEM::SharedPtr> meshes_in, int solverType_in)
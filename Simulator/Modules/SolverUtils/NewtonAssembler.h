@@ -83,6 +83,7 @@ namespace GAIA {
 		virtual void solve(bool patternChanged, bool handleCollision);
 
 		// configurations
+		// 0: direct, 1: CG, 2: matrix-free PCG, only supported by TetMeshNewtonAssembler
 		int solverType{ 0 };
 
 		int cgMaxIterations{ 300 };
@@ -94,13 +95,72 @@ namespace GAIA {
 		typedef std::shared_ptr<TetMeshNewtonAssembler> SharedPtr;
 		typedef TetMeshNewtonAssembler* Ptr;
 		
-		void initialize(std::vector<TetMeshFEM::SharedPtr> meshes);
-
+		// only need to be called once per simulation, it builds the pattern of the elastic Hessian
+		// solverType: 0 for the direct solver solverDirect, 1 for the CG solver solverCG, 2 for the matrix-free PCG (solveMatrixFreePCG)
+		void initialize(std::vector<TetMeshFEM::SharedPtr> meshes_in, int solverType_in = 0);
+		// need to be called after each collision detection
+		// collisionBlocks: the (row, col) of the first entry of each off-diagonal 3x3 block coupled by the collisions, sorted and without duplication
+		// the Hessian is rebuilt and its pattern re-analyzed only if the blocks differ from the last call, returns whether the pattern changed
+		bool analyzeCollision(const std::vector<std::pair<IdType, IdType>>& collisionBlocks);
+		// the index of the block in collisionHessianBlocks, -1 if it is not there
+		IdType findCollisionBlock(IdType row, IdType col) const;
+		// sets all the entries of the Hessian to zero, whether it is assembled or not
+		void clearHessian();
+
+		// matrix-free PCG (solverType 2): newtonHessianAll is not assembled, the block pointers point to diagonalHessianBlocks 
+		// and collisionHessianBlockValues instead, and the off-diagonal elastic blocks are read directly from elasticHessian
+		// solves the system into Ndx, starting from the Ndx of the last solve if pcgWarmStart is on
+		void solveMatrixFreePCG();
+		// y = H * x
+		void multiplyHessian(const NVecDynamic& x, NVecDynamic& y);
+		// inverts the diagonal blocks, or the local matrices of the tets for the additive Schwarz preconditioner
+		void setupPreconditioner();
+		// z = M^-1 * r
+		void applyPreconditioner(const NVecDynamic& r, NVecDynamic& z);
 
 		std::vector<NMat12> elasticHessian{};
 		std::vector<NVec12> elasticForce{};
 
+		// off-diagonal blocks coupled by the collisions, in the order given to analyzeCollision
+		std::vector<std::pair<IdType, IdType>> collisionHessianBlocks{};
+		// 9 pointers for each block of collisionHessianBlocks, row major
+		std::vector<NFloatingType*> collisionHessianBlockPtrs{};
+		std::vector<NTriplet> newtonHessianTripletsCollision{};
+
+		std::vector<TetMeshFEM::SharedPtr> meshes{};
+		// the index of the first tet of each mesh in elasticHessian
+		std::vector<IdType> tetOffsets{};
+
 		size_t numAllTets{};
+
+		// for the matrix-free PCG
+		// 0: block Jacobi, 1: additive Schwarz with the tets as the overlapping subdomains
+		int pcgPreconditionerType{ 0 };
+		bool pcgWarmStart{ true };
+		int pcgIterations{};
+		NFloatingType pcgRelativeResidual{};
+
+		// nAllVertices, include the inertia, the boundary and the collision terms
+		std::vector<NMat3> diagonalHessianBlocks{};
+		std::vector<NMat3> collisionHessianBlockValues{};
+		// nAllVertices + 1, the collision blocks of the row of each vertex in collisionHessianBlocks
+		std::vector<IdType> collisionHessianBlockRowOffsets{};
+
+		std::vector<NMat3> diagonalHessianBlockInverses{};
+		std::vector<NMat12> tetLocalHessianInverses{};
+		std::vector<NVec12> tetLocalSolutions{};
+		// 1 / sqrt(number of neighbor tets) of each vertex, applied on both sides to keep the Schwarz preconditioner symmetric
+		NVecDynamic schwarzWeights{};
+
+		NVecDynamic pcgResidual{};
+		NVecDynamic pcgZ{};
+		NVecDynamic pcgP{};
+		NVecDynamic pcgAp{};
+
+	private:
+		// builds newtonHessianAll from the elastic and the collision triplets, updates all the block pointers and analyzes the pattern
+		void buildHessian();
+		void buildMatrixFreeHessian();
 	};
 
 	struct TriMeshCollisionInfoForNewton {
@@ -0,0 +1,564 @@
+#include "TetMeshBinaryCache.h"
+#include "TetMeshFEM.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace GAIA;
+
+namespace {
+	const char tetMeshBinaryCacheMagic[8] = { 'G', 'A', 'I', 'A', 'T', 'M', 'C', '\0' };
+
+	// the order of the sections in the cache file;
+	// the nested vectors are stored as 2 sections: nVecs + 1 offsets (uint64_t) followed by the concatenated elements
+	enum TetMeshBinaryCacheSectionId
+	{
+		restPositions = 0,
+		DmInvs,
+		tetRestVolume,
+		vertexMass,
+		tetVIds,
+		surfaceVIds,
+		tetVertIndicesToSurfaceVertIndices,
+		surfaceFacesTetMeshVIds,
+		surfaceFacesSurfaceMeshVIds,
+		surfaceFacesBelongingTets,
+		surfaceFacesIdAtBelongingTets,
+		surfaceFaces3NeighborFaces,
+		surfaceVertexNeighborSurfaceFaces,
+		surfaceVertexNeighborSurfaceVertices = surfaceVertexNeighborSurfaceFaces + 2,
+		vertexNeighborTets = surfaceVertexNeighborSurfaceVertices + 2,
+		vertexNeighborTets_vertexOrder,
+		vertexNeighborTets_infos,
+		edgeNeighborTets,
+		edgeNeighborTets_edge2VerticesOrderInTet,
+		edgeNeighborTets_infos,
+		tetsXorSums,
+		tetsNeighborTets,
+		surfaceEdges,
+		tetsIsSurfaceTet,
+		edges,
+		tetsColoringCategories,
+		edgesColoringCategories = tetsColoringCategories + 2,
+		verticesColoringCategories = edgesColoringCategories + 2,
+#ifdef TET_TET_ADJACENT_LIST
+		tetAllNeighborTets = verticesColoringCategories + 2,
+		numSections = tetAllNeighborTets + 2
+#else
+		numSections = verticesColoringCategories + 2
+#endif // TET_TET_ADJACENT_LIST
+	};
+
+	// 64 bit FNV-1a over 8 bytes words, this is only used to detect changed inputs
+	uint64_t hashBytes(const char* data, size_t numBytes, uint64_t h)
+	{
+		const uint64_t prime = 0x100000001b3ULL;
+		size_t i = 0;
+		for (; i + 8 <= numBytes; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, data + i, 8);
+			h = (h ^ word) * prime;
+		}
+		for (; i < numBytes; i++)
+		{
+			h = (h ^ (uint64_t)(uint8_t)data[i]) * prime;
+		}
+		return h;
+	}
+
+	template<typename T>
+	uint64_t hashValue(const T& value, uint64_t h)
+	{
+		return hashBytes((const char*)&value, sizeof(T), h);
+	}
+
+	uint64_t hashString(const std::string& str, uint64_t h)
+	{
+		h = hashValue(str.size(), h);
+		return hashBytes(str.data(), str.size(), h);
+	}
+
+	// the file hashes are memorized because every object using the same mesh needs the key more than once
+	std::map<std::string, uint64_t> fileHashes;
+	std::mutex fileHashesLock;
+
+	uint64_t hashFile(const std::string& path)
+	{
+		{
+			std::lock_guard<std::mutex> fileHashesLockGuard(fileHashesLock);
+			auto pItem = fileHashes.find(path);
+			if (pItem != fileHashes.end())
+			{
+				return pItem->second;
+			}
+		}
+
+		uint64_t h = 0xcbf29ce484222325ULL;
+		std::ifstream ifs(path, std::ios::binary);
+		if (ifs.is_open())
+		{
+			std::vector<char> buffer(1 << 20);
+			while (ifs)
+			{
+				ifs.read(buffer.data(), buffer.size());
+				h = hashBytes(buffer.data(), ifs.gcount(), h);
+			}
+		}
+		else
+		{
+			// a missing file is hashed differently from an empty one
+			h = ~h;
+		}
+
+		std::lock_guard<std::mutex> fileHashesLockGuard(fileHashesLock);
+		fileHashes[path] = h;
+		return h;
+	}
+
+	// collects the sections in memory before writing them in one pass
+	struct TetMeshBinaryCacheWriter
+	{
+		template<typename T>
+		void addSection(const T* data, size_t num)
+		{
+			sectionData.push_back({ (const char*)data, num * sizeof(T) });
+		}
+
+		template<typename EigenMat>
+		void addMatrix(const EigenMat& mat)
+		{
+			addSection(mat.data(), mat.size());
+		}
+
+		void addNestedVectors(const std::vector<std::vector<int32_t>>& vecs)
+		{
+			std::vector<uint64_t>& offsets = ownedOffsets.emplace_back(vecs.size() + 1, 0);
+			for (size_t iVec = 0; iVec < vecs.size(); iVec++)
+			{
+				offsets[iVec + 1] = offsets[iVec] + vecs[iVec].size();
+			}
+			std::vector<int32_t>& elements = ownedElements.emplace_back();
+			elements.reserve(offsets.back());
+			for (const std::vector<int32_t>& vec : vecs)
+			{
+				elements.insert(elements.end(), vec.begin(), vec.end());
+			}
+			addSection(offsets.data(), offsets.size());
+			addSection(elements.data(), elements.size());
+		}
+
+		bool write(const std::string& path, TetMeshBinaryCacheHeader& header)
+		{
+			header.numSections = sectionData.size();
+			std::vector<TetMeshBinaryCacheSection> sections(sectionData.size());
+
+			size_t offset = sizeof(TetMeshBinaryCacheHeader) + sections.size() * sizeof(TetMeshBinaryCacheSection);
+			for (size_t iSection = 0; iSection < sections.size(); iSection++)
+			{
+				offset = (offset + TET_MESH_BINARY_CACHE_ALIGNMENT - 1) / TET_MESH_BINARY_CACHE_ALIGNMENT * TET_MESH_BINARY_CACHE_ALIGNMENT;
+				sections[iSection].offset = offset;
+				sections[iSection].numBytes = sectionData[iSection].second;
+				offset += sectionData[iSection].second;
+			}
+
+			std::ofstream ofs(path, std::ios::binary);
+			if (!ofs.is_open())
+			{
+				return false;
+			}
+			ofs.write((const char*)&header, sizeof(TetMeshBinaryCacheHeader));
+			ofs.write((const char*)sections.data(), sections.size() * sizeof(TetMeshBinaryCacheSection));
+
+			const char padding[TET_MESH_BINARY_CACHE_ALIGNMENT] = {};
+			size_t written = sizeof(TetMeshBinaryCacheHeader) + sections.size() * sizeof(TetMeshBinaryCacheSection);
+			for (size_t iSection = 0; iSection < sections.size(); iSection++)
+			{
+				ofs.write(padding, sections[iSection].offset - written);
+				ofs.write(sectionData[iSection].first, sectionData[iSection].second);
+				written = sections[iSection].offset + sections[iSection].numBytes;
+			}
+
+			return ofs.good();
+		}
+
+		std::vector<std::pair<const char*, size_t>> sectionData;
+		// std::list so the pointers in sectionData stay valid
+		std::list<std::vector<uint64_t>> ownedOffsets;
+		std::list<std::vector<int32_t>> ownedElements;
+	};
+
+	std::mutex saveLock;
+}
+
+GAIA::TetMeshBinaryCache::~TetMeshBinaryCache()
+{
+	close();
+}
+
+std::string GAIA::TetMeshBinaryCache::cachePath(ObjectParams::SharedPtr pObjectParams)
+{
+	std::ostringstream oss;
+	oss << pObjectParams->path << "." << std::hex << std::setw(16) << std::setfill('0') << computeKey(pObjectParams) << ".gaiacache";
+	return oss.str();
+}
+
+uint64_t GAIA::TetMeshBinaryCache::computeKey(ObjectParams::SharedPtr pObjectParams)
+{
+	uint64_t h = hashFile(pObjectParams->path);
+
+	h = hashValue((uint32_t)TET_MESH_BINARY_CACHE_VERSION, h);
+	h = hashValue((uint32_t)sizeof(FloatingType), h);
+
+	// parameters that change the rest state
+	h = hashBytes((const char*)pObjectParams->scale.data(), sizeof(FloatingType) * 3, h);
+	h = hashBytes((const char*)pObjectParams->rotation.data(), sizeof(FloatingType) * 3, h);
+	h = hashBytes((const char*)pObjectParams->translation.data(), sizeof(FloatingType) * 3, h);
+	h = hashValue(pObjectParams->density, h);
+
+	// the colorings are part of the topology
+	const std::string* coloringPaths[3] = { &pObjectParams->tetsColoringCategoriesPath,
+		&pObjectParams->edgesColoringCategoriesPath, &pObjectParams->verticesColoringCategoriesPath };
+	for (const std::string* pColoringPath : coloringPaths)
+	{
+		h = hashString(*pColoringPath, h);
+		if (*pColoringPath != "")
+		{
+			h = hashValue(hashFile(*pColoringPath), h);
+		}
+	}
+
+	return h;
+}
+
+bool GAIA::TetMeshBinaryCache::isValid(ObjectParams::SharedPtr pObjectParams)
+{
+	std::ifstream ifs(cachePath(pObjectParams), std::ios::binary);
+	if (!ifs.is_open())
+	{
+		return false;
+	}
+
+	TetMeshBinaryCacheHeader fileHeader;
+	ifs.read((char*)&fileHeader, sizeof(TetMeshBinaryCacheHeader));
+
+	return ifs.good()
+		&& memcmp(fileHeader.magic, tetMeshBinaryCacheMagic, sizeof(tetMeshBinaryCacheMagic)) == 0
+		&& fileHeader.version == TET_MESH_BINARY_CACHE_VERSION
+		&& fileHeader.floatingTypeSize == sizeof(FloatingType)
+		&& fileHeader.idTypeSize == sizeof(IdType)
+		&& fileHeader.numSections == numSections
+		&& fileHeader.key == computeKey(pObjectParams);
+}
+
+bool GAIA::TetMeshBinaryCache::save(ObjectParams::SharedPtr pObjectParams, TetMeshTopology& topology, TetMeshFEM& tetMesh)
+{
+	TetMeshBinaryCacheHeader fileHeader;
+	memset(&fileHeader, 0, sizeof(TetMeshBinaryCacheHeader));
+	memcpy(fileHeader.magic, tetMeshBinaryCacheMagic, sizeof(tetMeshBinaryCacheMagic));
+	fileHeader.version = TET_MESH_BINARY_CACHE_VERSION;
+	fileHeader.floatingTypeSize = sizeof(FloatingType);
+	fileHeader.idTypeSize = sizeof(IdType);
+	fileHeader.key = computeKey(pObjectParams);
+	fileHeader.numVertices = tetMesh.numVertices();
+	fileHeader.numTets = tetMesh.numTets();
+	fileHeader.numEdges = topology.nEdges;
+
+	TetMeshBinaryCacheWriter writer;
+	// the rest positions, without the extra vertex padded for embree
+	writer.addSection(tetMesh.mVertPos.data(), POINT_VEC_DIMS * tetMesh.numVertices());
+	writer.addMatrix(tetMesh.DmInvs);
+	writer.addMatrix(tetMesh.tetRestVolume);
+	writer.addMatrix(tetMesh.vertexMass);
+
+	writer.addMatrix(topology.tetVIds);
+	writer.addMatrix(topology.surfaceVIds);
+	writer.addMatrix(topology.tetVertIndicesToSurfaceVertIndices);
+	writer.addMatrix(topology.surfaceFacesTetMeshVIds);
+	writer.addMatrix(topology.surfaceFacesSurfaceMeshVIds);
+	writer.addMatrix(topology.surfaceFacesBelongingTets);
+	writer.addMatrix(topology.surfaceFacesIdAtBelongingTets);
+	writer.addMatrix(topology.surfaceFaces3NeighborFaces);
+	writer.addNestedVectors(topology.surfaceVertexNeighborSurfaceFaces);
+	writer.addNestedVectors(topology.surfaceVertexNeighborSurfaceVertices);
+	writer.addMatrix(topology.vertexNeighborTets);
+	writer.addMatrix(topology.vertexNeighborTets_vertexOrder);
+	writer.addMatrix(topology.vertexNeighborTets_infos);
+	writer.addMatrix(topology.edgeNeighborTets);
+	writer.addMatrix(topology.edgeNeighborTets_edge2VerticesOrderInTet);
+	writer.addMatrix(topology.edgeNeighborTets_infos);
+	writer.addMatrix(topology.tetsXorSums);
+	writer.addMatrix(topology.tetsNeighborTets);
+	writer.addMatrix(topology.surfaceEdges);
+	writer.addMatrix(topology.tetsIsSurfaceTet);
+	writer.addMatrix(topology.edges);
+	writer.addNestedVectors(topology.tetsColoringCategories);
+	writer.addNestedVectors(topology.edgesColoringCategories);
+	writer.addNestedVectors(topology.verticesColoringCategories);
+#ifdef TET_TET_ADJACENT_LIST
+	writer.addNestedVectors(topology.tetAllNeighborTets);
+#endif // TET_TET_ADJACENT_LIST
+	assert(writer.sectionData.size() == numSections);
+
+	// the objects sharing the same mesh and parameters are initialized in parallel and would write the same file
+	std::lock_guard<std::mutex> saveLockGuard(saveLock);
+	std::string path = cachePath(pObjectParams);
+	if (isValid(pObjectParams))
+	{
+		return true;
+	}
+
+	// write to a temporary file first so an interrupted write never leaves a broken cache behind
+	std::string tmpPath = path + ".tmp";
+	if (!writer.write(tmpPath, fileHeader))
+	{
+		std::cout << "Fail to write the binary mesh cache: " << tmpPath << "\n";
+		std::remove(tmpPath.c_str());
+		return false;
+	}
+	std::remove(path.c_str());
+	if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		std::cout << "Fail to write the binary mesh cache: " << path << "\n";
+		std::remove(tmpPath.c_str());
+		return false;
+	}
+
+	std::cout << "Saved the binary mesh cache: " << path << "\n";
+	return true;
+}
+
+bool GAIA::TetMeshBinaryCache::open(ObjectParams::SharedPtr pObjectParams)
+{
+	close();
+
+	std::string path = cachePath(pObjectParams);
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	fileHandle = hFile;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(TetMeshBinaryCacheHeader))
+	{
+		close();
+		return false;
+	}
+	dataSize = fileSize.QuadPart;
+
+	mappingHandle = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL)
+	{
+		close();
+		return false;
+	}
+	pData = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (pData == nullptr)
+	{
+		close();
+		return false;
+	}
+#else
+	fileDescriptor = ::open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(TetMeshBinaryCacheHeader))
+	{
+		close();
+		return false;
+	}
+	dataSize = fileStat.st_size;
+
+	void* pMapped = mmap(nullptr, dataSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (pMapped == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	pData = (const char*)pMapped;
+#endif
+
+	memcpy(&header, pData, sizeof(TetMeshBinaryCacheHeader));
+	if (memcmp(header.magic, tetMeshBinaryCacheMagic, sizeof(tetMeshBinaryCacheMagic)) != 0
+		|| header.version != TET_MESH_BINARY_CACHE_VERSION
+		|| header.floatingTypeSize != sizeof(FloatingType)
+		|| header.idTypeSize != sizeof(IdType)
+		|| header.numSections != numSections
+		|| header.key != computeKey(pObjectParams)
+		|| dataSize < sizeof(TetMeshBinaryCacheHeader) + header.numSections * sizeof(TetMeshBinaryCacheSection))
+	{
+		close();
+		return false;
+	}
+
+	sections.resize(header.numSections);
+	memcpy(sections.data(), pData + sizeof(TetMeshBinaryCacheHeader), header.numSections * sizeof(TetMeshBinaryCacheSection));
+	for (const TetMeshBinaryCacheSection& section : sections)
+	{
+		if (section.offset % TET_MESH_BINARY_CACHE_ALIGNMENT != 0 || section.offset > dataSize || section.numBytes > dataSize - section.offset)
+		{
+			std::cout << "Corrupted binary mesh cache: " << path << "\n";
+			close();
+			return false;
+		}
+	}
+
+	if (sectionSize<FloatingType>(restPositions) != POINT_VEC_DIMS * header.numVertices
+		|| sectionSize<FloatingType>(DmInvs) != 9 * header.numTets
+		|| sectionSize<IdType>(tetVIds) != 4 * header.numTets
+		|| sectionSize<IdType>(edges) != 2 * header.numEdges)
+	{
+		std::cout << "Corrupted binary mesh cache: " << path << "\n";
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void GAIA::TetMeshBinaryCache::close()
+{
+#ifdef _WIN32
+	if (pData != nullptr)
+	{
+		UnmapViewOfFile(pData);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = nullptr;
+	}
+#else
+	if (pData != nullptr)
+	{
+		munmap((void*)pData, dataSize);
+	}
+	if (fileDescriptor >= 0)
+	{
+		::close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+#endif
+	pData = nullptr;
+	dataSize = 0;
+	sections.clear();
+}
+
+void GAIA::TetMeshBinaryCache::loadTopology(TetMeshTopology& topology)
+{
+	topology.nVerts = header.numVertices;
+	topology.nEdges = header.numEdges;
+
+	readMatrix(tetVIds, topology.tetVIds);
+	readMatrix(surfaceVIds, topology.surfaceVIds);
+	readMatrix(tetVertIndicesToSurfaceVertIndices, topology.tetVertIndicesToSurfaceVertIndices);
+	readMatrix(surfaceFacesTetMeshVIds, topology.surfaceFacesTetMeshVIds);
+	readMatrix(surfaceFacesSurfaceMeshVIds, topology.surfaceFacesSurfaceMeshVIds);
+	readMatrix(surfaceFacesBelongingTets, topology.surfaceFacesBelongingTets);
+	readMatrix(surfaceFacesIdAtBelongingTets, topology.surfaceFacesIdAtBelongingTets);
+	readMatrix(surfaceFaces3NeighborFaces, topology.surfaceFaces3NeighborFaces);
+	readNestedVectors(surfaceVertexNeighborSurfaceFaces, topology.surfaceVertexNeighborSurfaceFaces);
+	readNestedVectors(surfaceVertexNeighborSurfaceVertices, topology.surfaceVertexNeighborSurfaceVertices);
+	readMatrix(vertexNeighborTets, topology.vertexNeighborTets);
+	readMatrix(vertexNeighborTets_vertexOrder, topology.vertexNeighborTets_vertexOrder);
+	readMatrix(vertexNeighborTets_infos, topology.vertexNeighborTets_infos);
+	readMatrix(edgeNeighborTets, topology.edgeNeighborTets);
+	readMatrix(edgeNeighborTets_edge2VerticesOrderInTet, topology.edgeNeighborTets_edge2VerticesOrderInTet);
+	readMatrix(edgeNeighborTets_infos, topology.edgeNeighborTets_infos);
+	readMatrix(tetsXorSums, topology.tetsXorSums);
+	readMatrix(tetsNeighborTets, topology.tetsNeighborTets);
+	readMatrix(surfaceEdges, topology.surfaceEdges);
+	readMatrix(tetsIsSurfaceTet, topology.tetsIsSurfaceTet);
+	readMatrix(edges, topology.edges);
+	readNestedVectors(tetsColoringCategories, topology.tetsColoringCategories);
+	readNestedVectors(edgesColoringCategories, topology.edgesColoringCategories);
+	readNestedVectors(verticesColoringCategories, topology.verticesColoringCategories);
+#ifdef TET_TET_ADJACENT_LIST
+	readNestedVectors(tetAllNeighborTets, topology.tetAllNeighborTets);
+#endif // TET_TET_ADJACENT_LIST
+}
+
+void GAIA::TetMeshBinaryCache::loadRestState(TetMeshFEM& tetMesh)
+{
+	readSection(restPositions, tetMesh.mVertPos.data());
+	readMatrix(DmInvs, tetMesh.DmInvs);
+	readMatrix(tetRestVolume, tetMesh.tetRestVolume);
+	readMatrix(vertexMass, tetMesh.vertexMass);
+
+	tetMesh.tetInvRestVolume = tetMesh.tetRestVolume.cwiseInverse();
+	tetMesh.vertexInvMass = tetMesh.vertexMass.cwiseInverse();
+}
+
+template<typename T>
+size_t GAIA::TetMeshBinaryCache::sectionSize(int iSection) const
+{
+	return sections[iSection].numBytes / sizeof(T);
+}
+
+template<typename T>
+void GAIA::TetMeshBinaryCache::readSection(int iSection, T* out) const
+{
+	memcpy(out, pData + sections[iSection].offset, sections[iSection].numBytes);
+}
+
+template<typename EigenMat>
+void GAIA::TetMeshBinaryCache::readMatrix(int iSection, EigenMat& mat) const
+{
+	typedef typename EigenMat::Scalar Scalar;
+	size_t num = sectionSize<Scalar>(iSection);
+	if (EigenMat::RowsAtCompileTime == Eigen::Dynamic)
+	{
+		mat.resize(num, 1);
+	}
+	else
+	{
+		mat.resize(EigenMat::RowsAtCompileTime, num / EigenMat::RowsAtCompileTime);
+	}
+	readSection(iSection, mat.data());
+}
+
+void GAIA::TetMeshBinaryCache::readNestedVectors(int iSection, std::vector<std::vector<int32_t>>& vecs) const
+{
+	const uint64_t* offsets = (const uint64_t*)(pData + sections[iSection].offset);
+	const int32_t* elements = (const int32_t*)(pData + sections[iSection + 1].offset);
+	size_t numVecs = sectionSize<uint64_t>(iSection) - 1;
+
+	vecs.resize(numVecs);
+	for (size_t iVec = 0; iVec < numVecs; iVec++)
+	{
+		vecs[iVec].assign(elements + offsets[iVec], elements + offsets[iVec + 1]);
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "../Types/Types.h"
+#include "Materials/Materials.h"
+
+// bump this whenever the layout of the cache or the content of TetMeshTopology changes
+#define TET_MESH_BINARY_CACHE_VERSION 1
+// every section of the cache file starts at a multiple of it, so the mapped arrays are aligned
+#define TET_MESH_BINARY_CACHE_ALIGNMENT 64
+
+namespace GAIA {
+	struct TetMeshTopology;
+	struct TetMeshFEM;
+
+	// the header of the binary cache file, followed by numSections TetMeshBinaryCacheSection and then the data of the sections
+	struct TetMeshBinaryCacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t floatingTypeSize;
+		uint32_t idTypeSize;
+		uint32_t numSections;
+		uint64_t key;
+		uint64_t numVertices;
+		uint64_t numTets;
+		uint64_t numEdges;
+	};
+
+	struct TetMeshBinaryCacheSection
+	{
+		uint64_t offset;
+		uint64_t numBytes;
+	};
+
+	// a versioned binary cache of the TetMeshTopology and the rest state (rest pose, DmInvs, volumes and masses) of a tet mesh,
+	// it is keyed by a hash of the input mesh file, the coloring files and the parameters that change the rest state;
+	// the file is memory mapped and the arrays are copied directly from the mapped sections, without any parsing
+	struct TetMeshBinaryCache
+	{
+		typedef std::shared_ptr<TetMeshBinaryCache> SharedPtr;
+
+		~TetMeshBinaryCache();
+
+		// the cache of each set of parameters is stored in its own file next to the input mesh
+		static std::string cachePath(ObjectParams::SharedPtr pObjectParams);
+		static uint64_t computeKey(ObjectParams::SharedPtr pObjectParams);
+		// whether there is a cache file that matches the current input mesh and parameters
+		static bool isValid(ObjectParams::SharedPtr pObjectParams);
+		static bool save(ObjectParams::SharedPtr pObjectParams, TetMeshTopology& topology, TetMeshFEM& tetMesh);
+
+		// maps the cache file and validates it, returns false if there is no valid cache for the input mesh and parameters
+		bool open(ObjectParams::SharedPtr pObjectParams);
+		void close();
+
+		void loadTopology(TetMeshTopology& topology);
+		// fills the rest pose positions, DmInvs, volumes and masses, mVertPos must be allocated before it
+		void loadRestState(TetMeshFEM& tetMesh);
+
+		size_t numVertices() const { return header.numVertices; }
+		size_t numTets() const { return header.numTets; }
+
+	private:
+		template<typename T>
+		size_t sectionSize(int iSection) const;
+		template<typename T>
+		void readSection(int iSection, T* out) const;
+		template<typename EigenMat>
+		void readMatrix(int iSection, EigenMat& mat) const;
+		void readNestedVectors(int iSection, std::vector<std::vector<int32_t>>& vecs) const;
+
+		TetMeshBinaryCacheHeader header;
+		const char* pData = nullptr;
+		size_t dataSize = 0;
+		std::vector<TetMeshBinaryCacheSection> sections;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+	};
+}
@@ -10,6 +10,7 @@ using namespace GAIA;
 #include <unordered_set>
 
 #include "../IO/FileIO.h"
+#include "../GraphColoring/JonesPlassmann.h"
 
 #define SIZE_CANDIDATE_FACE_STACK 32
 #define SIZE_TRAVERSED_LIST_STACK 128
@@ -327,6 +328,107 @@ void GAIA::TetMeshTopology::initialize(TetMeshMF * pTM_MF, ObjectParams::SharedP
 	// std::cout << "vertexNeighborTets: " << vertexNeighborTets.transpose() << "\n";
 	// std::cout << "vertexNeighborTets_vertexOrder: " << vertexNeighborTets_vertexOrder.transpose() << "\n";
 	// std::cout << "vertexNeighborTets_infos: " << vertexNeighborTets_infos.transpose() << "\n";
+
+	if (pObjectParams->verticesColoringCategoriesPath == "")
+	{
+		computeVerticesColoring(pObjectParams);
+	}
+}
+
+void GAIA::TetMeshTopology::computeVerticesColoring(ObjectParams::SharedPtr pObjectParams)
+{
+	std::string cacheFile = pObjectParams->path + ".verticesColoring.json";
+	if (pObjectParams->cacheVerticesColoring && loadVerticesColoring(cacheFile))
+	{
+		std::cout << "Loaded cached vertices coloring from: " << cacheFile << "\n";
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::vector<int>> vertexGraph(numVertices());
+	for (size_t iEdge = 0; iEdge < nEdges; iEdge++)
+	{
+		vertexGraph[edges(0, iEdge)].push_back(edges(1, iEdge));
+		vertexGraph[edges(1, iEdge)].push_back(edges(0, iEdge));
+	}
+
+	GraphColoring::JonesPlassmann coloring(vertexGraph);
+	coloring.color();
+	coloring.convertToColoredCategories();
+	coloring.balanceColoredCategories();
+	verticesColoringCategories = coloring.get_categories();
+
+	// we sort them from large to small for the aggregated solve
+	std::sort(verticesColoringCategories.begin(), verticesColoringCategories.end(),
+		[](const std::vector<int>& a, const std::vector<int>& b) { return a.size() > b.size(); });
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "Computed a vertices coloring with " << verticesColoringCategories.size() << " colors for " << pObjectParams->path << " in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms\n";
+
+	if (pObjectParams->cacheVerticesColoring)
+	{
+		nlohmann::json j = verticesColoringCategories;
+		std::ofstream ofs(cacheFile);
+		if (ofs.is_open())
+		{
+			ofs << j.dump(-1);
+		}
+		else
+		{
+			std::cout << "Fail to write the vertices coloring cache: " << cacheFile << "\n";
+		}
+	}
+}
+
+bool GAIA::TetMeshTopology::loadVerticesColoring(std::string coloringFile)
+{
+	if (!std::ifstream(coloringFile).good())
+	{
+		return false;
+	}
+
+	std::vector<std::vector<int32_t>> categories;
+	nlohmann::json vertsColoring;
+	if (!MF::loadJson(coloringFile, vertsColoring))
+	{
+		return false;
+	}
+	MF::convertJsonParameters(vertsColoring, categories);
+
+	// the cache is keyed by the mesh path only, make sure it still matches the mesh
+	VecDynamicI vertexColors = VecDynamicI::Constant(numVertices(), -1);
+	for (size_t iColor = 0; iColor < categories.size(); iColor++)
+	{
+		for (int32_t vId : categories[iColor])
+		{
+			if (vId < 0 || vId >= numVertices() || vertexColors(vId) != -1)
+			{
+				return false;
+			}
+			vertexColors(vId) = iColor;
+		}
+	}
+	for (size_t iV = 0; iV < numVertices(); iV++)
+	{
+		if (vertexColors(iV) == -1)
+		{
+			return false;
+		}
+	}
+	for (size_t iEdge = 0; iEdge < nEdges; iEdge++)
+	{
+		if (vertexColors(edges(0, iEdge)) == vertexColors(edges(1, iEdge)))
+		{
+			return false;
+		}
+	}
+
+	verticesColoringCategories = std::move(categories);
+	// we sort them from large to small for the aggregated solve
+	std::sort(verticesColoringCategories.begin(), verticesColoringCategories.end(),
+		[](const std::vector<int>& a, const std::vector<int>& b) { return a.size() > b.size(); });
+	return true;
 }
 
 void GAIA::TetMeshFEM::initialize(ObjectParams::SharedPtr inObjectParams, std::shared_ptr<TetMeshMF> pTM_MF)
@@ -353,41 +455,60 @@ void GAIA::TetMeshFEM::initialize(ObjectParams::SharedPtr inObjectParams, std::s
 	//	std::cout << "Unsupported file format: " << fp.ext << std::endl;
 	//	//continue;
 	//}
-	// initialize the vertices and tets
-	// we add one more vertex at the end to make sure it can be used as the vertex buffer of embree
-	mVertPos = TVerticesMat::Zero(POINT_VEC_DIMS, pTM_MF->numVertices() + 1);
-	mVertPos.block(0, 0, POINT_VEC_DIMS, pTM_MF->numVertices()) = pTM_MF->vertPos();
-	//TBB_PARALLEL_FOR(0, tetVIds.cols(), iTet, );
-
-	m_nVertices = pTM_MF->numVertices();
-	m_nTets = pTM_MF->numTets();
 	pObjectParams = inObjectParams;
 
-	computeTopology(pTM_MF.get());
-
-
-	Eigen::AngleAxisf angleAxis;
-	FloatingType rot = pObjectParams->rotation.norm();
-	angleAxis.angle() = rot;
-	angleAxis.axis() = pObjectParams->rotation / rot;
+	TetMeshBinaryCache binaryCache;
+	bool loadedFromCache = pObjectParams->useBinaryMeshCache && binaryCache.open(pObjectParams);
 
-	if (rot > 0)
+	if (loadedFromCache)
 	{
-		Eigen::Matrix3f R;
-		R = angleAxis.toRotationMatrix();
-		mVertPos = R * mVertPos;
+		std::cout << "Loading " << pObjectParams->path << " from the binary mesh cache.\n";
+		m_nVertices = binaryCache.numVertices();
+		m_nTets = binaryCache.numTets();
+		computeTopology(nullptr, &binaryCache);
+
+		mVertPos = TVerticesMat::Zero(POINT_VEC_DIMS, m_nVertices + 1);
+		binaryCache.loadRestState(*this);
+		binaryCache.close();
 	}
+	else
+	{
+		if (pTM_MF == nullptr)
+		{
+			std::cout << "[Error] No valid binary mesh cache for: " << pObjectParams->path << std::endl;
+			exit(-1);
+		}
 
-	mVertPos.row(0) *= pObjectParams->scale(0);
-	mVertPos.row(1) *= pObjectParams->scale(1);
-	mVertPos.row(2) *= pObjectParams->scale(2);
-	mVertPos.colwise() += pObjectParams->translation;
+		// initialize the vertices and tets
+		// we add one more vertex at the end to make sure it can be used as the vertex buffer of embree
+		mVertPos = TVerticesMat::Zero(POINT_VEC_DIMS, pTM_MF->numVertices() + 1);
+		mVertPos.block(0, 0, POINT_VEC_DIMS, pTM_MF->numVertices()) = pTM_MF->vertPos();
+		//TBB_PARALLEL_FOR(0, tetVIds.cols(), iTet, );
 
-	vertexMass = decltype(vertexMass)::Zero(m_nVertices);
+		m_nVertices = pTM_MF->numVertices();
+		m_nTets = pTM_MF->numTets();
 
-	tetRestVolume.resize(m_nTets);
-	tetInvRestVolume.resize(m_nTets);
-	DmInvs.resize(m_nTets * 9);
+		computeTopology(pTM_MF.get());
+
+		Eigen::AngleAxisf angleAxis;
+		FloatingType rot = pObjectParams->rotation.norm();
+		angleAxis.angle() = rot;
+		angleAxis.axis() = pObjectParams->rotation / rot;
+
+		if (rot > 0)
+		{
+			Eigen::Matrix3f R;
+			R = angleAxis.toRotationMatrix();
+			mVertPos = R * mVertPos;
+		}
+
+		mVertPos.row(0) *= pObjectParams->scale(0);
+		mVertPos.row(1) *= pObjectParams->scale(1);
+		mVertPos.row(2) *= pObjectParams->scale(2);
+		mVertPos.colwise() += pObjectParams->translation;
+
+		computeRestState();
+	}
 
 	verticesInvertedSign.resize(m_nVertices);
 	verticesInvertedSign.setZero();
@@ -406,27 +527,10 @@ void GAIA::TetMeshFEM::initialize(ObjectParams::SharedPtr inObjectParams, std::s
 
 	mVertPrevPos = TVerticesMat::Zero(mVertPos.rows(), mVertPos.cols());
 
-	for (int iTet = 0; iTet < numTets(); ++iTet)
+	if (pObjectParams->useBinaryMeshCache && !loadedFromCache)
 	{
-		Mat3 Dm;
-		Eigen::Map<Mat3> DmInv = getDmInv(iTet);
-		computeDs(Dm, iTet);
-		//std::cout << "Ds:\n" << Ds << "\n";
-		DmInv = Dm.inverse();
-		//std::cout << "DsInv:\n" << DSInv << "\n";
-
-		// compute volume and mass
-		FloatingType vol = Dm.determinant() / 6;
-		// compute DsInvs;
-
-		tetRestVolume[iTet] = vol;
-		tetInvRestVolume[iTet] = 1. / vol;
-		for (size_t iV = 0; iV < 4; iV++)
-		{
-			vertexMass(pTopology->tetVIds(iV, iTet)) += 0.25 * vol * pObjectParams->density;
-		}
+		TetMeshBinaryCache::save(pObjectParams, *pTopology, *this);
 	}
-	vertexInvMass = vertexMass.cwiseInverse();
 
 #ifdef ENABLE_REST_POSE_CLOSEST_POINT
 	restposeVerts = mVertPos;
@@ -500,6 +604,19 @@ void GAIA::TetMeshFEM::saveAsPLY(const std::string outFile)
 
 
 
+void GAIA::TetMeshFEM::getCheckpointBuffers(std::vector<CheckpointBuffer>& buffers)
+{
+	buffers.push_back(makeCheckpointBuffer(mVertPos));
+	buffers.push_back(makeCheckpointBuffer(mVelocity));
+	buffers.push_back(makeCheckpointBuffer(mVertPrevPos));
+	buffers.push_back(makeCheckpointBuffer(tetsInvertedSign));
+	buffers.push_back(makeCheckpointBuffer(verticesInvertedSign));
+	buffers.push_back(makeCheckpointBuffer(tetsInvertedSignPrevPos));
+	buffers.push_back(makeCheckpointBuffer(verticesInvertedSignPrevPos));
+	buffers.push_back(makeCheckpointBuffer(activeForCollision));
+	buffers.push_back(makeCheckpointBuffer(activeForMaterialSolve));
+}
+
 bool TetMeshFEM::tetrahedralTraverseTo(const Vec3& rayOrigin, const Vec3& rayDir, const FloatingType maxTraversalDis, int32_t startTetId, int32_t startFaceId,
 	int32_t targetTetId, FloatingType rayTriIntersectionEpsilon, TraverseStatistics& statistics)
 {
@@ -1134,7 +1251,7 @@ bool GAIA::TetMeshFEM::tetrahedralTraverseToDynamic(const Vec3& rayOrigin, const
 }
 
 
-void GAIA::TetMeshFEM::computeTopology(TetMeshMF* pTM_MF) 
+void GAIA::TetMeshFEM::computeTopology(TetMeshMF* pTM_MF, TetMeshBinaryCache* pBinaryCache)
 {
 	// scope of topologyLockGuard lock
 	bool alreadyComputed = false;
@@ -1158,6 +1275,44 @@ void GAIA::TetMeshFEM::computeTopology(TetMeshMF* pTM_MF)
 
 	if (!alreadyComputed)
 	{
-		pTopology->initialize(pTM_MF, pObjectParams);
+		if (pBinaryCache != nullptr)
+		{
+			pBinaryCache->loadTopology(*pTopology);
+		}
+		else
+		{
+			pTopology->initialize(pTM_MF, pObjectParams);
+		}
 	}
 }
+
+void GAIA::TetMeshFEM::computeRestState()
+{
+	vertexMass = decltype(vertexMass)::Zero(m_nVertices);
+
+	tetRestVolume.resize(m_nTets);
+	tetInvRestVolume.resize(m_nTets);
+	DmInvs.resize(m_nTets * 9);
+
+	for (int iTet = 0; iTet < numTets(); ++iTet)
+	{
+		Mat3 Dm;
+		Eigen::Map<Mat3> DmInv = getDmInv(iTet);
+		computeDs(Dm, iTet);
+		//std::cout << "Ds:\n" << Ds << "\n";
+		DmInv = Dm.inverse();
+		//std::cout << "DsInv:\n" << DSInv << "\n";
+
+		// compute volume and mass
+		FloatingType vol = Dm.determinant() / 6;
+		// compute DsInvs;
+
+		tetRestVolume[iTet] = vol;
+		tetInvRestVolume[iTet] = 1. / vol;
+		for (size_t iV = 0; iV < 4; iV++)
+		{
+			vertexMass(pTopology->tetVIds(iV, iTet)) += 0.25 * vol * pObjectParams->density;
+		}
+	}
+	vertexInvMass = vertexMass.cwiseInverse();
+}
@@ -12,6 +12,7 @@
 
 #include "../Types/Types.h"
 #include "Materials/Materials.h"
+#include "TetMeshBinaryCache.h"
 
 #include "CuMatrix/Geometry/Geometry.h"
 #include "CuMatrix/MatrixOps/CuMatrix.h"
@@ -83,6 +84,10 @@ namespace GAIA {
 	{
 
 		void initialize(TetMeshMF* pTM_MF, ObjectParams::SharedPtr pObjectParams);
+		// colors the vertex graph in parallel, used when no vertices coloring file is given
+		void computeVerticesColoring(ObjectParams::SharedPtr pObjectParams);
+		// returns false if the file does not exist or does not hold a valid coloring of this mesh
+		bool loadVerticesColoring(std::string coloringFile);
 
 		typedef std::shared_ptr<TetMeshTopology> SharedPtr;
 		typedef TetMeshTopology* Ptr;
@@ -155,6 +160,30 @@ namespace GAIA {
 
 	};
 
+	// a contiguous piece of the stepping state of a mesh, checkpoints save and restore it as raw bytes
+	struct CheckpointBuffer
+	{
+		void* data;
+		size_t numBytes;
+	};
+
+	template <typename EigenMatType>
+	inline CheckpointBuffer makeCheckpointBuffer(EigenMatType& mat) {
+		return { mat.data(), (size_t)mat.size() * sizeof(typename EigenMatType::Scalar) };
+	}
+
+	inline CheckpointBuffer makeCheckpointBuffer(bool& flag) {
+		return { &flag, sizeof(bool) };
+	}
+
+	inline CheckpointBuffer makeCheckpointBuffer(int& value) {
+		return { &value, sizeof(int) };
+	}
+
+	inline CheckpointBuffer makeCheckpointBuffer(FloatingType& value) {
+		return { &value, sizeof(FloatingType) };
+	}
+
 	struct TetMeshFEM
 	{
 		typedef std::shared_ptr<TetMeshFEM> SharedPtr;
@@ -194,6 +223,8 @@ namespace GAIA {
 
 		void save(const std::string outFile);
 		void saveAsPLY(const std::string outFile);
+		// appends the buffers holding the state carried from one time step to the next, derived meshes append their solver state
+		virtual void getCheckpointBuffers(std::vector<CheckpointBuffer>& buffers);
 
 		IdType* getSurfaceFVIdsInTetMeshVIds(IdType surfaceFId);
 
@@ -240,7 +271,10 @@ namespace GAIA {
 		// the 3 edges will be AB, BC, CD
 		void computeEdgeNormal(int32_t faceId, int32_t edgeId, Vec3& normal);
 
-		void computeTopology(TetMeshMF* pTM_MF);
+		// the topology is loaded from pBinaryCache when it is given, pTM_MF is not used in that case
+		void computeTopology(TetMeshMF* pTM_MF, TetMeshBinaryCache* pBinaryCache = nullptr);
+		// computes the DmInvs, the rest volumes and the masses from the rest pose
+		void computeRestState();
 		const VecDynamicI& surfaceVIds() const { return pTopology->surfaceVIds; }
 		const FaceVIdsMat& surfaceFacesSurfaceMeshVIds() const { return pTopology->surfaceFacesSurfaceMeshVIds; }
 		TTetIdsMat& tetVIds() { return pTopology->tetVIds; }
@@ -0,0 +1,324 @@
+#include "Profiler.h"
+
+#include <MeshFrame/Utility/Parser.h>
+#include <MeshFrame/Utility/IO.h>
+#include "../Utility/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+using namespace GAIA;
+
+std::atomic<bool> GAIA::Profiler::enabled(false);
+size_t GAIA::Profiler::eventsPerThread = 1 << 16;
+std::chrono::steady_clock::time_point GAIA::Profiler::origin = std::chrono::steady_clock::now();
+std::mutex GAIA::Profiler::buffersLock;
+std::vector<std::unique_ptr<ProfilerThreadBuffer>> GAIA::Profiler::threadBuffers;
+
+namespace {
+	// the buffers are never freed, so the pointer stays valid across reset
+	thread_local ProfilerThreadBuffer* tlsThreadBuffer = nullptr;
+
+	void initializeThreadBuffer(ProfilerThreadBuffer& buffer, size_t eventsPerThread)
+	{
+		buffer.events.assign(std::max(eventsPerThread, (size_t)1), ProfileEvent());
+		buffer.numRecorded = 0;
+		buffer.nodes.clear();
+		buffer.nodes.emplace_back();
+		buffer.nodes[0].name = "Thread";
+		buffer.nodes[0].parent = -1;
+		buffer.openScopes.clear();
+	}
+
+	// the per thread trees merged by path
+	struct MergedProfileNode
+	{
+		std::string name;
+		int32_t parent = -1;
+		std::map<std::string, int32_t> children;
+
+		uint64_t count = 0;
+		int64_t totalTime = 0;
+		int64_t childrenTime = 0;
+		int64_t maxTime = 0;
+	};
+
+	void mergeNode(const ProfilerThreadBuffer& buffer, int32_t iNode, std::vector<MergedProfileNode>& mergedNodes, int32_t iMergedNode)
+	{
+		const ProfileNode& node = buffer.nodes[iNode];
+		for (int32_t iChild : node.children)
+		{
+			const ProfileNode& child = buffer.nodes[iChild];
+			auto pMerged = mergedNodes[iMergedNode].children.find(child.name);
+			int32_t iMergedChild;
+			if (pMerged == mergedNodes[iMergedNode].children.end())
+			{
+				iMergedChild = (int32_t)mergedNodes.size();
+				mergedNodes[iMergedNode].children[child.name] = iMergedChild;
+				mergedNodes.emplace_back();
+				mergedNodes.back().name = child.name;
+				mergedNodes.back().parent = iMergedNode;
+			}
+			else
+			{
+				iMergedChild = pMerged->second;
+			}
+
+			MergedProfileNode& mergedChild = mergedNodes[iMergedChild];
+			mergedChild.count += child.count;
+			mergedChild.totalTime += child.totalTime;
+			mergedChild.childrenTime += child.childrenTime;
+			mergedChild.maxTime = std::max(mergedChild.maxTime, child.maxTime);
+
+			mergeNode(buffer, iChild, mergedNodes, iMergedChild);
+		}
+	}
+
+	void mergeThreadBuffers(const std::vector<std::unique_ptr<ProfilerThreadBuffer>>& threadBuffers, std::vector<MergedProfileNode>& mergedNodes)
+	{
+		mergedNodes.clear();
+		mergedNodes.emplace_back();
+		for (const auto& pBuffer : threadBuffers)
+		{
+			mergeNode(*pBuffer, 0, mergedNodes, 0);
+		}
+	}
+
+	inline double toMs(int64_t ns) { return ns * 1e-6; }
+
+	void writeSummaryRows(const std::vector<MergedProfileNode>& mergedNodes, int32_t iNode, int depth, std::ostream& os)
+	{
+		for (const auto& child : mergedNodes[iNode].children)
+		{
+			const MergedProfileNode& node = mergedNodes[child.second];
+			std::string name = std::string(2 * depth, ' ') + node.name;
+			os << std::left << std::setw(48) << name << std::right
+				<< std::setw(10) << node.count
+				<< std::setw(14) << toMs(node.totalTime)
+				<< std::setw(14) << toMs(node.totalTime - node.childrenTime)
+				<< std::setw(14) << toMs(node.totalTime) / node.count
+				<< std::setw(14) << toMs(node.maxTime) << "\n";
+			writeSummaryRows(mergedNodes, child.second, depth + 1, os);
+		}
+	}
+
+	void writeSummaryJson(const std::vector<MergedProfileNode>& mergedNodes, int32_t iNode, const std::string& parentPath, nlohmann::json& j)
+	{
+		for (const auto& child : mergedNodes[iNode].children)
+		{
+			const MergedProfileNode& node = mergedNodes[child.second];
+			std::string path = parentPath.empty() ? node.name : parentPath + "/" + node.name;
+
+			nlohmann::json row;
+			row["path"] = path;
+			row["count"] = node.count;
+			row["totalMs"] = toMs(node.totalTime);
+			row["selfMs"] = toMs(node.totalTime - node.childrenTime);
+			row["maxMs"] = toMs(node.maxTime);
+			j.push_back(row);
+
+			writeSummaryJson(mergedNodes, child.second, path, j);
+		}
+	}
+}
+
+void GAIA::ProfilerThreadBuffer::begin(const char* name, int32_t arg)
+{
+	int32_t iParent = openScopes.empty() ? 0 : openScopes.back().node;
+
+	int32_t iNode = -1;
+	for (int32_t iChild : nodes[iParent].children)
+	{
+		// the same literal usually has the same address, different translation units may have their own copies
+		if (nodes[iChild].name == name || strcmp(nodes[iChild].name, name) == 0)
+		{
+			iNode = iChild;
+			break;
+		}
+	}
+	if (iNode == -1)
+	{
+		iNode = (int32_t)nodes.size();
+		nodes[iParent].children.push_back(iNode);
+		nodes.emplace_back();
+		nodes.back().name = name;
+		nodes.back().parent = iParent;
+	}
+
+	openScopes.push_back({ iNode, arg, Profiler::now() });
+}
+
+void GAIA::ProfilerThreadBuffer::end()
+{
+	if (openScopes.empty())
+	{
+		// the profiler was reset while the scope was open
+		return;
+	}
+
+	const OpenScope& scope = openScopes.back();
+	int64_t duration = Profiler::now() - scope.start;
+
+	ProfileNode& node = nodes[scope.node];
+	node.count++;
+	node.totalTime += duration;
+	node.maxTime = std::max(node.maxTime, duration);
+	nodes[node.parent].childrenTime += duration;
+
+	ProfileEvent& event = events[numRecorded % events.size()];
+	event.name = node.name;
+	event.start = scope.start;
+	event.duration = duration;
+	event.arg = scope.arg;
+	numRecorded++;
+
+	openScopes.pop_back();
+}
+
+void GAIA::Profiler::start(size_t inEventsPerThread)
+{
+	std::lock_guard<std::mutex> buffersLockGuard(buffersLock);
+	eventsPerThread = inEventsPerThread;
+	for (auto& pBuffer : threadBuffers)
+	{
+		initializeThreadBuffer(*pBuffer, eventsPerThread);
+	}
+	origin = std::chrono::steady_clock::now();
+	enabled = true;
+}
+
+void GAIA::Profiler::stop()
+{
+	enabled = false;
+}
+
+void GAIA::Profiler::reset()
+{
+	std::lock_guard<std::mutex> buffersLockGuard(buffersLock);
+	for (auto& pBuffer : threadBuffers)
+	{
+		initializeThreadBuffer(*pBuffer, eventsPerThread);
+	}
+	origin = std::chrono::steady_clock::now();
+}
+
+ProfilerThreadBuffer* GAIA::Profiler::getThreadBuffer()
+{
+	if (tlsThreadBuffer == nullptr)
+	{
+		std::lock_guard<std::mutex> buffersLockGuard(buffersLock);
+		threadBuffers.push_back(std::make_unique<ProfilerThreadBuffer>());
+		tlsThreadBuffer = threadBuffers.back().get();
+		tlsThreadBuffer->threadId = (uint32_t)threadBuffers.size() - 1;
+		initializeThreadBuffer(*tlsThreadBuffer, eventsPerThread);
+	}
+	return tlsThreadBuffer;
+}
+
+int64_t GAIA::Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+bool GAIA::Profiler::writeChromeTrace(const std::string& path)
+{
+	std::ofstream ofs(path);
+	if (!ofs.is_open())
+	{
+		std::cout << "[Error] Fail to open file: " << path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> buffersLockGuard(buffersLock);
+	ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	ofs << std::fixed << std::setprecision(3);
+	bool first = true;
+	for (const auto& pBuffer : threadBuffers)
+	{
+		ofs << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << pBuffer->threadId
+			<< ",\"args\":{\"name\":\"Thread " << pBuffer->threadId << "\"}}";
+		first = false;
+
+		size_t numEvents = std::min((size_t)pBuffer->numRecorded, pBuffer->events.size());
+		uint64_t firstEvent = pBuffer->numRecorded - numEvents;
+		for (uint64_t iEvent = firstEvent; iEvent < pBuffer->numRecorded; iEvent++)
+		{
+			const ProfileEvent& event = pBuffer->events[iEvent % pBuffer->events.size()];
+			// the timestamps are in microseconds
+			ofs << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << pBuffer->threadId
+				<< ",\"ts\":" << event.start * 1e-3 << ",\"dur\":" << event.duration * 1e-3;
+			if (event.arg >= 0)
+			{
+				ofs << ",\"args\":{\"i\":" << event.arg << "}";
+			}
+			ofs << "}";
+		}
+	}
+	ofs << "\n]}\n";
+	return ofs.good();
+}
+
+std::string GAIA::Profiler::getSummaryString()
+{
+	std::vector<MergedProfileNode> mergedNodes;
+	{
+		std::lock_guard<std::mutex> buffersLockGuard(buffersLock);
+		mergeThreadBuffers(threadBuffers, mergedNodes);
+	}
+
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(3);
+	oss << std::left << std::setw(48) << "Scope" << std::right
+		<< std::setw(10) << "Count"
+		<< std::setw(14) << "Total(ms)"
+		<< std::setw(14) << "Self(ms)"
+		<< std::setw(14) << "Avg(ms)"
+		<< std::setw(14) << "Max(ms)" << "\n";
+	writeSummaryRows(mergedNodes, 0, 0, oss);
+	return oss.str();
+}
+
+bool GAIA::Profiler::writeSummary(const std::string& textPath, const std::string& jsonPath)
+{
+	std::ofstream ofsText(textPath);
+	if (!ofsText.is_open())
+	{
+		std::cout << "[Error] Fail to open file: " << textPath << std::endl;
+		return false;
+	}
+	ofsText << getSummaryString();
+
+	std::vector<MergedProfileNode> mergedNodes;
+	{
+		std::lock_guard<std::mutex> buffersLockGuard(buffersLock);
+		mergeThreadBuffers(threadBuffers, mergedNodes);
+	}
+	nlohmann::json j = nlohmann::json::array();
+	writeSummaryJson(mergedNodes, 0, "", j);
+
+	std::ofstream ofsJson(jsonPath);
+	if (!ofsJson.is_open())
+	{
+		std::cout << "[Error] Fail to open file: " << jsonPath << std::endl;
+		return false;
+	}
+	ofsJson << j.dump(2);
+	return ofsText.good() && ofsJson.good();
+}
+
+void GAIA::Profiler::writeOutputs(const std::string& outFolder, int debugVerboseLvl)
+{
+	stop();
+	std::string profileOutPath = outFolder + "/Profile";
+	MF::IO::createFolder(profileOutPath);
+	writeChromeTrace(profileOutPath + "/Trace.json");
+	writeSummary(profileOutPath + "/Summary.txt", profileOutPath + "/Summary.json");
+	debugInfoGen(debugVerboseLvl, DEBUG_LVL_INFO, [&]() {
+		std::cout << getSummaryString();
+		});
+}
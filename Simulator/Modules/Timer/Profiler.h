@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// hierarchical scoped profiler
+// GAIA_PROFILE_SCOPE(name) times the rest of the enclosing scope, name must be a string literal
+// GAIA_PROFILE_SCOPE_I(name, i) also records an integer, e.g. the iteration or the color group, which shows up in the trace
+// the scopes nest per thread: the aggregate table is keyed by the path of the scope in that tree
+// the scopes are compiled out with GAIA_NO_PROFILER, otherwise they cost a branch while the profiler is not started
+#ifdef GAIA_NO_PROFILER
+#define GAIA_PROFILE_SCOPE(name)
+#define GAIA_PROFILE_SCOPE_I(name, i)
+#else
+#define GAIA_PROFILE_CONCAT_IMPL(a, b) a##b
+#define GAIA_PROFILE_CONCAT(a, b) GAIA_PROFILE_CONCAT_IMPL(a, b)
+#define GAIA_PROFILE_SCOPE(name) GAIA::ProfileScope GAIA_PROFILE_CONCAT(profileScope_, __LINE__)(name);
+#define GAIA_PROFILE_SCOPE_I(name, i) GAIA::ProfileScope GAIA_PROFILE_CONCAT(profileScope_, __LINE__)(name, (int32_t)(i));
+#endif // GAIA_NO_PROFILER
+
+namespace GAIA {
+	// one closed scope, in nanoseconds since Profiler::start
+	struct ProfileEvent
+	{
+		const char* name;
+		int64_t start;
+		int64_t duration;
+		int32_t arg;
+	};
+
+	// a node of the per thread scope tree, accumulating every occurrence of the same scope path
+	struct ProfileNode
+	{
+		const char* name;
+		int32_t parent;
+		std::vector<int32_t> children;
+
+		uint64_t count = 0;
+		int64_t totalTime = 0;
+		int64_t childrenTime = 0;
+		int64_t maxTime = 0;
+	};
+
+	// only touched by its own thread while the simulation runs
+	struct ProfilerThreadBuffer
+	{
+		void begin(const char* name, int32_t arg);
+		void end();
+
+		uint32_t threadId = 0;
+
+		// ring buffer of the most recent events, for the trace
+		std::vector<ProfileEvent> events;
+		uint64_t numRecorded = 0;
+
+		// nodes[0] is the root of the thread
+		std::vector<ProfileNode> nodes;
+
+		struct OpenScope
+		{
+			int32_t node;
+			int32_t arg;
+			int64_t start;
+		};
+		std::vector<OpenScope> openScopes;
+	};
+
+	struct Profiler
+	{
+		// eventsPerThread is the size of the ring buffer of each thread, the trace holds the latest eventsPerThread events of each thread;
+		// the aggregates cover everything since start
+		static void start(size_t eventsPerThread);
+		static void stop();
+		// the exports and the reset read the buffers of all the threads, call them when no scope is open on other threads
+		static void reset();
+		// Chrome trace event format, can be opened by chrome://tracing and Perfetto
+		static bool writeChromeTrace(const std::string& path);
+		// the per thread scope trees are merged by path
+		static bool writeSummary(const std::string& textPath, const std::string& jsonPath);
+		static std::string getSummaryString();
+		// stops the profiler and writes Trace.json, Summary.txt and Summary.json to outFolder/Profile;
+		// the summary is also printed at DEBUG_LVL_INFO of debugVerboseLvl
+		static void writeOutputs(const std::string& outFolder, int debugVerboseLvl);
+
+		static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+		static ProfilerThreadBuffer* getThreadBuffer();
+		static int64_t now();
+
+	private:
+		static std::atomic<bool> enabled;
+		static size_t eventsPerThread;
+		static std::chrono::steady_clock::time_point origin;
+
+		static std::mutex buffersLock;
+		static std::vector<std::unique_ptr<ProfilerThreadBuffer>> threadBuffers;
+	};
+
+	struct ProfileScope
+	{
+		ProfileScope(const char* name, int32_t arg = -1)
+		{
+			if (Profiler::isEnabled())
+			{
+				pBuffer = Profiler::getThreadBuffer();
+				pBuffer->begin(name, arg);
+			}
+		}
+
+		~ProfileScope()
+		{
+			if (pBuffer != nullptr)
+			{
+				pBuffer->end();
+			}
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		ProfilerThreadBuffer* pBuffer = nullptr;
+	};
+}
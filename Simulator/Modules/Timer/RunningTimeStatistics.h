@@ -75,6 +75,22 @@ namespace GAIA {
             timeCsmpUpdateVelocity = 0;
             timeCsmpSaveOutputs = 0;
 
+            timeCsmpNewtonFactorization = 0;
+            timeCsmpNewtonFactorizationSaved = 0;
+            numNewtonFactorizations = 0;
+            numNewtonFactorizationReuses = 0;
+
+            numMeshesFellAsleep = 0;
+            numMeshesWokenUp = 0;
+
+            numIterations = 0;
+            numSubsteps = 0;
+
+            numDCDCoherentTetQueries = 0;
+            numDCDCoherentTetHits = 0;
+            numDCDCoherentFaceQueries = 0;
+            numDCDCoherentFaceHits = 0;
+
             meritEnergy.clear();
         }
 
@@ -88,17 +104,36 @@ namespace GAIA {
             ss << "-----Step Total: " << timeCsmpAllSubSteps << "\n";
             ss << "-----Initial Step: " << timeCsmpInitialStep << "\n";
             ss << "-----Material Solve: " << timeCsmpMaterialSolve << "\n";
+            if (numSubsteps)
+            {
+                ss << "---------Iterations: " << numIterations << " in " << numSubsteps << " substeps\n";
+            }
             ss << "-----Initial Collision Detection: " << timeCsmpInitialCollision << "\n";
             ss << "-----Inversion Solve: " << timeCsmpInversionSolve << "\n";
             ss << "-----DCD Collision Information Uptate: " << timeCsmpUpdatingCollisionInfoDCD << "\n";
             ss << "---------DCD Uptating BVH: " << timeCsmpUpdatingBVHDCD << "\n";
             ss << "---------DCD Detecting Collision: " << timeCsmpColDetectDCD << "\n";
             ss << "---------Shortest Path Search: " << timeCsmpShortestPathSearchDCD << "\n";
+            if (numDCDCoherentTetQueries || numDCDCoherentFaceQueries)
+            {
+                ss << "---------DCD Coherence Cache: " << numDCDCoherentTetHits << " / " << numDCDCoherentTetQueries << " tet hits, "
+                    << numDCDCoherentFaceHits << " / " << numDCDCoherentFaceQueries << " face hits\n";
+            }
             ss << "-----CCD Collision Information Uptate: " << timeCsmpUpdatingCollisionInfoCCD << "\n";
             ss << "---------CCD Uptating BVH: " << timeCsmpUpdatingBVHCCD << "\n";
             ss << "---------CCD Detecting Collision: " << timeCsmpColDetectCCD << "\n";
             ss << "-----Collision Solve: " << timeCsmpCollisionSolve << "\n";
             ss << "-----Updating Velocity: " << timeCsmpUpdateVelocity << "\n";
+            if (numNewtonFactorizations || numNewtonFactorizationReuses)
+            {
+                ss << "-----Newton Factorization: " << timeCsmpNewtonFactorization << " (" << numNewtonFactorizations << " factorizations, "
+                    << numNewtonFactorizationReuses << " reuses, " << timeCsmpNewtonFactorizationSaved << " saved)\n";
+            }
+            if (numSleepingMeshes || numMeshesFellAsleep || numMeshesWokenUp)
+            {
+                ss << "-----Sleeping Meshes: " << numSleepingMeshes << " (" << numMeshesFellAsleep << " fell asleep, "
+                    << numMeshesWokenUp << " woken up)\n";
+            }
             ss << customString();
             ss << "-----Save Outputs: " << timeCsmpSaveOutputs << "\n";
 
@@ -133,6 +168,23 @@ namespace GAIA {
 
             PUT_TO_JSON(j, timeCsmpSaveOutputs);
 
+            PUT_TO_JSON(j, timeCsmpNewtonFactorization);
+            PUT_TO_JSON(j, timeCsmpNewtonFactorizationSaved);
+            PUT_TO_JSON(j, numNewtonFactorizations);
+            PUT_TO_JSON(j, numNewtonFactorizationReuses);
+
+            PUT_TO_JSON(j, numIterations);
+            PUT_TO_JSON(j, numSubsteps);
+
+            PUT_TO_JSON(j, numDCDCoherentTetQueries);
+            PUT_TO_JSON(j, numDCDCoherentTetHits);
+            PUT_TO_JSON(j, numDCDCoherentFaceQueries);
+            PUT_TO_JSON(j, numDCDCoherentFaceHits);
+
+            PUT_TO_JSON(j, numSleepingMeshes);
+            PUT_TO_JSON(j, numMeshesFellAsleep);
+            PUT_TO_JSON(j, numMeshesWokenUp);
+
             PUT_TO_JSON(j, meritEnergy);
 
             return true;
@@ -171,6 +223,28 @@ namespace GAIA {
 
         FloatingType timeCsmpSaveOutputs;
 
+        FloatingType timeCsmpNewtonFactorization = 0;
+        // estimated by the time of the last factorization, for each time it was reused instead
+        FloatingType timeCsmpNewtonFactorizationSaved = 0;
+        int numNewtonFactorizations = 0;
+        int numNewtonFactorizationReuses = 0;
+
+        // the iterations actually run, summed over the substeps of the frame; 
+        // a substep counts the most iterations run by any part of it, e.g. the colored sweep or an island solved per task
+        int numIterations = 0;
+        int numSubsteps = 0;
+
+        // the DCD queries that had a cached tet or face from the last DCD of the vertex, and how many of them were answered by it
+        int numDCDCoherentTetQueries = 0;
+        int numDCDCoherentTetHits = 0;
+        int numDCDCoherentFaceQueries = 0;
+        int numDCDCoherentFaceHits = 0;
+
+        // at the end of the frame, it is a state so it is not reset by setToZero
+        int numSleepingMeshes = 0;
+        int numMeshesFellAsleep = 0;
+        int numMeshesWokenUp = 0;
+
 
         // convergence statistics
         // step x iteration x object
@@ -110,3 +110,206 @@ void GAIA::ActiveCollisionList::addToActiveCollisionList(CollisionDetectionResul
 		activeCollisions.push_back({ iMesh, surfaceVIdTetMesh });
 	}
 }
+
+void GAIA::ActiveCollisionList::buildFromCollisionResults(std::vector<std::vector<VBDCollisionDetectionResult>>& collisionResultsAll)
+{
+	// the surface vertices of all the meshes are flattened and split into fixed size blocks, each processed by one task;
+	// the first pass counts what each block will add, the counts are prefix summed over the blocks and the second pass 
+	// writes every block's entries to its own slots, thus no locks are needed and the order does not depend on the scheduling
+	const size_t numMeshes = tMeshes.size();
+	const size_t numParallelGroups = activeCollisionsEachParallelGroup.size();
+	const size_t numSurfaceVerts = surfaceVertexOffsets[numMeshes];
+	const size_t numBlocks = (numSurfaceVerts + ACTIVE_COLLISION_LIST_BUILD_BLOCK_SIZE - 1) / ACTIVE_COLLISION_LIST_BUILD_BLOCK_SIZE;
+
+	// resize() does not release memory, after the first few steps these never reallocate
+	blockGroupOffsets.resize(numBlocks * numParallelGroups);
+	blockActiveCollisionOffsets.resize(numBlocks + 1);
+	blockRelationOffsets.resize(numBlocks + 1);
+
+	auto clearMaskFunc = [&](int iMesh) {
+		tMeshes[iMesh]->activeCollisionMask.setZero();
+	};
+	cpu_parallel_for(0, numMeshes, clearMaskFunc);
+
+	// calls func(iMesh, iSurfaceV) for every surface vertex of the block
+	auto forEachSurfaceVertexInBlock = [&](int iBlock, auto&& func) {
+		size_t iStart = iBlock * ACTIVE_COLLISION_LIST_BUILD_BLOCK_SIZE;
+		size_t iEnd = std::min(iStart + ACTIVE_COLLISION_LIST_BUILD_BLOCK_SIZE, numSurfaceVerts);
+		int iMesh = std::upper_bound(surfaceVertexOffsets.begin(), surfaceVertexOffsets.end(), iStart) - surfaceVertexOffsets.begin() - 1;
+		for (size_t iFlat = iStart; iFlat < iEnd; iFlat++)
+		{
+			while (iFlat >= surfaceVertexOffsets[iMesh + 1])
+			{
+				iMesh++;
+			}
+			func(iMesh, int(iFlat - surfaceVertexOffsets[iMesh]));
+		}
+	};
+
+	// the parallel groups that a v-f collision is added to: the vertex' group and the face vertices' groups, without duplication
+	auto getParallelGroupsOfCollision = [&](VBDBaseTetMesh* pTetMesh, IdType surfaceVIdTetMesh, const CollidingPointInfo& collidingPt, 
+		CPArray<int, 4>& parallelGroups) {
+		parallelGroups.clear();
+		parallelGroups.push_back(pTetMesh->vertexParallelGroups[surfaceVIdTetMesh]);
+		VBDBaseTetMesh* pTetMesh_intersecting = tMeshes[collidingPt.intersectedMeshId].get();
+		for (size_t iSurfaceFaceV = 0; iSurfaceFaceV < 3; iSurfaceFaceV++)
+		{
+			IdType faceVId = pTetMesh_intersecting->surfaceFacesTetMeshVIds()(iSurfaceFaceV, collidingPt.closestSurfaceFaceId);
+			int iParallelGroupFV = pTetMesh_intersecting->vertexParallelGroups[faceVId];
+			if (!parallelGroups.has(iParallelGroupFV))
+			{
+				parallelGroups.push_back(iParallelGroupFV);
+			}
+		}
+	};
+
+	// pass 1: count the active collisions, the per group collisions and the collision relations of each block
+	auto countFunc = [&](int iBlock) {
+		size_t* groupCounts = blockGroupOffsets.data() + iBlock * numParallelGroups;
+		std::fill(groupCounts, groupCounts + numParallelGroups, 0);
+		size_t numActiveCollisions = 0;
+		size_t numRelations = 0;
+		CPArray<int, 4> parallelGroups;
+
+		forEachSurfaceVertexInBlock(iBlock, [&](int iMesh, int iSurfaceV) {
+			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
+			VBDCollisionDetectionResult& collisionResult = collisionResultsAll[iMesh][iSurfaceV];
+			IdType surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
+			bool isValidCollision = false;
+			for (int iIntersection = 0; iIntersection < collisionResult.numIntersections(); iIntersection++)
+			{
+				const CollidingPointInfo& collidingPt = collisionResult.collidingPts[iIntersection];
+				if (collidingPt.shortestPathFound)
+				{
+					isValidCollision = true;
+					getParallelGroupsOfCollision(pTetMesh, surfaceVIdTetMesh, collidingPt, parallelGroups);
+					for (size_t iGroup = 0; iGroup < parallelGroups.size(); iGroup++)
+					{
+						groupCounts[parallelGroups[iGroup]]++;
+					}
+					numRelations += 3;
+				}
+			}
+			if (isValidCollision)
+			{
+				numActiveCollisions++;
+			}
+		});
+		blockActiveCollisionOffsets[iBlock + 1] = numActiveCollisions;
+		blockRelationOffsets[iBlock + 1] = numRelations;
+	};
+	cpu_parallel_for(0, numBlocks, countFunc);
+
+	// exclusive prefix sums over the blocks; there are only a few hundreds of blocks, which is not worth parallelizing
+	blockActiveCollisionOffsets[0] = 0;
+	blockRelationOffsets[0] = 0;
+	for (size_t iBlock = 0; iBlock < numBlocks; iBlock++)
+	{
+		blockActiveCollisionOffsets[iBlock + 1] += blockActiveCollisionOffsets[iBlock];
+		blockRelationOffsets[iBlock + 1] += blockRelationOffsets[iBlock];
+	}
+	for (size_t iGroup = 0; iGroup < numParallelGroups; iGroup++)
+	{
+		size_t numCollisionsInGroup = 0;
+		for (size_t iBlock = 0; iBlock < numBlocks; iBlock++)
+		{
+			size_t& blockGroupOffset = blockGroupOffsets[iBlock * numParallelGroups + iGroup];
+			size_t blockGroupCount = blockGroupOffset;
+			blockGroupOffset = numCollisionsInGroup;
+			numCollisionsInGroup += blockGroupCount;
+		}
+
+		size_t groupCapacity = activeCollisionsEachParallelGroup[iGroup].size() / 2;
+		if (numCollisionsInGroup > groupCapacity)
+		{
+			std::cout << "Parallel group: " << iGroup << " has exceeded the max number collisions! Skipping more collisions\n";
+			numCollisionsInGroup = groupCapacity;
+		}
+		numActiveCollisionsEachParallelGroup[iGroup] = numCollisionsInGroup;
+	}
+
+	const size_t numActiveCollisions = blockActiveCollisionOffsets[numBlocks];
+	const size_t numRelations = blockRelationOffsets[numBlocks];
+	activeCollisions.resize(numActiveCollisions);
+	pendingRelations.resize(numRelations);
+	pendingRelationKeys.resize(numRelations);
+
+	// pass 2: every block writes its entries starting from its offsets
+	auto fillFunc = [&](int iBlock) {
+		size_t* groupOffsets = blockGroupOffsets.data() + iBlock * numParallelGroups;
+		size_t activeCollisionOffset = blockActiveCollisionOffsets[iBlock];
+		size_t relationOffset = blockRelationOffsets[iBlock];
+		CPArray<int, 4> parallelGroups;
+
+		forEachSurfaceVertexInBlock(iBlock, [&](int iMesh, int iSurfaceV) {
+			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
+			VBDCollisionDetectionResult& collisionResult = collisionResultsAll[iMesh][iSurfaceV];
+			IdType surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
+			bool isValidCollision = false;
+			for (int iIntersection = 0; iIntersection < collisionResult.numIntersections(); iIntersection++)
+			{
+				const CollidingPointInfo& collidingPt = collisionResult.collidingPts[iIntersection];
+				if (collidingPt.shortestPathFound)
+				{
+					isValidCollision = true;
+					// each surface vertex belongs to exactly one block, no other task writes this entry
+					pTetMesh->activeCollisionMask(surfaceVIdTetMesh) = true;
+
+					getParallelGroupsOfCollision(pTetMesh, surfaceVIdTetMesh, collidingPt, parallelGroups);
+					for (size_t iGroup = 0; iGroup < parallelGroups.size(); iGroup++)
+					{
+						int iParallelGroup = parallelGroups[iGroup];
+						size_t activeColId = groupOffsets[iParallelGroup]++;
+						if (activeColId < numActiveCollisionsEachParallelGroup[iParallelGroup])
+						{
+							activeCollisionsEachParallelGroup[iParallelGroup](activeColId * 2) = iMesh;
+							activeCollisionsEachParallelGroup[iParallelGroup](activeColId * 2 + 1) = surfaceVIdTetMesh;
+						}
+					}
+
+					const int meshId_intersecting = collidingPt.intersectedMeshId;
+					VBDBaseTetMesh* pTetMesh_intersecting = tMeshes[meshId_intersecting].get();
+					for (size_t iSurfaceFaceV = 0; iSurfaceFaceV < 3; iSurfaceFaceV++)
+					{
+						IdType faceVId = pTetMesh_intersecting->surfaceFacesTetMeshVIds()(iSurfaceFaceV, collidingPt.closestSurfaceFaceId);
+						PendingCollisionRelation& pendingRelation = pendingRelations[relationOffset];
+						pendingRelation.targetMeshId = meshId_intersecting;
+						pendingRelation.targetVertexId = faceVId;
+						pendingRelation.relation.meshId = iMesh;
+						pendingRelation.relation.surfaceVertexId = iSurfaceV;
+						pendingRelation.relation.collisionId = iIntersection;
+						pendingRelation.relation.collisionType = 0;
+						pendingRelation.relation.collisionVertexOrder = iSurfaceFaceV;
+						pendingRelationKeys[relationOffset] = (uint64_t(vertexOffsets[meshId_intersecting] + faceVId) << 32) | uint64_t(relationOffset);
+						relationOffset++;
+					}
+				}
+			}
+			if (isValidCollision)
+			{
+				activeCollisions[activeCollisionOffset++] = { iMesh, surfaceVIdTetMesh };
+			}
+		});
+	};
+	cpu_parallel_for(0, numBlocks, fillFunc);
+
+	// pass 3: group the relations by their target vertex; since the relation index is in the low bits of the key,
+	// each vertex' relations stay in the serial order, and the task starting a run of a vertex owns its relation list
+	cpu_parallel_sort(pendingRelationKeys.begin(), pendingRelationKeys.end());
+	auto appendRelationFunc = [&](int iKey) {
+		const uint64_t targetVertex = pendingRelationKeys[iKey] >> 32;
+		if (iKey > 0 && (pendingRelationKeys[iKey - 1] >> 32) == targetVertex)
+		{
+			return;
+		}
+		const PendingCollisionRelation& firstRelation = pendingRelations[pendingRelationKeys[iKey] & 0xFFFFFFFF];
+		VBDBaseTetMesh* pTetMesh_target = tMeshes[firstRelation.targetMeshId].get();
+		pTetMesh_target->activeCollisionMask(firstRelation.targetVertexId) = true;
+		CollisionRelationList& collisionRelations = vertexCollisionRelations[firstRelation.targetMeshId][firstRelation.targetVertexId];
+		for (size_t iRun = iKey; iRun < numRelations && (pendingRelationKeys[iRun] >> 32) == targetVertex; iRun++)
+		{
+			collisionRelations.push_back(pendingRelations[pendingRelationKeys[iRun] & 0xFFFFFFFF].relation);
+		}
+	};
+	cpu_parallel_for(0, numRelations, appendRelationFunc);
+}
@@ -2,8 +2,11 @@
 #include "../Types/Types.h"
 #include "VBD_BaseMaterial.h"
 #include "../CollisionDetector/CollisionDetertionParameters.h"
+#include "VBD_CollisionInfo.h"
 
 #define COLLISION_RELATION_PREALLOCATE 4
+// number of surface vertices processed by one task when building the active collision list in parallel
+#define ACTIVE_COLLISION_LIST_BUILD_BLOCK_SIZE 256
 
 namespace GAIA {
 	struct CollisionRelation
@@ -17,6 +20,14 @@ namespace GAIA {
 
 	typedef CPArray<CollisionRelation, COLLISION_RELATION_PREALLOCATE> CollisionRelationList;
 
+	// a collision relation waiting to be appended to the relation list of vertex targetVertexId of mesh targetMeshId
+	struct PendingCollisionRelation
+	{
+		IdType targetMeshId;
+		IdType targetVertexId;
+		CollisionRelation relation;
+	};
+
 	struct ActiveCollisionList
 	{
 		void initialize(const std::vector<std::shared_ptr<VBDBaseTetMesh>>& basetetMeshes,
@@ -24,9 +35,13 @@ namespace GAIA {
 		{
 			tMeshes = basetetMeshes;
 			vertexCollisionRelations.resize(basetetMeshes.size());
+			surfaceVertexOffsets.assign(basetetMeshes.size() + 1, 0);
+			vertexOffsets.assign(basetetMeshes.size() + 1, 0);
 			for (size_t iMesh = 0; iMesh < basetetMeshes.size(); iMesh++)
 			{
 				vertexCollisionRelations[iMesh].resize(basetetMeshes[iMesh]->numVertices());
+				surfaceVertexOffsets[iMesh + 1] = surfaceVertexOffsets[iMesh] + basetetMeshes[iMesh]->surfaceVIds().size();
+				vertexOffsets[iMesh + 1] = vertexOffsets[iMesh] + basetetMeshes[iMesh]->numVertices();
 			}
 
 			initializeParallelGroup(vertexParallelGroups, activeCollisionListPreAllocationRatio);
@@ -39,6 +54,12 @@ namespace GAIA {
 
 		void addToActiveCollisionList(CollisionDetectionResult& collisionResult, size_t numIntersections = -1);
 
+		// builds activeCollisions, the per parallel group lists, the vertex collision relations and the activeCollisionMask 
+		// of all the meshes from the v-f collision results in parallel;
+		// the result is in the same order as calling addToActiveCollisionList on every surface vertex serially
+		// clear() must be called before it
+		void buildFromCollisionResults(std::vector<std::vector<VBDCollisionDetectionResult>>& collisionResultsAll);
+
 		std::vector<std::shared_ptr<VBDBaseTetMesh>> tMeshes;
 		// nCollision x (iMesh, vertexTetMeshId)
 		std::vector<std::pair<IdType, IdType>> activeCollisions;
@@ -50,6 +71,16 @@ namespace GAIA {
 		// reserved the size of each group to make sure it's always enough
 		std::vector<VecDynamicI> activeCollisionsEachParallelGroup;
 		std::vector<size_t> numActiveCollisionsEachParallelGroup;
+
+		// scratch buffers for buildFromCollisionResults, kept alive between the steps so they are only allocated once
+		std::vector<size_t> surfaceVertexOffsets;         // nMeshes + 1, prefix sum of the number of surface vertices
+		std::vector<size_t> vertexOffsets;                // nMeshes + 1, prefix sum of the number of vertices
+		std::vector<size_t> blockGroupOffsets;            // nBlocks x nParallelGroups
+		std::vector<size_t> blockActiveCollisionOffsets;  // nBlocks + 1
+		std::vector<size_t> blockRelationOffsets;         // nBlocks + 1
+		std::vector<PendingCollisionRelation> pendingRelations;
+		// (global target vertex id << 32) | index in pendingRelations, sorted to group the relations by target vertex
+		std::vector<uint64_t> pendingRelationKeys;
 	};
 
 }
\ No newline at end of file
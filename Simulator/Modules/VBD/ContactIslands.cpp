@@ -0,0 +1,76 @@
+#include "ContactIslands.h"
+
+using namespace GAIA;
+
+void GAIA::ContactIslands::initialize(size_t numMeshes)
+{
+	parent.resize(numMeshes);
+	rank.resize(numMeshes);
+	islandIdOfMesh.assign(numMeshes, -1);
+	islandIdOfRoot.assign(numMeshes, -1);
+	reset();
+}
+
+void GAIA::ContactIslands::reset()
+{
+	for (size_t iMesh = 0; iMesh < parent.size(); iMesh++)
+	{
+		parent[iMesh] = iMesh;
+		rank[iMesh] = 0;
+	}
+}
+
+IdType GAIA::ContactIslands::find(IdType iMesh)
+{
+	// path halving
+	while (parent[iMesh] != iMesh)
+	{
+		parent[iMesh] = parent[parent[iMesh]];
+		iMesh = parent[iMesh];
+	}
+	return iMesh;
+}
+
+bool GAIA::ContactIslands::unite(IdType iMesh1, IdType iMesh2)
+{
+	IdType root1 = find(iMesh1);
+	IdType root2 = find(iMesh2);
+	if (root1 == root2)
+	{
+		return false;
+	}
+
+	if (rank[root1] < rank[root2])
+	{
+		std::swap(root1, root2);
+	}
+	parent[root2] = root1;
+	if (rank[root1] == rank[root2])
+	{
+		rank[root1]++;
+	}
+	return true;
+}
+
+void GAIA::ContactIslands::buildIslands(const std::vector<int8_t>& meshIncluded)
+{
+	islandMeshes.clear();
+	std::fill(islandIdOfRoot.begin(), islandIdOfRoot.end(), -1);
+	for (size_t iMesh = 0; iMesh < parent.size(); iMesh++)
+	{
+		if (!meshIncluded[iMesh])
+		{
+			islandIdOfMesh[iMesh] = -1;
+			continue;
+		}
+
+		IdType root = find(iMesh);
+		if (islandIdOfRoot[root] == -1)
+		{
+			islandIdOfRoot[root] = islandMeshes.size();
+			islandMeshes.emplace_back();
+		}
+		islandIdOfMesh[iMesh] = islandIdOfRoot[root];
+		islandMeshes[islandIdOfRoot[root]].push_back(iMesh);
+	}
+}
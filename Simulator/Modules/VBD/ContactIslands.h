@@ -0,0 +1,37 @@
+#pragma once
+#include "../Types/Types.h"
+
+#include <vector>
+
+namespace GAIA {
+	// groups the meshes into islands connected by contacts, with a union-find over the meshes
+	// the pairs can be added incrementally, e.g. after the DCD, after the CCD and after each intermediate collision detection;
+	// buildIslands can be called any number of times in between, the unions are kept until reset
+	struct ContactIslands
+	{
+		void initialize(size_t numMeshes);
+
+		// every mesh becomes its own island
+		void reset();
+
+		IdType find(IdType iMesh);
+		// returns whether two different islands were merged
+		bool unite(IdType iMesh1, IdType iMesh2);
+
+		// numbers the islands of the meshes with meshIncluded set, in the order of their smallest mesh id
+		void buildIslands(const std::vector<int8_t>& meshIncluded);
+
+		size_t numIslands() const { return islandMeshes.size(); }
+
+		// nMeshes
+		std::vector<IdType> parent;
+		std::vector<IdType> rank;
+
+		// nMeshes, -1 for the meshes not included
+		std::vector<IdType> islandIdOfMesh;
+		// nIslands x nMeshesInIsland
+		std::vector<std::vector<IdType>> islandMeshes;
+		// nMeshes, scratch buffer of buildIslands: the island id of each root
+		std::vector<IdType> islandIdOfRoot;
+	};
+}
@@ -0,0 +1,62 @@
+#include "VBDPackedTetData.h"
+#include "../Parallelization/CPUParallelization.h"
+
+using namespace GAIA;
+
+void GAIA::VBDPackedTetData::initialize(const std::vector<std::shared_ptr<VBDBaseTetMesh>>& tMeshes, const std::vector<std::vector<IdType>>& vertexParallelGroups)
+{
+	vertexRecordIds.resize(tMeshes.size());
+	for (size_t iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+	{
+		vertexRecordIds[iMesh].setConstant(tMeshes[iMesh]->numVertices(), -1);
+	}
+
+	// record of each vertex in the sweep order: (meshId, vertexId)
+	std::vector<std::pair<IdType, IdType>> records;
+	recordNeiTetOffsets.clear();
+	recordNeiTetOffsets.push_back(0);
+	for (size_t iGroup = 0; iGroup < vertexParallelGroups.size(); iGroup++)
+	{
+		const std::vector<IdType>& parallelGroup = vertexParallelGroups[iGroup];
+		for (size_t iV = 0; iV < parallelGroup.size() / 2; iV++)
+		{
+			IdType meshId = parallelGroup[iV * 2];
+			IdType vertexId = parallelGroup[iV * 2 + 1];
+			vertexRecordIds[meshId](vertexId) = records.size();
+			records.emplace_back(meshId, vertexId);
+			recordNeiTetOffsets.push_back(recordNeiTetOffsets.back() + tMeshes[meshId]->getNumVertexNeighborTets(vertexId));
+		}
+	}
+
+	const size_t numNeiTets = recordNeiTetOffsets.back();
+	neiTetDmInvs.resize(9 * numNeiTets);
+	neiTetRestVolumes.resize(numNeiTets);
+	neiTetVertexOrders.resize(numNeiTets);
+	neiTetOtherVIds.resize(3 * numNeiTets);
+
+	auto fillRecordFunc = [&](int iRecord) {
+		VBDBaseTetMesh* pMesh = tMeshes[records[iRecord].first].get();
+		IdType vertexId = records[iRecord].second;
+		IdType iPacked = recordNeiTetOffsets[iRecord];
+		for (int iNeiTet = 0; iNeiTet < pMesh->getNumVertexNeighborTets(vertexId); iNeiTet++, iPacked++)
+		{
+			IdType tetId = pMesh->getVertexNeighborTet(vertexId, iNeiTet);
+			auto DmInv = pMesh->getDmInv(tetId);
+			std::copy(DmInv.data(), DmInv.data() + 9, neiTetDmInvs.begin() + 9 * iPacked);
+			neiTetRestVolumes[iPacked] = pMesh->tetRestVolume(tetId);
+
+			int vertedTetVId = pMesh->getVertexNeighborTetVertexOrder(vertexId, iNeiTet);
+			neiTetVertexOrders[iPacked] = vertedTetVId;
+			int iOther = 0;
+			for (int iTetV = 0; iTetV < 4; iTetV++)
+			{
+				if (iTetV != vertedTetVId)
+				{
+					neiTetOtherVIds[3 * iPacked + iOther] = pMesh->tetVIds()(iTetV, tetId);
+					iOther++;
+				}
+			}
+		}
+	};
+	cpu_parallel_for(0, records.size(), fillRecordFunc);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "../Types/Types.h"
+#include "VBD_BaseMaterial.h"
+
+namespace GAIA {
+	// a packed copy of the rest data of each vertex' neighbor tets, laid out in the order the CPU solver sweeps the vertices:
+	// parallel group by parallel group, and within a group in the order of vertexParallelGroups;
+	// a sweep over a parallel group reads it linearly instead of gathering through vertexNeighborTets, tetVIds, DmInvs and tetRestVolume
+	// it only depends on the topology and the rest shape, call initialize again when either changes
+	struct VBDPackedTetData
+	{
+		void initialize(const std::vector<std::shared_ptr<VBDBaseTetMesh>>& tMeshes, const std::vector<std::vector<IdType>>& vertexParallelGroups);
+
+		IdType getVertexRecord(IdType meshId, IdType vertexId) const { return vertexRecordIds[meshId](vertexId); }
+
+		// nMeshes x nVertices, the record of each vertex; -1 if the vertex is not in any parallel group
+		std::vector<VecDynamicI> vertexRecordIds;
+		// nRecords + 1, where each record's neighbor tets start in the arrays below
+		std::vector<IdType> recordNeiTetOffsets;
+
+		// 9 x nNeiTets, column major DmInv of each neighbor tet
+		std::vector<FloatingType> neiTetDmInvs;
+		std::vector<FloatingType> neiTetRestVolumes;
+		// the order of the record's vertex in each neighbor tet
+		std::vector<IdType> neiTetVertexOrders;
+		// 3 x nNeiTets, the other three vertices of each neighbor tet, in the order they appear in the tet
+		std::vector<IdType> neiTetOtherVIds;
+	};
+}
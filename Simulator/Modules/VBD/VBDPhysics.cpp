@@ -9,6 +9,7 @@
 
 
 #include "../Timer/Timer.h"
+#include "../Timer/Profiler.h"
 #include "../Timer/RunningTimeStatistics.h"
 #include "../CollisionDetector/CollisionDetertionParameters.h"
 
@@ -93,6 +94,23 @@ void GAIA::VBDPhysics::loadRunningparameters(std::string inModelInputFile, std::
 
 	physicsParamsVBD = std::static_pointer_cast<VBDPhysicsParameters>(basePhysicsParams);
 
+#ifdef GAIA_NO_CUDA
+	if (physicsParams().useGPU || physicsParams().useGDSolver || physicsParams().debugGPU)
+	{
+		std::cout << "Warning! GAIA is built without CUDA (GAIA_WITH_CUDA=OFF), the GPU solvers are unavailable. "
+			<< "Falling back to the CPU VBD solver.\n";
+		physicsParams().useGPU = false;
+		physicsParams().useGDSolver = false;
+		physicsParams().debugGPU = false;
+	}
+#endif // GAIA_NO_CUDA
+
+	if (physicsParams().usePackedTetData && physicsParams().useSIMDMaterialKernel)
+	{
+		std::cout << "Warning! usePackedTetData and useSIMDMaterialKernel are both on, the SIMD material kernel does not read the packed layout. "
+			<< "Falling back to the scalar kernel on the packed tets.\n";
+		physicsParams().useSIMDMaterialKernel = false;
+	}
 
 }
 
@@ -243,6 +261,7 @@ void GAIA::VBDPhysics::initialize()
 	}
 
 	vertexParallelGroups.resize(numberOfParallelGroups);
+	meshColorOfParallelGroup.assign(tMeshes.size(), std::vector<IdType>(numberOfParallelGroups, -1));
 
 	numAllVertices = 0;
 	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
@@ -262,6 +281,7 @@ void GAIA::VBDPhysics::initialize()
 			const std::vector<IdType>& currentColorGroup = pMesh->verticesColoringCategories()[iColor];
 
 			int smallestGroupId = findSmallestParallelGroup(availableColors, vertexParallelGroups, true);
+			meshColorOfParallelGroup[iMesh][smallestGroupId] = iColor;
 			// add the current color group to this parallel group
 			for (int iVertex = 0; iVertex < currentColorGroup.size(); iVertex++)
 			{
@@ -411,6 +431,16 @@ void GAIA::VBDPhysics::initialize()
 
 
 	activeColllisionList.initialize(tMeshes, vertexParallelGroups, physicsParams().activeCollisionListPreAllocationRatio);
+	contactIslands.initialize(tMeshes.size());
+	meshBroadPhase.initialize(basetetMeshes);
+	meshSolvedPerTask.assign(tMeshes.size(), 0);
+	meshInColoredSweep.assign(tMeshes.size(), 0);
+	meshIslandIterations.assign(tMeshes.size(), physicsParams().iterations);
+	if (physicsParams().usePackedTetData)
+	{
+		packedTetData.initialize(tMeshes, vertexParallelGroups);
+	}
+
 	if (physicsParams().useGPU)
 	{
 		initializeGPU();
@@ -458,107 +488,14 @@ void GAIA::VBDPhysics::initializeNewton()
 {
 	pNewtonAssembler = std::make_shared<TetMeshNewtonAssembler>();
 
-	pNewtonAssembler->diagonalHessianBlockPtrs.resize(tMeshes.size());
-	pNewtonAssembler->offDiagonalHessianBlockPtrs.resize(tMeshes.size());
-	std::vector<NTriplet> newtonHessianTriplets;
-	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
-	{
-		VBDBaseTetMesh::SharedPtr pMesh = tMeshes[iMesh];
-
-		pNewtonAssembler->diagonalHessianBlockPtrs[iMesh].reserve(pMesh->numVertices() * 9);
-		pNewtonAssembler->offDiagonalHessianBlockPtrs[iMesh].reserve(pMesh->numEdges() * 18);
+	pNewtonAssembler->cgMaxIterations = physicsParams().NewtonCGMaxIterations;
+	pNewtonAssembler->cgTolerance = physicsParams().NewtonCGTolerance;
+	pNewtonAssembler->pcgPreconditionerType = physicsParams().NewtonPCGPreconditioner;
+	pNewtonAssembler->pcgWarmStart = physicsParams().NewtonPCGWarmStart;
 
-	}
-	newtonHessianTriplets.reserve(numAllVertices * 9 + numAllEdges * 18);
-	int offset = 0;
-	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
-	{
-		VBDBaseTetMesh::SharedPtr pMesh = tMeshes[iMesh];
-		for (int iV = 0; iV < pMesh->numVertices(); iV++)
-		{
-			int vertPos = offset + iV * 3;
-			for (int i = 0; i < 3; ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					newtonHessianTriplets.emplace_back(vertPos + j, vertPos + i, 1.0);
-				}
-			}
-		}
-		for (int iE = 0; iE < pMesh->numEdges(); iE++)
-		{
-			int vertPosi = offset + pMesh->edges()(0, iE) * 3;
-			int vertPosj = offset + pMesh->edges()(1, iE) * 3;
-			for (int j = 0; j < 3; ++j)
-			{
-				for (int i = 0; i < 3; ++i)
-				{
-					newtonHessianTriplets.emplace_back(vertPosi + i, vertPosj + j, 1.0);
-				}
-			}
-			for (int i = 0; i < 3; ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					newtonHessianTriplets.emplace_back(vertPosj + j, vertPosi + i, 1.0);
-				}
-			}
-		}
-		offset += pMesh->numVertices() * 3;
-	}
-	pNewtonAssembler->newtonHessianAll.resize(numAllVertices * 3, numAllVertices * 3);
-	pNewtonAssembler->newtonHessianAll.setFromTriplets(newtonHessianTriplets.begin(), newtonHessianTriplets.end());
-	pNewtonAssembler->newtonHessianAll.makeCompressed();
-
-	if (physicsParams().NewtonUseCG)
-	{
-		pNewtonAssembler->solverCG.compute(pNewtonAssembler->newtonHessianAll);
-		pNewtonAssembler->solverCG.setMaxIterations(300);
-		pNewtonAssembler->solverCG.setTolerance(1e-7f);
-	}
-	else {
-		pNewtonAssembler->solverDirect.analyzePattern(pNewtonAssembler->newtonHessianAll);
-	}
-
-	offset = 0;
-	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
-	{
-		VBDBaseTetMesh::SharedPtr pMesh = tMeshes[iMesh];
-		for (int iV = 0; iV < pMesh->numVertices(); iV++)
-		{
-			int vertPos = offset + iV * 3;
-			for (int i = 0; i < 3; ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					pNewtonAssembler->diagonalHessianBlockPtrs[iMesh].push_back(&pNewtonAssembler->newtonHessianAll.coeffRef(vertPos + j, vertPos + i));
-				}
-			}
-		}
-		for (int iE = 0; iE < pMesh->numEdges(); iE++)
-		{
-			int vertPosi = offset + pMesh->edges()(0, iE) * 3;
-			int vertPosj = offset + pMesh->edges()(1, iE) * 3;
-			for (int j = 0; j < 3; ++j)
-			{
-				for (int i = 0; i < 3; ++i)
-				{
-					pNewtonAssembler->offDiagonalHessianBlockPtrs[iMesh].push_back(&pNewtonAssembler->newtonHessianAll.coeffRef(vertPosi + i, vertPosj + j));
-				}
-			}
-			for (int i = 0; i < 3; ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					pNewtonAssembler->offDiagonalHessianBlockPtrs[iMesh].push_back(&pNewtonAssembler->newtonHessianAll.coeffRef(vertPosj + j, vertPosi + i));
-				}
-			}
-		}
-		offset += pMesh->numVertices() * 3;
-	}
-	pNewtonAssembler->newtonForce.resize(numAllVertices * 3);
-	pNewtonAssembler->elasticHessian.resize(numAllTets);
-	pNewtonAssembler->elasticForce.resize(numAllTets);
+	std::vector<TetMeshFEM::SharedPtr> meshes(tMeshes.begin(), tMeshes.end());
+	int solverType = physicsParams().NewtonUseMatrixFreePCG ? 2 : (physicsParams().NewtonUseCG ? 1 : 0);
+	pNewtonAssembler->initialize(meshes, solverType);
 }
 
 void GAIA::VBDPhysics::initializeGPU()
@@ -689,7 +626,8 @@ void GAIA::VBDPhysics::enableModels()
 	for (size_t iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 	{
 		VBDBaseTetMesh::SharedPtr pTetMesh = tMeshes[iMesh];
-		if (pTetMesh->pObjectParams->frameToAppear <= frameId) {
+		// the sleeping meshes are deactivated on purpose
+		if (pTetMesh->pObjectParams->frameToAppear <= frameId && !pTetMesh->sleeping) {
 			bool changed = false;
 			if (false == pTetMesh->activeForCollision)
 			{
@@ -809,10 +747,12 @@ void GAIA::VBDPhysics::timeStepEqualize()
 
 void GAIA::VBDPhysics::runStep()
 {
+	GAIA_PROFILE_SCOPE("runStep");
 	if (physicsParams().useNewton)
 	{
 		runStepNewton();
 	}
+#ifndef GAIA_NO_CUDA
 	else if (physicsParams().useGDSolver)
 	{
 		runStepGPU_GD();
@@ -822,6 +762,7 @@ void GAIA::VBDPhysics::runStep()
 		runStepGPU();
 		//runStepGPU_allInOneSweep();
 	}
+#endif // !GAIA_NO_CUDA
 	else {
 		switch (physicsParams().collisionSolutionType)
 		{
@@ -837,10 +778,13 @@ void GAIA::VBDPhysics::runStep()
 	}
 }
 
+#ifndef GAIA_NO_CUDA
 void GAIA::VBDPhysics::runStepGPU()
 {
+	GAIA_PROFILE_SCOPE("runStepGPU");
 	for (substep = 0; substep < physicsParams().numSubsteps; substep++)
 	{
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
 		curTime += physicsParams().dt;
 		debugOperation(DEBUG_LVL_DEBUG, [&]() {
 			std::cout << "Substep step: " << substep << std::endl;
@@ -881,6 +825,7 @@ void GAIA::VBDPhysics::runStepGPU()
 		TICK(timeCsmpMaterialSolve);
 		for (iIter = 0; iIter < physicsParams().iterations; iIter++)
 		{
+			GAIA_PROFILE_SCOPE_I("Iteration", iIter);
 			if (physicsParams().intermediateCollisionIterations > 0
 				&& !(iIter % physicsParams().intermediateCollisionIterations)
 				&& iIter)
@@ -1177,8 +1122,10 @@ void GAIA::VBDPhysics::runStepGPU()
 
 void GAIA::VBDPhysics::runStepGPU_GD()
 {
+	GAIA_PROFILE_SCOPE("runStepGPU_GD");
 	for (substep = 0; substep < physicsParams().numSubsteps; substep++)
 	{
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
 		curTime += physicsParams().dt;
 		debugOperation(DEBUG_LVL_DEBUG, [&]() {
 			std::cout << "Substep step: " << substep << std::endl;
@@ -1234,6 +1181,7 @@ void GAIA::VBDPhysics::runStepGPU_GD()
 
 		for (iIter = 0; iIter < physicsParams().iterations; iIter++)
 		{
+			GAIA_PROFILE_SCOPE_I("Iteration", iIter);
 			if (physicsParams().useAccelerator)
 			{
 				acceleratorOmega = getAcceleratorOmega(iIter + 1, physicsParams().acceleratorRho, acceleratorOmega);
@@ -1315,6 +1263,7 @@ void GAIA::VBDPhysics::runStepGPU_GD()
 
 	} // substep
 }
+#endif // !GAIA_NO_CUDA
 
 //void GAIA::VBDPhysics::runStepGPU_debugOnCPU()
 //{
@@ -1438,14 +1387,19 @@ void GAIA::VBDPhysics::runStepGPU_GD()
 
 void GAIA::VBDPhysics::runStepNewton()
 {
+	GAIA_PROFILE_SCOPE("runStepNewton");
 	for (substep = 0; substep < physicsParams().numSubsteps; substep++)
 	{
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
 		curTime += physicsParams().dt;
 		debugOperation(DEBUG_LVL_DEBUG, [&]() {
 			std::cout << "Substep step: " << substep << std::endl;
 			});
 
-		// dcd();
+		if (physicsParams().handleCollision)
+		{
+			dcd();
+		}
 
                 //		cpu_parallel_for(0, numTetMeshes(), [&](int iMesh) {
                 auto lambdaFunc3 = [&](int iMesh) {
@@ -1458,8 +1412,12 @@ void GAIA::VBDPhysics::runStepNewton()
                 cpu_parallel_for(0, numTetMeshes(), lambdaFunc3);
 		applyDeformers();
 
-		// ccd();
-		// prepareCollisionDataCPU();
+		if (physicsParams().handleCollision)
+		{
+			ccd();
+			prepareCollisionDataCPU();
+			analyzeNewtonCollision();
+		}
 
 		if (physicsParams().evaluateConvergence)
 		{
@@ -1472,6 +1430,7 @@ void GAIA::VBDPhysics::runStepNewton()
 
 		for (iIter = 0; iIter < physicsParams().iterations; iIter++)
 		{
+			GAIA_PROFILE_SCOPE_I("Iteration", iIter);
 			bool apply_friction = iIter >= physicsParams().frictionStartIter;
 			apply_friction = true;
 			debugOperation(DEBUG_LVL_DEBUG, [&]() {
@@ -1480,12 +1439,27 @@ void GAIA::VBDPhysics::runStepNewton()
 			debugOperation(DEBUG_LVL_DEBUG_VEBOSE_2, std::bind(&VBDPhysics::outputPosVel, this));
 			debugOperation(DEBUG_LVL_DEBUG_VEBOSE_2, std::bind(&VBDPhysics::clearForces, this));
 			
+			if (physicsParams().handleCollision)
+			{
+				updateAllCollisionInfos();
+			}
 			computeElasticForceHessian();
-			fillNewtonSystem();
+			fillNewtonSystem(apply_friction);
 			NVecDynamic Ndx ;
 
-			if (physicsParams().NewtonUseCG)
+			if (pNewtonAssembler->solverType == 2)
 			{
+				GAIA_PROFILE_SCOPE("NewtonPCGSolve");
+				pNewtonAssembler->solveMatrixFreePCG();
+				Ndx = pNewtonAssembler->Ndx;
+				debugOperation(DEBUG_LVL_DEBUG, [&]() {
+					std::cout << "PCG iterations: " << pNewtonAssembler->pcgIterations 
+						<< ", relative residual: " << pNewtonAssembler->pcgRelativeResidual << std::endl;
+					});
+			}
+			else if (pNewtonAssembler->solverType == 1)
+			{
+				GAIA_PROFILE_SCOPE("NewtonCGSolve");
 				pNewtonAssembler->solverCG.compute(pNewtonAssembler->newtonHessianAll);
 				Ndx = pNewtonAssembler->solverCG.solve(pNewtonAssembler->newtonForce);
 
@@ -1497,7 +1471,28 @@ void GAIA::VBDPhysics::runStepNewton()
 			}
 			else
 			{
-				pNewtonAssembler->solverDirect.factorize(pNewtonAssembler->newtonHessianAll);
+				GAIA_PROFILE_SCOPE("NewtonDirectSolve");
+				newtonFactorizationFresh = !physicsParams().NewtonReuseFactorization || newtonRefactorize
+					|| newtonNumFactorizationReuses >= physicsParams().NewtonMaxFactorizationReuses;
+				if (newtonFactorizationFresh)
+				{
+					FloatingType timeFactorization = 0;
+					TICK(timeFactorization);
+					pNewtonAssembler->solverDirect.factorize(pNewtonAssembler->newtonHessianAll);
+					TOCK(timeFactorization);
+					timeStatistics().timeCsmpNewtonFactorization += timeFactorization;
+					timeStatistics().numNewtonFactorizations++;
+					newtonLastFactorizationTime = timeFactorization;
+					newtonNumFactorizationReuses = 0;
+					newtonRefactorize = false;
+				}
+				else
+				{
+					// lagged Hessian: the direction solved with the old factorization is still a descent direction
+					timeStatistics().timeCsmpNewtonFactorizationSaved += newtonLastFactorizationTime;
+					timeStatistics().numNewtonFactorizationReuses++;
+					newtonNumFactorizationReuses++;
+				}
 				Ndx = pNewtonAssembler->solverDirect.solve(pNewtonAssembler->newtonForce);
 
 				if (pNewtonAssembler->solverDirect.info() != Eigen::Success)
@@ -1522,11 +1517,27 @@ void GAIA::VBDPhysics::runStepNewton()
 					NFloatingType eInertia{};
 					NFloatingType eElastic{};
 					// Elastic is already computed during force and hessian evaluation, set elasticReady to true
-					pNewtonAssembler->newtonEnergy = evaluateMeritEnergy(eInertia, eElastic, true);
+					pNewtonAssembler->newtonEnergy = evaluateMeritEnergy(eInertia, eElastic, true) + evaluateCollisionEnergy();
 				}
 				FloatingType stepSizeNew;
+				NCFloatingType energyPrev = pNewtonAssembler->newtonEnergy;
 				pNewtonAssembler->newtonEnergy = newtonLineSearch(dx, pNewtonAssembler->newtonEnergy, stepSize, physicsParams().backtracingLineSearchC,
 					physicsParams().backtracingLineSearchTau, physicsParams().backtracingLineSearchMaxIters, stepSizeNew);
+
+				if (physicsParams().NewtonReuseFactorization && pNewtonAssembler->solverType == 0)
+				{
+					NCFloatingType energyDecrease = energyPrev - pNewtonAssembler->newtonEnergy;
+					if (newtonFactorizationFresh)
+					{
+						newtonLastFreshEnergyDecrease = energyDecrease;
+					}
+					else if (stepSizeNew < stepSize 
+						|| energyDecrease < physicsParams().NewtonRefactorizeStallRatio * newtonLastFreshEnergyDecrease)
+					{
+						// the lagged Hessian is too far off
+						newtonRefactorize = true;
+					}
+				}
 				stepSize = physicsParams().backtracingLineSearchAlpha;
 			}
 			else {
@@ -1550,6 +1561,7 @@ void GAIA::VBDPhysics::runStepNewton()
 	} // substep
 }
 
+#ifndef GAIA_NO_CUDA
 void GAIA::VBDPhysics::recordVBDSolveGraph()
 {
 	cudaStreamBeginCapture(cudaStream, cudaStreamCaptureModeGlobal);
@@ -1575,9 +1587,11 @@ void GAIA::VBDPhysics::recordVBDSolveGraph()
 	graphCreated = true;
 
 }
+#endif // !GAIA_NO_CUDA
 
 void GAIA::VBDPhysics::applyDeformers()
 {
+	GAIA_PROFILE_SCOPE("applyDeformers");
 	for (size_t iDeformer = 0; iDeformer < deformers.size(); iDeformer++)
 	{
 		(*deformers[iDeformer])(*this, curTime, frameId, substep, iIter, physicsParams().dt);
@@ -1586,8 +1600,10 @@ void GAIA::VBDPhysics::applyDeformers()
 
 void GAIA::VBDPhysics::runStep_serialCollisionHandling()
 {
+	GAIA_PROFILE_SCOPE("runStep_serialCollisionHandling");
 	for (substep = 0; substep < physicsParams().numSubsteps; substep++)
 	{
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
 		curTime += physicsParams().dt;
 		debugOperation(DEBUG_LVL_DEBUG, [&]() {
 			std::cout << "Substep step: " << substep << std::endl;
@@ -1611,12 +1627,27 @@ void GAIA::VBDPhysics::runStep_serialCollisionHandling()
 		prepareCollisionDataCPU();
 
 		TICK(timeCsmpMaterialSolve);
+		FloatingType acceleratorOmega = 1.f;
+		if (physicsParams().useAccelerator)
+		{
+			auto recordAcceleratorHandler = [&](int iMesh) {
+				if (tMeshes[iMesh]->activeForMaterialSolve)
+				{
+					recordInitialPositionForAcceleratorCPU(iMesh);
+				}
+			};
+			cpu_parallel_for(0, numTetMeshes(), recordAcceleratorHandler);
+		}
+		int numIterationsUsed = 0;
 		for (iIter = 0; iIter < physicsParams().iterations; iIter++)
 		{
+			GAIA_PROFILE_SCOPE_I("Iteration", iIter);
 			bool apply_friction = iIter >= physicsParams().frictionStartIter;
-			solveCollisionsSequentially();
+			// the vertices moved by the collisions count for the convergence as well
+			FloatingType maxStep = solveCollisionsSequentially();
 			for (size_t iGroup = 0; iGroup < vertexParallelGroups.size(); iGroup++)
 			{
+				GAIA_PROFILE_SCOPE_I("ColorGroup", iGroup);
 				const std::vector<IdType>& parallelGroup = vertexParallelGroups[iGroup];
 
 				size_t numVertices = parallelGroup.size() / 2;
@@ -1630,13 +1661,33 @@ void GAIA::VBDPhysics::runStep_serialCollisionHandling()
 						//if (!pMesh->fixedMask[vId])
 					{
 						//pMesh->VBDStep(vId);
-						VBDStepWithCollision(pMesh, iMesh, vId, apply_friction);
+						return VBDStepWithCollision(pMesh, iMesh, vId, apply_friction);
 					}
+					return FloatingType(0.f);
 					};
-                                cpu_parallel_for(0, numVertices, lambdaFunc5);
+                                maxStep = std::max(maxStep, cpu_parallel_max(0, numVertices, FloatingType(0.f), lambdaFunc5));
+			}
+			numIterationsUsed = iIter + 1;
+			if (iterationsConverged(numIterationsUsed, maxStep))
+			{
+				break;
+			}
+
+			if (physicsParams().useAccelerator)
+			{
+				acceleratorOmega = getAcceleratorOmega(iIter + 1, physicsParams().acceleratorRho, acceleratorOmega);
+				for (IdType iMesh = 0; iMesh < numTetMeshes(); iMesh++)
+				{
+					if (tMeshes[iMesh]->activeForMaterialSolve)
+					{
+						applyAcceleratorCPU(iMesh, acceleratorOmega, true);
+					}
+				}
 			}
 		} // iteration
 		TOCK_STRUCT(timeStatistics(), timeCsmpMaterialSolve);
+		timeStatistics().numIterations += numIterationsUsed;
+		timeStatistics().numSubsteps++;
 
 		updateVelocities();
 	} // substep
@@ -1644,13 +1695,19 @@ void GAIA::VBDPhysics::runStep_serialCollisionHandling()
 
 void GAIA::VBDPhysics::runStep_hybridCollisionHandling()
 {
+	GAIA_PROFILE_SCOPE("runStep_hybridCollisionHandling");
 	for (substep = 0; substep < physicsParams().numSubsteps; substep++)
 	{
+		GAIA_PROFILE_SCOPE_I("Substep", substep);
 		curTime += physicsParams().dt;
 		debugOperation(DEBUG_LVL_DEBUG, [&]() {
 			std::cout << "Substep step: " << substep << std::endl;
 			});
 
+		if (physicsParams().sleepKineticEnergyThres > 0)
+		{
+			wakeUpDeformedMeshes();
+		}
 		dcd();
 
 		//cpu_parallel_for(0, numTetMeshes(), [&](int iMesh) {
@@ -1666,12 +1723,45 @@ void GAIA::VBDPhysics::runStep_hybridCollisionHandling()
 
 		ccd();
 		prepareCollisionDataCPU();
-
+		if (physicsParams().sleepKineticEnergyThres > 0)
+		{
+			wakeUpTouchedMeshes();
+		}
 
 		TICK(timeCsmpMaterialSolve);
-		for (iIter = 0; iIter < physicsParams().iterations; iIter++)
+		updateContactIslands(true);
+		int numIterationsUsed = 0;
+		if (perTaskIslands.size())
+		{
+			GAIA_PROFILE_SCOPE("PerTaskIslands");
+			// a single fork/join for all the iterations of these islands
+			auto perTaskIslandHandler = [&](int iPerTaskIsland) {
+				return solveIslandAllIterations(perTaskIslands[iPerTaskIsland]);
+			};
+			numIterationsUsed = cpu_parallel_max(0, perTaskIslands.size(), 0, perTaskIslandHandler);
+		}
+
+		// the Chebyshev sequence restarts after each intermediate collision detection, the collisions it finds change the problem
+		FloatingType acceleratorOmega = 1.f;
+		int acceleratorOrder = 0;
+		bool acceleratorRestarted = false;
+		auto recordAcceleratorHandler = [&](int iMesh) {
+			if (meshInColoredSweep[iMesh])
+			{
+				recordInitialPositionForAcceleratorCPU(iMesh);
+			}
+		};
+		if (physicsParams().useAccelerator)
+		{
+			cpu_parallel_for(0, numTetMeshes(), recordAcceleratorHandler);
+		}
+
+		// the bound is re-read every iteration, the intermediate collision detection can move islands to the colored sweep
+		for (iIter = 0; iIter < numColoredSweepIterations; iIter++)
 		{
+			GAIA_PROFILE_SCOPE_I("Iteration", iIter);
 			bool apply_friction = iIter >= physicsParams().frictionStartIter;
+			FloatingType maxStep = 0.f;
 			// apply_friction = true;
 			debugOperation(DEBUG_LVL_DEBUG_VEBOSE, [&]() {
 				std::cout << "iIter: " << iIter << std::endl;
@@ -1680,6 +1770,7 @@ void GAIA::VBDPhysics::runStep_hybridCollisionHandling()
 			debugOperation(DEBUG_LVL_DEBUG_VEBOSE, std::bind(&VBDPhysics::clearForces, this));
 			for (size_t iGroup = 0; iGroup < vertexParallelGroups.size(); iGroup++)
 			{
+				GAIA_PROFILE_SCOPE_I("ColorGroup", iGroup);
 				const std::vector<IdType>& parallelGroup = vertexParallelGroups[iGroup];
 
 				size_t numVertices = parallelGroup.size() / 2;
@@ -1689,6 +1780,10 @@ void GAIA::VBDPhysics::runStep_hybridCollisionHandling()
                                 auto collisionHandler = [&](int iCollision) {
 					IdType iMesh = activeColllisionList.activeCollisionsEachParallelGroup[iGroup][iCollision * 2];
 					int vId = activeColllisionList.activeCollisionsEachParallelGroup[iGroup][2 * iCollision + 1];
+					if (!meshInColoredSweep[iMesh])
+					{
+						return;
+					}
 					updateCollisionInfo(getCollisionDetectionResultFromTetMeshId(iMesh, vId));
 
 					};
@@ -1700,14 +1795,15 @@ void GAIA::VBDPhysics::runStep_hybridCollisionHandling()
 					int vId = parallelGroup[2 * iV + 1];
 
 					VBDTetMeshNeoHookean* pMesh = (VBDTetMeshNeoHookean*)tMeshes[iMesh].get();
-					if (!pMesh->fixedMask[vId] && pMesh->activeForMaterialSolve)
+					if (!pMesh->fixedMask[vId] && meshInColoredSweep[iMesh] && iIter < meshIslandIterations[iMesh])
 						//if (!pMesh->fixedMask[vId])
 					{
 						//pMesh->VBDStep(vId);
-						VBDStepWithCollision(pMesh, iMesh, vId, apply_friction);
+						return VBDStepWithCollision(pMesh, iMesh, vId, apply_friction);
 					}
+					return FloatingType(0.f);
 					};
-                                cpu_parallel_for(0, numVertices, vertexHandler);
+                                maxStep = std::max(maxStep, cpu_parallel_max(0, numVertices, FloatingType(0.f), vertexHandler));
 				// VBDTetMeshNeoHookean* pMesh = (VBDTetMeshNeoHookean*)tMeshes[0].get();
 				//int sum = checksum(reinterpret_cast<int*>(pMesh->mVertPos.data()), sizeof(FloatingType) / sizeof(int) * pMesh->mVertPos.size());
 				//std::cout << "substep: " << substep << "iteration: " << iteration << "iGroup: " << iGroup << ", checksum: " << sum << std::endl;
@@ -1715,76 +1811,416 @@ void GAIA::VBDPhysics::runStep_hybridCollisionHandling()
 			debugOperation(DEBUG_LVL_DEBUG_VEBOSE, std::bind(&VBDPhysics::outputForces, this));
 			if (physicsParams().intermediateCollisionIterations > 0 && iIter % physicsParams().intermediateCollisionIterations == physicsParams().intermediateCollisionIterations - 1) {
 				intermediateCollisionDetection();
+				updateContactIslands(false);
+				if (physicsParams().useAccelerator)
+				{
+					acceleratorOrder = 0;
+					acceleratorOmega = 1.f;
+					acceleratorRestarted = true;
+					cpu_parallel_for(0, numTetMeshes(), recordAcceleratorHandler);
+				}
+			}
+			numIterationsUsed = std::max(numIterationsUsed, iIter + 1);
+			if (iterationsConverged(iIter + 1, maxStep))
+			{
+				break;
+			}
+
+			if (physicsParams().useAccelerator && !acceleratorRestarted)
+			{
+				acceleratorOrder++;
+				acceleratorOmega = getAcceleratorOmega(acceleratorOrder, physicsParams().acceleratorRho, acceleratorOmega);
+				for (IdType iMesh = 0; iMesh < numTetMeshes(); iMesh++)
+				{
+					if (meshInColoredSweep[iMesh] && iIter < meshIslandIterations[iMesh])
+					{
+						applyAcceleratorCPU(iMesh, acceleratorOmega, true);
+					}
+				}
 			}
+			// the positions just recorded are the start of the restarted sequence
+			acceleratorRestarted = false;
 		} // iteration
 		TOCK_STRUCT(timeStatistics(), timeCsmpMaterialSolve);
+		timeStatistics().numIterations += numIterationsUsed;
+		timeStatistics().numSubsteps++;
 
 		updateVelocities();
+		if (physicsParams().sleepKineticEnergyThres > 0)
+		{
+			updateSleepingMeshes();
+		}
 	} // substep
 }
 
-void GAIA::VBDPhysics::prepareCollisionDataCPU()
+int GAIA::VBDPhysics::getMeshIterations(IdType iMesh)
 {
-	// record the activate collisions
-	activeColllisionList.clear();
+	int iterations = tMeshes[iMesh]->pObjParamsVBD->iterations;
+	return iterations > 0 ? iterations : physicsParams().iterations;
+}
 
-	int numActiveDCD = 0;
-	int numActiveCCD = 0;
+void GAIA::VBDPhysics::updateContactIslands(bool newSubstep)
+{
+	GAIA_PROFILE_SCOPE("updateContactIslands");
+	size_t numMeshes = numTetMeshes();
+	if (newSubstep)
+	{
+		contactIslands.reset();
+	}
 
-	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++) {
-		VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
-		pTetMesh->activeCollisionMask.setZero();
-		std::vector<VBDCollisionDetectionResult>& dcdResults = collisionResultsAll[iMesh];
+	// only the meshes being solved are connected, a contact with a static mesh does not couple anything
+	for (size_t iCol = 0; iCol < activeColllisionList.activeCollisions.size(); iCol++)
+	{
+		IdType meshId = activeColllisionList.activeCollisions[iCol].first;
+		IdType vertexId = activeColllisionList.activeCollisions[iCol].second;
+		if (!tMeshes[meshId]->activeForMaterialSolve)
+		{
+			continue;
+		}
+		VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(meshId, vertexId);
+		for (size_t iIntersection = 0; iIntersection < colResult.numIntersections(); iIntersection++)
+		{
+			const CollidingPointInfo& collidingPt = colResult.collidingPts[iIntersection];
+			if (collidingPt.shortestPathFound && tMeshes[collidingPt.intersectedMeshId]->activeForMaterialSolve)
+			{
+				contactIslands.unite(meshId, collidingPt.intersectedMeshId);
+			}
+		}
+	}
 
-		// todo: make this parallel using 
-		for (int iSurfaceV = 0; iSurfaceV < pTetMesh->surfaceVIds().size(); ++iSurfaceV)
+	std::vector<int8_t> meshIncluded(numMeshes);
+	for (size_t iMesh = 0; iMesh < numMeshes; iMesh++)
+	{
+		meshIncluded[iMesh] = tMeshes[iMesh]->activeForMaterialSolve;
+	}
+	contactIslands.buildIslands(meshIncluded);
+	size_t numIslands = contactIslands.numIslands();
+
+	islandSolvedPerTask.assign(numIslands, 0);
+	islandIterations.assign(numIslands, 0);
+	perTaskIslands.clear();
+	numMeshesInColoredSweep = 0;
+	numColoredSweepIterations = 0;
+	for (size_t iIsland = 0; iIsland < numIslands; iIsland++)
+	{
+		const std::vector<IdType>& meshes = contactIslands.islandMeshes[iIsland];
+		size_t numIslandVertices = 0;
+		bool allSolvedPerTask = true;
+		for (IdType iMesh : meshes)
 		{
-			VBDCollisionDetectionResult& collisionResult = dcdResults[iSurfaceV];
-			int32_t surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
-			if (collisionResult.numIntersections())
+			numIslandVertices += tMeshes[iMesh]->numVertices();
+			islandIterations[iIsland] = std::max(islandIterations[iIsland], getMeshIterations(iMesh));
+			allSolvedPerTask = allSolvedPerTask && meshSolvedPerTask[iMesh];
+		}
+
+		if (newSubstep)
+		{
+			islandSolvedPerTask[iIsland] = physicsParams().solveSmallIslandsPerTask
+				&& numIslandVertices <= physicsParams().perTaskIslandMaxVertices;
+		}
+		else
+		{
+			// the islands merged by the intermediate collision detection continue in the colored sweep,
+			// unless all their meshes are already done
+			islandSolvedPerTask[iIsland] = allSolvedPerTask;
+		}
+
+		if (islandSolvedPerTask[iIsland])
+		{
+			if (newSubstep)
 			{
-				activeColllisionList.addToActiveCollisionList(collisionResult);
-				//std::cout << "collision mask of " << surfaceVId << " set to true\n";
+				perTaskIslands.push_back(iIsland);
+			}
+		}
+		else
+		{
+			numMeshesInColoredSweep += meshes.size();
+			numColoredSweepIterations = std::max(numColoredSweepIterations, islandIterations[iIsland]);
+		}
+
+		for (IdType iMesh : meshes)
+		{
+			meshSolvedPerTask[iMesh] = islandSolvedPerTask[iIsland];
+			meshInColoredSweep[iMesh] = !islandSolvedPerTask[iIsland];
+			meshIslandIterations[iMesh] = islandIterations[iIsland];
+		}
+	}
+
+	for (size_t iMesh = 0; iMesh < numMeshes; iMesh++)
+	{
+		if (!meshIncluded[iMesh])
+		{
+			meshSolvedPerTask[iMesh] = 0;
+			meshInColoredSweep[iMesh] = 0;
+		}
+	}
 
-				if (collisionResult.fromCCD)
+	// the collisions of the per task islands, by the parallel group of the colliding vertex
+	// a collision belongs to the island of its vertex, or to the island of the intersected mesh if the vertex is from a static mesh
+	islandCollisionsEachParallelGroup.resize(numIslands);
+	for (IdType iIsland : perTaskIslands)
+	{
+		islandCollisionsEachParallelGroup[iIsland].resize(vertexParallelGroups.size());
+		for (std::vector<IdType>& collisions : islandCollisionsEachParallelGroup[iIsland])
+		{
+			collisions.clear();
+		}
+	}
+	if (perTaskIslands.size())
+	{
+		for (size_t iGroup = 0; iGroup < vertexParallelGroups.size(); iGroup++)
+		{
+			for (size_t iCollision = 0; iCollision < activeColllisionList.numActiveCollisionsEachParallelGroup[iGroup]; iCollision++)
+			{
+				IdType iMesh = activeColllisionList.activeCollisionsEachParallelGroup[iGroup][iCollision * 2];
+				IdType vId = activeColllisionList.activeCollisionsEachParallelGroup[iGroup][iCollision * 2 + 1];
+				IdType iIsland = contactIslands.islandIdOfMesh[iMesh];
+				if (iIsland == -1)
 				{
-					numActiveCCD++;
-				}
-				else {
-					numActiveDCD++;
+					VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(iMesh, vId);
+					for (size_t iIntersection = 0; iIntersection < colResult.numIntersections(); iIntersection++)
+					{
+						const CollidingPointInfo& collidingPt = colResult.collidingPts[iIntersection];
+						if (collidingPt.shortestPathFound && contactIslands.islandIdOfMesh[collidingPt.intersectedMeshId] != -1)
+						{
+							iIsland = contactIslands.islandIdOfMesh[collidingPt.intersectedMeshId];
+							break;
+						}
+					}
 				}
 
-				for (size_t iIntersection = 0; iIntersection < collisionResult.numIntersections(); iIntersection++)
+				if (iIsland != -1 && islandSolvedPerTask[iIsland])
 				{
-					const CollidingPointInfo& collidingPt = collisionResult.collidingPts[iIntersection];
-					if (collidingPt.shortestPathFound)
-					{
-						pTetMesh->activeCollisionMask(surfaceVIdTetMesh) = true;
+					islandCollisionsEachParallelGroup[iIsland][iGroup].push_back(iMesh);
+					islandCollisionsEachParallelGroup[iIsland][iGroup].push_back(vId);
+				}
+			}
+		}
+	}
 
-						int meshId_intersecting = collidingPt.intersectedMeshId;
-						int surfaceFaceId = collidingPt.closestSurfaceFaceId;
-						VBDBaseTetMesh* pTetMesh_intersecting = tMeshes[meshId_intersecting].get();
+	debugOperation(DEBUG_LVL_DEBUG, [&]() {
+		std::cout << numIslands << " contact islands, " << perTaskIslands.size() << " solved per task, "
+			<< numMeshesInColoredSweep << " meshes in the colored sweep\n";
+		});
+}
 
-						//std::cout << "surfaceFaceId " << surfaceFaceId << "\n";
+void GAIA::VBDPhysics::wakeUpDeformedMeshes()
+{
+	GAIA_PROFILE_SCOPE("wakeUpDeformedMeshes");
+	// the positions of a sleeping mesh stay at positionsPrev, only the deformers can change them
+	for (size_t iMesh = 0; iMesh < numTetMeshes(); iMesh++)
+	{
+		VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+		if (!pMesh->sleeping)
+		{
+			continue;
+		}
+		for (int vId : pMesh->pObjectParams->fixedPoints)
+		{
+			if (pMesh->vertex(vId) != pMesh->positionsPrev().col(vId))
+			{
+				wakeUpMesh(iMesh);
+				break;
+			}
+		}
+	}
+}
 
-						for (size_t iSurfaceFaceV = 0; iSurfaceFaceV < 3; iSurfaceFaceV++)
-						{
-							IdType faceVId = pTetMesh_intersecting->surfaceFacesTetMeshVIds()(iSurfaceFaceV, surfaceFaceId);
-							//std::cout << "collision mask of " << faceVId << " set to true\n";
-							CollisionRelationList& collisionRelation = getCollisionRelationList(meshId_intersecting, faceVId);
-							pTetMesh_intersecting->activeCollisionMask(faceVId) = true;
-							collisionRelation.emplace_back();
-							collisionRelation.back().meshId = iMesh;
-							collisionRelation.back().surfaceVertexId = iSurfaceV;
-							collisionRelation.back().collisionId = iIntersection;
-							collisionRelation.back().collisionType = 0;
-							collisionRelation.back().collisionVertexOrder = iSurfaceFaceV;
-						}
+void GAIA::VBDPhysics::wakeUpTouchedMeshes()
+{
+	GAIA_PROFILE_SCOPE("wakeUpTouchedMeshes");
+	// the sleeping meshes do not query collisions, so every active collision comes from an awake mesh
+	std::vector<IdType> wokenUpMeshes;
+	for (size_t iCol = 0; iCol < activeColllisionList.activeCollisions.size(); iCol++)
+	{
+		IdType meshId = activeColllisionList.activeCollisions[iCol].first;
+		IdType vertexId = activeColllisionList.activeCollisions[iCol].second;
+		VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(meshId, vertexId);
+		for (size_t iIntersection = 0; iIntersection < colResult.numIntersections(); iIntersection++)
+		{
+			const CollidingPointInfo& collidingPt = colResult.collidingPts[iIntersection];
+			if (collidingPt.shortestPathFound && tMeshes[collidingPt.intersectedMeshId]->sleeping)
+			{
+				wokenUpMeshes.push_back(collidingPt.intersectedMeshId);
+				wakeUpMesh(collidingPt.intersectedMeshId);
+			}
+		}
+	}
+
+	// they missed the initial step of this substep
+	auto initialStepHandler = [&](int iWokenUpMesh) {
+		VBDBaseTetMesh* pMesh = tMeshes[wokenUpMeshes[iWokenUpMesh]].get();
+		pMesh->evaluateExternalForce();
+		pMesh->applyInitialStep();
+	};
+	cpu_parallel_for(0, wokenUpMeshes.size(), initialStepHandler);
+}
+
+void GAIA::VBDPhysics::updateSleepingMeshes()
+{
+	GAIA_PROFILE_SCOPE("updateSleepingMeshes");
+	auto stillnessHandler = [&](int iMesh) {
+		VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+		if (!pMesh->activeForMaterialSolve)
+		{
+			return;
+		}
+		FloatingType kineticEnergy = 0.5f * (pMesh->velocities().colwise().squaredNorm().transpose().array() * pMesh->vertexMass.array()).sum();
+		FloatingType mass = pMesh->vertexMass.sum();
+		FloatingType displacement = sqrt((pMesh->positions() - pMesh->positionsPrev()).colwise().squaredNorm().maxCoeff());
+
+		if (kineticEnergy < physicsParams().sleepKineticEnergyThres * mass
+			&& pMesh->sleepWindowDisplacement + displacement < physicsParams().sleepDisplacementThres)
+		{
+			pMesh->numStillSubsteps++;
+			pMesh->sleepWindowDisplacement += displacement;
+		}
+		else
+		{
+			pMesh->numStillSubsteps = 0;
+			pMesh->sleepWindowDisplacement = 0.f;
+		}
+	};
+	cpu_parallel_for(0, numTetMeshes(), stillnessHandler);
+
+	// a contact island falls asleep as a whole, otherwise a mesh could sleep on top of a moving one
+	for (size_t iIsland = 0; iIsland < contactIslands.numIslands(); iIsland++)
+	{
+		const std::vector<IdType>& meshes = contactIslands.islandMeshes[iIsland];
+		bool allStill = true;
+		for (IdType iMesh : meshes)
+		{
+			allStill = allStill && tMeshes[iMesh]->activeForMaterialSolve && tMeshes[iMesh]->numStillSubsteps >= physicsParams().sleepWindowSubsteps;
+		}
+		if (allStill)
+		{
+			for (IdType iMesh : meshes)
+			{
+				putMeshToSleep(iMesh);
+			}
+		}
+	}
+
+	int numSleepingMeshes = 0;
+	for (size_t iMesh = 0; iMesh < numTetMeshes(); iMesh++)
+	{
+		numSleepingMeshes += tMeshes[iMesh]->sleeping;
+	}
+	timeStatistics().numSleepingMeshes = numSleepingMeshes;
+}
+
+void GAIA::VBDPhysics::putMeshToSleep(IdType iMesh)
+{
+	VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+	pMesh->sleeping = true;
+	pMesh->activeForMaterialSolve = false;
+	pMesh->velocities().setZero();
+	pMesh->velocitiesPrev().setZero();
+	pMesh->positionsPrev() = pMesh->positions();
+	pMesh->penetratedMask.setZero();
+	for (VBDCollisionDetectionResult& colResult : collisionResultsAll[iMesh])
+	{
+		colResult.clear();
+	}
+	pMesh->numStillSubsteps = 0;
+	pMesh->sleepWindowDisplacement = 0.f;
+	timeStatistics().numMeshesFellAsleep++;
+	debugOperation(DEBUG_LVL_DEBUG, [&]() {
+		std::cout << "Mesh " << iMesh << " fell asleep\n";
+		});
+}
+
+void GAIA::VBDPhysics::wakeUpMesh(IdType iMesh)
+{
+	VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+	if (!pMesh->sleeping)
+	{
+		return;
+	}
+	pMesh->sleeping = false;
+	pMesh->activeForMaterialSolve = true;
+	pMesh->numStillSubsteps = 0;
+	pMesh->sleepWindowDisplacement = 0.f;
+	timeStatistics().numMeshesWokenUp++;
+	debugOperation(DEBUG_LVL_DEBUG, [&]() {
+		std::cout << "Mesh " << iMesh << " woke up\n";
+		});
+}
+
+int GAIA::VBDPhysics::solveIslandAllIterations(IdType iIsland)
+{
+	const std::vector<IdType>& meshes = contactIslands.islandMeshes[iIsland];
+	const std::vector<std::vector<IdType>>& islandCollisions = islandCollisionsEachParallelGroup[iIsland];
+	// the island has its own Chebyshev sequence, it is solved within this task
+	FloatingType acceleratorOmega = 1.f;
+	if (physicsParams().useAccelerator)
+	{
+		for (IdType iMesh : meshes)
+		{
+			recordInitialPositionForAcceleratorCPU(iMesh);
+		}
+	}
+	for (int iIterIsland = 0; iIterIsland < islandIterations[iIsland]; iIterIsland++)
+	{
+		bool apply_friction = iIterIsland >= physicsParams().frictionStartIter;
+		FloatingType maxStep = 0.f;
+		// the same order as the colored sweep, so the collision infos are updated right before the group of their vertex
+		for (size_t iGroup = 0; iGroup < vertexParallelGroups.size(); iGroup++)
+		{
+			for (size_t iCollision = 0; iCollision < islandCollisions[iGroup].size() / 2; iCollision++)
+			{
+				updateCollisionInfo(getCollisionDetectionResultFromTetMeshId(islandCollisions[iGroup][iCollision * 2],
+					islandCollisions[iGroup][iCollision * 2 + 1]));
+			}
+
+			for (IdType iMesh : meshes)
+			{
+				IdType iColor = meshColorOfParallelGroup[iMesh][iGroup];
+				if (iColor == -1)
+				{
+					continue;
+				}
+				VBDTetMeshNeoHookean* pMesh = (VBDTetMeshNeoHookean*)tMeshes[iMesh].get();
+				for (int32_t vId : pMesh->verticesColoringCategories()[iColor])
+				{
+					if (!pMesh->fixedMask[vId])
+					{
+						maxStep = std::max(maxStep, VBDStepWithCollision(pMesh, iMesh, vId, apply_friction));
 					}
 				}
 			}
 		}
+
+		if (iterationsConverged(iIterIsland + 1, maxStep))
+		{
+			return iIterIsland + 1;
+		}
+
+		if (physicsParams().useAccelerator)
+		{
+			acceleratorOmega = getAcceleratorOmega(iIterIsland + 1, physicsParams().acceleratorRho, acceleratorOmega);
+			for (IdType iMesh : meshes)
+			{
+				applyAcceleratorCPU(iMesh, acceleratorOmega, false);
+			}
+		}
 	}
+	return islandIterations[iIsland];
+}
+
+bool GAIA::VBDPhysics::iterationsConverged(int numIterationsRun, FloatingType maxStep)
+{
+	return physicsParams().adaptiveIterations && numIterationsRun >= physicsParams().adaptiveIterationsMin
+		&& maxStep < physicsParams().convergenceAvgNormThres * physicsParams().dt;
+}
+
+void GAIA::VBDPhysics::prepareCollisionDataCPU()
+{
+	GAIA_PROFILE_SCOPE("prepareCollisionDataCPU");
+	// record the activate collisions
+	activeColllisionList.clear();
+	activeColllisionList.buildFromCollisionResults(collisionResultsAll);
+
 	// std::cout << "-------------------------------------\n";
 	//for (size_t iCol = 0; iCol < activeColllisionList.activeCollisions.size(); iCol++)
 	//{
@@ -1822,12 +2258,11 @@ void GAIA::VBDPhysics::prepareCollisionDataCPU()
 	//		std::cout << "active collision: " << iMesh << ", " << vId << "\n";
 	//	}
 	//}
-	//std::cout << "numActiveDCD: "  << numActiveDCD << "\n";
-	//std::cout << "numActiveCCD: "  << numActiveCCD << "\n";
 }
 
 void GAIA::VBDPhysics::prepareCollisionDataGPU()
 {
+	GAIA_PROFILE_SCOPE("prepareCollisionDataGPU");
 	// clear the collision relations
 	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 	{
@@ -1974,6 +2409,7 @@ void GAIA::VBDPhysics::prepareCollisionDataGPU()
 
 void GAIA::VBDPhysics::dcd()
 {
+	GAIA_PROFILE_SCOPE("dcd");
 	TICK(timeCsmpUpdatingCollisionInfoDCD);
 	if (collisionParams().allowDCD)
 	{
@@ -1985,24 +2421,40 @@ void GAIA::VBDPhysics::dcd()
 
 		// DCD
 		TICK(timeCsmpColDetectDCD);
+		TICK(timeDCDQueries);
+		bool useBroadPhase = collisionParams().meshBroadPhase;
+		if (useBroadPhase)
+		{
+			meshBroadPhase.update(false, collisionParams().handleSelfCollision);
+		}
 		for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 		{
 			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
 			std::vector<VBDCollisionDetectionResult>& collisionResults = collisionResultsAll[iMesh];
-			if (!pTetMesh->activeForCollision)
+			if (!pTetMesh->activeForCollision || pTetMesh->sleeping)
 			{
 				continue;
 			}
 			pTetMesh->penetratedMask.setZero();
+			if (useBroadPhase && !meshBroadPhase.meshHasPartner(iMesh))
+			{
+				for (VBDCollisionDetectionResult& colResult : collisionResults)
+				{
+					colResult.clear();
+				}
+				continue;
+			}
 
 			//cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), [&](int iSurfaceV) {
                         auto surfaceHandler = [&](int iSurfaceV) {
 					int32_t surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
-					if (pTetMesh->vertex(surfaceVIdTetMesh)[GRAVITY_AXIS] < physicsParams().collisionOffHeight
+					VBDCollisionDetectionResult& colResult = collisionResults[iSurfaceV];
+					// a penetrating vertex is inside the AABB of the mesh it penetrates
+					if (!useBroadPhase
+						|| meshBroadPhase.overlapsPartner(iMesh, pTetMesh->vertex(surfaceVIdTetMesh), pTetMesh->vertex(surfaceVIdTetMesh))
 						// && !pTetMesh->penetratedMask(surfaceVIdTetMesh))
 						)
 					{
-						VBDCollisionDetectionResult& colResult = collisionResults[iSurfaceV];
 						pDCD->vertexCollisionDetection(surfaceVIdTetMesh, iMesh, &colResult);
 						if (colResult.numIntersections())
 						{
@@ -2024,10 +2476,26 @@ void GAIA::VBDPhysics::dcd()
 							//	<< "]\n";
 						}
 					}
+					else
+					{
+						colResult.clear();
+					}
 
 				};
                         cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), surfaceHandler);
 		}
+		double timeDCDQueries = 0;
+		TOCK(timeDCDQueries);
+		pDCD->recordQueryTime(timeDCDQueries);
+		if (physicsParams().doStatistics)
+		{
+			DCDCoherenceStatistics coherenceStatistics = pDCD->coherenceStatistics();
+			timeStatistics().numDCDCoherentTetQueries += coherenceStatistics.numTetQueries;
+			timeStatistics().numDCDCoherentTetHits += coherenceStatistics.numTetHits;
+			timeStatistics().numDCDCoherentFaceQueries += coherenceStatistics.numFaceQueries;
+			timeStatistics().numDCDCoherentFaceHits += coherenceStatistics.numFaceHits;
+			pDCD->resetCoherenceStatistics();
+		}
 		TOCK_STRUCT(timeStatistics(), timeCsmpColDetectDCD);
 	}
 	else if (collisionParams().allowCCD)
@@ -2052,6 +2520,7 @@ void GAIA::VBDPhysics::dcd()
 
 void GAIA::VBDPhysics::intermediateDCD()
 {
+	GAIA_PROFILE_SCOPE("intermediateDCD");
 	TICK(timeCsmpUpdatingCollisionInfoDCD);
 	if (collisionParams().allowDCD)
 	{
@@ -2063,11 +2532,17 @@ void GAIA::VBDPhysics::intermediateDCD()
 
 		// DCD
 		TICK(timeCsmpColDetectDCD);
+		TICK(timeDCDQueries);
+		bool useBroadPhase = collisionParams().meshBroadPhase;
+		if (useBroadPhase)
+		{
+			meshBroadPhase.update(false, collisionParams().handleSelfCollision);
+		}
 		for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 		{
 			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
 			std::vector<VBDCollisionDetectionResult>& collisionResults = collisionResultsAll[iMesh];
-			if (!pTetMesh->activeForCollision)
+			if (!pTetMesh->activeForCollision || pTetMesh->sleeping)
 			{
 				continue;
 			}
@@ -2078,6 +2553,12 @@ void GAIA::VBDPhysics::intermediateDCD()
 						|| !collisionParams().allowCCD)
 					{
 						VBDCollisionDetectionResult& colResult = collisionResults[iSurfaceV];
+						if (useBroadPhase
+							&& !meshBroadPhase.overlapsPartner(iMesh, pTetMesh->vertex(surfaceVIdTetMesh), pTetMesh->vertex(surfaceVIdTetMesh)))
+						{
+							colResult.clear();
+							return;
+						}
 						pDCD->vertexCollisionDetection(surfaceVIdTetMesh, iMesh, &colResult);
 						if (colResult.numIntersections())
 						{
@@ -2089,6 +2570,18 @@ void GAIA::VBDPhysics::intermediateDCD()
 				};
                         cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), intermediateDCDHandler);
 		}
+		double timeDCDQueries = 0;
+		TOCK(timeDCDQueries);
+		pDCD->recordQueryTime(timeDCDQueries);
+		if (physicsParams().doStatistics)
+		{
+			DCDCoherenceStatistics coherenceStatistics = pDCD->coherenceStatistics();
+			timeStatistics().numDCDCoherentTetQueries += coherenceStatistics.numTetQueries;
+			timeStatistics().numDCDCoherentTetHits += coherenceStatistics.numTetHits;
+			timeStatistics().numDCDCoherentFaceQueries += coherenceStatistics.numFaceQueries;
+			timeStatistics().numDCDCoherentFaceHits += coherenceStatistics.numFaceHits;
+			pDCD->resetCoherenceStatistics();
+		}
 		TOCK_STRUCT(timeStatistics(), timeCsmpColDetectDCD);
 	}
 
@@ -2097,6 +2590,7 @@ void GAIA::VBDPhysics::intermediateDCD()
 
 void GAIA::VBDPhysics::ccd()
 {
+	GAIA_PROFILE_SCOPE("ccd");
 	TICK(timeCsmpUpdatingCollisionInfoCCD);
 	if (collisionParams().allowCCD)
 	{
@@ -2105,25 +2599,59 @@ void GAIA::VBDPhysics::ccd()
 		updateCCDBVH(rebuildCCDBVH);
 		TOCK_STRUCT(timeStatistics(), timeCsmpUpdatingBVHCCD);
 
+		TICK(timeCCDQueries);
+		if (collisionParams().ccdBatchVertexFace)
+		{
+			batchVertexFaceCCD();
+			edgeEdgeCCD();
+			double timeCCDQueries = 0;
+			TOCK(timeCCDQueries);
+			pCCD->recordQueryTime(timeCCDQueries);
+			TOCK_STRUCT(timeStatistics(), timeCsmpUpdatingCollisionInfoCCD);
+			return;
+		}
+		bool useBroadPhase = collisionParams().meshBroadPhase;
+		if (useBroadPhase)
+		{
+			meshBroadPhase.update(true, collisionParams().handleSelfCollision);
+		}
 		for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 		{
 			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
 			std::vector<VBDCollisionDetectionResult>& collisionResults = collisionResultsAll[iMesh];
-			if (!pTetMesh->activeForCollision)
+			if (!pTetMesh->activeForCollision || pTetMesh->sleeping)
+			{
+				continue;
+			}
+			if (useBroadPhase && !meshBroadPhase.meshHasPartner(iMesh))
 			{
+				// keep the DCD results of the penetrated vertices, as the CCD would
+				for (int iSurfaceV = 0; iSurfaceV < pTetMesh->surfaceVIds().size(); iSurfaceV++)
+				{
+					if (!pTetMesh->penetratedMask(pTetMesh->surfaceVIds()(iSurfaceV)))
+					{
+						collisionResults[iSurfaceV].clear();
+					}
+				}
 				continue;
 			}
 			TICK(timeCsmpColDetectCCD);
                         //			cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), [&](int iSurfaceV) {
                         auto ccdHandler = [&](int iSurfaceV) {
 					VBDCollisionDetectionResult& colResult = collisionResults[iSurfaceV];
-					// if not already penetrated use ccd
 					int32_t surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
-					if (
-						pTetMesh->vertex(surfaceVIdTetMesh)[GRAVITY_AXIS] < physicsParams().collisionOffHeight
-						&& !pTetMesh->penetratedMask(surfaceVIdTetMesh)
-						)
+					// if not already penetrated use ccd
+					if (!pTetMesh->penetratedMask(surfaceVIdTetMesh))
 					{
+						// the trajectory of a colliding vertex overlaps the swept AABB of the mesh it hits
+						if (useBroadPhase
+							&& !meshBroadPhase.overlapsPartner(iMesh,
+								pTetMesh->vertex(surfaceVIdTetMesh).cwiseMin(pTetMesh->vertexPrevPos(surfaceVIdTetMesh)),
+								pTetMesh->vertex(surfaceVIdTetMesh).cwiseMax(pTetMesh->vertexPrevPos(surfaceVIdTetMesh))))
+						{
+							colResult.clear();
+							return;
+						}
 						pCCD->vertexContinuousCollisionDetection(surfaceVIdTetMesh, iMesh, &colResult);
 
 					}
@@ -2131,12 +2659,17 @@ void GAIA::VBDPhysics::ccd()
                         cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), ccdHandler);
 			TOCK_STRUCT(timeStatistics(), timeCsmpColDetectCCD);
 		}
+		edgeEdgeCCD();
+		double timeCCDQueries = 0;
+		TOCK(timeCCDQueries);
+		pCCD->recordQueryTime(timeCCDQueries);
 	}
 	TOCK_STRUCT(timeStatistics(), timeCsmpUpdatingCollisionInfoCCD);
 }
 
 void GAIA::VBDPhysics::intermediateCCD()
 {
+	GAIA_PROFILE_SCOPE("intermediateCCD");
 	TICK(timeCsmpUpdatingCollisionInfoCCD);
 	if (collisionParams().allowCCD)
 	{
@@ -2145,12 +2678,40 @@ void GAIA::VBDPhysics::intermediateCCD()
 		updateCCDBVH(rebuildCCDBVH);
 		TOCK_STRUCT(timeStatistics(), timeCsmpUpdatingBVHCCD);
 
+		TICK(timeCCDQueries);
+		if (collisionParams().ccdBatchVertexFace)
+		{
+			batchVertexFaceCCD();
+			edgeEdgeCCD();
+			double timeCCDQueries = 0;
+			TOCK(timeCCDQueries);
+			pCCD->recordQueryTime(timeCCDQueries);
+			TOCK_STRUCT(timeStatistics(), timeCsmpUpdatingCollisionInfoCCD);
+			return;
+		}
+		bool useBroadPhase = collisionParams().meshBroadPhase;
+		if (useBroadPhase)
+		{
+			meshBroadPhase.update(true, collisionParams().handleSelfCollision);
+		}
 		for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 		{
 			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
 			std::vector<VBDCollisionDetectionResult>& collisionResults = collisionResultsAll[iMesh];
-			if (!pTetMesh->activeForCollision)
+			if (!pTetMesh->activeForCollision || pTetMesh->sleeping)
+			{
+				continue;
+			}
+			if (useBroadPhase && !meshBroadPhase.meshHasPartner(iMesh))
 			{
+				// keep the DCD results of the penetrated vertices, as the CCD would
+				for (int iSurfaceV = 0; iSurfaceV < pTetMesh->surfaceVIds().size(); iSurfaceV++)
+				{
+					if (!pTetMesh->penetratedMask(pTetMesh->surfaceVIds()(iSurfaceV)))
+					{
+						collisionResults[iSurfaceV].clear();
+					}
+				}
 				continue;
 			}
 			TICK(timeCsmpColDetectCCD);
@@ -2159,11 +2720,17 @@ void GAIA::VBDPhysics::intermediateCCD()
 					VBDCollisionDetectionResult& colResult = collisionResults[iSurfaceV];
 					int32_t surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
 					// if not already penetrated use ccd
-					if (
-						pTetMesh->vertex(surfaceVIdTetMesh)[GRAVITY_AXIS] < physicsParams().collisionOffHeight
-						&& !pTetMesh->penetratedMask(surfaceVIdTetMesh)
-						)
+					if (!pTetMesh->penetratedMask(surfaceVIdTetMesh))
 					{
+						// the trajectory of a colliding vertex overlaps the swept AABB of the mesh it hits
+						if (useBroadPhase
+							&& !meshBroadPhase.overlapsPartner(iMesh,
+								pTetMesh->vertex(surfaceVIdTetMesh).cwiseMin(pTetMesh->vertexPrevPos(surfaceVIdTetMesh)),
+								pTetMesh->vertex(surfaceVIdTetMesh).cwiseMax(pTetMesh->vertexPrevPos(surfaceVIdTetMesh))))
+						{
+							colResult.clear();
+							return;
+						}
 						pCCD->vertexContinuousCollisionDetection(surfaceVIdTetMesh, iMesh, &colResult);
 
 					}
@@ -2171,12 +2738,146 @@ void GAIA::VBDPhysics::intermediateCCD()
                         cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), intermediateCCDHandler);
 			TOCK_STRUCT(timeStatistics(), timeCsmpColDetectCCD);
 		}
+		edgeEdgeCCD();
+		double timeCCDQueries = 0;
+		TOCK(timeCCDQueries);
+		pCCD->recordQueryTime(timeCCDQueries);
 	}
 	TOCK_STRUCT(timeStatistics(), timeCsmpUpdatingCollisionInfoCCD);
 }
 
+void GAIA::VBDPhysics::batchVertexFaceCCD()
+{
+	GAIA_PROFILE_SCOPE("batchVertexFaceCCD");
+	TICK(timeCsmpColDetectCCD);
+	TICK(timeBatchCCD);
+	// the vertices of the active meshes that are not penetrated get the CCD results, like the point query version
+	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+	{
+		VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
+		std::vector<VBDCollisionDetectionResult>& collisionResults = collisionResultsAll[iMesh];
+		if (!pTetMesh->activeForCollision || pTetMesh->sleeping)
+		{
+			continue;
+		}
+		auto clearCCDResults = [&](int iSurfaceV) {
+			int32_t surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
+			if (!pTetMesh->penetratedMask(surfaceVIdTetMesh))
+			{
+				pCCD->clearVertexResult(surfaceVIdTetMesh, iMesh, &collisionResults[iSurfaceV]);
+			}
+		};
+		cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), clearCCDResults);
+	}
+
+	pCCD->vertexFaceContinuousCollisionDetection();
+
+	// the collisions are sorted by vertex, the task starting the run of a vertex owns its collision result
+	const std::vector<uint64_t>& vfCollisionKeys = pCCD->vfCollisionKeys;
+	auto vertexCollisionsHandler = [&](int iKey) {
+		const uint64_t globalVId = vfCollisionKeys[iKey] >> 32;
+		if (iKey > 0 && (vfCollisionKeys[iKey - 1] >> 32) == globalVId)
+		{
+			return;
+		}
+		const VFCollision& firstCollision = pCCD->vfCollisionResults.collisions[vfCollisionKeys[iKey] & 0xFFFFFFFF];
+		VBDBaseTetMesh* pTetMesh = tMeshes[firstCollision.vertexMeshId].get();
+		if (!pTetMesh->activeForCollision || pTetMesh->sleeping || pTetMesh->penetratedMask(firstCollision.vertexId))
+		{
+			return;
+		}
+		VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(firstCollision.vertexMeshId, firstCollision.vertexId);
+		for (size_t iRun = iKey; iRun < vfCollisionKeys.size() && (vfCollisionKeys[iRun] >> 32) == globalVId; iRun++)
+		{
+			const VFCollision& vfCollision = pCCD->vfCollisionResults.collisions[vfCollisionKeys[iRun] & 0xFFFFFFFF];
+			pCCD->updateVertexFaceCollision(&colResult, vfCollision.faceMeshId, vfCollision.faceId, vfCollision.t, vfCollision.barycentrics);
+		}
+	};
+	cpu_parallel_for(0, vfCollisionKeys.size(), vertexCollisionsHandler);
+	double timeBatchCCD = 0;
+	TOCK(timeBatchCCD);
+
+	if (collisionParams().ccdBatchBenchmark)
+	{
+		// rerun the same vertices with the point queries, into scratch results
+		TICK(timePointQueryCCD);
+		std::atomic<int> numMismatches = 0;
+		std::atomic<int> numCollidingVerts = 0;
+		for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
+		{
+			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
+			std::vector<VBDCollisionDetectionResult>& collisionResults = collisionResultsAll[iMesh];
+			if (!pTetMesh->activeForCollision || pTetMesh->sleeping)
+			{
+				continue;
+			}
+			auto pointQueryCCDHandler = [&](int iSurfaceV) {
+				int32_t surfaceVIdTetMesh = pTetMesh->surfaceVIds()(iSurfaceV);
+				if (pTetMesh->penetratedMask(surfaceVIdTetMesh))
+				{
+					return;
+				}
+				CollisionDetectionResult pointQueryResult;
+				pCCD->vertexContinuousCollisionDetection(surfaceVIdTetMesh, iMesh, &pointQueryResult);
+				CollisionDetectionResult& batchResult = collisionResults[iSurfaceV];
+				if (pointQueryResult.numIntersections())
+				{
+					numCollidingVerts++;
+				}
+				if (pointQueryResult.numIntersections() != batchResult.numIntersections()
+					|| (batchResult.numIntersections() 
+						&& (pointQueryResult.collidingPts[0].closestSurfaceFaceId != batchResult.collidingPts[0].closestSurfaceFaceId
+						|| pointQueryResult.collidingPts[0].intersectedMeshId != batchResult.collidingPts[0].intersectedMeshId)))
+				{
+					numMismatches++;
+				}
+			};
+			cpu_parallel_for(0, pTetMesh->surfaceVIds().size(), pointQueryCCDHandler);
+		}
+		double timePointQueryCCD = 0;
+		TOCK(timePointQueryCCD);
+		std::cout << "[CCD] batched v-f CCD: " << timeBatchCCD << "ms, " << pCCD->vfCollisionKeys.size() << " collisions"
+			<< " | point query v-f CCD: " << timePointQueryCCD << "ms, " << numCollidingVerts << " colliding vertices"
+			<< " | vertices with different results: " << numMismatches << "\n";
+	}
+	TOCK_STRUCT(timeStatistics(), timeCsmpColDetectCCD);
+}
+
+void GAIA::VBDPhysics::edgeEdgeCCD()
+{
+	if (!collisionParams().doEdgeEdgeCCD)
+	{
+		return;
+	}
+	GAIA_PROFILE_SCOPE("edgeEdgeCCD");
+	TICK(timeCsmpColDetectCCD);
+	pCCD->edgeEdgeContinuousCollisionDetection();
+
+	// serial, since the e-e collisions of a vertex need to be compared to each other; there are usually only a few of them
+	const size_t numEECollisions = std::min(size_t(pCCD->eeCollisionResults.numCollisions), pCCD->eeCollisionResults.collisions.size());
+	for (size_t iEECollision = 0; iEECollision < numEECollisions; iEECollision++)
+	{
+		const EECollision& eeCollision = pCCD->eeCollisionResults.collisions[iEECollision];
+		for (int iSide = 0; iSide < 2; iSide++)
+		{
+			int32_t vId, iMesh;
+			pCCD->getEdgeEdgeCollisionVertex(eeCollision, iSide, vId, iMesh);
+			VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
+			// the penetrated vertices keep their DCD results, as in the v-f CCD
+			if (!pTetMesh->activeForCollision || pTetMesh->sleeping || pTetMesh->penetratedMask(vId))
+			{
+				continue;
+			}
+			VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(iMesh, vId);
+			pCCD->edgeEdgeCollisionToVertexFace(eeCollision, iSide, &colResult);
+		}
+	}
+	TOCK_STRUCT(timeStatistics(), timeCsmpColDetectCCD);
+}
+
 void GAIA::VBDPhysics::intermediateCollisionDetection()
 {
+	GAIA_PROFILE_SCOPE("intermediateCollisionDetection");
 	if (physicsParams().useGPU) {
 		syncAllToCPUVertPosOnly(true);
 	}
@@ -2193,6 +2894,12 @@ void GAIA::VBDPhysics::intermediateCollisionDetection()
 
 void GAIA::VBDPhysics::updateDCDBVH(bool rebuildTetMeshScene, bool rebuildSurfaceScene)
 {
+	GAIA_PROFILE_SCOPE("updateDCDBVH");
+	if (collisionParams().adaptiveBVHRebuild)
+	{
+		pDCD->updateBVHAdaptive(true);
+		return;
+	}
 	RTCBuildQuality tetSceneQuality = rebuildTetMeshScene ? RTC_BUILD_QUALITY_LOW : RTC_BUILD_QUALITY_REFIT;
 	RTCBuildQuality surfaceSceneQuality = rebuildSurfaceScene ? RTC_BUILD_QUALITY_LOW : RTC_BUILD_QUALITY_REFIT;
 	pDCD->updateBVH(tetSceneQuality, surfaceSceneQuality, true);
@@ -2200,14 +2907,23 @@ void GAIA::VBDPhysics::updateDCDBVH(bool rebuildTetMeshScene, bool rebuildSurfac
 
 void GAIA::VBDPhysics::updateCCDBVH(bool rebuildScene)
 {
+	GAIA_PROFILE_SCOPE("updateCCDBVH");
 	TICK(timeCsmpUpdatingBVHCCD);
-	RTCBuildQuality sceneQuality = rebuildScene ? RTC_BUILD_QUALITY_LOW : RTC_BUILD_QUALITY_REFIT;
-	pCCD->updateBVH(sceneQuality);
+	if (collisionParams().adaptiveBVHRebuild)
+	{
+		pCCD->updateBVHAdaptive();
+	}
+	else
+	{
+		RTCBuildQuality sceneQuality = rebuildScene ? RTC_BUILD_QUALITY_LOW : RTC_BUILD_QUALITY_REFIT;
+		pCCD->updateBVH(sceneQuality);
+	}
 	TOCK_STRUCT(timeStatistics(), timeCsmpUpdatingBVHCCD);
 }
 
 void GAIA::VBDPhysics::updateAllCollisionInfos()
 {
+	GAIA_PROFILE_SCOPE("updateAllCollisionInfos");
 	for (size_t iMesh = 0; iMesh < numTetMeshes(); iMesh++)
 	{
 		VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
@@ -2331,8 +3047,10 @@ void GAIA::VBDPhysics::updateCollisionInfo(VBDCollisionDetectionResult& collisio
 	}
 }
 
-void GAIA::VBDPhysics::solveCollisionsSequentially()
+FloatingType GAIA::VBDPhysics::solveCollisionsSequentially()
 {
+	GAIA_PROFILE_SCOPE("solveCollisionsSequentially");
+	FloatingType maxStep = 0.f;
 	for (size_t iMesh = 0; iMesh < basetetMeshes.size(); iMesh++)
 	{
 		VBDBaseTetMesh* pTetMesh = tMeshes[iMesh].get();
@@ -2341,14 +3059,33 @@ void GAIA::VBDPhysics::solveCollisionsSequentially()
 			if (pTetMesh->activeCollisionMask[iV] && pTetMesh->activeForMaterialSolve)
 			{
 				updateCollisionInfo(getCollisionDetectionResultFromTetMeshId(iMesh, iV));
-				VBDStepWithCollision(pTetMesh, iMesh, iV);
+				maxStep = std::max(maxStep, VBDStepWithCollision(pTetMesh, iMesh, iV));
 			}
 		}
 	}
+	return maxStep;
+}
 
+void GAIA::VBDPhysics::accumlateMaterialForceAndHessian(VBDTetMeshNeoHookean* pMesh, IdType meshId, IdType vertexId, Vec3& force, Mat3& hessian)
+{
+	if (physicsParams().usePackedTetData)
+	{
+		pMesh->accumlateMaterialForceAndHessian2Packed(vertexId, packedTetData, packedTetData.getVertexRecord(meshId, vertexId), force, hessian);
+	}
+	else if (physicsParams().useSIMDMaterialKernel)
+	{
+		pMesh->accumlateMaterialForceAndHessian2SIMD(vertexId, force, hessian);
+		debugOperation(DEBUG_LVL_DEBUG, [&]() {
+			pMesh->validateMaterialForceAndHessianSIMD(vertexId);
+			});
+	}
+	else
+	{
+		pMesh->accumlateMaterialForceAndHessian2(vertexId, force, hessian);
+	}
 }
 
-void GAIA::VBDPhysics::VBDStep(TetMeshFEM* pMesh_, IdType vertexId)
+void GAIA::VBDPhysics::VBDStep(TetMeshFEM* pMesh_, IdType meshId, IdType vertexId)
 {
 
 	VBDTetMeshNeoHookean* pMesh = (VBDTetMeshNeoHookean*)pMesh_;
@@ -2366,7 +3103,7 @@ void GAIA::VBDPhysics::VBDStep(TetMeshFEM* pMesh_, IdType vertexId)
 	//printf("h: ");
 	//CuMatrix::printMat3(h.data());
 	Mat3 tmp_h = h;
-	pMesh->accumlateMaterialForceAndHessian2(vertexId, force, h);
+	accumlateMaterialForceAndHessian(pMesh, meshId, vertexId, force, h);
 	Mat3 K = h - tmp_h;
 	// CuMatrix::printMat3(K.data());
 	accumlateDampingForceAndHessian(pMesh, vertexId, force, h, K);
@@ -2376,7 +3113,7 @@ void GAIA::VBDPhysics::VBDStep(TetMeshFEM* pMesh_, IdType vertexId)
 	//printf("h: ");
 	//CuMatrix::printMat3(h.data());
 
-	accumlateBoundaryForceAndHessian(pMesh, 0, vertexId, force, h);
+	accumlateBoundaryForceAndHessian(pMesh, meshId, vertexId, force, h);
 	//accum
 	// add external force
 	force += pMesh->vertexExternalForces.col(vertexId);
@@ -2420,16 +3157,17 @@ void GAIA::VBDPhysics::VBDStep(TetMeshFEM* pMesh_, IdType vertexId)
 	}
 }
 
-void GAIA::VBDPhysics::VBDStepWithCollision(TetMeshFEM* pMesh_, IdType meshId, IdType vertexId, bool apply_friction)
+FloatingType GAIA::VBDPhysics::VBDStepWithCollision(TetMeshFEM* pMesh_, IdType meshId, IdType vertexId, bool apply_friction)
 {
 	VBDTetMeshNeoHookean* pMesh = (VBDTetMeshNeoHookean*)pMesh_;
+	const Vec3 positionBeforeStep = pMesh->vertex(vertexId);
 
 	Mat3 h;
 	Vec3 force;
 	h.setZero();
 	force.setZero();
 
-	pMesh->accumlateMaterialForceAndHessian2(vertexId, force, h);
+	accumlateMaterialForceAndHessian(pMesh, meshId, vertexId, force, h);
 	debugOperation(DEBUG_LVL_DEBUG_VEBOSE, [&]() {
 		MaterialForce[meshId].col(vertexId) += force;
 		});
@@ -2501,11 +3239,13 @@ void GAIA::VBDPhysics::VBDStepWithCollision(TetMeshFEM* pMesh_, IdType meshId, I
 		pMesh->vertex(vertexId) += stepSize * descentDirection;
 #endif // LOCAL_LINE_SEARCH
 	}
+	return (pMesh->vertex(vertexId) - positionBeforeStep).norm();
 }
 
 
 void GAIA::VBDPhysics::updateVelocities()
 {
+	GAIA_PROFILE_SCOPE("updateVelocities");
 	// updateAllCollisionInfos();
 	for (size_t iMesh = 0; iMesh < numTetMeshes(); iMesh++)
 	{
@@ -2528,11 +3268,14 @@ void GAIA::VBDPhysics::updateVelocities()
 
 }
 
+#ifndef GAIA_NO_CUDA
 void GAIA::VBDPhysics::updateVelocitiesGPU()
 {
+	GAIA_PROFILE_SCOPE("updateVelocitiesGPU");
 	VBDUpdateVelocityGPU(getVBDPhysicsDataGPU(), vertexAllParallelGroupsBuffer->getGPUBuffer(), numAllVertices,
 		physicsParams().numThreadsVBDSolve, cudaStream);
 }
+#endif // !GAIA_NO_CUDA
 
 void GAIA::VBDPhysics::updateVelocity(TetMeshFEM* pMesh, IdType vertexId)
 {
@@ -3220,6 +3963,7 @@ ObjectParams::SharedPtr GAIA::ObjectParamsListVBD::createObjectParam(const std::
 
 void GAIA::VBDPhysics::prepareCollisionDataCPUAndGPU()
 {
+	GAIA_PROFILE_SCOPE("prepareCollisionDataCPUAndGPU");
 	// clear the collision relations
 	for (int iMesh = 0; iMesh < tMeshes.size(); iMesh++)
 	{
@@ -3482,6 +4226,7 @@ void GAIA::VBDPhysics::clearForces()
 
 void GAIA::VBDPhysics::evaluateConvergence()
 {
+	GAIA_PROFILE_SCOPE("evaluateConvergence");
 	NFloatingType e = 0.f;
 	NFloatingType eInertia = 0.f;
 	NFloatingType eElastic = 0.f;
@@ -3533,8 +4278,10 @@ void GAIA::VBDPhysics::evaluateConvergence()
 	}
 }
 
+#ifndef GAIA_NO_CUDA
 void GAIA::VBDPhysics::evaluateConvergenceGPU()
 {
+	GAIA_PROFILE_SCOPE("evaluateConvergenceGPU");
 	FloatingType e = 0.f;
 	FloatingType eInertia = 0.f;
 	FloatingType eElastic = 0.f;
@@ -3582,6 +4329,7 @@ void GAIA::VBDPhysics::evaluateConvergenceGPU()
 		stats.writeToJsonFile(outFile);
 	}
 }
+#endif // !GAIA_NO_CUDA
 
 FloatingType GAIA::VBDPhysics::getAcceleratorOmega(int order, CFloatingType pho, CFloatingType prevOmega)
 {
@@ -3635,8 +4383,45 @@ void GAIA::VBDPhysics::recordPrevIterPositionsAccelerator(bool sync)
 	}
 }
 
+void GAIA::VBDPhysics::recordInitialPositionForAcceleratorCPU(IdType iMesh)
+{
+	VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+	// both are written so the first pass, with omega == 1, never reads an uninitialized buffer
+	pMesh->positionsPrevPrevIterAccelerator = pMesh->mVertPos;
+	pMesh->positionsPrevIterAccelerator = pMesh->mVertPos;
+}
+
+void GAIA::VBDPhysics::applyAcceleratorCPU(IdType iMesh, FloatingType omega, bool parallel)
+{
+	VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+	auto accelerateVertex = [&](int vId) {
+		// the vertices with active collisions are not accelerated, as on the GPU
+		if (omega != 1.f && !pMesh->fixedMask[vId] && !pMesh->activeCollisionMask[vId])
+		{
+			// y_k+1_accelerated = (y_k+1 - y_k-1) * omega +  y_k-1
+			pMesh->vertex(vId) = pMesh->positionsPrevPrevIterAccelerator.col(vId)
+				+ omega * (pMesh->vertex(vId) - pMesh->positionsPrevPrevIterAccelerator.col(vId));
+		}
+		// y_k-1 is not needed anymore, its buffer takes y_k+1 and becomes the previous iteration after the swap
+		pMesh->positionsPrevPrevIterAccelerator.col(vId) = pMesh->vertex(vId);
+	};
+	if (parallel)
+	{
+		cpu_parallel_for(0, pMesh->numVertices(), accelerateVertex);
+	}
+	else
+	{
+		for (int vId = 0; vId < pMesh->numVertices(); vId++)
+		{
+			accelerateVertex(vId);
+		}
+	}
+	pMesh->positionsPrevPrevIterAccelerator.swap(pMesh->positionsPrevIterAccelerator);
+}
+
 void GAIA::VBDPhysics::computeElasticForceHessian()
 {
+	GAIA_PROFILE_SCOPE("computeElasticForceHessian");
 	auto energyIter = &pNewtonAssembler->elasticEnergy[0];
 	auto forceIter = &pNewtonAssembler->elasticForce[0];
 	auto hessianIter = &pNewtonAssembler->elasticHessian[0];
@@ -3675,6 +4460,7 @@ void GAIA::VBDPhysics::computeElasticForceHessian()
 
 void GAIA::VBDPhysics::computeElasticEnergy()
 {
+	GAIA_PROFILE_SCOPE("computeElasticEnergy");
 	auto energyIter = &pNewtonAssembler->elasticEnergy[0];
 	for (size_t iMesh = 0; iMesh < numTetMeshes(); iMesh++)
 	{
@@ -3688,15 +4474,21 @@ void GAIA::VBDPhysics::computeElasticEnergy()
 	}
 }
 
-void GAIA::VBDPhysics::fillNewtonSystem()
+void GAIA::VBDPhysics::fillNewtonSystem(bool apply_friction)
 {
+	GAIA_PROFILE_SCOPE("fillNewtonSystem");
 	pNewtonAssembler->newtonForce.setZero();
 	fillNewtonForce();
 
-	auto data_ptr = pNewtonAssembler->newtonHessianAll.valuePtr();
-	memset(data_ptr, 0, pNewtonAssembler->newtonHessianAll.nonZeros() * sizeof(FloatingType));
+	pNewtonAssembler->clearHessian();
 	fillNewtonHessianDiagonal();
-	fillNewtonHessianOffDiagonal();
+	// the matrix-free solver reads the off-diagonal elastic blocks directly from the per tet Hessians
+	if (pNewtonAssembler->solverType != 2)
+	{
+		fillNewtonHessianOffDiagonal();
+	}
+	// must come after the elastic part, the elastic blocks are assigned while these are added to them
+	fillNewtonCollisionForceAndHessian(apply_friction);
 	// std::cout << newtonHessian.block(0, 0, 9, 9) << "\n";
 }
 
@@ -3807,6 +4599,151 @@ void GAIA::VBDPhysics::fillNewtonHessianOffDiagonal()
 	}
 }
 
+void GAIA::VBDPhysics::fillNewtonCollisionForceAndHessian(bool apply_friction)
+{
+	GAIA_PROFILE_SCOPE("fillNewtonCollisionForceAndHessian");
+	NFloatingType* forcePtr = pNewtonAssembler->newtonForce.data();
+	for (size_t iMesh = 0; iMesh < numTetMeshes(); iMesh++)
+	{
+		VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+		auto fillNewtonCollisionDiagonalHandler = [&](int iV) {
+			if (pMesh->fixedMask[iV])
+			{
+				return;
+			}
+			Vec3 force = Vec3::Zero();
+			Mat3 hessian = Mat3::Zero();
+			accumlateBoundaryForceAndHessian(pMesh, iMesh, iV, force, hessian, apply_friction);
+			if (physicsParams().handleCollision)
+			{
+				accumlateCollisionForceAndHessian(pMesh, iMesh, iV, force, hessian, apply_friction);
+			}
+			Eigen::Map<NVec3>(forcePtr + iV * 3) += force.cast<NFloatingType>();
+
+			NFloatingType** hessianPtr = &pNewtonAssembler->diagonalHessianBlockPtrs[iMesh][iV * 9];
+			for (size_t iRow = 0; iRow < 3; iRow++)
+			{
+				for (size_t iCol = 0; iCol < 3; iCol++)
+				{
+					**hessianPtr += hessian(iRow, iCol);
+					hessianPtr++;
+				}
+			}
+		};
+		cpu_parallel_for(0, pMesh->numVertices(), fillNewtonCollisionDiagonalHandler);
+		forcePtr += pMesh->numVertices() * 3;
+	}
+
+	if (!physicsParams().handleCollision)
+	{
+		return;
+	}
+
+	// the coupling between the vertices of each v-f collision: b_i * b_j * H, where b is 1 for the colliding vertex and 
+	// minus the barycentrics for the face vertices; the same block can be hit by several collisions, thus it is done serially
+	for (size_t iActiveCol = 0; iActiveCol < activeColllisionList.activeCollisions.size(); iActiveCol++)
+	{
+		IdType meshId = activeColllisionList.activeCollisions[iActiveCol].first;
+		IdType vertexId = activeColllisionList.activeCollisions[iActiveCol].second;
+		VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(meshId, vertexId);
+
+		for (size_t iIntersection = 0; iIntersection < colResult.numIntersections(); iIntersection++)
+		{
+			CollidingPointInfo& collidingPt = colResult.collidingPts[iIntersection];
+			VBDCollisionInfo& collisionFH = colResult.collisionForceAndHessian[iIntersection];
+			if (!collidingPt.shortestPathFound || collisionFH.penetrationDepth <= 0)
+			{
+				continue;
+			}
+
+			VBDBaseTetMesh* pMeshFSide = tMeshes[collidingPt.intersectedMeshId].get();
+			IdType vertPos[4];
+			FloatingType b[4];
+			for (int iFaceV = 0; iFaceV < 3; iFaceV++)
+			{
+				IdType faceVId = pMeshFSide->surfaceFacesTetMeshVIds()(iFaceV, collidingPt.closestSurfaceFaceId);
+				vertPos[iFaceV] = pMeshFSide->fixedMask[faceVId] ? -1 : pNewtonAssembler->meshOffsets[collidingPt.intersectedMeshId] + faceVId * 3;
+				b[iFaceV] = -collidingPt.closestSurfacePtBarycentrics[iFaceV];
+			}
+			vertPos[3] = tMeshes[meshId]->fixedMask[vertexId] ? -1 : pNewtonAssembler->meshOffsets[meshId] + vertexId * 3;
+			b[3] = 1.f;
+
+			for (int iRow = 0; iRow < 4; iRow++)
+			{
+				for (int iCol = 0; iCol < 4; iCol++)
+				{
+					if (iRow == iCol || vertPos[iRow] < 0 || vertPos[iCol] < 0 || b[iRow] * b[iCol] == 0)
+					{
+						continue;
+					}
+					IdType iBlock = pNewtonAssembler->findCollisionBlock(vertPos[iRow], vertPos[iCol]);
+					assert(iBlock >= 0);
+					NFloatingType** hessianPtr = &pNewtonAssembler->collisionHessianBlockPtrs[iBlock * 9];
+					for (size_t i = 0; i < 3; i++)
+					{
+						for (size_t j = 0; j < 3; j++)
+						{
+							**hessianPtr += b[iRow] * b[iCol] * collisionFH.collisionHessian(i, j);
+							hessianPtr++;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void GAIA::VBDPhysics::analyzeNewtonCollision()
+{
+	GAIA_PROFILE_SCOPE("analyzeNewtonCollision");
+	newtonCollisionBlocks.clear();
+	for (size_t iActiveCol = 0; iActiveCol < activeColllisionList.activeCollisions.size(); iActiveCol++)
+	{
+		IdType meshId = activeColllisionList.activeCollisions[iActiveCol].first;
+		IdType vertexId = activeColllisionList.activeCollisions[iActiveCol].second;
+		VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(meshId, vertexId);
+
+		for (size_t iIntersection = 0; iIntersection < colResult.numIntersections(); iIntersection++)
+		{
+			CollidingPointInfo& collidingPt = colResult.collidingPts[iIntersection];
+			if (!collidingPt.shortestPathFound)
+			{
+				continue;
+			}
+			// the penetration depth changes during the iterations, the blocks are reserved for every detected collision
+			VBDBaseTetMesh* pMeshFSide = tMeshes[collidingPt.intersectedMeshId].get();
+			IdType vertPos[4];
+			for (int iFaceV = 0; iFaceV < 3; iFaceV++)
+			{
+				IdType faceVId = pMeshFSide->surfaceFacesTetMeshVIds()(iFaceV, collidingPt.closestSurfaceFaceId);
+				vertPos[iFaceV] = pMeshFSide->fixedMask[faceVId] ? -1 : pNewtonAssembler->meshOffsets[collidingPt.intersectedMeshId] + faceVId * 3;
+			}
+			vertPos[3] = tMeshes[meshId]->fixedMask[vertexId] ? -1 : pNewtonAssembler->meshOffsets[meshId] + vertexId * 3;
+
+			for (int iRow = 0; iRow < 4; iRow++)
+			{
+				for (int iCol = 0; iCol < 4; iCol++)
+				{
+					if (iRow != iCol && vertPos[iRow] >= 0 && vertPos[iCol] >= 0)
+					{
+						newtonCollisionBlocks.emplace_back(vertPos[iRow], vertPos[iCol]);
+					}
+				}
+			}
+		}
+	}
+	std::sort(newtonCollisionBlocks.begin(), newtonCollisionBlocks.end());
+	newtonCollisionBlocks.erase(std::unique(newtonCollisionBlocks.begin(), newtonCollisionBlocks.end()), newtonCollisionBlocks.end());
+
+	bool patternChanged = pNewtonAssembler->analyzeCollision(newtonCollisionBlocks);
+	// the old factorization does not match the new pattern
+	newtonRefactorize = newtonRefactorize || patternChanged;
+	debugOperation(DEBUG_LVL_DEBUG, [&]() {
+		std::cout << "Newton collision blocks: " << newtonCollisionBlocks.size()
+			<< (patternChanged ? ", pattern re-analyzed\n" : ", pattern reused\n");
+		});
+}
+
 void GAIA::VBDPhysics::updatePositions(const VecDynamic& dx)
 {
 	int offset = 0;
@@ -3836,9 +4773,79 @@ GAIA::NFloatingType GAIA::VBDPhysics::evaluateMeritEnergy(NFloatingType& eInerti
 	return eElastic + eInertia;
 }
 
+GAIA::NFloatingType GAIA::VBDPhysics::evaluateCollisionEnergy()
+{
+	NFloatingType eCollision = 0;
+	CFloatingType boundaryCollisionStiffness = physicsParams().boundaryCollisionStiffness;
+	for (size_t iMesh = 0; iMesh < numTetMeshes(); iMesh++)
+	{
+		VBDBaseTetMesh* pMesh = tMeshes[iMesh].get();
+		for (IdType iV = 0; iV < pMesh->numVertices(); iV++)
+		{
+			const Vec3 pos = pMesh->vertex(iV);
+			if (physicsParams().useBowlGround) {
+				const Vec3& center = physicsParams().bowlCenter;
+				CFloatingType radius = physicsParams().bowlRadius;
+				if (!physicsParams().bowlCap && (pos.y() - center.y() > 0)) continue;
+				CFloatingType dist = (pos - center).norm();
+				if (dist > radius)
+				{
+					eCollision += 0.5f * boundaryCollisionStiffness * (dist - radius) * (dist - radius);
+				}
+			}
+			else if (physicsParams().usePlaneGround) {
+				for (size_t iDim = 0; iDim < 3; iDim++)
+				{
+					CFloatingType lowerBound = physicsParams().worldBounds(iDim, 0);
+					CFloatingType upperBound = physicsParams().worldBounds(iDim, 1);
+					CFloatingType penetrationDepth = pos[iDim] < lowerBound ? lowerBound - pos[iDim] :
+						(pos[iDim] > upperBound ? pos[iDim] - upperBound : 0.f);
+					eCollision += 0.5f * boundaryCollisionStiffness * penetrationDepth * penetrationDepth;
+				}
+			}
+		}
+	}
+
+	if (!physicsParams().handleCollision)
+	{
+		return eCollision;
+	}
+
+	// the contact normals and the barycentrics are kept from the last updateAllCollisionInfos, consistent with the forces
+	CFloatingType k = physicsParams().collisionStiffness;
+	for (size_t iActiveCol = 0; iActiveCol < activeColllisionList.activeCollisions.size(); iActiveCol++)
+	{
+		IdType meshId = activeColllisionList.activeCollisions[iActiveCol].first;
+		IdType vertexId = activeColllisionList.activeCollisions[iActiveCol].second;
+		VBDCollisionDetectionResult& colResult = getCollisionDetectionResultFromTetMeshId(meshId, vertexId);
+		for (size_t iIntersection = 0; iIntersection < colResult.numIntersections(); iIntersection++)
+		{
+			CollidingPointInfo& collidingPt = colResult.collidingPts[iIntersection];
+			if (!collidingPt.shortestPathFound)
+			{
+				continue;
+			}
+			VBDBaseTetMesh* pMeshFSide = tMeshes[collidingPt.intersectedMeshId].get();
+			Vec3 closestSurfacePt = Vec3::Zero();
+			for (int iFaceV = 0; iFaceV < 3; iFaceV++)
+			{
+				IdType faceVId = pMeshFSide->surfaceFacesTetMeshVIds()(iFaceV, collidingPt.closestSurfaceFaceId);
+				closestSurfacePt += collidingPt.closestSurfacePtBarycentrics[iFaceV] * pMeshFSide->vertex(faceVId);
+			}
+			CFloatingType penetrationDepth = (closestSurfacePt - tMeshes[meshId]->vertex(vertexId)).dot(collidingPt.closestPointNormal);
+			if (penetrationDepth > 0)
+			{
+				eCollision += 0.5f * k * penetrationDepth * penetrationDepth;
+			}
+		}
+	}
+	return eCollision;
+}
+
 GAIA::NFloatingType GAIA::VBDPhysics::newtonLineSearch(const VecDynamic& dx, NFloatingType E0, FloatingType alpha,
 	FloatingType c, FloatingType tau, int maxNumIters, FloatingType& stepSizeOut)
 {
+	GAIA_PROFILE_SCOPE("newtonLineSearch");
 	FloatingType m = dx.squaredNorm();
 
 	std::vector<TVerticesMat> orgPos{};
@@ -3864,7 +4871,7 @@ GAIA::NFloatingType GAIA::VBDPhysics::newtonLineSearch(const VecDynamic& dx, NFl
 			pMesh->vertices() = orgPos[iMesh] + alpha * Eigen::Map<const TVerticesMat>(dx.data() + offset, 3, pMesh->numVertices());
 			offset += pMesh->numVertices() * 3;
 		}
-		e = evaluateMeritEnergy(eInertia, eElastic);
+		e = evaluateMeritEnergy(eInertia, eElastic) + evaluateCollisionEnergy();
 		debugOperation(DEBUG_LVL_DEBUG_VEBOSE, [&]() {
 			std::cout << "alpha: " << alpha << ", energy: " << e << ", inertia: " << eInertia << ", elastic: " << eElastic << std::endl;
 			});
@@ -3886,6 +4893,7 @@ GAIA::NFloatingType GAIA::VBDPhysics::newtonLineSearch(const VecDynamic& dx, NFl
 	return e;
 }
 
+#ifndef GAIA_NO_CUDA
 FloatingType GAIA::VBDPhysics::evaluateMeritEnergyGPU(FloatingType& eInertia, FloatingType& eElastic, bool elasticReady)
 {
 	evaluateElasticEnergyGPU(pPhysicsDataGPUBuffer->getData(), pLineSearchUtilities->tetAllParallelGroupsBuffer->getGPUBuffer(), numAllTets, pLineSearchUtilities->tetElasticEnergyBuffer->getGPUBuffer(),
@@ -3907,6 +4915,7 @@ FloatingType GAIA::VBDPhysics::evaluateMeritEnergyGPU(FloatingType& eInertia, Fl
 	}
 	return eInertia + eElastic;
 }
+#endif // !GAIA_NO_CUDA
 
 void GAIA::VBDPhysics::GDBackupPositions(bool sync, CFloatingType omega)
 {
@@ -10,6 +10,8 @@
 #include "VBDPhysicsParameters.h"
 
 #include "ActiveCollisionList.h"
+#include "ContactIslands.h"
+#include "../CollisionDetector/MeshBroadPhase.h"
 #include "VBDPhysicsTest.h"
 
 #include "VBD_CollisionInfo.h"
@@ -70,6 +72,28 @@ namespace GAIA {
 		// CPU VBD
 		void runStep_serialCollisionHandling();
 		void runStep_hybridCollisionHandling();
+		// groups the meshes into contact islands from the active collisions and decides how each island is solved this substep:
+		// as one task or in the global colored sweep; must be called after prepareCollisionDataCPU
+		// newSubstep = false after an intermediate collision detection: the new contacts merge islands but do not split them
+		void updateContactIslands(bool newSubstep);
+		// runs all the iterations of an island serially on the calling thread, in the order of the parallel groups;
+		// returns the number of iterations run, which can be less with adaptiveIterations
+		int solveIslandAllIterations(IdType iIsland);
+		// adaptiveIterations: whether the iterations can stop, from the largest vertex step of the last iteration
+		bool iterationsConverged(int numIterationsRun, FloatingType maxStep);
+		// ObjectParamsVBD::iterations, or the global iterations if it is not set
+		int getMeshIterations(IdType iMesh);
+
+		// sleeping of the resting meshes, only for the CPU hybrid collision handling
+		// wakes up the sleeping meshes whose fixed vertices were moved by the deformers, called before the initial step
+		void wakeUpDeformedMeshes();
+		// wakes up the sleeping meshes hit by the vertices of the awake meshes, called after prepareCollisionDataCPU
+		void wakeUpTouchedMeshes();
+		// accumulates the sleeping criteria over the substep window and puts the contact islands that meet them to sleep,
+		// called after updateVelocities
+		void updateSleepingMeshes();
+		void putMeshToSleep(IdType iMesh);
+		void wakeUpMesh(IdType iMesh);
 
 		// void runStepGPU_debugOnCPU();
 		// void runStepGPUNoCollision();
@@ -87,15 +111,23 @@ namespace GAIA {
 		void intermediateDCD();
 		void ccd();
 		void intermediateCCD();
+		// the v-f CCD of all the surface vertices with a single rtcCollide call, used instead of the per vertex point queries
+		// with collisionParams().ccdBatchVertexFace
+		void batchVertexFaceCCD();
+		// e-e CCD between the surface edges, must be called after the v-f CCD of the same pass;
+		// each e-e collision is added to the collision results of the edge endpoints as a v-f collision
+		void edgeEdgeCCD();
 		void intermediateCollisionDetection();
 		void updateDCDBVH(bool rebuildTetMeshScene, bool rebuildSurfaceScene);
 		void updateCCDBVH(bool rebuildScene);
 		void updateAllCollisionInfos();
 		void updateCollisionInfo(VBDCollisionDetectionResult& collisionResult);
-		void solveCollisionsSequentially();
+		// returns the max norm of the steps the colliding vertices made
+		FloatingType solveCollisionsSequentially();
 
-		void VBDStep(TetMeshFEM* pMesh, IdType vertexId);
-		void VBDStepWithCollision(TetMeshFEM* pMesh, IdType meshId, IdType vertexId, bool apply_friction = false);
+		void VBDStep(TetMeshFEM* pMesh, IdType meshId, IdType vertexId);
+		// returns the norm of the step the vertex made
+		FloatingType VBDStepWithCollision(TetMeshFEM* pMesh, IdType meshId, IdType vertexId, bool apply_friction = false);
 
 		void updateVelocities();
 		void updateVelocitiesGPU();
@@ -107,6 +139,8 @@ namespace GAIA {
 		Vec3 applyFrictinalVelocityDamping(Vec3 velocity, Vec3& contactNormal, CFloatingType vertInvMass,
 			CFloatingType frictionRatio, CFloatingType contactForce, CFloatingType dt);
 
+		// dispatches to the packed, the SIMD or the scalar material kernel according to physicsParams()
+		void accumlateMaterialForceAndHessian(VBDTetMeshNeoHookean* pMesh, IdType meshId, IdType vertexId, Vec3& force, Mat3& hessian);
 		void accumlateDampingForceAndHessian(TetMeshFEM* pMesh, IdType vertexId, Vec3& force, Mat3& hessian, const Mat3& K);
 
 		void solveBoxBoundaryConstraintForVertex(TetMeshFEM* pMesh, IdType vertexId);
@@ -168,6 +202,11 @@ namespace GAIA {
 		FloatingType getAcceleratorOmega(int order, CFloatingType pho, CFloatingType prevOmega);
 		void recordInitialPositionForAccelerator(bool sync);
 		void recordPrevIterPositionsAccelerator(bool sync);
+		// the CPU counterparts, per mesh: the record restarts the Chebyshev sequence from the current positions,
+		// the acceleration pass computes x_k+1 = x_k-1 + omega * (x_hat_k+1 - x_k-1) and shifts the buffers in the same pass
+		void recordInitialPositionForAcceleratorCPU(IdType iMesh);
+		// parallel: over the vertices of the mesh, off for the islands solved in a single task
+		void applyAcceleratorCPU(IdType iMesh, FloatingType omega, bool parallel);
 
 		// data
 	public:
@@ -224,6 +263,28 @@ namespace GAIA {
 		std::vector<std::vector<IdType>> tetParallelGroups;
 
 		ActiveCollisionList activeColllisionList;
+		// updated before each DCD and CCD pass, with swept AABBs for the CCD
+		MeshBroadPhase meshBroadPhase;
+		// nMeshes x nGroups, the color of the mesh in each parallel group, -1 if the mesh has no vertex in that group
+		std::vector<std::vector<IdType>> meshColorOfParallelGroup;
+
+		// contact islands, updated every substep by updateContactIslands
+		ContactIslands contactIslands;
+		// nIslands
+		std::vector<int8_t> islandSolvedPerTask;
+		// the max of the iterations of the meshes in the island
+		std::vector<int> islandIterations;
+		// nIslands x nGroups x (2 * nCollisions): iMesh1, vertexId1, iMesh2, vertexId2, ..., only filled for the per task islands
+		std::vector<std::vector<std::vector<IdType>>> islandCollisionsEachParallelGroup;
+		std::vector<IdType> perTaskIslands;
+		// nMeshes, the state of the island of each mesh
+		std::vector<int8_t> meshSolvedPerTask;
+		std::vector<int8_t> meshInColoredSweep;
+		std::vector<int> meshIslandIterations;
+		size_t numMeshesInColoredSweep = 0;
+		int numColoredSweepIterations = 0;
+		// packed neighbor tet data in the order of vertexParallelGroups, only built if physicsParams().usePackedTetData
+		VBDPackedTetData packedTetData;
 
 	private:
 		// for line search
@@ -234,12 +295,26 @@ namespace GAIA {
 
 		void computeElasticForceHessian();
 		void computeElasticEnergy();
-		void fillNewtonSystem();
+		void fillNewtonSystem(bool apply_friction = true);
 		void fillNewtonForce();
 		void fillNewtonHessianDiagonal();
 		void fillNewtonHessianOffDiagonal();
+		// boundary and collision forces and the diagonal blocks of their Hessians, then the blocks coupling the vertices of each collision
+		void fillNewtonCollisionForceAndHessian(bool apply_friction);
+		// collects the off-diagonal blocks coupled by the active collisions and hands them to the assembler
+		void analyzeNewtonCollision();
 		void updatePositions(const VecDynamic& dx);
 		NFloatingType evaluateMeritEnergy(NFloatingType& eInertia, NFloatingType& eElastic, bool elasticReady = false);
+		// penalty energy of the boundary and the active collisions, the friction is not conservative and is left out
+		NFloatingType evaluateCollisionEnergy();
+		std::vector<std::pair<IdType, IdType>> newtonCollisionBlocks;
+
+		// for reusing the factorization of the direct Newton solver
+		bool newtonRefactorize = true;
+		bool newtonFactorizationFresh = false;
+		int newtonNumFactorizationReuses = 0;
+		FloatingType newtonLastFactorizationTime = 0;
+		NFloatingType newtonLastFreshEnergyDecrease = 0;
 		NFloatingType newtonLineSearch(const VecDynamic& dx, NFloatingType E0, FloatingType alpha,
 			FloatingType c, FloatingType tau, int maxNumIters, FloatingType& stepSizeOut);
 
@@ -32,7 +32,7 @@ namespace GAIA {
 		FloatingType backtracingLineSearchC = 0.0; // first wolfe condition multiplier
 
 		// collision detecion
-		bool handleCollision = false;
+		bool handleCollision = false; // only for Newton, the VBD solvers always handle collisions
 		FloatingType collisionStiffness = 1e5f;
 		FloatingType collisionAirDistance = 0.0f;
 		int contactDetectionIters = 1;
@@ -44,6 +44,10 @@ namespace GAIA {
 		FloatingType boundaryCollisionStiffness = 1e5f;
 		FloatingType boundaryFrictionEpsV = 1.0f;
 		int frictionStartIter = 0;
+		// CPU VBD: a substep stops iterating once the largest vertex step of an iteration, divided by dt, is below convergenceAvgNormThres;
+		// iterations is the cap, and at least adaptiveIterationsMin iterations are run
+		bool adaptiveIterations = false;
+		int adaptiveIterationsMin = 1;
 
 		// material solve
 		FloatingType degenerateTriangleThres = 1e-6f;
@@ -51,12 +55,37 @@ namespace GAIA {
 		// solver
 		bool useGPU = false;
 		bool useDouble3x3 = false; // only for CPU
+		bool useSIMDMaterialKernel = false; // only for CPU, validated against the scalar kernel at debug level DEBUG_LVL_DEBUG; falls back to the scalar kernel when PSD_FILTERING is defined
+		bool usePackedTetData = false; // only for CPU, read the tets from the per parallel group packed layout; wins over useSIMDMaterialKernel, which is turned off with a warning when both are on
 		bool useNewton = false;
+		// only for CPU hybrid collision handling: each contact island, i.e. a group of meshes connected by active collisions,
+		// with at most perTaskIslandMaxVertices vertices runs all its iterations as one task; only the rest goes through the global colored sweep
+		bool solveSmallIslandsPerTask = false;
+		int perTaskIslandMaxVertices = 5000;
+		// only for CPU hybrid collision handling: a mesh falls asleep, i.e. is deactivated for the material solve and the collision queries,
+		// when for sleepWindowSubsteps substeps its kinetic energy per unit mass stayed below sleepKineticEnergyThres 
+		// and its vertices moved less than sleepDisplacementThres in total, and the same holds for all the meshes of its contact island;
+		// it wakes up when a vertex of an awake mesh collides with it or a deformer moves its fixed vertices; 0 turns it off
+		FloatingType sleepKineticEnergyThres = 0.f;
+		FloatingType sleepDisplacementThres = 1e-3f;
+		int sleepWindowSubsteps = 10;
 		bool useGDSolver = false;  // only for GPU
 		bool GDSolverUseBlockJacobi = false;  // only for GPU
 		bool useLineSearch = false;
 
 		bool NewtonUseCG = false;
+		// matrix-free PCG, overrides NewtonUseCG
+		bool NewtonUseMatrixFreePCG = false;
+		int NewtonPCGPreconditioner = 0; // 0: block Jacobi, 1: additive Schwarz over the tets
+		bool NewtonPCGWarmStart = true;
+		int NewtonCGMaxIterations = 300;
+		FloatingType NewtonCGTolerance = 1e-7f;
+		// direct solver only: keep using the last factorization, across iterations and substeps, until the line search has to shrink 
+		// the step, the energy decrease drops below NewtonRefactorizeStallRatio of the one after the last factorization, or it has
+		// been reused NewtonMaxFactorizationReuses times; without line search only the last criterion applies
+		bool NewtonReuseFactorization = false;
+		int NewtonMaxFactorizationReuses = 8;
+		FloatingType NewtonRefactorizeStallRatio = 0.25f;
 
 		int lineSearchGapIter = 8;
 
@@ -67,7 +96,6 @@ namespace GAIA {
 		// for debug
 		bool saveIntermediateResults = false;
 		int debugOutputInterval = 1;
-		FloatingType collisionOffHeight = 1e7;
 		bool evaluateConvergence = false;
 		bool saveConvergenceEvaluationResults = false;
 		int evaluationSteps = 10;
@@ -110,17 +138,43 @@ namespace GAIA {
 		EXTRACT_FROM_JSON(physicsParams, backtracingLineSearchC);
 
 		EXTRACT_FROM_JSON(physicsParams, useDouble3x3);
+		EXTRACT_FROM_JSON(physicsParams, useSIMDMaterialKernel);
+		EXTRACT_FROM_JSON(physicsParams, usePackedTetData);
 		EXTRACT_FROM_JSON(physicsParams, frictionStartIter);
+		EXTRACT_FROM_JSON(physicsParams, adaptiveIterations);
+		EXTRACT_FROM_JSON(physicsParams, adaptiveIterationsMin);
 
 		EXTRACT_FROM_JSON(physicsParams, useGPU);
 		EXTRACT_FROM_JSON(physicsParams, useGDSolver);
 		EXTRACT_FROM_JSON(physicsParams, useNewton);
+		EXTRACT_FROM_JSON(physicsParams, solveSmallIslandsPerTask);
+		EXTRACT_FROM_JSON(physicsParams, perTaskIslandMaxVertices);
+		// the keys of the per mesh tasks these two replace, still read from the scene files written with them
+		if (physicsParams.contains("solveIsolatedMeshesPerTask") && !physicsParams.contains("solveSmallIslandsPerTask"))
+		{
+			MF::parseJsonParameters(physicsParams, "solveIsolatedMeshesPerTask", solveSmallIslandsPerTask);
+		}
+		if (physicsParams.contains("perTaskMeshMaxVertices") && !physicsParams.contains("perTaskIslandMaxVertices"))
+		{
+			MF::parseJsonParameters(physicsParams, "perTaskMeshMaxVertices", perTaskIslandMaxVertices);
+		}
+		EXTRACT_FROM_JSON(physicsParams, sleepKineticEnergyThres);
+		EXTRACT_FROM_JSON(physicsParams, sleepDisplacementThres);
+		EXTRACT_FROM_JSON(physicsParams, sleepWindowSubsteps);
 		EXTRACT_FROM_JSON(physicsParams, useLineSearch);
 		EXTRACT_FROM_JSON(physicsParams, lineSearchGapIter);
 		EXTRACT_FROM_JSON(physicsParams, useAccelerator);
 		EXTRACT_FROM_JSON(physicsParams, acceleratorRho);
 		EXTRACT_FROM_JSON(physicsParams, GDSolverUseBlockJacobi);
 		EXTRACT_FROM_JSON(physicsParams, NewtonUseCG);
+		EXTRACT_FROM_JSON(physicsParams, NewtonUseMatrixFreePCG);
+		EXTRACT_FROM_JSON(physicsParams, NewtonPCGPreconditioner);
+		EXTRACT_FROM_JSON(physicsParams, NewtonPCGWarmStart);
+		EXTRACT_FROM_JSON(physicsParams, NewtonCGMaxIterations);
+		EXTRACT_FROM_JSON(physicsParams, NewtonCGTolerance);
+		EXTRACT_FROM_JSON(physicsParams, NewtonReuseFactorization);
+		EXTRACT_FROM_JSON(physicsParams, NewtonMaxFactorizationReuses);
+		EXTRACT_FROM_JSON(physicsParams, NewtonRefactorizeStallRatio);
 
 		// collision detecion
 		EXTRACT_FROM_JSON(physicsParams, handleCollision);
@@ -136,7 +190,6 @@ namespace GAIA {
 		// for debug
 		EXTRACT_FROM_JSON(physicsParams, saveIntermediateResults);
 		EXTRACT_FROM_JSON(physicsParams, debugOutputInterval);
-		EXTRACT_FROM_JSON(physicsParams, collisionOffHeight);
 		EXTRACT_FROM_JSON(physicsParams, evaluateConvergence);
 		EXTRACT_FROM_JSON(physicsParams, evaluationSteps);
 		EXTRACT_FROM_JSON(physicsParams, saveConvergenceEvaluationResults);
@@ -174,17 +227,34 @@ namespace GAIA {
 		PUT_TO_JSON(physicsParams, backtracingLineSearchC);
 
 		PUT_TO_JSON(physicsParams, useDouble3x3);
+		PUT_TO_JSON(physicsParams, useSIMDMaterialKernel);
+		PUT_TO_JSON(physicsParams, usePackedTetData);
 		PUT_TO_JSON(physicsParams, frictionStartIter);
+		PUT_TO_JSON(physicsParams, adaptiveIterations);
+		PUT_TO_JSON(physicsParams, adaptiveIterationsMin);
 
 		PUT_TO_JSON(physicsParams, useGPU);
 		PUT_TO_JSON(physicsParams, useGDSolver);
 		PUT_TO_JSON(physicsParams, useNewton);
+		PUT_TO_JSON(physicsParams, solveSmallIslandsPerTask);
+		PUT_TO_JSON(physicsParams, perTaskIslandMaxVertices);
+		PUT_TO_JSON(physicsParams, sleepKineticEnergyThres);
+		PUT_TO_JSON(physicsParams, sleepDisplacementThres);
+		PUT_TO_JSON(physicsParams, sleepWindowSubsteps);
 		PUT_TO_JSON(physicsParams, useLineSearch);
 		PUT_TO_JSON(physicsParams, lineSearchGapIter);
 		PUT_TO_JSON(physicsParams, useAccelerator);
 		PUT_TO_JSON(physicsParams, acceleratorRho);
 		PUT_TO_JSON(physicsParams, GDSolverUseBlockJacobi);
 		PUT_TO_JSON(physicsParams, NewtonUseCG);
+		PUT_TO_JSON(physicsParams, NewtonUseMatrixFreePCG);
+		PUT_TO_JSON(physicsParams, NewtonPCGPreconditioner);
+		PUT_TO_JSON(physicsParams, NewtonPCGWarmStart);
+		PUT_TO_JSON(physicsParams, NewtonCGMaxIterations);
+		PUT_TO_JSON(physicsParams, NewtonCGTolerance);
+		PUT_TO_JSON(physicsParams, NewtonReuseFactorization);
+		PUT_TO_JSON(physicsParams, NewtonMaxFactorizationReuses);
+		PUT_TO_JSON(physicsParams, NewtonRefactorizeStallRatio);
 
 		// collision detecion
 		PUT_TO_JSON(physicsParams, handleCollision);
@@ -204,7 +274,6 @@ namespace GAIA {
 		// for debug
 		PUT_TO_JSON(physicsParams, saveIntermediateResults);
 		PUT_TO_JSON(physicsParams, debugOutputInterval);
-		PUT_TO_JSON(physicsParams, collisionOffHeight);
 
 		PUT_TO_JSON(physicsParams, numThreadsVBDSolve);
 		return true;
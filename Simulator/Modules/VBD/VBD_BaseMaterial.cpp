@@ -146,3 +146,21 @@ void VBDBaseTetMesh::forwardStepSimplecticEuler()
 		};
         cpu_parallel_for(0, numVertices(), forwardStepHandler);
 }
+
+void VBDBaseTetMesh::getCheckpointBuffers(std::vector<CheckpointBuffer>& buffers)
+{
+	TetMeshFEM::getCheckpointBuffers(buffers);
+	// used by the initialization of the next step
+	buffers.push_back(makeCheckpointBuffer(mVelocitiesPrev));
+	buffers.push_back(makeCheckpointBuffer(acceletration));
+	buffers.push_back(makeCheckpointBuffer(hasVelocitiesPrev));
+	buffers.push_back(makeCheckpointBuffer(hasApproxAcceleration));
+	// the sleeping state, so a resumed run keeps the sleeping meshes asleep and continues their stillness windows
+	buffers.push_back(makeCheckpointBuffer(sleeping));
+	buffers.push_back(makeCheckpointBuffer(numStillSubsteps));
+	buffers.push_back(makeCheckpointBuffer(sleepWindowDisplacement));
+	// the rest is recomputed every step, it is saved so checkpoints taken within a step (e.g. debug states) resume identically
+	buffers.push_back(makeCheckpointBuffer(inertia));
+	buffers.push_back(makeCheckpointBuffer(activeCollisionMask));
+	buffers.push_back(makeCheckpointBuffer(penetratedMask));
+}
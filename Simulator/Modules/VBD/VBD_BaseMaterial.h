@@ -44,6 +44,10 @@ namespace GAIA {
 
 		FloatingType initRatio_g = 0.5f;
 
+		// iterations of the contact island of this object in the CPU hybrid solver, the island takes the max of its objects;
+		// -1: the global iterations
+		int iterations = -1;
+
 		virtual bool fromJson(nlohmann::json& objectParam);
 		virtual bool toJson(nlohmann::json& objectParam);
 	};
@@ -116,6 +120,7 @@ namespace GAIA {
 		virtual void handleForceConstraints();
 		virtual void handleVelocityConstraint();
 		virtual void evaluateExternalForce();;
+		virtual void getCheckpointBuffers(std::vector<CheckpointBuffer>& buffers);
 
 		virtual void initializeGPUMesh() = 0;
 		virtual VBDBaseTetMeshGPU* getGPUMesh() = 0;
@@ -187,6 +192,18 @@ namespace GAIA {
 		// used to separate dcd/ccd scheme
 		VecDynamicBool penetratedMask;
 
+		// a sleeping mesh has activeForMaterialSolve off and its vertices are not queried for collisions,
+		// but it stays in the collision scenes so the other meshes still collide with it and wake it up
+		bool sleeping = false;
+		// for how many substeps the mesh has met the sleeping criteria, and how far its vertices moved meanwhile
+		int numStillSubsteps = 0;
+		FloatingType sleepWindowDisplacement = 0.f;
+
+		// the CPU accelerator: the positions of the previous iteration and of the one before it,
+		// the buffers are swapped by each acceleration pass; sized by VBDPhysics::recordInitialPositionForAcceleratorCPU
+		TVerticesMat positionsPrevPrevIterAccelerator;
+		TVerticesMat positionsPrevIterAccelerator;
+
 		VBDPhysicsParameters::SharedPtr pPhysicsParams;
 		BasePhysicFramework* pPhysicsFramework;
 
@@ -438,6 +455,7 @@ namespace GAIA {
 		EXTRACT_FROM_JSON(objectParam, frictionEpsV);
 		EXTRACT_FROM_JSON(objectParam, exponentialVelDamping);
 		EXTRACT_FROM_JSON(objectParam, constantVelDamping);
+		EXTRACT_FROM_JSON(objectParam, iterations);
 
 		return true;
 	}
@@ -449,6 +467,7 @@ namespace GAIA {
 		PUT_TO_JSON(objectParam, frictionEpsV);
 		PUT_TO_JSON(objectParam, exponentialVelDamping);
 		PUT_TO_JSON(objectParam, constantVelDamping);
+		PUT_TO_JSON(objectParam, iterations);
 
 		return true;
 	}
@@ -1,5 +1,6 @@
 #include "VBD_NeoHookean.h"
 #include "../Parallelization/CPUParallelization.h"
+#include "../common/simd/simd.h"
 
 using namespace GAIA;
 
@@ -395,10 +396,6 @@ void GAIA::VBDTetMeshNeoHookean::accumlateMaterialForceAndHessian(int iV, Vec3&
 void GAIA::VBDTetMeshNeoHookean::accumlateMaterialForceAndHessian2(int iV, Vec3& force, Mat3& hessian)
 {
 	const size_t numNeiTest = getNumVertexNeighborTets(iV);
-	const auto& material = ObjectParametersMaterial();
-	CFloatingType miu = material.miu;
-	CFloatingType lmbd = material.lmbd;
-	CFloatingType a = 1 + miu / lmbd;
 	Vec3 displacement = vertex(iV) - vertexPrevPos(iV);
 
 	for (size_t iNeiTet = 0; iNeiTet < numNeiTest; iNeiTet++)
@@ -407,193 +404,388 @@ void GAIA::VBDTetMeshNeoHookean::accumlateMaterialForceAndHessian2(int iV, Vec3&
 
 		CFloatingType A = tetRestVolume(tetId);
 
-		Vec3 forceTet;
-		Mat3 hessianTet;
-
 		auto DmInv = getDmInv(tetId);
 
 		Mat3 Ds;
 		computeDs(Ds, tetId);
 		//std::cout << "Ds:\n" << Ds << std::endl;
 
-		Mat3 F = Ds * DmInv;
-		//std::cout << "F:\n" << F << std::endl;
+		accumlateTetMaterialForceAndHessian2(Ds, DmInv, A, getVertexNeighborTetVertexOrder(iV, iNeiTet), displacement, force, hessian);
+	}
+}
 
-		CFloatingType detF = F.determinant();
+void GAIA::VBDTetMeshNeoHookean::accumlateTetMaterialForceAndHessian2(const Mat3& Ds, const Mat3& DmInv, CFloatingType A, int vertedTetVId, 
+	const Vec3& displacement, Vec3& force, Mat3& hessian)
+{
+	const auto& material = ObjectParametersMaterial();
+	CFloatingType miu = material.miu;
+	CFloatingType lmbd = material.lmbd;
+	CFloatingType a = 1 + miu / lmbd;
 
-		Eigen::Map<Vec9> dPhi_D_dF(F.data());
+	Mat3 F = Ds * DmInv;
+	//std::cout << "F:\n" << F << std::endl;
 
-		// std::cout << "dPhi_D_dF:\n" << dPhi_D_dF << std::endl;
+	CFloatingType detF = F.determinant();
 
-		CFloatingType F1_1 = F(0, 0);
-		CFloatingType F2_1 = F(1, 0);
-		CFloatingType F3_1 = F(2, 0);
-		CFloatingType F1_2 = F(0, 1);
-		CFloatingType F2_2 = F(1, 1);
-		CFloatingType F3_2 = F(2, 1);
-		CFloatingType F1_3 = F(0, 2);
-		CFloatingType F2_3 = F(1, 2);
-		CFloatingType F3_3 = F(2, 2);
+	Eigen::Map<Vec9> dPhi_D_dF(F.data());
 
-		Vec9 ddetF_dF;
-		ddetF_dF << F2_2 * F3_3 - F2_3 * F3_2,
-			F1_3* F3_2 - F1_2 * F3_3,
-			F1_2* F2_3 - F1_3 * F2_2,
-			F2_3* F3_1 - F2_1 * F3_3,
-			F1_1* F3_3 - F1_3 * F3_1,
-			F1_3* F2_1 - F1_1 * F2_3,
-			F2_1* F3_2 - F2_2 * F3_1,
-			F1_2* F3_1 - F1_1 * F3_2,
-			F1_1* F2_2 - F1_2 * F2_1;
+	// std::cout << "dPhi_D_dF:\n" << dPhi_D_dF << std::endl;
 
-		// std::cout << "ddetF_dF:\n" << ddetF_dF << std::endl;
+	CFloatingType F1_1 = F(0, 0);
+	CFloatingType F2_1 = F(1, 0);
+	CFloatingType F3_1 = F(2, 0);
+	CFloatingType F1_2 = F(0, 1);
+	CFloatingType F2_2 = F(1, 1);
+	CFloatingType F3_2 = F(2, 1);
+	CFloatingType F1_3 = F(0, 2);
+	CFloatingType F2_3 = F(1, 2);
+	CFloatingType F3_3 = F(2, 2);
 
-		Mat9 d2E_dF_dF = ddetF_dF * ddetF_dF.transpose();
+	Vec9 ddetF_dF;
+	ddetF_dF << F2_2 * F3_3 - F2_3 * F3_2,
+		F1_3* F3_2 - F1_2 * F3_3,
+		F1_2* F2_3 - F1_3 * F2_2,
+		F2_3* F3_1 - F2_1 * F3_3,
+		F1_1* F3_3 - F1_3 * F3_1,
+		F1_3* F2_1 - F1_1 * F2_3,
+		F2_1* F3_2 - F2_2 * F3_1,
+		F1_2* F3_1 - F1_1 * F3_2,
+		F1_1* F2_2 - F1_2 * F2_1;
 
-		CFloatingType k = detF - a;
-		d2E_dF_dF(0, 4) += k * F3_3;
-		d2E_dF_dF(4, 0) += k * F3_3;
-		d2E_dF_dF(0, 5) += k * -F2_3;
-		d2E_dF_dF(5, 0) += k * -F2_3;
-		d2E_dF_dF(0, 7) += k * -F3_2;
-		d2E_dF_dF(7, 0) += k * -F3_2;
-		d2E_dF_dF(0, 8) += k * F2_2;
-		d2E_dF_dF(8, 0) += k * F2_2;
+	// std::cout << "ddetF_dF:\n" << ddetF_dF << std::endl;
 
-		d2E_dF_dF(1, 3) += k * -F3_3;
-		d2E_dF_dF(3, 1) += k * -F3_3;
-		d2E_dF_dF(1, 5) += k * F1_3;
-		d2E_dF_dF(5, 1) += k * F1_3;
-		d2E_dF_dF(1, 6) += k * F3_2;
-		d2E_dF_dF(6, 1) += k * F3_2;
-		d2E_dF_dF(1, 8) += k * -F1_2;
-		d2E_dF_dF(8, 1) += k * -F1_2;
+	Mat9 d2E_dF_dF = ddetF_dF * ddetF_dF.transpose();
 
-		d2E_dF_dF(2, 3) += k * F2_3;
-		d2E_dF_dF(3, 2) += k * F2_3;
-		d2E_dF_dF(2, 4) += k * -F1_3;
-		d2E_dF_dF(4, 2) += k * -F1_3;
-		d2E_dF_dF(2, 6) += k * -F2_2;
-		d2E_dF_dF(6, 2) += k * -F2_2;
-		d2E_dF_dF(2, 7) += k * F1_2;
-		d2E_dF_dF(7, 2) += k * F1_2;
+	CFloatingType k = detF - a;
+	d2E_dF_dF(0, 4) += k * F3_3;
+	d2E_dF_dF(4, 0) += k * F3_3;
+	d2E_dF_dF(0, 5) += k * -F2_3;
+	d2E_dF_dF(5, 0) += k * -F2_3;
+	d2E_dF_dF(0, 7) += k * -F3_2;
+	d2E_dF_dF(7, 0) += k * -F3_2;
+	d2E_dF_dF(0, 8) += k * F2_2;
+	d2E_dF_dF(8, 0) += k * F2_2;
 
-		d2E_dF_dF(3, 7) += k * F3_1;
-		d2E_dF_dF(7, 3) += k * F3_1;
-		d2E_dF_dF(3, 8) += k * -F2_1;
-		d2E_dF_dF(8, 3) += k * -F2_1;
+	d2E_dF_dF(1, 3) += k * -F3_3;
+	d2E_dF_dF(3, 1) += k * -F3_3;
+	d2E_dF_dF(1, 5) += k * F1_3;
+	d2E_dF_dF(5, 1) += k * F1_3;
+	d2E_dF_dF(1, 6) += k * F3_2;
+	d2E_dF_dF(6, 1) += k * F3_2;
+	d2E_dF_dF(1, 8) += k * -F1_2;
+	d2E_dF_dF(8, 1) += k * -F1_2;
 
-		d2E_dF_dF(4, 6) += k * -F3_1;
-		d2E_dF_dF(6, 4) += k * -F3_1;
-		d2E_dF_dF(4, 8) += k * F1_1;
-		d2E_dF_dF(8, 4) += k * F1_1;
+	d2E_dF_dF(2, 3) += k * F2_3;
+	d2E_dF_dF(3, 2) += k * F2_3;
+	d2E_dF_dF(2, 4) += k * -F1_3;
+	d2E_dF_dF(4, 2) += k * -F1_3;
+	d2E_dF_dF(2, 6) += k * -F2_2;
+	d2E_dF_dF(6, 2) += k * -F2_2;
+	d2E_dF_dF(2, 7) += k * F1_2;
+	d2E_dF_dF(7, 2) += k * F1_2;
 
-		d2E_dF_dF(5, 6) += k * F2_1;
-		d2E_dF_dF(6, 5) += k * F2_1;
-		d2E_dF_dF(5, 7) += k * -F1_1;
-		d2E_dF_dF(7, 5) += k * -F1_1;
+	d2E_dF_dF(3, 7) += k * F3_1;
+	d2E_dF_dF(7, 3) += k * F3_1;
+	d2E_dF_dF(3, 8) += k * -F2_1;
+	d2E_dF_dF(8, 3) += k * -F2_1;
 
-		d2E_dF_dF *= lmbd;
+	d2E_dF_dF(4, 6) += k * -F3_1;
+	d2E_dF_dF(6, 4) += k * -F3_1;
+	d2E_dF_dF(4, 8) += k * F1_1;
+	d2E_dF_dF(8, 4) += k * F1_1;
 
-		//d2E_dF_dF(0, 0) += miu;
-		//d2E_dF_dF(1, 1) += miu;
-		//d2E_dF_dF(2, 2) += miu;
-		//d2E_dF_dF(3, 3) += miu;
-		//d2E_dF_dF(4, 4) += miu;
-		//d2E_dF_dF(5, 5) += miu;
-		//d2E_dF_dF(6, 6) += miu;
-		//d2E_dF_dF(7, 7) += miu;
-		//d2E_dF_dF(8, 8) += miu;
+	d2E_dF_dF(5, 6) += k * F2_1;
+	d2E_dF_dF(6, 5) += k * F2_1;
+	d2E_dF_dF(5, 7) += k * -F1_1;
+	d2E_dF_dF(7, 5) += k * -F1_1;
 
-		d2E_dF_dF *= A;
+	d2E_dF_dF *= lmbd;
+
+	//d2E_dF_dF(0, 0) += miu;
+	//d2E_dF_dF(1, 1) += miu;
+	//d2E_dF_dF(2, 2) += miu;
+	//d2E_dF_dF(3, 3) += miu;
+	//d2E_dF_dF(4, 4) += miu;
+	//d2E_dF_dF(5, 5) += miu;
+	//d2E_dF_dF(6, 6) += miu;
+	//d2E_dF_dF(7, 7) += miu;
+	//d2E_dF_dF(8, 8) += miu;
+
+	d2E_dF_dF *= A;
 
 #ifdef PSD_FILTERING
-		Eigen::JacobiSVD<Mat9> svd(d2E_dF_dF, Eigen::ComputeFullU | Eigen::ComputeFullV);
+	Eigen::JacobiSVD<Mat9> svd(d2E_dF_dF, Eigen::ComputeFullU | Eigen::ComputeFullV);
 
-		Vec9 eigenVals = svd.singularValues();
+	Vec9 eigenVals = svd.singularValues();
 
-		Mat9 diagonalEV = Mat9::Zero();
-		for (size_t iDim = 0; iDim < 9; iDim++)
+	Mat9 diagonalEV = Mat9::Zero();
+	for (size_t iDim = 0; iDim < 9; iDim++)
+	{
+		if (eigenVals(iDim) > 0) diagonalEV(iDim, iDim) = eigenVals(iDim);
+		else
 		{
-			if (eigenVals(iDim) > 0) diagonalEV(iDim, iDim) = eigenVals(iDim);
-			else
-			{
-				//std::cout << "Negative Hessian ecountered: " << eigenVals.transpose() << "\n";
-			}
-			d2E_dF_dF = svd.matrixU() * diagonalEV * svd.matrixV().transpose();
+			//std::cout << "Negative Hessian ecountered: " << eigenVals.transpose() << "\n";
 		}
+		d2E_dF_dF = svd.matrixU() * diagonalEV * svd.matrixV().transpose();
+	}
 #endif // PSD_FILTERING
 
 
 
-		Vec9 dE_dF = A * (miu * dPhi_D_dF + lmbd * (detF - a) * ddetF_dF);
+	Vec9 dE_dF = A * (miu * dPhi_D_dF + lmbd * (detF - a) * ddetF_dF);
 
 
 
-		CFloatingType DmInv1_1 = DmInv(0, 0);
-		CFloatingType DmInv2_1 = DmInv(1, 0);
-		CFloatingType DmInv3_1 = DmInv(2, 0);
-		CFloatingType DmInv1_2 = DmInv(0, 1);
-		CFloatingType DmInv2_2 = DmInv(1, 1);
-		CFloatingType DmInv3_2 = DmInv(2, 1);
-		CFloatingType DmInv1_3 = DmInv(0, 2);
-		CFloatingType DmInv2_3 = DmInv(1, 2);
-		CFloatingType DmInv3_3 = DmInv(2, 2);
+	CFloatingType DmInv1_1 = DmInv(0, 0);
+	CFloatingType DmInv2_1 = DmInv(1, 0);
+	CFloatingType DmInv3_1 = DmInv(2, 0);
+	CFloatingType DmInv1_2 = DmInv(0, 1);
+	CFloatingType DmInv2_2 = DmInv(1, 1);
+	CFloatingType DmInv3_2 = DmInv(2, 1);
+	CFloatingType DmInv1_3 = DmInv(0, 2);
+	CFloatingType DmInv2_3 = DmInv(1, 2);
+	CFloatingType DmInv3_3 = DmInv(2, 2);
 
-		int vertedTetVId = getVertexNeighborTetVertexOrder(iV, iNeiTet);
+	Eigen::Matrix<FloatingType, 9, 3> dF_dxi;
+	Vec3 dE_dxi;
+	Mat3 d2E_dxi_dxi;
+	FloatingType m1, m2, m3;
 
-		Eigen::Matrix<FloatingType, 9, 3> dF_dxi;
-		Vec3 dE_dxi;
-		Mat3 d2E_dxi_dxi;
-		FloatingType m1, m2, m3;
+	switch (vertedTetVId)
+	{
+	case 0:
+		m1 = -DmInv1_1 - DmInv2_1 - DmInv3_1;
+		m2 = -DmInv1_2 - DmInv2_2 - DmInv3_2;
+		m3 = -DmInv1_3 - DmInv2_3 - DmInv3_3;
+		break;
+
+	case 1:
+		m1 = DmInv1_1;
+		m2 = DmInv1_2;
+		m3 = DmInv1_3;
+		break;
+	case 2:
+		m1 = DmInv2_1;
+		m2 = DmInv2_2;
+		m3 = DmInv2_3;
+		break;
+
+	case 3:
+		m1 = DmInv3_1;
+		m2 = DmInv3_2;
+		m3 = DmInv3_3;
+		break;
+	default:
+		break;
+	}
+	assembleVertexVForceAndHessian(dE_dF, d2E_dF_dF, m1, m2, m3, dE_dxi, d2E_dxi_dxi);
+	Mat3 dampingH = d2E_dxi_dxi * material.dampingHydrostatic;
+	FloatingType tmp = (m1 * m1 + m2 * m2 + m3 * m3) * miu * A;
+	d2E_dxi_dxi(0, 0) += tmp;
+	d2E_dxi_dxi(1, 1) += tmp;
+	d2E_dxi_dxi(2, 2) += tmp;
+	tmp *= material.dampingDeviatoric;
+	dampingH(0, 0) += tmp;
+	dampingH(1, 1) += tmp;
+	dampingH(2, 2) += tmp;
+	dampingH /= pPhysicsParams->dt;
+	Vec3 dampingForce = dampingH * displacement;
+	force -= dE_dxi + dampingForce;
+	hessian += d2E_dxi_dxi + dampingH;
+}
 
-		switch (vertedTetVId)
+void GAIA::VBDTetMeshNeoHookean::accumlateMaterialForceAndHessian2Packed(int iV, const VBDPackedTetData& packedTetData, IdType recordId, 
+	Vec3& force, Mat3& hessian)
+{
+	Vec3 displacement = vertex(iV) - vertexPrevPos(iV);
+	const IdType neiTetsEnd = packedTetData.recordNeiTetOffsets[recordId + 1];
+
+	for (IdType iNeiTet = packedTetData.recordNeiTetOffsets[recordId]; iNeiTet < neiTetsEnd; iNeiTet++)
+	{
+		const int vertedTetVId = packedTetData.neiTetVertexOrders[iNeiTet];
+		const IdType* otherVIds = packedTetData.neiTetOtherVIds.data() + 3 * iNeiTet;
+		IdType tetVIds[4];
+		for (int iTetV = 0, iOther = 0; iTetV < 4; iTetV++)
 		{
-		case 0:
-			m1 = -DmInv1_1 - DmInv2_1 - DmInv3_1;
-			m2 = -DmInv1_2 - DmInv2_2 - DmInv3_2;
-			m3 = -DmInv1_3 - DmInv2_3 - DmInv3_3;
-			break;
+			tetVIds[iTetV] = iTetV == vertedTetVId ? iV : otherVIds[iOther++];
+		}
 
-		case 1:
-			m1 = DmInv1_1;
-			m2 = DmInv1_2;
-			m3 = DmInv1_3;
-			break;
-		case 2:
-			m1 = DmInv2_1;
-			m2 = DmInv2_2;
-			m3 = DmInv2_3;
-			break;
+		Mat3 Ds;
+		auto v1 = vertex(tetVIds[0]);
+		for (size_t iCol = 0; iCol < 3; iCol++)
+		{
+			Ds.col(iCol) = vertex(tetVIds[iCol + 1]) - v1;
+		}
 
-		case 3:
-			m1 = DmInv3_1;
-			m2 = DmInv3_2;
-			m3 = DmInv3_3;
-			break;
-		default:
-			break;
+		Eigen::Map<const Mat3> DmInv(packedTetData.neiTetDmInvs.data() + 9 * iNeiTet);
+		accumlateTetMaterialForceAndHessian2(Ds, DmInv, packedTetData.neiTetRestVolumes[iNeiTet], vertedTetVId, displacement, force, hessian);
+	}
+}
+
+void GAIA::VBDTetMeshNeoHookean::accumlateMaterialForceAndHessian2SIMD(int iV, Vec3& force, Mat3& hessian)
+{
+#ifdef PSD_FILTERING
+	// the PSD projection of the per tet 9x9 hessian is not vectorized, keep the results identical to the scalar kernel
+	accumlateMaterialForceAndHessian2(iV, force, hessian);
+	return;
+#endif // PSD_FILTERING
+
+	typedef embree::vfloat<VBD_SIMD_WIDTH> vfloatN;
+
+	const int numNeiTets = getNumVertexNeighborTets(iV);
+	const auto& material = ObjectParametersMaterial();
+	CFloatingType miu = material.miu;
+	CFloatingType lmbd = material.lmbd;
+	CFloatingType a = 1 + miu / lmbd;
+	Vec3 displacement = vertex(iV) - vertexPrevPos(iV);
+
+	// SoA gather buffers, one lane per neighbor tet, all matrices are column major
+	alignas(64) FloatingType DmInvSoA[9][VBD_SIMD_WIDTH];
+	alignas(64) FloatingType DsSoA[9][VBD_SIMD_WIDTH];
+	alignas(64) FloatingType mSoA[3][VBD_SIMD_WIDTH];
+	alignas(64) FloatingType ASoA[VBD_SIMD_WIDTH];
+
+	vfloatN dE_dxi[3] = { vfloatN(embree::zero), vfloatN(embree::zero), vfloatN(embree::zero) };
+	// upper triangle of the hydrostatic hessian: 00, 01, 02, 11, 12, 22
+	vfloatN hHydrostatic[6] = { vfloatN(embree::zero), vfloatN(embree::zero), vfloatN(embree::zero),
+		vfloatN(embree::zero), vfloatN(embree::zero), vfloatN(embree::zero) };
+	// the deviatoric hessian is a multiple of the identity
+	vfloatN hDeviatoric = vfloatN(embree::zero);
+
+	for (int iBatch = 0; iBatch < numNeiTets; iBatch += VBD_SIMD_WIDTH)
+	{
+		const int numLanes = std::min(VBD_SIMD_WIDTH, numNeiTets - iBatch);
+		for (int iLane = 0; iLane < VBD_SIMD_WIDTH; iLane++)
+		{
+			if (iLane >= numLanes)
+			{
+				// padding lanes have zero volume and contribute nothing
+				for (int iEntry = 0; iEntry < 9; iEntry++)
+				{
+					DmInvSoA[iEntry][iLane] = 0.f;
+					DsSoA[iEntry][iLane] = 0.f;
+				}
+				mSoA[0][iLane] = mSoA[1][iLane] = mSoA[2][iLane] = 0.f;
+				ASoA[iLane] = 0.f;
+				continue;
+			}
+
+			const int iNeiTet = iBatch + iLane;
+			IdType tetId = getVertexNeighborTet(iV, iNeiTet);
+			auto DmInv = getDmInv(tetId);
+			Mat3 Ds;
+			computeDs(Ds, tetId);
+			for (int iEntry = 0; iEntry < 9; iEntry++)
+			{
+				DmInvSoA[iEntry][iLane] = DmInv.data()[iEntry];
+				DsSoA[iEntry][iLane] = Ds.data()[iEntry];
+			}
+			ASoA[iLane] = tetRestVolume(tetId);
+
+			// m = dF/dxi, see accumlateMaterialForceAndHessian2
+			int vertedTetVId = getVertexNeighborTetVertexOrder(iV, iNeiTet);
+			for (int iCol = 0; iCol < 3; iCol++)
+			{
+				mSoA[iCol][iLane] = vertedTetVId == 0 ? -DmInv(0, iCol) - DmInv(1, iCol) - DmInv(2, iCol) : DmInv(vertedTetVId - 1, iCol);
+			}
 		}
-		assembleVertexVForceAndHessian(dE_dF, d2E_dF_dF, m1, m2, m3, dE_dxi, d2E_dxi_dxi);
-		Mat3 dampingH = d2E_dxi_dxi * material.dampingHydrostatic;
-		FloatingType tmp = (m1 * m1 + m2 * m2 + m3 * m3) * miu * A;
-		d2E_dxi_dxi(0, 0) += tmp;
-		d2E_dxi_dxi(1, 1) += tmp;
-		d2E_dxi_dxi(2, 2) += tmp;
-		tmp *= material.dampingDeviatoric;
-		dampingH(0, 0) += tmp;
-		dampingH(1, 1) += tmp;
-		dampingH(2, 2) += tmp;
-		dampingH /= pPhysicsParams->dt;
-		Vec3 dampingForce = dampingH * displacement;
-		force -= dE_dxi + dampingForce;
-		hessian += d2E_dxi_dxi + dampingH;
 
-		//printf("dE_dF of tet %d:\n", tetId);
-		//std::cout << dE_dF.transpose() << "\n";
-		//printf("force of tet %d:\n-------------\n", tetId);
-		//std::cout << force.transpose() << "\n";
+		vfloatN DmInvV[9], DsV[9], F[9];
+		for (int iEntry = 0; iEntry < 9; iEntry++)
+		{
+			DmInvV[iEntry] = vfloatN::load(DmInvSoA[iEntry]);
+			DsV[iEntry] = vfloatN::load(DsSoA[iEntry]);
+		}
+		const vfloatN m1 = vfloatN::load(mSoA[0]);
+		const vfloatN m2 = vfloatN::load(mSoA[1]);
+		const vfloatN m3 = vfloatN::load(mSoA[2]);
+		const vfloatN A = vfloatN::load(ASoA);
+
+		// F = Ds * DmInv
+		for (int iRow = 0; iRow < 3; iRow++)
+		{
+			for (int iCol = 0; iCol < 3; iCol++)
+			{
+				F[iRow + 3 * iCol] = DsV[iRow] * DmInvV[3 * iCol] + DsV[iRow + 3] * DmInvV[3 * iCol + 1] + DsV[iRow + 6] * DmInvV[3 * iCol + 2];
+			}
+		}
+
+		const vfloatN& F1_1 = F[0];
+		const vfloatN& F2_1 = F[1];
+		const vfloatN& F3_1 = F[2];
+		const vfloatN& F1_2 = F[3];
+		const vfloatN& F2_2 = F[4];
+		const vfloatN& F3_2 = F[5];
+		const vfloatN& F1_3 = F[6];
+		const vfloatN& F2_3 = F[7];
+		const vfloatN& F3_3 = F[8];
+
+		// ddetF_dF, the cofactor matrix of F
+		vfloatN ddetF_dF[9];
+		ddetF_dF[0] = F2_2 * F3_3 - F2_3 * F3_2;
+		ddetF_dF[1] = F1_3 * F3_2 - F1_2 * F3_3;
+		ddetF_dF[2] = F1_2 * F2_3 - F1_3 * F2_2;
+		ddetF_dF[3] = F2_3 * F3_1 - F2_1 * F3_3;
+		ddetF_dF[4] = F1_1 * F3_3 - F1_3 * F3_1;
+		ddetF_dF[5] = F1_3 * F2_1 - F1_1 * F2_3;
+		ddetF_dF[6] = F2_1 * F3_2 - F2_2 * F3_1;
+		ddetF_dF[7] = F1_2 * F3_1 - F1_1 * F3_2;
+		ddetF_dF[8] = F1_1 * F2_2 - F1_2 * F2_1;
+
+		const vfloatN detF = F1_1 * ddetF_dF[0] + F2_1 * ddetF_dF[1] + F3_1 * ddetF_dF[2];
+		const vfloatN miuA = A * miu;
+		const vfloatN lmbdA = A * lmbd;
+		const vfloatN lmbdAk = lmbdA * (detF - a);
+
+		for (int iDim = 0; iDim < 3; iDim++)
+		{
+			// dE_dF = A * (miu * F + lmbd * (detF - a) * ddetF_dF), contracted with m
+			const vfloatN dE_dF1 = miuA * F[iDim] + lmbdAk * ddetF_dF[iDim];
+			const vfloatN dE_dF2 = miuA * F[iDim + 3] + lmbdAk * ddetF_dF[iDim + 3];
+			const vfloatN dE_dF3 = miuA * F[iDim + 6] + lmbdAk * ddetF_dF[iDim + 6];
+			dE_dxi[iDim] += dE_dF1 * m1 + dE_dF2 * m2 + dE_dF3 * m3;
+		}
+
+		// the hydrostatic part of d2E_dF_dF is lmbd * A * (ddetF_dF * ddetF_dF^T + (detF - a) * d2detF_dF_dF);
+		// the second term vanishes after being contracted with m on both sides, because detF is linear in each vertex
+		const vfloatN gm1 = ddetF_dF[0] * m1 + ddetF_dF[3] * m2 + ddetF_dF[6] * m3;
+		const vfloatN gm2 = ddetF_dF[1] * m1 + ddetF_dF[4] * m2 + ddetF_dF[7] * m3;
+		const vfloatN gm3 = ddetF_dF[2] * m1 + ddetF_dF[5] * m2 + ddetF_dF[8] * m3;
+		hHydrostatic[0] += lmbdA * gm1 * gm1;
+		hHydrostatic[1] += lmbdA * gm1 * gm2;
+		hHydrostatic[2] += lmbdA * gm1 * gm3;
+		hHydrostatic[3] += lmbdA * gm2 * gm2;
+		hHydrostatic[4] += lmbdA * gm2 * gm3;
+		hHydrostatic[5] += lmbdA * gm3 * gm3;
+
+		hDeviatoric += miuA * (m1 * m1 + m2 * m2 + m3 * m3);
 	}
+
+	Vec3 dE_dxiSum;
+	dE_dxiSum << embree::reduce_add(dE_dxi[0]), embree::reduce_add(dE_dxi[1]), embree::reduce_add(dE_dxi[2]);
+
+	Mat3 d2E_dxi_dxi;
+	d2E_dxi_dxi(0, 0) = embree::reduce_add(hHydrostatic[0]);
+	d2E_dxi_dxi(0, 1) = d2E_dxi_dxi(1, 0) = embree::reduce_add(hHydrostatic[1]);
+	d2E_dxi_dxi(0, 2) = d2E_dxi_dxi(2, 0) = embree::reduce_add(hHydrostatic[2]);
+	d2E_dxi_dxi(1, 1) = embree::reduce_add(hHydrostatic[3]);
+	d2E_dxi_dxi(1, 2) = d2E_dxi_dxi(2, 1) = embree::reduce_add(hHydrostatic[4]);
+	d2E_dxi_dxi(2, 2) = embree::reduce_add(hHydrostatic[5]);
+
+	// damping is linear in the hessian of each tet, thus can be applied to the sums
+	Mat3 dampingH = d2E_dxi_dxi * material.dampingHydrostatic;
+	FloatingType tmp = embree::reduce_add(hDeviatoric);
+	d2E_dxi_dxi(0, 0) += tmp;
+	d2E_dxi_dxi(1, 1) += tmp;
+	d2E_dxi_dxi(2, 2) += tmp;
+	tmp *= material.dampingDeviatoric;
+	dampingH(0, 0) += tmp;
+	dampingH(1, 1) += tmp;
+	dampingH(2, 2) += tmp;
+	dampingH /= pPhysicsParams->dt;
+	Vec3 dampingForce = dampingH * displacement;
+	force -= dE_dxiSum + dampingForce;
+	hessian += d2E_dxi_dxi + dampingH;
 }
 
 // old version, use densit matmul
@@ -1626,6 +1818,30 @@ void GAIA::VBDTetMeshNeoHookean::validateElasticGradientHessianF(int tetId)
 	}
 }
 
+void GAIA::VBDTetMeshNeoHookean::validateMaterialForceAndHessianSIMD(int iV)
+{
+	Vec3 force = Vec3::Zero();
+	Mat3 hessian = Mat3::Zero();
+	Vec3 forceSIMD = Vec3::Zero();
+	Mat3 hessianSIMD = Mat3::Zero();
+	accumlateMaterialForceAndHessian2(iV, force, hessian);
+	accumlateMaterialForceAndHessian2SIMD(iV, forceSIMD, hessianSIMD);
+
+	// the two kernels sum in different orders, compare relatively
+	FloatingType forceDiff = (force - forceSIMD).norm() / std::max(force.norm(), FloatingType(1.f));
+	FloatingType hessianDiff = (hessian - hessianSIMD).norm() / std::max(hessian.norm(), FloatingType(1.f));
+	if (forceDiff > 1e-4f) {
+		std::cout << "SIMD material force mismatch at vertex " << iV << ":\n";
+		std::cout << force.transpose() << std::endl;
+		std::cout << forceSIMD.transpose() << std::endl;
+	}
+	if (hessianDiff > 1e-4f) {
+		std::cout << "SIMD material hessian mismatch at vertex " << iV << ":\n";
+		std::cout << hessian << std::endl;
+		std::cout << hessianSIMD << std::endl;
+	}
+}
+
 bool GAIA::ObjectParametersVBDNeoHookean::fromJson(nlohmann::json& objectJsonParams)
 {
 	ObjectParamsVBD::fromJson(objectJsonParams);
@@ -7,7 +7,14 @@
 
 #include "../TetMesh/TetMeshFEMShared.h"
 #include "VBD_NeoHookeanGPU.h"
+#include "VBDPackedTetData.h"
 
+// number of neighbor tets evaluated at once by the SIMD material kernel: AVX's vfloat8 or SSE's vfloat4
+#if defined(__AVX__)
+#define VBD_SIMD_WIDTH 8
+#else
+#define VBD_SIMD_WIDTH 4
+#endif
 
 
 namespace GAIA {
@@ -52,6 +59,13 @@ namespace GAIA {
 		FloatingType evaluateVertexMeritEnergy(int iV, FloatingType& meInertia, FloatingType& meElastic_bending);
 		virtual void accumlateMaterialForceAndHessian(int iV, Vec3& force, Mat3& hessian);
 		virtual void accumlateMaterialForceAndHessian2(int iV, Vec3& force, Mat3& hessian);
+		// same as accumlateMaterialForceAndHessian2, but evaluates VBD_SIMD_WIDTH neighbor tets at once
+		void accumlateMaterialForceAndHessian2SIMD(int iV, Vec3& force, Mat3& hessian);
+		// same as accumlateMaterialForceAndHessian2, but reads the neighbor tets from record recordId of packedTetData
+		void accumlateMaterialForceAndHessian2Packed(int iV, const VBDPackedTetData& packedTetData, IdType recordId, Vec3& force, Mat3& hessian);
+		// the contribution of a single neighbor tet, in which iV has the order vertedTetVId
+		void accumlateTetMaterialForceAndHessian2(const Mat3& Ds, const Mat3& DmInv, CFloatingType A, int vertedTetVId,
+			const Vec3& displacement, Vec3& force, Mat3& hessian);
 		virtual void accumlateMaterialForce(int iV, Vec3& force);
 		virtual void computeElasticForceHessian(int tetId, FloatingType& energy, Vec12& force, Mat12& hessian);
 		virtual void computeElasticForceHessianDouble(int tetId, double& energy, Eigen::Vector<double, 12>& force, Eigen::Matrix<double, 12, 12>& hessian);
@@ -59,6 +73,7 @@ namespace GAIA {
 		virtual void computeElasticGradientHessianFDouble(const Eigen::Matrix3d& F, double& energy, Eigen::Vector<double, 9>& gradient, Eigen::Matrix<double, 9, 9>& hessian);
 		void validateElasticForceHessian(int tetId);
 		void validateElasticGradientHessianF(int tetId);
+		void validateMaterialForceAndHessianSIMD(int iV);
 
 		template<typename T>
 		inline void computeElasticEnergy(int tetId, T& energy)
@@ -20,7 +20,21 @@ int main(int argc, char** argv) {
 	InputHandler<GAIA::PBDPhysics> inputHanlder;
 	inputHanlder.handleInput(inModelInputFile, inParameterFile, outFolder, parser, physics);
 
-	physics.initializeGPU();
+#ifdef GAIA_NO_CUDA
+	if (!parser.runOnCPU)
+	{
+		std::cout << "Warning! GAIA is built without CUDA (GAIA_WITH_CUDA=OFF), the GPU solver is unavailable. "
+			<< "Falling back to the CPU PBD solver.\n";
+		parser.runOnCPU = true;
+	}
+#endif // GAIA_NO_CUDA
+
+	physics.initialize();
+#ifndef GAIA_NO_CUDA
+	if (!parser.runOnCPU) {
+		physics.initializeGPU();
+	}
+#endif // !GAIA_NO_CUDA
 
 	if (parser.recoveryStateFile != "")
 	{
@@ -28,11 +42,13 @@ int main(int argc, char** argv) {
 	}
 
 	if (parser.runOnCPU) {
-		physics.simulateGPU_debugOnCPU();
+		physics.simulateCPU();
 	}
+#ifndef GAIA_NO_CUDA
 	else
 	{
 		physics.simulateGPU();
 	}
+#endif // !GAIA_NO_CUDA
 
 }
\ No newline at end of file
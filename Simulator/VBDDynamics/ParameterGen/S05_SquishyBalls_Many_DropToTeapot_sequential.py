@@ -118,7 +118,6 @@ if __name__ == '__main__':
     parameters["PhysicsParams"]["outputExt"] = "bin"
     parameters["PhysicsParams"]["binaryModeVisualizationSteps"] = 100
     # parameters["PhysicsParams"]["binaryModeVisualizationSteps"] = 50
-    parameters["PhysicsParams"]["collisionOffHeight"] = 60
 
     # parameters["PhysicsParams"]["saveOutputs"] = False # turn on to output files
     parameters["ViewerParams"] = {